@@ -920,6 +920,12 @@ bool audio_driver_find_driver(void)
    driver_ctx_info_t drv;
    settings_t *settings = config_get_ptr();
 
+   if (rarch_ctl(RARCH_CTL_IS_HEADLESS, NULL))
+   {
+      current_audio = &audio_null;
+      return true;
+   }
+
    drv.label = "audio_driver";
    drv.s     = settings->arrays.audio_driver;
 
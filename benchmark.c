@@ -0,0 +1,299 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+
+#include "benchmark.h"
+#include "core.h"
+#include "performance_counters.h"
+#include "retroarch.h"
+#include "verbosity.h"
+
+#include "gfx/video_driver.h"
+
+enum benchmark_counter
+{
+   BENCHMARK_RETRO_RUN = 0,
+   BENCHMARK_VIDEO_REFRESH,
+   BENCHMARK_AUDIO_SAMPLE,
+   BENCHMARK_AUDIO_SAMPLE_BATCH,
+   BENCHMARK_INPUT_STATE,
+   BENCHMARK_INPUT_POLL,
+   BENCHMARK_COUNTER_LAST
+};
+
+/* Ticks of the callbacks include whatever the frontend does
+ * with the data, i.e. the null drivers in headless mode. */
+static struct retro_perf_counter benchmark_perf[BENCHMARK_COUNTER_LAST] = {
+   { "retro_run" },
+   { "retro_video_refresh" },
+   { "retro_audio_sample" },
+   { "retro_audio_sample_batch" },
+   { "retro_input_state" },
+   { "retro_input_poll" },
+};
+
+static retro_video_refresh_t      benchmark_frame_cb        = NULL;
+static retro_audio_sample_t       benchmark_sample_cb       = NULL;
+static retro_audio_sample_batch_t benchmark_sample_batch_cb = NULL;
+static retro_input_state_t        benchmark_state_cb        = NULL;
+static retro_input_poll_t         benchmark_poll_cb         = NULL;
+
+static bool         benchmark_enabled      = false;
+static bool         benchmark_reported     = false;
+static unsigned     benchmark_frames       = 0;
+static unsigned     benchmark_frames_run   = 0;
+static retro_time_t benchmark_start_usec   = 0;
+static retro_time_t benchmark_run_usec     = 0;
+
+#define BENCHMARK_BEGIN(id) \
+   benchmark_perf[id].call_cnt++; \
+   benchmark_perf[id].start = cpu_features_get_perf_counter()
+
+#define BENCHMARK_END(id) \
+   benchmark_perf[id].total += cpu_features_get_perf_counter() \
+      - benchmark_perf[id].start
+
+static void benchmark_video_refresh(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   BENCHMARK_BEGIN(BENCHMARK_VIDEO_REFRESH);
+   benchmark_frame_cb(data, width, height, pitch);
+   BENCHMARK_END(BENCHMARK_VIDEO_REFRESH);
+}
+
+static void benchmark_audio_sample(int16_t left, int16_t right)
+{
+   BENCHMARK_BEGIN(BENCHMARK_AUDIO_SAMPLE);
+   benchmark_sample_cb(left, right);
+   BENCHMARK_END(BENCHMARK_AUDIO_SAMPLE);
+}
+
+static size_t benchmark_audio_sample_batch(const int16_t *data,
+      size_t frames)
+{
+   size_t ret;
+
+   BENCHMARK_BEGIN(BENCHMARK_AUDIO_SAMPLE_BATCH);
+   ret = benchmark_sample_batch_cb(data, frames);
+   BENCHMARK_END(BENCHMARK_AUDIO_SAMPLE_BATCH);
+
+   return ret;
+}
+
+static int16_t benchmark_input_state(unsigned port,
+      unsigned device, unsigned idx, unsigned id)
+{
+   int16_t ret;
+
+   BENCHMARK_BEGIN(BENCHMARK_INPUT_STATE);
+   ret = benchmark_state_cb(port, device, idx, id);
+   BENCHMARK_END(BENCHMARK_INPUT_STATE);
+
+   return ret;
+}
+
+static void benchmark_input_poll(void)
+{
+   BENCHMARK_BEGIN(BENCHMARK_INPUT_POLL);
+   benchmark_poll_cb();
+   BENCHMARK_END(BENCHMARK_INPUT_POLL);
+}
+
+void benchmark_init(unsigned frames)
+{
+   unsigned i;
+
+   for (i = 0; i < BENCHMARK_COUNTER_LAST; i++)
+   {
+      benchmark_perf[i].call_cnt = 0;
+      benchmark_perf[i].total    = 0;
+   }
+
+   benchmark_enabled    = true;
+   benchmark_reported   = false;
+   benchmark_frames     = frames;
+   benchmark_frames_run = 0;
+   benchmark_start_usec = 0;
+   benchmark_run_usec   = 0;
+}
+
+bool benchmark_is_enabled(void)
+{
+   return benchmark_enabled;
+}
+
+void benchmark_wrap_callbacks(
+      retro_video_refresh_t *frame_cb,
+      retro_audio_sample_t *sample_cb,
+      retro_audio_sample_batch_t *sample_batch_cb,
+      retro_input_state_t *state_cb,
+      retro_input_poll_t *poll_cb)
+{
+   if (!benchmark_enabled)
+      return;
+
+   benchmark_frame_cb        = *frame_cb;
+   benchmark_sample_cb       = *sample_cb;
+   benchmark_sample_batch_cb = *sample_batch_cb;
+   benchmark_state_cb        = *state_cb;
+   benchmark_poll_cb         = *poll_cb;
+
+   *frame_cb                 = benchmark_video_refresh;
+   *sample_cb                = benchmark_audio_sample;
+   *sample_batch_cb          = benchmark_audio_sample_batch;
+   *state_cb                 = benchmark_input_state;
+   *poll_cb                  = benchmark_input_poll;
+}
+
+void benchmark_core_run_begin(void)
+{
+   if (!benchmark_enabled)
+      return;
+
+   if (!benchmark_start_usec)
+   {
+      unsigned i;
+
+      /* Show up with the frontend counters as well. */
+      for (i = 0; i < BENCHMARK_COUNTER_LAST; i++)
+         rarch_perf_register(&benchmark_perf[i]);
+
+      benchmark_start_usec = cpu_features_get_time_usec();
+   }
+
+   BENCHMARK_BEGIN(BENCHMARK_RETRO_RUN);
+}
+
+void benchmark_core_run_end(void)
+{
+   if (!benchmark_enabled || !benchmark_start_usec)
+      return;
+
+   BENCHMARK_END(BENCHMARK_RETRO_RUN);
+
+   benchmark_frames_run++;
+   benchmark_run_usec = cpu_features_get_time_usec() - benchmark_start_usec;
+}
+
+static bool benchmark_frame_crc(uint32_t *crc)
+{
+   unsigned y, width, height;
+   size_t pitch, row_size;
+   const void *data = NULL;
+   unsigned bpp     = video_driver_get_pixel_format()
+      == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2;
+
+   video_driver_cached_frame_get(&data, &width, &height, &pitch);
+
+   if (!data || data == RETRO_HW_FRAME_BUFFER_VALID)
+      return false;
+
+   /* Only the visible part of each line, padding is
+    * not guaranteed to be deterministic. */
+   row_size = width * bpp;
+   *crc     = 0;
+
+   for (y = 0; y < height; y++)
+      *crc  = encoding_crc32(*crc,
+            (const uint8_t*)data + y * pitch, row_size);
+
+   return true;
+}
+
+static bool benchmark_state_crc(uint32_t *crc)
+{
+   retro_ctx_size_info_t info;
+   retro_ctx_serialize_info_t serial_info;
+   void *buf = NULL;
+   bool ret  = false;
+
+   core_serialize_size(&info);
+
+   if (!info.size || !(buf = malloc(info.size)))
+      return false;
+
+   serial_info.data = buf;
+   serial_info.size = info.size;
+
+   if (core_serialize(&serial_info))
+   {
+      *crc = encoding_crc32(0, (const uint8_t*)buf, info.size);
+      ret  = true;
+   }
+
+   free(buf);
+   return ret;
+}
+
+void benchmark_report(void)
+{
+   unsigned i;
+   uint32_t crc;
+   double seconds;
+   retro_perf_tick_t run_ticks;
+
+   if (!benchmark_enabled || benchmark_reported)
+      return;
+
+   benchmark_reported = true;
+   seconds            = benchmark_run_usec / 1000000.0;
+   run_ticks          = benchmark_perf[BENCHMARK_RETRO_RUN].total;
+
+   if (benchmark_frames && benchmark_frames_run < benchmark_frames)
+      RARCH_WARN("[Benchmark]: Stopped after %u of %u frames.\n",
+            benchmark_frames_run, benchmark_frames);
+
+   printf("benchmark.frames: %u\n", benchmark_frames_run);
+   printf("benchmark.seconds: %.3f\n", seconds);
+   printf("benchmark.fps: %.2f\n",
+         seconds > 0.0 ? benchmark_frames_run / seconds : 0.0);
+
+   /* Callback totals are a share of retro_run, which they
+    * are called from. */
+   for (i = 0; i < BENCHMARK_COUNTER_LAST; i++)
+   {
+      const struct retro_perf_counter *perf = &benchmark_perf[i];
+
+      if (!perf->call_cnt)
+         continue;
+
+      printf("benchmark.%s: %llu calls, %llu ticks/call, %.1f%%\n",
+            perf->ident,
+            (unsigned long long)perf->call_cnt,
+            (unsigned long long)(perf->total / perf->call_cnt),
+            run_ticks ? 100.0 * perf->total / run_ticks : 0.0);
+   }
+
+   if (benchmark_frame_crc(&crc))
+      printf("benchmark.frame_crc32: %08x\n", crc);
+   else
+      printf("benchmark.frame_crc32: none\n");
+
+   if (benchmark_state_crc(&crc))
+      printf("benchmark.state_crc32: %08x\n", crc);
+   else
+      printf("benchmark.state_crc32: none\n");
+
+   fflush(stdout);
+
+   rarch_perf_log();
+}
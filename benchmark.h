@@ -0,0 +1,69 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_BENCHMARK_H
+#define __RARCH_BENCHMARK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/**
+ * benchmark_init:
+ * @frames             : Number of frames to run.
+ *
+ * Enables benchmark mode. The core callbacks are timed
+ * while the core runs and a report is printed by
+ * benchmark_report().
+ **/
+void benchmark_init(unsigned frames);
+
+bool benchmark_is_enabled(void);
+
+/**
+ * benchmark_wrap_callbacks:
+ *
+ * Replaces the given core callbacks by timed wrappers
+ * calling them. Does nothing unless benchmark mode is on.
+ **/
+void benchmark_wrap_callbacks(
+      retro_video_refresh_t *frame_cb,
+      retro_audio_sample_t *sample_cb,
+      retro_audio_sample_batch_t *sample_batch_cb,
+      retro_input_state_t *state_cb,
+      retro_input_poll_t *poll_cb);
+
+void benchmark_core_run_begin(void);
+
+void benchmark_core_run_end(void);
+
+/**
+ * benchmark_report:
+ *
+ * Prints frames per second, callback timings and hashes of
+ * the last frame and of the core state to stdout. Needs the
+ * core to still be loaded. Only reports once.
+ **/
+void benchmark_report(void);
+
+RETRO_END_DECLS
+
+#endif
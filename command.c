@@ -16,6 +16,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
@@ -128,6 +129,9 @@ struct command
 #endif
 };
 
+static bool command_movie_seek(const char *arg);
+static bool command_perf_export(const char *arg);
+
 #if defined(HAVE_COMMAND) && defined(HAVE_CHEEVOS)
 static bool command_read_ram(const char *arg);
 static bool command_write_ram(const char *arg);
@@ -135,6 +139,8 @@ static bool command_write_ram(const char *arg);
 
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER",      command_set_shader,  "<shader path>" },
+   { "MOVIE_SEEK",      command_movie_seek,  "<frame>" },
+   { "PERF_EXPORT",     command_perf_export, "<json|trace> <path>" },
 #if defined(HAVE_COMMAND) && defined(HAVE_CHEEVOS)
    { "READ_CORE_RAM",   command_read_ram,    "<address> <number of bytes>" },
    { "WRITE_CORE_RAM",  command_write_ram,   "<address> <byte1> <byte2> ..." },
@@ -243,6 +249,41 @@ bool command_set_shader(const char *arg)
    return menu_shader_manager_set_preset(shader, type, arg);
 }
 
+static bool command_movie_seek(const char *arg)
+{
+   char *end      = NULL;
+   unsigned frame = (unsigned)strtoul(arg, &end, 10);
+
+   if (end == arg)
+      return false;
+
+   return bsv_movie_seek(frame);
+}
+
+static bool command_perf_export(const char *arg)
+{
+   bool ret         = false;
+   const char *path = strchr(arg, ' ');
+
+   if (!path || !*++path)
+      return false;
+
+   if (!strncmp(arg, "json ", 5))
+      ret = performance_counters_export_json(path);
+   else if (!strncmp(arg, "trace ", 6))
+      ret = performance_counters_export_trace(path);
+   else
+      return false;
+
+   if (ret)
+      RARCH_LOG("[PERF]: Exported performance counters to \"%s\".\n", path);
+   else
+      RARCH_ERR("[PERF]: Could not export performance counters to \"%s\", "
+            "are performance counters enabled?\n", path);
+
+   return ret;
+}
+
 #if defined(HAVE_COMMAND) && defined(HAVE_CHEEVOS)
 static bool command_read_ram(const char *arg)
 {
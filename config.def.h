@@ -74,6 +74,7 @@ static const int crt_switch_resolution_super = 2560;
 static const bool def_history_list_enable = true;
 static const bool def_playlist_entry_remove = true;
 static const bool def_playlist_entry_rename = true;
+static const bool def_playlist_use_binary = false;
 
 static const unsigned int def_user_language = 0;
 
@@ -163,6 +164,17 @@ static const unsigned hard_sync_frames = 0;
  */
 static const unsigned frame_delay = 0;
 
+/* Picks the frame delay automatically from measured core run
+ * and video swap times instead of using frame_delay.
+ */
+static const bool frame_delay_auto = false;
+
+/* Spins for the last fraction of a millisecond of each
+ * frame limiter wait instead of sleeping it off. More
+ * precise frame pacing, at the cost of some CPU time.
+ */
+static const bool frame_limit_spin = false;
+
 /* Inserts a black frame inbetween frames.
  * Useful for 120 Hz monitors who want to play 60 Hz material with eliminated
  * ghosting. video_refresh_rate should still be configured as if it
@@ -423,6 +435,10 @@ static const bool video_shader_watch_files = false;
 /* Screenshots named automatically. */
 static const bool auto_screenshot_filename = true;
 
+/* Image format of screenshots: png, bmp, tga or qoi.
+ * Savestate thumbnails are always PNG. */
+static const char *screenshot_format = "png";
+
 /* Record post-shaded GPU output instead of raw game footage if available. */
 static const bool gpu_record = false;
 
@@ -278,6 +278,7 @@ enum menu_driver_enum
 enum record_driver_enum
 {
    RECORD_FFMPEG            = MENU_NULL + 1,
+   RECORD_RDIFF,
    RECORD_NULL
 };
 
@@ -383,7 +384,7 @@ static enum audio_resampler_driver_enum AUDIO_DEFAULT_RESAMPLER_DRIVER = AUDIO_R
 #if defined(HAVE_FFMPEG)
 static enum record_driver_enum RECORD_DEFAULT_DRIVER = RECORD_FFMPEG;
 #else
-static enum record_driver_enum RECORD_DEFAULT_DRIVER = RECORD_NULL;
+static enum record_driver_enum RECORD_DEFAULT_DRIVER = RECORD_RDIFF;
 #endif
 
 #if defined(XENON)
@@ -648,6 +649,8 @@ const char *config_get_default_record(void)
    {
       case RECORD_FFMPEG:
          return "ffmpeg";
+      case RECORD_RDIFF:
+         return "rdiff";
       case RECORD_NULL:
          break;
    }
@@ -1046,6 +1049,7 @@ static struct config_array_setting *populate_settings_array(settings_t *settings
    SETTING_ARRAY("bundle_assets_dst_path_subdir", settings->arrays.bundle_assets_dst_subdir, false, NULL, true);
    SETTING_ARRAY("led_driver",               settings->arrays.led_driver, false, NULL, true);
    SETTING_ARRAY("netplay_mitm_server",      settings->arrays.netplay_mitm_server, false, NULL, true);
+   SETTING_ARRAY("screenshot_format",        settings->arrays.screenshot_format, false, NULL, true);
    *size = count;
 
    return tmp;
@@ -1247,6 +1251,8 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("bundle_assets_extract_enable",  &settings->bools.bundle_assets_extract_enable, true, bundle_assets_extract_enable, false);
    SETTING_BOOL("video_vsync",                   &settings->bools.video_vsync, true, vsync, false);
    SETTING_BOOL("video_hard_sync",               &settings->bools.video_hard_sync, true, hard_sync, false);
+   SETTING_BOOL("video_frame_delay_auto",        &settings->bools.video_frame_delay_auto, true, frame_delay_auto, false);
+   SETTING_BOOL("video_frame_limit_spin",        &settings->bools.video_frame_limit_spin, true, frame_limit_spin, false);
    SETTING_BOOL("video_black_frame_insertion",   &settings->bools.video_black_frame_insertion, true, black_frame_insertion, false);
    SETTING_BOOL("crt_switch_resolution",  		 &settings->bools.crt_switch_resolution, true, crt_switch_resolution, false); 
    SETTING_BOOL("video_disable_composition",     &settings->bools.video_disable_composition, true, disable_composition, false);
@@ -1386,6 +1392,7 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("history_list_enable",          &settings->bools.history_list_enable, true, def_history_list_enable, false);
    SETTING_BOOL("playlist_entry_remove",        &settings->bools.playlist_entry_remove, true, def_playlist_entry_remove, false);
    SETTING_BOOL("playlist_entry_rename",        &settings->bools.playlist_entry_rename, true, def_playlist_entry_rename, false);
+   SETTING_BOOL("playlist_use_binary",          &settings->bools.playlist_use_binary, true, def_playlist_use_binary, false);
    SETTING_BOOL("game_specific_options",        &settings->bools.game_specific_options, true, default_game_specific_options, false);
    SETTING_BOOL("auto_overrides_enable",        &settings->bools.auto_overrides_enable, true, default_auto_overrides_enable, false);
    SETTING_BOOL("auto_remaps_enable",           &settings->bools.auto_remaps_enable, true, default_auto_remaps_enable, false);
@@ -1668,6 +1675,8 @@ static void config_set_defaults(void)
    if (def_mitm)
       strlcpy(settings->arrays.netplay_mitm_server,
             def_mitm, sizeof(settings->arrays.netplay_mitm_server));
+   strlcpy(settings->arrays.screenshot_format,
+         screenshot_format, sizeof(settings->arrays.screenshot_format));
 #ifdef HAVE_MENU
    if (def_menu)
       strlcpy(settings->arrays.menu_driver,
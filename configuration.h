@@ -74,6 +74,8 @@ typedef struct settings
       bool video_windowed_fullscreen;
       bool video_vsync;
       bool video_hard_sync;
+      bool video_frame_delay_auto;
+      bool video_frame_limit_spin;
       bool video_black_frame_insertion;
       bool video_vfilter;
       bool video_smooth;
@@ -237,6 +239,7 @@ typedef struct settings
       bool history_list_enable;
       bool playlist_entry_remove;
       bool playlist_entry_rename;
+      bool playlist_use_binary;
       bool rewind_enable;
       bool run_ahead_enabled;
       bool run_ahead_secondary_instance;
@@ -437,6 +440,7 @@ typedef struct settings
       char bundle_assets_dst_subdir[PATH_MAX_LENGTH];
 
       char netplay_mitm_server[255];
+      char screenshot_format[8];
    } arrays;
 
    struct
@@ -35,6 +35,7 @@
 #include "network/netplay/netplay.h"
 #endif
 
+#include "benchmark.h"
 #include "core.h"
 #include "content.h"
 #include "dynamic.h"
@@ -98,11 +99,20 @@ void core_set_input_state(retro_ctx_input_state_info_t *info)
  **/
 static bool core_init_libretro_cbs(struct retro_callbacks *cbs)
 {
-   current_core.retro_set_video_refresh(video_driver_frame);
-   current_core.retro_set_audio_sample(audio_driver_sample);
-   current_core.retro_set_audio_sample_batch(audio_driver_sample_batch);
-   current_core.retro_set_input_state(core_input_state_poll);
-   current_core.retro_set_input_poll(core_input_state_poll_maybe);
+   retro_video_refresh_t frame_cb             = video_driver_frame;
+   retro_audio_sample_t sample_cb             = audio_driver_sample;
+   retro_audio_sample_batch_t sample_batch_cb = audio_driver_sample_batch;
+   retro_input_state_t state_cb               = core_input_state_poll;
+   retro_input_poll_t poll_cb                 = core_input_state_poll_maybe;
+
+   benchmark_wrap_callbacks(&frame_cb, &sample_cb, &sample_batch_cb,
+         &state_cb, &poll_cb);
+
+   current_core.retro_set_video_refresh(frame_cb);
+   current_core.retro_set_audio_sample(sample_cb);
+   current_core.retro_set_audio_sample_batch(sample_batch_cb);
+   current_core.retro_set_input_state(state_cb);
+   current_core.retro_set_input_poll(poll_cb);
 
    core_set_default_callbacks(cbs);
 
@@ -18,12 +18,17 @@
 #include <stdio.h>
 #include <stdint.h>
 
+#include <rhash.h>
 #include <compat/strl.h>
 #include <retro_endianness.h>
 #include <file/file_path.h>
 #include <lists/string_list.h>
 #include <lists/dir_list.h>
 #include <string/stdstring.h>
+#include <streams/file_stream.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "libretro-db/libretrodb.h"
 
@@ -148,119 +153,105 @@ char *bin_to_hex_alloc(const uint8_t *data, size_t len)
    return ret;
 }
 
+/* Strings read through a libretrodb view are not NUL-terminated,
+ * copy them out with their length. */
+static char *database_info_strdup(const struct rmsgpack_dom_value *val)
+{
+   char *s = NULL;
+
+   if (     (val->type != RDT_STRING && val->type != RDT_BINARY)
+         || val->val.string.len == 0)
+      return NULL;
+
+   if (!(s = (char*)malloc(val->val.string.len + 1)))
+      return NULL;
+
+   memcpy(s, val->val.string.buff, val->val.string.len);
+   s[val->val.string.len] = '\0';
+   return s;
+}
+
+static void database_info_key(char *s, size_t len,
+      const struct rmsgpack_dom_value *key)
+{
+   size_t key_len = 0;
+
+   if (key->type == RDT_STRING)
+   {
+      key_len = key->val.string.len < len - 1
+         ? key->val.string.len : len - 1;
+      memcpy(s, key->val.string.buff, key_len);
+   }
+
+   s[key_len] = '\0';
+}
+
+static uint32_t database_info_crc(const struct rmsgpack_dom_value *val)
+{
+   uint32_t crc = 0;
+
+   if (val->type == RDT_BINARY && val->val.binary.len == sizeof(crc))
+      memcpy(&crc, val->val.binary.buff, sizeof(crc));
+
+   return swap_if_little32(crc);
+}
 
 static int database_cursor_iterate(libretrodb_cursor_t *cur,
       database_info_t *db_info)
 {
-   unsigned i;
-   struct rmsgpack_dom_value item;
-   const char* str                = NULL;
+   libretrodb_view_t view;
+   struct rmsgpack_dom_value key, value;
+   struct rmsgpack_dom_value *val = &value;
+   char str[64];
 
-   if (libretrodb_cursor_read_item(cur, &item) != 0)
+   if (libretrodb_cursor_read_view(cur, &view) != 0)
       return -1;
 
-   if (item.type != RDT_MAP)
-   {
-      rmsgpack_dom_value_free(&item);
-      return 1;
-   }
-
    db_info->analog_supported       = -1;
    db_info->rumble_supported       = -1;
    db_info->coop_supported         = -1;
 
-   for (i = 0; i < item.val.map.len; i++)
+   while (libretrodb_view_next(&view, &key, &value) == 0)
    {
-      struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
-      struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
-      const char *val_string         = NULL;
-
-      if (!key || !val)
-         continue;
-
-      val_string                     = val->val.string.buff;
-      str                            = key->val.string.buff;
+      database_info_key(str, sizeof(str), &key);
 
       if (string_is_equal(str, "publisher"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->publisher = strdup(val_string);
-      }
+         db_info->publisher = database_info_strdup(val);
       else if (string_is_equal(str, "developer"))
       {
-         if (!string_is_empty(val_string))
-            db_info->developer = string_split(val_string, "|");
+         char *developer = database_info_strdup(val);
+         if (developer)
+            db_info->developer = string_split(developer, "|");
+         free(developer);
       }
       else if (string_is_equal(str, "serial"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->serial = strdup(val_string);
-      }
+         db_info->serial = database_info_strdup(val);
       else if (string_is_equal(str, "rom_name"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->rom_name = strdup(val_string);
-      }
+         db_info->rom_name = database_info_strdup(val);
       else if (string_is_equal(str, "name"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->name = strdup(val_string);
-      }
+         db_info->name = database_info_strdup(val);
       else if (string_is_equal(str, "description"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->description = strdup(val_string);
-      }
+         db_info->description = database_info_strdup(val);
       else if (string_is_equal(str, "genre"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->genre = strdup(val_string);
-      }
+         db_info->genre = database_info_strdup(val);
       else if (string_is_equal(str, "origin"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->origin = strdup(val_string);
-      }
+         db_info->origin = database_info_strdup(val);
       else if (string_is_equal(str, "franchise"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->franchise = strdup(val_string);
-      }
+         db_info->franchise = database_info_strdup(val);
       else if (string_is_equal(str, "bbfc_rating"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->bbfc_rating = strdup(val_string);
-      }
+         db_info->bbfc_rating = database_info_strdup(val);
       else if (string_is_equal(str, "esrb_rating"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->esrb_rating = strdup(val_string);
-      }
+         db_info->esrb_rating = database_info_strdup(val);
       else if (string_is_equal(str, "elspa_rating"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->elspa_rating = strdup(val_string);
-      }
+         db_info->elspa_rating = database_info_strdup(val);
       else if (string_is_equal(str, "cero_rating"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->cero_rating          = strdup(val_string);
-      }
+         db_info->cero_rating          = database_info_strdup(val);
       else if (string_is_equal(str, "pegi_rating"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->pegi_rating          = strdup(val_string);
-      }
+         db_info->pegi_rating          = database_info_strdup(val);
       else if (string_is_equal(str, "enhancement_hw"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->enhancement_hw       = strdup(val_string);
-      }
+         db_info->enhancement_hw       = database_info_strdup(val);
       else if (string_is_equal(str, "edge_review"))
-      {
-         if (!string_is_empty(val_string))
-            db_info->edge_magazine_review = strdup(val_string);
-      }
+         db_info->edge_magazine_review = database_info_strdup(val);
       else if (string_is_equal(str, "edge_rating"))
          db_info->edge_magazine_rating    = (unsigned)val->val.uint_;
       else if (string_is_equal(str, "edge_issue"))
@@ -284,8 +275,7 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       else if (string_is_equal(str, "size"))
          db_info->size                    = (unsigned)val->val.uint_;
       else if (string_is_equal(str, "crc"))
-         db_info->crc32 = swap_if_little32(
-               *(uint32_t*)val->val.binary.buff);
+         db_info->crc32 = database_info_crc(val);
       else if (string_is_equal(str, "sha1"))
          db_info->sha1 = bin_to_hex_alloc(
                (uint8_t*)val->val.binary.buff, val->val.binary.len);
@@ -298,8 +288,6 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       }
    }
 
-   rmsgpack_dom_value_free(&item);
-
    return 0;
 }
 
@@ -509,6 +497,724 @@ end:
    return database_info_list;
 }
 
+struct database_index
+{
+   database_info_t *entries;
+   size_t count;
+   /* Open addressing, slots hold an entry index plus one. */
+   uint32_t *crc_slots;
+   uint32_t *serial_slots;
+   size_t mask;
+};
+
+static size_t database_index_crc_slot(uint32_t crc)
+{
+   return (size_t)(crc * 0x9E3779B1U);
+}
+
+static void database_index_insert(uint32_t *slots, size_t mask,
+      size_t hash, uint32_t entry)
+{
+   while (slots[hash & mask])
+      hash++;
+   slots[hash & mask] = entry + 1;
+}
+
+/* Reads only the columns the index needs. */
+static int database_index_read_entry(libretrodb_cursor_t *cur,
+      database_info_t *db_info)
+{
+   libretrodb_view_t view;
+   struct rmsgpack_dom_value key, val;
+   char str[16];
+
+   if (libretrodb_cursor_read_view(cur, &view) != 0)
+      return -1;
+
+   while (libretrodb_view_next(&view, &key, &val) == 0)
+   {
+      database_info_key(str, sizeof(str), &key);
+
+      if (string_is_equal(str, "crc"))
+         db_info->crc32 = database_info_crc(&val);
+      else if (string_is_equal(str, "serial"))
+         db_info->serial = database_info_strdup(&val);
+      else if (string_is_equal(str, "name") && val.type == RDT_STRING)
+         db_info->name = database_info_strdup(&val);
+   }
+
+   return 0;
+}
+
+/**
+ * database_index_new:
+ * @rdb_path           : Path to the database.
+ *
+ * Reads the crc, serial and name of every entry in a database
+ * once, so that content can be matched against it without
+ * running a query over the whole database per file.
+ *
+ * Returns: the index, NULL on error.
+ **/
+database_index_t *database_index_new(const char *rdb_path)
+{
+   size_t i, cap          = 0;
+   int ret                = 0;
+   size_t slots           = 16;
+   database_index_t *index = NULL;
+   libretrodb_t *db       = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+
+   if (!db || !cur)
+      goto end;
+
+   if (database_cursor_open(db, cur, rdb_path, NULL) != 0)
+      goto end;
+
+   if (!(index = (database_index_t*)calloc(1, sizeof(*index))))
+      goto close;
+
+   while (ret != -1)
+   {
+      database_info_t db_info = {0};
+
+      if ((ret = database_index_read_entry(cur, &db_info)) != 0)
+         continue;
+
+      if (!db_info.crc32 && !db_info.serial)
+      {
+         free(db_info.name);
+         continue;
+      }
+
+      if (index->count == cap)
+      {
+         database_info_t *entries = NULL;
+         cap                      = cap ? cap * 2 : 256;
+         entries                  = (database_info_t*)
+            realloc(index->entries, cap * sizeof(*entries));
+
+         if (!entries)
+         {
+            free(db_info.name);
+            free(db_info.serial);
+            database_index_free(index);
+            index = NULL;
+            goto close;
+         }
+
+         index->entries = entries;
+      }
+
+      index->entries[index->count++] = db_info;
+   }
+
+   /* Keep the load factor at or below one half. */
+   while (slots < index->count * 2)
+      slots *= 2;
+
+   index->mask         = slots - 1;
+   index->crc_slots    = (uint32_t*)calloc(slots, sizeof(uint32_t));
+   index->serial_slots = (uint32_t*)calloc(slots, sizeof(uint32_t));
+
+   if (!index->crc_slots || !index->serial_slots)
+   {
+      database_index_free(index);
+      index = NULL;
+      goto close;
+   }
+
+   for (i = 0; i < index->count; i++)
+   {
+      const database_info_t *entry = &index->entries[i];
+
+      if (entry->crc32)
+         database_index_insert(index->crc_slots, index->mask,
+               database_index_crc_slot(entry->crc32), (uint32_t)i);
+      if (entry->serial)
+         database_index_insert(index->serial_slots, index->mask,
+               djb2_calculate(entry->serial), (uint32_t)i);
+   }
+
+close:
+   database_cursor_close(db, cur);
+end:
+   if (db)
+      libretrodb_free(db);
+   if (cur)
+      libretrodb_cursor_free(cur);
+
+   return index;
+}
+
+void database_index_free(database_index_t *index)
+{
+   size_t i;
+
+   if (!index)
+      return;
+
+   for (i = 0; i < index->count; i++)
+   {
+      free(index->entries[i].name);
+      free(index->entries[i].serial);
+   }
+
+   free(index->entries);
+   free(index->crc_slots);
+   free(index->serial_slots);
+   free(index);
+}
+
+/* Entries are inserted in database order, so when several
+ * share a key the first one in the database is found, as
+ * with a query. */
+const database_info_t *database_index_find_crc(
+      const database_index_t *index, uint32_t crc)
+{
+   size_t hash;
+
+   if (!index || !crc)
+      return NULL;
+
+   for (hash = database_index_crc_slot(crc);
+         index->crc_slots[hash & index->mask]; hash++)
+   {
+      const database_info_t *entry =
+         &index->entries[index->crc_slots[hash & index->mask] - 1];
+      if (entry->crc32 == crc)
+         return entry;
+   }
+
+   return NULL;
+}
+
+const database_info_t *database_index_find_serial(
+      const database_index_t *index, const char *serial)
+{
+   size_t hash;
+
+   if (!index || string_is_empty(serial))
+      return NULL;
+
+   for (hash = djb2_calculate(serial);
+         index->serial_slots[hash & index->mask]; hash++)
+   {
+      const database_info_t *entry =
+         &index->entries[index->serial_slots[hash & index->mask] - 1];
+      if (string_is_equal(entry->serial, serial))
+         return entry;
+   }
+
+   return NULL;
+}
+
+/* Scan cache file layout, all words little-endian:
+ *
+ * "RASC" magic, version, entry count, then per entry:
+ *   path length, serial length, crc, archive crc, lookup type,
+ *   size (lo, hi), mtime (lo, hi), path bytes, serial bytes.
+ */
+#define DATABASE_SCAN_CACHE_MAGIC      0x43534152
+#define DATABASE_SCAN_CACHE_VERSION    1
+#define DATABASE_SCAN_CACHE_HEADER     3
+#define DATABASE_SCAN_CACHE_RECORD     9
+
+typedef struct database_scan_cache_entry
+{
+   bool seen;
+   enum database_type type;
+   uint32_t crc;
+   uint32_t archive_crc;
+   int64_t size;
+   int64_t mtime;
+   char *path;
+   char *serial;
+} database_scan_cache_entry_t;
+
+struct database_scan_cache
+{
+   bool dirty;
+   size_t count;
+   size_t cap;
+   size_t mask;
+   /* Open addressing over 'entries', slots hold an index plus one. */
+   uint32_t *slots;
+   database_scan_cache_entry_t *entries;
+   char *path;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+};
+
+static void database_scan_cache_put32(uint8_t **out, uint32_t val)
+{
+   (*out)[0] = (uint8_t)(val >>  0);
+   (*out)[1] = (uint8_t)(val >>  8);
+   (*out)[2] = (uint8_t)(val >> 16);
+   (*out)[3] = (uint8_t)(val >> 24);
+   *out     += 4;
+}
+
+static uint32_t database_scan_cache_get32(const uint8_t *in)
+{
+   return (uint32_t)in[0] | ((uint32_t)in[1] << 8)
+      | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+static bool database_scan_cache_rehash(database_scan_cache_t *cache)
+{
+   size_t i;
+   size_t slots    = 64;
+   uint32_t *table = NULL;
+
+   /* Keep the load factor at or below one half. */
+   while (slots < cache->cap * 2)
+      slots *= 2;
+
+   if (!(table = (uint32_t*)calloc(slots, sizeof(*table))))
+      return false;
+
+   free(cache->slots);
+   cache->slots = table;
+   cache->mask  = slots - 1;
+
+   for (i = 0; i < cache->count; i++)
+      database_index_insert(cache->slots, cache->mask,
+            djb2_calculate(cache->entries[i].path), (uint32_t)i);
+
+   return true;
+}
+
+static database_scan_cache_entry_t *database_scan_cache_lookup(
+      database_scan_cache_t *cache, const char *path)
+{
+   size_t hash;
+
+   for (hash = djb2_calculate(path);
+         cache->slots[hash & cache->mask]; hash++)
+   {
+      database_scan_cache_entry_t *entry =
+         &cache->entries[cache->slots[hash & cache->mask] - 1];
+      if (string_is_equal(entry->path, path))
+         return entry;
+   }
+
+   return NULL;
+}
+
+static database_scan_cache_entry_t *database_scan_cache_add(
+      database_scan_cache_t *cache, const char *path)
+{
+   database_scan_cache_entry_t *entry = NULL;
+
+   if (cache->count == cache->cap)
+   {
+      size_t cap                            = cache->cap ? cache->cap * 2 : 256;
+      database_scan_cache_entry_t *entries  = (database_scan_cache_entry_t*)
+         realloc(cache->entries, cap * sizeof(*entries));
+
+      if (!entries)
+         return NULL;
+
+      cache->entries = entries;
+      cache->cap     = cap;
+
+      if (!database_scan_cache_rehash(cache))
+         return NULL;
+   }
+
+   entry = &cache->entries[cache->count];
+   memset(entry, 0, sizeof(*entry));
+
+   if (!(entry->path = strdup(path)))
+      return NULL;
+
+   database_index_insert(cache->slots, cache->mask,
+         djb2_calculate(path), (uint32_t)cache->count);
+   cache->count++;
+
+   return entry;
+}
+
+static void database_scan_cache_load(database_scan_cache_t *cache)
+{
+   void *buf          = NULL;
+   int64_t len        = 0;
+   const uint8_t *ptr = NULL;
+   const uint8_t *end = NULL;
+   uint32_t i, count  = 0;
+
+   if (!path_is_valid(cache->path)
+         || !filestream_read_file(cache->path, &buf, &len))
+      return;
+
+   ptr = (const uint8_t*)buf;
+   end = ptr + len;
+
+   if (len < DATABASE_SCAN_CACHE_HEADER * 4
+         || database_scan_cache_get32(ptr) != DATABASE_SCAN_CACHE_MAGIC
+         || database_scan_cache_get32(ptr + 4) != DATABASE_SCAN_CACHE_VERSION)
+   {
+      RARCH_WARN("Ignoring invalid scan cache \"%s\".\n", cache->path);
+      goto end;
+   }
+
+   count = database_scan_cache_get32(ptr + 8);
+   ptr  += DATABASE_SCAN_CACHE_HEADER * 4;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t path_len, serial_len;
+      database_scan_cache_entry_t *entry = NULL;
+      char *path                         = NULL;
+
+      if (end - ptr < DATABASE_SCAN_CACHE_RECORD * 4)
+         break;
+
+      path_len   = database_scan_cache_get32(ptr);
+      serial_len = database_scan_cache_get32(ptr + 4);
+
+      if ((uint64_t)(end - ptr) < DATABASE_SCAN_CACHE_RECORD * 4
+            + (uint64_t)path_len + serial_len || !path_len)
+         break;
+
+      if (!(path = (char*)malloc(path_len + 1)))
+         break;
+      memcpy(path, ptr + DATABASE_SCAN_CACHE_RECORD * 4, path_len);
+      path[path_len] = '\0';
+
+      entry = database_scan_cache_lookup(cache, path);
+      if (!entry)
+         entry = database_scan_cache_add(cache, path);
+      free(path);
+
+      if (!entry)
+         break;
+
+      entry->crc         = database_scan_cache_get32(ptr + 8);
+      entry->archive_crc = database_scan_cache_get32(ptr + 12);
+      entry->type        = (enum database_type)
+         database_scan_cache_get32(ptr + 16);
+      entry->size        = (int64_t)((uint64_t)database_scan_cache_get32(ptr + 20)
+            | ((uint64_t)database_scan_cache_get32(ptr + 24) << 32));
+      entry->mtime       = (int64_t)((uint64_t)database_scan_cache_get32(ptr + 28)
+            | ((uint64_t)database_scan_cache_get32(ptr + 32) << 32));
+
+      free(entry->serial);
+      entry->serial = NULL;
+
+      if (serial_len && (entry->serial = (char*)malloc(serial_len + 1)))
+      {
+         memcpy(entry->serial,
+               ptr + DATABASE_SCAN_CACHE_RECORD * 4 + path_len, serial_len);
+         entry->serial[serial_len] = '\0';
+      }
+
+      ptr += DATABASE_SCAN_CACHE_RECORD * 4 + path_len + serial_len;
+   }
+
+   if (i != count)
+      RARCH_WARN("Scan cache \"%s\" is truncated, kept %u of %u entries.\n",
+            cache->path, (unsigned)i, (unsigned)count);
+
+end:
+   free(buf);
+}
+
+/**
+ * database_scan_cache_new:
+ * @path               : Path to the cache file.
+ *
+ * Loads the scan cache at @path. A missing or invalid file
+ * gives an empty cache that will be written to @path.
+ *
+ * Returns: the cache, NULL on allocation failure.
+ **/
+database_scan_cache_t *database_scan_cache_new(const char *path)
+{
+   database_scan_cache_t *cache = (database_scan_cache_t*)
+      calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+   cache->path = strdup(path);
+
+#ifdef HAVE_THREADS
+   cache->lock = slock_new();
+   if (!cache->lock)
+      goto error;
+#endif
+
+   if (!cache->path || !database_scan_cache_rehash(cache))
+      goto error;
+
+   database_scan_cache_load(cache);
+
+   RARCH_LOG("Loaded %u entries from scan cache \"%s\".\n",
+         (unsigned)cache->count, path);
+
+   return cache;
+
+error:
+   database_scan_cache_free(cache);
+   return NULL;
+}
+
+void database_scan_cache_free(database_scan_cache_t *cache)
+{
+   size_t i;
+
+   if (!cache)
+      return;
+
+   for (i = 0; i < cache->count; i++)
+   {
+      free(cache->entries[i].path);
+      free(cache->entries[i].serial);
+   }
+
+#ifdef HAVE_THREADS
+   if (cache->lock)
+      slock_free(cache->lock);
+#endif
+   free(cache->entries);
+   free(cache->slots);
+   free(cache->path);
+   free(cache);
+}
+
+/**
+ * database_scan_cache_find:
+ * @cache              : Scan cache.
+ * @content_path       : Path of the content file.
+ * @size               : Current size of the content.
+ * @mtime              : Current modification time of the content.
+ * @type               : Lookup to perform with the cached hash.
+ * @crc                : Cached CRC32.
+ * @archive_crc        : Cached CRC32 of the archive itself.
+ * @serial             : Cached serial, empty if there is none.
+ * @serial_len         : Size of @serial.
+ *
+ * Looks up the hash of a file scanned before. Entries whose size
+ * or modification time changed since are treated as missing.
+ *
+ * Returns: true if a cached hash was found, otherwise false.
+ **/
+bool database_scan_cache_find(database_scan_cache_t *cache,
+      const char *content_path, int64_t size, int64_t mtime,
+      enum database_type *type, uint32_t *crc, uint32_t *archive_crc,
+      char *serial, size_t serial_len)
+{
+   bool found                         = false;
+   database_scan_cache_entry_t *entry = NULL;
+
+   if (!cache)
+      return false;
+
+#ifdef HAVE_THREADS
+   slock_lock(cache->lock);
+#endif
+   entry = database_scan_cache_lookup(cache, content_path);
+
+   if (entry && entry->size == size && entry->mtime == mtime)
+   {
+      entry->seen  = true;
+      *type        = entry->type;
+      *crc         = entry->crc;
+      *archive_crc = entry->archive_crc;
+      strlcpy(serial, entry->serial ? entry->serial : "", serial_len);
+      found        = true;
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(cache->lock);
+#endif
+
+   return found;
+}
+
+/**
+ * database_scan_cache_update:
+ * @cache              : Scan cache.
+ * @content_path       : Path of the content file.
+ * @size               : Size of the content when it was hashed.
+ * @mtime              : Modification time of the content when it
+ *                       was hashed.
+ * @type               : Lookup to perform with the hash.
+ * @crc                : CRC32 of the content.
+ * @archive_crc        : CRC32 of the archive itself.
+ * @serial             : Serial of the content, may be empty.
+ *
+ * Records the hash of a file, replacing any previous entry.
+ **/
+void database_scan_cache_update(database_scan_cache_t *cache,
+      const char *content_path, int64_t size, int64_t mtime,
+      enum database_type type, uint32_t crc, uint32_t archive_crc,
+      const char *serial)
+{
+   database_scan_cache_entry_t *entry = NULL;
+
+   if (!cache)
+      return;
+
+#ifdef HAVE_THREADS
+   slock_lock(cache->lock);
+#endif
+   if (!(entry = database_scan_cache_lookup(cache, content_path)))
+      entry = database_scan_cache_add(cache, content_path);
+
+   if (entry)
+   {
+      free(entry->serial);
+      entry->seen        = true;
+      entry->type        = type;
+      entry->crc         = crc;
+      entry->archive_crc = archive_crc;
+      entry->size        = size;
+      entry->mtime       = mtime;
+      entry->serial      = string_is_empty(serial) ? NULL : strdup(serial);
+      cache->dirty       = true;
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(cache->lock);
+#endif
+}
+
+/**
+ * database_scan_cache_prune:
+ * @cache              : Scan cache.
+ * @dir                : Directory that was scanned.
+ *
+ * Drops the entries below @dir that were not found or updated
+ * since the cache was loaded, i.e. files that have been removed.
+ * Only call this once a scan of @dir has run to completion.
+ **/
+void database_scan_cache_prune(database_scan_cache_t *cache,
+      const char *dir)
+{
+   size_t i, kept = 0;
+   size_t dir_len = 0;
+
+   if (!cache || string_is_empty(dir))
+      return;
+
+   dir_len = strlen(dir);
+   while (dir_len > 1 && path_char_is_slash(dir[dir_len - 1]))
+      dir_len--;
+
+#ifdef HAVE_THREADS
+   slock_lock(cache->lock);
+#endif
+   for (i = 0; i < cache->count; i++)
+   {
+      database_scan_cache_entry_t *entry = &cache->entries[i];
+
+      if (!entry->seen && !strncmp(entry->path, dir, dir_len)
+            && path_char_is_slash(entry->path[dir_len]))
+      {
+         free(entry->path);
+         free(entry->serial);
+         continue;
+      }
+
+      cache->entries[kept++] = *entry;
+   }
+
+   if (kept != cache->count)
+   {
+      RARCH_LOG("Pruned %u stale entries from scan cache.\n",
+            (unsigned)(cache->count - kept));
+      cache->count = kept;
+      cache->dirty = true;
+      database_scan_cache_rehash(cache);
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(cache->lock);
+#endif
+}
+
+/**
+ * database_scan_cache_write:
+ * @cache              : Scan cache.
+ *
+ * Writes the cache back to the path it was loaded from, if it
+ * changed.
+ *
+ * Returns: true on success or if there was nothing to write.
+ **/
+bool database_scan_cache_write(database_scan_cache_t *cache)
+{
+   size_t i;
+   bool ret       = true;
+   size_t len     = DATABASE_SCAN_CACHE_HEADER * 4;
+   uint8_t *buf   = NULL;
+   uint8_t *out   = NULL;
+
+   if (!cache)
+      return false;
+
+#ifdef HAVE_THREADS
+   slock_lock(cache->lock);
+#endif
+   if (!cache->dirty)
+      goto end;
+
+   for (i = 0; i < cache->count; i++)
+   {
+      const database_scan_cache_entry_t *entry = &cache->entries[i];
+      len += DATABASE_SCAN_CACHE_RECORD * 4 + strlen(entry->path);
+      if (entry->serial)
+         len += strlen(entry->serial);
+   }
+
+   if (!(buf = (uint8_t*)malloc(len)))
+   {
+      ret = false;
+      goto end;
+   }
+
+   out = buf;
+   database_scan_cache_put32(&out, DATABASE_SCAN_CACHE_MAGIC);
+   database_scan_cache_put32(&out, DATABASE_SCAN_CACHE_VERSION);
+   database_scan_cache_put32(&out, (uint32_t)cache->count);
+
+   for (i = 0; i < cache->count; i++)
+   {
+      const database_scan_cache_entry_t *entry = &cache->entries[i];
+      size_t path_len   = strlen(entry->path);
+      size_t serial_len = entry->serial ? strlen(entry->serial) : 0;
+
+      database_scan_cache_put32(&out, (uint32_t)path_len);
+      database_scan_cache_put32(&out, (uint32_t)serial_len);
+      database_scan_cache_put32(&out, entry->crc);
+      database_scan_cache_put32(&out, entry->archive_crc);
+      database_scan_cache_put32(&out, (uint32_t)entry->type);
+      database_scan_cache_put32(&out, (uint32_t)((uint64_t)entry->size));
+      database_scan_cache_put32(&out, (uint32_t)((uint64_t)entry->size >> 32));
+      database_scan_cache_put32(&out, (uint32_t)((uint64_t)entry->mtime));
+      database_scan_cache_put32(&out, (uint32_t)((uint64_t)entry->mtime >> 32));
+      memcpy(out, entry->path, path_len);
+      out += path_len;
+      if (serial_len)
+         memcpy(out, entry->serial, serial_len);
+      out += serial_len;
+   }
+
+   if ((ret = filestream_write_file(cache->path, buf, (int64_t)len)))
+      cache->dirty = false;
+   else
+      RARCH_ERR("Could not write scan cache \"%s\".\n", cache->path);
+
+   free(buf);
+
+end:
+#ifdef HAVE_THREADS
+   slock_unlock(cache->lock);
+#endif
+   return ret;
+}
+
 void database_info_list_free(database_info_list_t *database_info_list)
 {
    size_t i;
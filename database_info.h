@@ -120,11 +120,48 @@ typedef struct
    database_info_t *list;
 } database_info_list_t;
 
+/* Hash index over the crc and serial columns of a database.
+ * Entries only carry crc32, name and serial. */
+typedef struct database_index database_index_t;
+
 database_info_list_t *database_info_list_new(const char *rdb_path,
       const char *query);
 
 void database_info_list_free(database_info_list_t *list);
 
+database_index_t *database_index_new(const char *rdb_path);
+
+void database_index_free(database_index_t *index);
+
+const database_info_t *database_index_find_crc(
+      const database_index_t *index, uint32_t crc);
+
+const database_info_t *database_index_find_serial(
+      const database_index_t *index, const char *serial);
+
+/* Hash of every scanned file, keyed on path, size and
+ * modification time, so that rescans can skip unchanged files. */
+typedef struct database_scan_cache database_scan_cache_t;
+
+database_scan_cache_t *database_scan_cache_new(const char *path);
+
+void database_scan_cache_free(database_scan_cache_t *cache);
+
+bool database_scan_cache_find(database_scan_cache_t *cache,
+      const char *content_path, int64_t size, int64_t mtime,
+      enum database_type *type, uint32_t *crc, uint32_t *archive_crc,
+      char *serial, size_t serial_len);
+
+void database_scan_cache_update(database_scan_cache_t *cache,
+      const char *content_path, int64_t size, int64_t mtime,
+      enum database_type type, uint32_t crc, uint32_t archive_crc,
+      const char *serial);
+
+void database_scan_cache_prune(database_scan_cache_t *cache,
+      const char *dir);
+
+bool database_scan_cache_write(database_scan_cache_t *cache);
+
 database_info_handle_t *database_info_dir_init(const char *dir,
       enum database_type type, retro_task_t *task,
       bool show_hidden_files);
@@ -305,6 +305,7 @@ static bool d3d10_gfx_set_shader(void* data,
    unsigned         i;
    config_file_t* conf     = NULL;
    d3d10_texture_t* source = NULL;
+   slang_compiled_preset_t* compiled = NULL;
    d3d10_video_t*   d3d10  = (d3d10_video_t*)data;
 
    if (!d3d10)
@@ -334,6 +335,12 @@ static bool d3d10_gfx_set_shader(void* data,
 
    video_shader_resolve_relative(d3d10->shader_preset, path);
 
+   /* Compile all passes up front so they can be built concurrently. */
+   compiled = slang_compile_preset(d3d10->shader_preset);
+
+   if (!compiled)
+      goto error;
+
    source = &d3d10->frame.texture[0];
    for (i = 0; i < d3d10->shader_preset->passes; source = &d3d10->pass[i++].rt)
    {
@@ -376,7 +383,7 @@ static bool d3d10_gfx_set_shader(void* data,
 
       if (!slang_process(
                 d3d10->shader_preset, i, RARCH_SHADER_HLSL, 40, &semantics_map,
-                &d3d10->pass[i].semantics))
+                &d3d10->pass[i].semantics, compiled))
          goto error;
 
       {
@@ -456,6 +463,9 @@ static bool d3d10_gfx_set_shader(void* data,
       }
    }
 
+   slang_compiled_preset_free(compiled);
+   compiled = NULL;
+
    for (i = 0; i < d3d10->shader_preset->luts; i++)
    {
       struct texture_image image = { 0 };
@@ -491,6 +501,7 @@ static bool d3d10_gfx_set_shader(void* data,
    return true;
 
 error:
+   slang_compiled_preset_free(compiled);
    d3d10_free_shader_preset(d3d10);
 #endif
 
@@ -319,6 +319,7 @@ static bool d3d11_gfx_set_shader(void* data, enum rarch_shader_type type, const
 #if defined(HAVE_SLANG) && defined(HAVE_SPIRV_CROSS)
    unsigned         i;
    d3d11_texture_t* source;
+   slang_compiled_preset_t* compiled = NULL;
    d3d11_video_t*   d3d11 = (d3d11_video_t*)data;
 
    if (!d3d11)
@@ -348,6 +349,12 @@ static bool d3d11_gfx_set_shader(void* data, enum rarch_shader_type type, const
 
    video_shader_resolve_relative(d3d11->shader_preset, path);
 
+   /* Compile all passes up front so they can be built concurrently. */
+   compiled = slang_compile_preset(d3d11->shader_preset);
+
+   if (!compiled)
+      goto error;
+
    source = &d3d11->frame.texture[0];
    for (i = 0; i < d3d11->shader_preset->passes; source = &d3d11->pass[i++].rt)
    {
@@ -390,7 +397,7 @@ static bool d3d11_gfx_set_shader(void* data, enum rarch_shader_type type, const
 
       if (!slang_process(
                 d3d11->shader_preset, i, RARCH_SHADER_HLSL, 40, &semantics_map,
-                &d3d11->pass[i].semantics))
+                &d3d11->pass[i].semantics, compiled))
          goto error;
 
       {
@@ -470,6 +477,9 @@ static bool d3d11_gfx_set_shader(void* data, enum rarch_shader_type type, const
       }
    }
 
+   slang_compiled_preset_free(compiled);
+   compiled = NULL;
+
    for (i = 0; i < d3d11->shader_preset->luts; i++)
    {
       struct texture_image image = { 0 };
@@ -503,6 +513,7 @@ static bool d3d11_gfx_set_shader(void* data, enum rarch_shader_type type, const
    return true;
 
 error:
+   slang_compiled_preset_free(compiled);
    d3d11_free_shader_preset(d3d11);
 #endif
    return false;
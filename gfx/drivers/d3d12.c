@@ -327,6 +327,7 @@ static bool d3d12_gfx_set_shader(void* data, enum rarch_shader_type type, const
 #if defined(HAVE_SLANG) && defined(HAVE_SPIRV_CROSS)
    unsigned         i;
    d3d12_texture_t* source;
+   slang_compiled_preset_t* compiled = NULL;
    d3d12_video_t*   d3d12 = (d3d12_video_t*)data;
 
    if (!d3d12)
@@ -357,6 +358,12 @@ static bool d3d12_gfx_set_shader(void* data, enum rarch_shader_type type, const
 
    video_shader_resolve_relative(d3d12->shader_preset, path);
 
+   /* Compile all passes up front so they can be built concurrently. */
+   compiled = slang_compile_preset(d3d12->shader_preset);
+
+   if (!compiled)
+      goto error;
+
    source = &d3d12->frame.texture[0];
    for (i = 0; i < d3d12->shader_preset->passes; source = &d3d12->pass[i++].rt)
    {
@@ -399,7 +406,7 @@ static bool d3d12_gfx_set_shader(void* data, enum rarch_shader_type type, const
 
       if (!slang_process(
                 d3d12->shader_preset, i, RARCH_SHADER_HLSL, 50, &semantics_map,
-                &d3d12->pass[i].semantics))
+                &d3d12->pass[i].semantics, compiled))
          goto error;
 
       {
@@ -499,6 +506,9 @@ static bool d3d12_gfx_set_shader(void* data, enum rarch_shader_type type, const
       }
    }
 
+   slang_compiled_preset_free(compiled);
+   compiled = NULL;
+
    for (i = 0; i < d3d12->shader_preset->luts; i++)
    {
       struct texture_image image = { 0 };
@@ -533,6 +543,7 @@ static bool d3d12_gfx_set_shader(void* data, enum rarch_shader_type type, const
    return true;
 
 error:
+   slang_compiled_preset_free(compiled);
    d3d12_free_shader_preset(d3d12);
 #endif
    return false;
@@ -20,6 +20,7 @@
 #include <algorithm>
 
 #include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
 #include <file/file_path.h>
 #include <streams/file_stream.h>
 #include <lists/string_list.h>
@@ -29,7 +30,12 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include "glslang_util.h"
+#include "slang_cache.h"
 #if defined(HAVE_GLSLANG)
 #include <glslang.hpp>
 #endif
@@ -373,8 +379,9 @@ bool glslang_parse_meta(const vector<string> &lines, glslang_meta *meta)
 bool glslang_compile_shader(const char *shader_path, glslang_output *output)
 {
    vector<string> lines;
-
-   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
+   string vertex_source;
+   string fragment_source;
+   string cache_key;
 
    if (!glslang_read_shader_file(shader_path, &lines, true))
       return false;
@@ -382,20 +389,140 @@ bool glslang_compile_shader(const char *shader_path, glslang_output *output)
    if (!glslang_parse_meta(lines, &output->meta))
       return false;
 
-   if (    !glslang::compile_spirv(build_stage_source(lines, "vertex"),
+   vertex_source   = build_stage_source(lines, "vertex");
+   fragment_source = build_stage_source(lines, "fragment");
+
+   /* Includes are already expanded at this point, so the
+    * stage sources fully determine the SPIR-V. */
+   cache_key       = "#stage vertex\n" + vertex_source
+      + "#stage fragment\n" + fragment_source;
+
+   if (slang_cache_load_spirv(cache_key,
+            &output->vertex, &output->fragment))
+   {
+      RARCH_LOG("[slang]: Using cached SPIR-V for \"%s\".\n", shader_path);
+      return true;
+   }
+
+   RARCH_LOG("[slang]: Compiling shader \"%s\".\n", shader_path);
+
+   if (    !glslang::compile_spirv(vertex_source,
             glslang::StageVertex, &output->vertex))
    {
       RARCH_ERR("Failed to compile vertex shader stage.\n");
       return false;
    }
 
-   if (    !glslang::compile_spirv(build_stage_source(lines, "fragment"),
+   if (    !glslang::compile_spirv(fragment_source,
             glslang::StageFragment, &output->fragment))
    {
       RARCH_ERR("Failed to compile fragment shader stage.\n");
       return false;
    }
 
+   slang_cache_store_spirv(cache_key, output->vertex, output->fragment);
+
+   return true;
+}
+
+#ifdef HAVE_THREADS
+struct glslang_compile_queue
+{
+   slock_t *lock;
+   const char * const *shader_paths;
+   glslang_output *outputs;
+   unsigned count;
+   unsigned next;
+   bool failed;
+};
+
+static void glslang_compile_worker(void *data)
+{
+   glslang_compile_queue *queue = (glslang_compile_queue*)data;
+
+   for (;;)
+   {
+      unsigned index;
+
+      slock_lock(queue->lock);
+      if (queue->failed || queue->next >= queue->count)
+      {
+         slock_unlock(queue->lock);
+         break;
+      }
+      index = queue->next++;
+      slock_unlock(queue->lock);
+
+      if (!glslang_compile_shader(queue->shader_paths[index],
+               &queue->outputs[index]))
+      {
+         RARCH_ERR("[slang]: Failed to compile shader: \"%s\".\n",
+               queue->shader_paths[index]);
+
+         slock_lock(queue->lock);
+         queue->failed = true;
+         slock_unlock(queue->lock);
+      }
+   }
+}
+#endif
+
+bool glslang_compile_shaders(const char * const *shader_paths,
+      glslang_output *outputs, unsigned count)
+{
+   unsigned i;
+#ifdef HAVE_THREADS
+   glslang_compile_queue queue;
+   vector<sthread_t*> workers;
+   unsigned num_workers = cpu_features_get_core_amount();
+
+   if (num_workers > count)
+      num_workers = count;
+
+   if (num_workers > 1)
+   {
+      queue.lock         = slock_new();
+      queue.shader_paths = shader_paths;
+      queue.outputs      = outputs;
+      queue.count        = count;
+      queue.next         = 0;
+      queue.failed       = false;
+
+      if (queue.lock)
+      {
+         /* Passes only depend on each other through their
+          * semantics, which are resolved after compilation,
+          * so every pass can be compiled independently. */
+         for (i = 1; i < num_workers; i++)
+         {
+            sthread_t *worker = sthread_create(glslang_compile_worker, &queue);
+            if (!worker)
+               break;
+            workers.push_back(worker);
+         }
+
+         /* The calling thread takes part as well. */
+         glslang_compile_worker(&queue);
+
+         for (i = 0; i < workers.size(); i++)
+            sthread_join(workers[i]);
+
+         slock_free(queue.lock);
+         return !queue.failed;
+      }
+   }
+#endif
+
+   for (i = 0; i < count; i++)
+   {
+      if (!glslang_compile_shader(shader_paths[i], &outputs[i]))
+      {
+         RARCH_ERR("[slang]: Failed to compile shader: \"%s\".\n",
+               shader_paths[i]);
+         return false;
+      }
+   }
+
    return true;
 }
 #else
@@ -403,4 +530,10 @@ bool glslang_compile_shader(const char *shader_path, glslang_output *output)
 {
    return false;
 }
+
+bool glslang_compile_shaders(const char * const *shader_paths,
+      glslang_output *outputs, unsigned count)
+{
+   return false;
+}
 #endif
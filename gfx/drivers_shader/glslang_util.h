@@ -105,6 +105,12 @@ struct glslang_output
 
 bool glslang_compile_shader(const char *shader_path, glslang_output *output);
 
+/* Compiles @count independent shaders, spreading them over
+ * worker threads when threading is available. Returns false
+ * if any of them fails to compile. */
+bool glslang_compile_shaders(const char * const *shader_paths,
+      glslang_output *outputs, unsigned count);
+
 /* Helpers for internal use. */
 bool glslang_read_shader_file(const char *path, std::vector<std::string> *output, bool root_file);
 bool glslang_parse_meta(const std::vector<std::string> &lines, glslang_meta *meta);
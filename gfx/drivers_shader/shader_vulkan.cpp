@@ -2825,9 +2825,23 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
 
    shader->num_parameters = 0;
 
+   vector<glslang_output> outputs(shader->passes);
+   vector<const char*> shader_paths(shader->passes);
+
+   for (i = 0; i < shader->passes; i++)
+      shader_paths[i] = shader->pass[i].source.path;
+
+   // Passes are independent until linking, so compile them all up front.
+   if (!glslang_compile_shaders(shader_paths.data(),
+            outputs.data(), shader->passes))
+   {
+      RARCH_ERR("Failed to compile shader preset: \"%s\".\n", path);
+      return nullptr;
+   }
+
    for (i = 0; i < shader->passes; i++)
    {
-      glslang_output output;
+      glslang_output &output = outputs[i];
       struct vulkan_filter_chain_pass_info pass_info;
       const video_shader_pass *pass      = &shader->pass[i];
       const video_shader_pass *next_pass =
@@ -2843,13 +2857,6 @@ vulkan_filter_chain_t *vulkan_filter_chain_create_from_preset(
       pass_info.address       = VULKAN_FILTER_CHAIN_ADDRESS_REPEAT;
       pass_info.max_levels    = 0;
 
-      if (!glslang_compile_shader(pass->source.path, &output))
-      {
-         RARCH_ERR("Failed to compile shader: \"%s\".\n",
-               pass->source.path);
-         return nullptr;
-      }
-
       for (auto &meta_param : output.meta.parameters)
       {
          if (shader->num_parameters >= GFX_MAX_PARAMETERS)
@@ -0,0 +1,303 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <retro_miscellaneous.h>
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <rhash.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "slang_cache.h"
+#include "../../verbosity.h"
+
+using namespace std;
+
+/* Entry layout (native endian):
+ *
+ * magic[4] version vertex_size fragment_size crc32
+ * vertex bytes, fragment bytes
+ *
+ * The CRC covers both payloads so truncated or
+ * half-written entries are treated as misses. */
+struct slang_cache_header
+{
+   char magic[4];
+   uint32_t version;
+   uint32_t vertex_size;
+   uint32_t fragment_size;
+   uint32_t crc;
+};
+
+static char slang_cache_dir[PATH_MAX_LENGTH];
+static unsigned slang_cache_hits;
+static unsigned slang_cache_misses;
+static unsigned slang_cache_tmp_count;
+
+/* Passes may be compiled concurrently, see
+ * glslang_compile_shaders(). */
+#ifdef HAVE_THREADS
+static slock_t *slang_cache_lock;
+#define SLANG_CACHE_LOCK() slock_lock(slang_cache_lock)
+#define SLANG_CACHE_UNLOCK() slock_unlock(slang_cache_lock)
+#else
+#define SLANG_CACHE_LOCK()
+#define SLANG_CACHE_UNLOCK()
+#endif
+
+void slang_cache_set_directory(const char *dir)
+{
+#ifdef HAVE_THREADS
+   if (!slang_cache_lock)
+      slang_cache_lock = slock_new();
+#endif
+
+   slang_cache_dir[0] = '\0';
+
+   if (string_is_empty(dir))
+      return;
+
+   fill_pathname_join(slang_cache_dir, dir, "slang",
+         sizeof(slang_cache_dir));
+
+   if (!path_is_directory(slang_cache_dir) && !path_mkdir(slang_cache_dir))
+   {
+      RARCH_WARN("[slang]: Cannot create shader cache directory \"%s\".\n",
+            slang_cache_dir);
+      slang_cache_dir[0] = '\0';
+   }
+}
+
+bool slang_cache_is_enabled(void)
+{
+   return !string_is_empty(slang_cache_dir);
+}
+
+void slang_cache_get_stats(unsigned *hits, unsigned *misses)
+{
+   SLANG_CACHE_LOCK();
+   if (hits)
+      *hits   = slang_cache_hits;
+   if (misses)
+      *misses = slang_cache_misses;
+   SLANG_CACHE_UNLOCK();
+}
+
+static void slang_cache_entry_path(char *path, size_t size,
+      const string &key, const char *ext)
+{
+   char hash[65];
+   string versioned = "slang-cache-" + to_string(SLANG_CACHE_VERSION)
+      + "\n" + key;
+
+   hash[0] = '\0';
+   sha256_hash(hash, (const uint8_t*)versioned.data(), versioned.size());
+
+   fill_pathname_join(path, slang_cache_dir, hash, size);
+   strlcat(path, ext, size);
+}
+
+static bool slang_cache_load(const string &key, const char *magic,
+      const char *ext, vector<uint8_t> *vertex, vector<uint8_t> *fragment)
+{
+   char path[PATH_MAX_LENGTH];
+   struct slang_cache_header header;
+   void *buf           = NULL;
+   int64_t len         = 0;
+   const uint8_t *data = NULL;
+   bool ret            = false;
+
+   if (!slang_cache_is_enabled())
+      return false;
+
+   slang_cache_entry_path(path, sizeof(path), key, ext);
+
+   if (!filestream_exists(path) || !filestream_read_file(path, &buf, &len))
+      goto end;
+
+   if (len < (int64_t)sizeof(header))
+      goto end;
+
+   memcpy(&header, buf, sizeof(header));
+   data = (const uint8_t*)buf + sizeof(header);
+
+   if (     memcmp(header.magic, magic, sizeof(header.magic))
+         || header.version != SLANG_CACHE_VERSION
+         || (int64_t)sizeof(header) + header.vertex_size
+            + header.fragment_size != len
+         || encoding_crc32(0, data,
+            header.vertex_size + header.fragment_size) != header.crc)
+   {
+      RARCH_WARN("[slang]: Ignoring stale shader cache entry \"%s\".\n", path);
+      goto end;
+   }
+
+   vertex->assign(data, data + header.vertex_size);
+   data += header.vertex_size;
+   fragment->assign(data, data + header.fragment_size);
+   ret   = true;
+
+end:
+   free(buf);
+
+   SLANG_CACHE_LOCK();
+   if (ret)
+      slang_cache_hits++;
+   else
+      slang_cache_misses++;
+   SLANG_CACHE_UNLOCK();
+
+   return ret;
+}
+
+static bool slang_cache_store(const string &key, const char *magic,
+      const char *ext, const void *vertex, size_t vertex_size,
+      const void *fragment, size_t fragment_size)
+{
+   char path[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   char tmp_ext[48];
+   struct slang_cache_header header;
+   vector<uint8_t> blob;
+   unsigned tmp_index;
+
+   if (!slang_cache_is_enabled())
+      return false;
+
+   slang_cache_entry_path(path, sizeof(path), key, ext);
+
+   memcpy(header.magic, magic, sizeof(header.magic));
+   header.version       = SLANG_CACHE_VERSION;
+   header.vertex_size   = (uint32_t)vertex_size;
+   header.fragment_size = (uint32_t)fragment_size;
+
+   blob.resize(sizeof(header) + vertex_size + fragment_size);
+   if (vertex_size)
+      memcpy(&blob[sizeof(header)], vertex, vertex_size);
+   if (fragment_size)
+      memcpy(&blob[sizeof(header) + vertex_size], fragment, fragment_size);
+
+   header.crc = encoding_crc32(0, &blob[sizeof(header)],
+         vertex_size + fragment_size);
+   memcpy(&blob[0], &header, sizeof(header));
+
+   /* Write to a temporary file first, so other instances
+    * never observe a partially written entry. Identical
+    * passes in one preset may be stored at the same time,
+    * and other instances may share the cache directory,
+    * so every writer gets its own file. */
+   SLANG_CACHE_LOCK();
+   tmp_index = slang_cache_tmp_count++;
+   SLANG_CACHE_UNLOCK();
+
+#ifdef _WIN32
+   snprintf(tmp_ext, sizeof(tmp_ext), ".%d.%u.tmp",
+         (int)_getpid(), tmp_index);
+#else
+   snprintf(tmp_ext, sizeof(tmp_ext), ".%ld.%u.tmp",
+         (long)getpid(), tmp_index);
+#endif
+   strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcat(tmp_path, tmp_ext, sizeof(tmp_path));
+
+   if (!filestream_write_file(tmp_path, blob.data(), blob.size()))
+      return false;
+
+   if (filestream_rename(tmp_path, path) != 0)
+   {
+      /* Some platforms refuse to rename over an existing file. */
+      filestream_delete(path);
+
+      if (filestream_rename(tmp_path, path) != 0)
+      {
+         filestream_delete(tmp_path);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool slang_cache_load_spirv(const string &key,
+      vector<uint32_t> *vertex, vector<uint32_t> *fragment)
+{
+   vector<uint8_t> vs, fs;
+
+   if (!slang_cache_load(key, "RSPV", ".spv", &vs, &fs))
+      return false;
+
+   if ((vs.size() % sizeof(uint32_t)) || (fs.size() % sizeof(uint32_t)))
+      return false;
+
+   vertex->resize(vs.size() / sizeof(uint32_t));
+   fragment->resize(fs.size() / sizeof(uint32_t));
+   if (!vs.empty())
+      memcpy(vertex->data(), vs.data(), vs.size());
+   if (!fs.empty())
+      memcpy(fragment->data(), fs.data(), fs.size());
+
+   return true;
+}
+
+bool slang_cache_store_spirv(const string &key,
+      const vector<uint32_t> &vertex, const vector<uint32_t> &fragment)
+{
+   return slang_cache_store(key, "RSPV", ".spv",
+         vertex.data(), vertex.size() * sizeof(uint32_t),
+         fragment.data(), fragment.size() * sizeof(uint32_t));
+}
+
+bool slang_cache_load_source(const string &key,
+      string *vertex, string *fragment)
+{
+   vector<uint8_t> vs, fs;
+
+   if (!slang_cache_load(key, "RSRC", ".src", &vs, &fs))
+      return false;
+
+   vertex->assign(vs.begin(), vs.end());
+   fragment->assign(fs.begin(), fs.end());
+
+   return true;
+}
+
+bool slang_cache_store_source(const string &key,
+      const string &vertex, const string &fragment)
+{
+   return slang_cache_store(key, "RSRC", ".src",
+         vertex.data(), vertex.size(),
+         fragment.data(), fragment.size());
+}
@@ -0,0 +1,66 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SLANG_CACHE_HPP
+#define SLANG_CACHE_HPP
+
+#include <stdint.h>
+#include <boolean.h>
+#include <retro_common_api.h>
+
+/* Bump whenever the on-disk layout or anything feeding
+ * into the compiled output changes (glslang/SPIRV-Cross
+ * updates, stage source generation). */
+#define SLANG_CACHE_VERSION 1
+
+RETRO_BEGIN_DECLS
+
+/**
+ * slang_cache_set_directory:
+ * @dir                  : Base directory. Cache entries are kept in
+ *                         a "slang" subdirectory. NULL or an empty
+ *                         string disables the cache.
+ **/
+void slang_cache_set_directory(const char *dir);
+
+bool slang_cache_is_enabled(void);
+
+void slang_cache_get_stats(unsigned *hits, unsigned *misses);
+
+RETRO_END_DECLS
+
+#ifdef __cplusplus
+#include <vector>
+#include <string>
+
+/* Content-addressed: @key is hashed (SHA-256) together with
+ * SLANG_CACHE_VERSION, so callers pass everything the output
+ * depends on, e.g. the preprocessed source plus defines. */
+bool slang_cache_load_spirv(const std::string &key,
+      std::vector<uint32_t> *vertex, std::vector<uint32_t> *fragment);
+
+bool slang_cache_store_spirv(const std::string &key,
+      const std::vector<uint32_t> &vertex,
+      const std::vector<uint32_t> &fragment);
+
+/* Cross-compiled (SPIRV-Cross) stage sources. */
+bool slang_cache_load_source(const std::string &key,
+      std::string *vertex, std::string *fragment);
+
+bool slang_cache_store_source(const std::string &key,
+      const std::string &vertex, const std::string &fragment);
+#endif
+
+#endif
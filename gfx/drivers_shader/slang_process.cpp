@@ -5,6 +5,7 @@
 #include <stdint.h>
 
 #include "glslang_util.h"
+#include "slang_cache.h"
 #include "slang_preprocess.h"
 #include "slang_reflection.h"
 #include "slang_process.h"
@@ -338,20 +339,55 @@ static bool slang_process_reflection(
    return true;
 }
 
+struct slang_compiled_preset
+{
+   vector<glslang_output> outputs;
+};
+
+slang_compiled_preset_t* slang_compile_preset(const video_shader* shader_info)
+{
+   unsigned                 i;
+   vector<const char*>      shader_paths(shader_info->passes);
+   slang_compiled_preset_t* compiled = new slang_compiled_preset_t();
+
+   compiled->outputs.resize(shader_info->passes);
+
+   for (i = 0; i < shader_info->passes; i++)
+      shader_paths[i] = shader_info->pass[i].source.path;
+
+   if (!glslang_compile_shaders(shader_paths.data(),
+            compiled->outputs.data(), shader_info->passes))
+   {
+      delete compiled;
+      return NULL;
+   }
+
+   return compiled;
+}
+
+void slang_compiled_preset_free(slang_compiled_preset_t* compiled)
+{
+   delete compiled;
+}
+
 bool slang_process(
-      video_shader*          shader_info,
-      unsigned               pass_number,
-      enum rarch_shader_type dst_type,
-      unsigned               version,
-      const semantics_map_t* semantics_map,
-      pass_semantics_t*      out)
+      video_shader*            shader_info,
+      unsigned                 pass_number,
+      enum rarch_shader_type   dst_type,
+      unsigned                 version,
+      const semantics_map_t*   semantics_map,
+      pass_semantics_t*        out,
+      slang_compiled_preset_t* compiled)
 {
    glslang_output     output;
+   string             cache_key;
    Compiler*          vs_compiler = NULL;
    Compiler*          ps_compiler = NULL;
    video_shader_pass& pass        = shader_info->pass[pass_number];
 
-   if (!glslang_compile_shader(pass.source.path, &output))
+   if (compiled && pass_number < compiled->outputs.size())
+      output = std::move(compiled->outputs[pass_number]);
+   else if (!glslang_compile_shader(pass.source.path, &output))
       return false;
 
    if (!slang_preprocess_parse_parameters(output.meta, shader_info))
@@ -375,6 +411,17 @@ bool slang_process(
    pass.source.string.vertex   = NULL;
    pass.source.string.fragment = NULL;
 
+   /* Cross-compiled sources depend on the SPIR-V
+    * and on the target language/version only. */
+   cache_key = "#target " + to_string((int)dst_type) + " "
+      + to_string((int)shader_info->type) + " "
+      + to_string(version) + "\n";
+   cache_key.append((const char*)output.vertex.data(),
+         output.vertex.size() * sizeof(uint32_t));
+   cache_key.append("#fragment\n");
+   cache_key.append((const char*)output.fragment.data(),
+         output.fragment.size() * sizeof(uint32_t));
+
    try
    {
       ShaderResources vs_resources;
@@ -445,8 +492,12 @@ bool slang_process(
             }
          }
 
-         vs_code = vs->compile();
-         ps_code = ps->compile(ps_attrib_remap);
+         if (!slang_cache_load_source(cache_key, &vs_code, &ps_code))
+         {
+            vs_code = vs->compile();
+            ps_code = ps->compile(ps_attrib_remap);
+            slang_cache_store_source(cache_key, vs_code, ps_code);
+         }
       }
       else if (shader_info->type == RARCH_SHADER_GLSL)
       {
@@ -457,8 +508,12 @@ bool slang_process(
          ps->set_options(options);
          vs->set_options(options);
 
-         vs_code = vs->compile();
-         ps_code = ps->compile();
+         if (!slang_cache_load_source(cache_key, &vs_code, &ps_code))
+         {
+            vs_code = vs->compile();
+            ps_code = ps->compile();
+            slang_cache_store_source(cache_key, vs_code, ps_code);
+         }
       }
       else
          goto error;
@@ -84,13 +84,26 @@ typedef struct
 
 RETRO_BEGIN_DECLS
 
+typedef struct slang_compiled_preset slang_compiled_preset_t;
+
+/* Compiles every pass of @shader_info to SPIR-V up front,
+ * concurrently where possible. Returns NULL if any pass
+ * fails to compile. */
+slang_compiled_preset_t* slang_compile_preset(
+      const struct video_shader* shader_info);
+
+void slang_compiled_preset_free(slang_compiled_preset_t* compiled);
+
+/* @compiled is optional. When given, the SPIR-V for @pass_number
+ * is taken (and consumed) from it instead of compiling the pass. */
 bool slang_process(
-      struct video_shader*   shader_info,
-      unsigned               pass_number,
-      enum rarch_shader_type dst_type,
-      unsigned               version,
-      const semantics_map_t* semantics_map,
-      pass_semantics_t*      out);
+      struct video_shader*     shader_info,
+      unsigned                 pass_number,
+      enum rarch_shader_type   dst_type,
+      unsigned                 version,
+      const semantics_map_t*   semantics_map,
+      pass_semantics_t*        out,
+      slang_compiled_preset_t* compiled);
 
 RETRO_END_DECLS
 
@@ -53,6 +53,11 @@
 #include "video_driver.h"
 #include "video_display_server.h"
 #include "video_crt_switch.h"
+#include "video_frame_pacing.h"
+
+#ifdef HAVE_SLANG
+#include "drivers_shader/slang_cache.h"
+#endif
 
 #include "../frontend/frontend_driver.h"
 #include "../record/record_driver.h"
@@ -691,7 +696,6 @@ static void video_driver_init_filter(enum retro_pixel_format colfmt_int)
 {
    unsigned pow2_x, pow2_y, maxsize;
    void *buf                            = NULL;
-   settings_t *settings                 = config_get_ptr();
    struct retro_game_geometry *geom     = &video_driver_av_info.geometry;
    unsigned width                       = geom->max_width;
    unsigned height                      = geom->max_height;
@@ -707,7 +711,7 @@ static void video_driver_init_filter(enum retro_pixel_format colfmt_int)
    }
 
    video_driver_state_filter            = rarch_softfilter_new(
-         settings->paths.path_softfilter_plugin,
+         recording_get_filter_path(),
          RARCH_SOFTFILTER_THREADS_AUTO, colfmt, width, height);
 
    if (!video_driver_state_filter)
@@ -935,9 +939,13 @@ static bool video_driver_init_internal(bool *video_is_threaded)
    settings_t *settings                   = config_get_ptr();
    struct retro_game_geometry *geom       = &video_driver_av_info.geometry;
 
-   if (!string_is_empty(settings->paths.path_softfilter_plugin))
+   if (!string_is_empty(recording_get_filter_path()))
       video_driver_init_filter(video_driver_pix_fmt);
 
+#ifdef HAVE_SLANG
+   /* Must be set before the driver loads its first shader. */
+   slang_cache_set_directory(settings->paths.directory_cache);
+#endif
 
    max_dim   = MAX(geom->max_width, geom->max_height);
    scale     = next_pow2(max_dim) / RARCH_SCALE_BASE;
@@ -1927,6 +1935,13 @@ bool video_driver_find_driver(void)
    driver_ctx_info_t drv;
    settings_t *settings = config_get_ptr();
 
+   if (rarch_ctl(RARCH_CTL_IS_HEADLESS, NULL))
+   {
+      RARCH_LOG("[Video]: Running headless, using null driver.\n");
+      current_video = &video_null;
+      return true;
+   }
+
    if (video_driver_is_hw_context())
    {
       struct retro_hw_render_callback *hwr = video_driver_get_hw_context();
@@ -2600,11 +2615,15 @@ void video_driver_frame(const void *data, unsigned width,
 #endif
    }
 
+   video_frame_pacing_swap_begin();
+
    video_driver_active = current_video->frame(
          video_driver_data, data, width, height,
          video_driver_frame_count,
          (unsigned)pitch, video_driver_msg, &video_info);
 
+   video_frame_pacing_swap_end();
+
    video_driver_frame_count++;
 
    /* Display the FPS, with a higher priority. */
@@ -2730,7 +2749,8 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->framecount_show       = settings->bools.video_framecount_show;
    video_info->scale_integer         = settings->bools.video_scale_integer;
    video_info->aspect_ratio_idx      = settings->uints.video_aspect_ratio_idx;
-   video_info->post_filter_record    = settings->bools.video_post_filter_record;
+   video_info->post_filter_record    = settings->bools.video_post_filter_record
+      || recording_is_offline();
    video_info->max_swapchain_images  = settings->uints.video_max_swapchain_images;
    video_info->windowed_fullscreen   = settings->bools.video_windowed_fullscreen;
    video_info->fullscreen            = settings->bools.video_fullscreen || retroarch_is_forced_fullscreen();
@@ -0,0 +1,249 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <features/features_cpu.h>
+
+#include "video_frame_pacing.h"
+
+#include "../performance_counters.h"
+#include "../retroarch.h"
+
+static retro_time_t frame_pacing_core_run_samples[FRAME_PACING_SAMPLES_COUNT];
+static retro_time_t frame_pacing_swap_samples[FRAME_PACING_SAMPLES_COUNT];
+static unsigned     frame_pacing_sample_count     = 0;
+
+static retro_time_t frame_pacing_core_run_start   = 0;
+static retro_time_t frame_pacing_swap_start       = 0;
+static retro_time_t frame_pacing_swap_accum       = 0;
+static retro_time_t frame_pacing_last_swap_end    = 0;
+static retro_time_t frame_pacing_input_to_photon  = 0;
+static unsigned     frame_pacing_last_delay       = 0;
+
+/* The same spans in performance counter ticks, published
+ * through the performance counter API. */
+static retro_perf_tick_t frame_pacing_core_run_start_ticks = 0;
+static retro_perf_tick_t frame_pacing_swap_start_ticks     = 0;
+static retro_perf_tick_t frame_pacing_swap_accum_ticks     = 0;
+static retro_perf_tick_t frame_pacing_last_swap_end_ticks  = 0;
+
+static struct retro_perf_counter frame_pacing_perf_core_run;
+static struct retro_perf_counter frame_pacing_perf_video_swap;
+static struct retro_perf_counter frame_pacing_perf_input_to_photon;
+
+static void frame_pacing_perf_add(struct retro_perf_counter *perf,
+      retro_perf_tick_t ticks)
+{
+   if (!perf->registered)
+      return;
+   perf->call_cnt++;
+   perf->total += ticks;
+}
+
+void video_frame_pacing_reset(void)
+{
+   memset(frame_pacing_core_run_samples, 0,
+         sizeof(frame_pacing_core_run_samples));
+   memset(frame_pacing_swap_samples, 0,
+         sizeof(frame_pacing_swap_samples));
+   frame_pacing_sample_count    = 0;
+   frame_pacing_core_run_start  = 0;
+   frame_pacing_swap_start      = 0;
+   frame_pacing_swap_accum      = 0;
+   frame_pacing_last_swap_end   = 0;
+   frame_pacing_input_to_photon = 0;
+   frame_pacing_last_delay      = 0;
+
+   frame_pacing_core_run_start_ticks = 0;
+   frame_pacing_swap_start_ticks     = 0;
+   frame_pacing_swap_accum_ticks     = 0;
+   frame_pacing_last_swap_end_ticks  = 0;
+
+   if (rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL))
+   {
+      performance_counter_init(frame_pacing_perf_core_run,
+            "frame_pacing_core_run");
+      performance_counter_init(frame_pacing_perf_video_swap,
+            "frame_pacing_video_swap");
+      performance_counter_init(frame_pacing_perf_input_to_photon,
+            "frame_pacing_input_to_photon");
+   }
+}
+
+void video_frame_pacing_core_run_begin(void)
+{
+   frame_pacing_swap_accum           = 0;
+   frame_pacing_last_swap_end        = 0;
+   frame_pacing_swap_accum_ticks     = 0;
+   frame_pacing_last_swap_end_ticks  = 0;
+   frame_pacing_core_run_start       = cpu_features_get_time_usec();
+   frame_pacing_core_run_start_ticks = cpu_features_get_perf_counter();
+}
+
+void video_frame_pacing_core_run_end(void)
+{
+   unsigned write_index;
+   retro_time_t core_run;
+   retro_perf_tick_t core_run_ticks;
+
+   if (!frame_pacing_core_run_start)
+      return;
+
+   core_run = cpu_features_get_time_usec()
+      - frame_pacing_core_run_start - frame_pacing_swap_accum;
+   if (core_run < 0)
+      core_run = 0;
+
+   core_run_ticks = cpu_features_get_perf_counter()
+      - frame_pacing_core_run_start_ticks;
+   core_run_ticks = core_run_ticks > frame_pacing_swap_accum_ticks
+      ? core_run_ticks - frame_pacing_swap_accum_ticks : 0;
+
+   write_index = frame_pacing_sample_count++ &
+      (FRAME_PACING_SAMPLES_COUNT - 1);
+   frame_pacing_core_run_samples[write_index] = core_run;
+   frame_pacing_swap_samples[write_index]     = frame_pacing_swap_accum;
+
+   frame_pacing_perf_add(&frame_pacing_perf_core_run, core_run_ticks);
+   frame_pacing_perf_add(&frame_pacing_perf_video_swap,
+         frame_pacing_swap_accum_ticks);
+
+   /* Input was polled at the earliest at the start of core_run,
+    * and the frame is on screen once the swap returned. Cores
+    * that did not present a frame (duped frames, frameskip)
+    * don't produce an estimate. */
+   if (frame_pacing_last_swap_end)
+   {
+      frame_pacing_input_to_photon = frame_pacing_last_swap_end
+         - frame_pacing_core_run_start;
+      frame_pacing_perf_add(&frame_pacing_perf_input_to_photon,
+            frame_pacing_last_swap_end_ticks
+            - frame_pacing_core_run_start_ticks);
+   }
+
+   frame_pacing_core_run_start = 0;
+}
+
+void video_frame_pacing_swap_begin(void)
+{
+   frame_pacing_swap_start       = cpu_features_get_time_usec();
+   frame_pacing_swap_start_ticks = cpu_features_get_perf_counter();
+}
+
+void video_frame_pacing_swap_end(void)
+{
+   retro_time_t now;
+   retro_perf_tick_t now_ticks;
+
+   if (!frame_pacing_swap_start)
+      return;
+
+   now                               = cpu_features_get_time_usec();
+   now_ticks                         = cpu_features_get_perf_counter();
+   frame_pacing_swap_accum          += now - frame_pacing_swap_start;
+   frame_pacing_swap_accum_ticks    += now_ticks
+      - frame_pacing_swap_start_ticks;
+   frame_pacing_last_swap_end        = now;
+   frame_pacing_last_swap_end_ticks  = now_ticks;
+   frame_pacing_swap_start           = 0;
+}
+
+static void frame_pacing_get_max(retro_time_t *core_run_max,
+      retro_time_t *swap_max)
+{
+   unsigned i;
+   unsigned count = frame_pacing_sample_count;
+
+   *core_run_max  = 0;
+   *swap_max      = 0;
+
+   if (count > FRAME_PACING_SAMPLES_COUNT)
+      count = FRAME_PACING_SAMPLES_COUNT;
+
+   for (i = 0; i < count; i++)
+   {
+      if (frame_pacing_core_run_samples[i] > *core_run_max)
+         *core_run_max = frame_pacing_core_run_samples[i];
+      if (frame_pacing_swap_samples[i] > *swap_max)
+         *swap_max     = frame_pacing_swap_samples[i];
+   }
+}
+
+unsigned video_frame_pacing_get_auto_delay(float refresh_rate)
+{
+   retro_time_t core_run_max, swap_max, budget;
+   unsigned delay;
+
+   if (refresh_rate <= 0.0f ||
+         frame_pacing_sample_count < FRAME_PACING_SAMPLES_COUNT)
+      return 0;
+
+   frame_pacing_get_max(&core_run_max, &swap_max);
+
+   /* The slowest frame in the window has to fit between the
+    * delay and the next vblank. Using the maximum rather than
+    * the average makes the delay back off immediately when a
+    * heavy scene comes up, and creep back up only once it
+    * has left the window. */
+   budget = (retro_time_t)(1000000.0f / refresh_rate)
+      - core_run_max - swap_max - FRAME_PACING_SAFETY_MARGIN_USEC;
+
+   if (budget <= 0)
+      delay = 0;
+   else
+      delay = (unsigned)(budget / 1000);
+
+   if (delay > FRAME_PACING_MAX_DELAY_MS)
+      delay = FRAME_PACING_MAX_DELAY_MS;
+
+   frame_pacing_last_delay = delay;
+
+   return delay;
+}
+
+void video_frame_pacing_spin_until(retro_time_t target_usec)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+
+   /* Anything further away is the frontend's to sleep off. */
+   if (target_usec - now > FRAME_PACING_SPIN_THRESHOLD_USEC)
+      return;
+
+   while (now < target_usec)
+      now = cpu_features_get_time_usec();
+}
+
+bool video_frame_pacing_get_stats(video_frame_pacing_stats_t *stats)
+{
+   unsigned index;
+
+   if (!stats || !frame_pacing_sample_count)
+      return false;
+
+   index = (frame_pacing_sample_count - 1) &
+      (FRAME_PACING_SAMPLES_COUNT - 1);
+
+   stats->core_run_usec        = frame_pacing_core_run_samples[index];
+   stats->video_swap_usec      = frame_pacing_swap_samples[index];
+   frame_pacing_get_max(&stats->core_run_max_usec,
+         &stats->video_swap_max_usec);
+   stats->input_to_photon_usec = frame_pacing_input_to_photon;
+   stats->frame_delay_ms       = frame_pacing_last_delay;
+   stats->samples              = frame_pacing_sample_count;
+
+   return true;
+}
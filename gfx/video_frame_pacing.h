@@ -0,0 +1,109 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIDEO_FRAME_PACING_H__
+#define __VIDEO_FRAME_PACING_H__
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Must be a power of two. */
+#define FRAME_PACING_SAMPLES_COUNT       32
+
+/* Longest wait that is spun rather than slept. The frontend
+ * sleeps whole milliseconds, so at most the remainder below
+ * one millisecond is left to spin. */
+#define FRAME_PACING_SPIN_THRESHOLD_USEC 1000
+
+/* Headroom left in the frame period when picking
+ * the automatic frame delay. */
+#define FRAME_PACING_SAFETY_MARGIN_USEC  2000
+
+#define FRAME_PACING_MAX_DELAY_MS        15
+
+typedef struct video_frame_pacing_stats
+{
+   retro_time_t core_run_usec;
+   retro_time_t video_swap_usec;
+   retro_time_t core_run_max_usec;
+   retro_time_t video_swap_max_usec;
+   retro_time_t input_to_photon_usec;
+   unsigned frame_delay_ms;
+   unsigned samples;
+} video_frame_pacing_stats_t;
+
+/**
+ * video_frame_pacing_reset:
+ *
+ * Drops all collected samples and registers the performance
+ * counters. Called whenever the timing of the running content
+ * changes (core load, driver reinit).
+ **/
+void video_frame_pacing_reset(void);
+
+/**
+ * video_frame_pacing_core_run_begin:
+ *
+ * Marks the start of core_run(). Input for the frame is
+ * polled from here on, so this is also the input timestamp
+ * used for input-to-photon estimates.
+ **/
+void video_frame_pacing_core_run_begin(void);
+
+/**
+ * video_frame_pacing_core_run_end:
+ *
+ * Marks the end of core_run() and commits the frame's
+ * samples. Time spent inside video_driver_frame() is
+ * accounted as swap time, not core time.
+ **/
+void video_frame_pacing_core_run_end(void);
+
+void video_frame_pacing_swap_begin(void);
+
+void video_frame_pacing_swap_end(void);
+
+/**
+ * video_frame_pacing_get_auto_delay:
+ * @refresh_rate         : display refresh rate in Hz.
+ *
+ * Returns: the largest frame delay (in milliseconds) that
+ * still leaves room for the slowest recent frame, or 0
+ * until enough samples have been collected.
+ **/
+unsigned video_frame_pacing_get_auto_delay(float refresh_rate);
+
+/**
+ * video_frame_pacing_spin_until:
+ * @target_usec          : absolute time as returned by
+ *                         cpu_features_get_time_usec().
+ *
+ * Busy-waits until @target_usec for sub-millisecond accuracy.
+ * Returns immediately if @target_usec is more than
+ * FRAME_PACING_SPIN_THRESHOLD_USEC away.
+ **/
+void video_frame_pacing_spin_until(retro_time_t target_usec);
+
+bool video_frame_pacing_get_stats(video_frame_pacing_stats_t *stats);
+
+RETRO_END_DECLS
+
+#endif
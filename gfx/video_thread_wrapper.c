@@ -29,6 +29,18 @@
 #include "../retroarch.h"
 #include "../verbosity.h"
 
+/* Frames are handed to the video thread through three buffers:
+ * one owned by the main thread (write), one owned by the video
+ * thread (read) and the most recently completed frame (ready).
+ * Handing a frame over swaps indices, the pixel data never
+ * moves. */
+#define THREAD_FRAME_SLOTS 3
+
+/* Commands which don't return anything are queued here and
+ * applied by the video thread before it renders the next frame
+ * or handles the next blocking command, whichever comes first. */
+#define THREAD_CMD_QUEUE_SIZE 64
+
 enum thread_cmd
 {
    CMD_VIDEO_NONE = 0,
@@ -59,6 +71,7 @@ enum thread_cmd
    CMD_POKE_SET_OSD_MSG,
    CMD_FONT_INIT,
    CMD_CUSTOM_COMMAND,
+   CMD_FLUSH, /* Blocking no-op. Drains the command queue. */
 
    CMD_DUMMY = INT_MAX
 };
@@ -66,6 +79,7 @@ enum thread_cmd
 struct thread_packet
 {
    enum thread_cmd type;
+   bool async; /* Queued, the sender does not wait for a reply. */
    union
    {
       bool b;
@@ -123,6 +137,7 @@ struct thread_packet
       {
          char msg[128];
          struct font_params params;
+         void *font;
       } osd_message;
 
       struct
@@ -201,16 +216,31 @@ struct thread_video
    enum thread_cmd reply_cmd;
    thread_packet_t cmd_data;
 
+   struct
+   {
+      thread_packet_t packets[THREAD_CMD_QUEUE_SIZE];
+      /* Owned by the video thread, filled while draining. */
+      thread_packet_t drained[THREAD_CMD_QUEUE_SIZE];
+      unsigned head;
+      unsigned count;
+   } cmd_queue;
+
    struct video_viewport vp;
    struct video_viewport read_vp; /* Last viewport reported to caller. */
 
    struct
    {
       slock_t *lock;
-      uint8_t *buffer;
+      uint8_t *buffer[THREAD_FRAME_SLOTS];
+      size_t buffer_size;
+      unsigned write_index;
+      unsigned ready_index;
+      unsigned read_index;
       unsigned width;
       unsigned height;
       unsigned pitch;
+      bool ready;
+      bool dupe;
       bool updated;
       bool within_thread;
       uint64_t count;
@@ -235,6 +265,9 @@ static void *video_thread_init_never_call(const video_info_t *video,
 /* thread -> user */
 static void video_thread_reply(thread_video_t *thr, const thread_packet_t *pkt)
 {
+   if (pkt->async)
+      return;
+
    slock_lock(thr->lock);
 
    thr->cmd_data  = *pkt;
@@ -283,6 +316,34 @@ static void video_thread_send_and_wait_user_to_thread(thread_video_t *thr, threa
    video_thread_wait_reply(thr, pkt);
 }
 
+/* user -> thread
+ *
+ * Queues a command that has no return value. The video thread
+ * picks it up with the next frame or blocking command, so
+ * ordering relative to blocking commands is preserved. */
+static void video_thread_send_async(thread_video_t *thr,
+      const thread_packet_t *pkt)
+{
+   unsigned tail;
+
+   slock_lock(thr->lock);
+   if (thr->cmd_queue.count == THREAD_CMD_QUEUE_SIZE)
+   {
+      thread_packet_t flush = { CMD_FLUSH };
+
+      slock_unlock(thr->lock);
+      video_thread_send_and_wait_user_to_thread(thr, &flush);
+      slock_lock(thr->lock);
+   }
+
+   tail = (thr->cmd_queue.head + thr->cmd_queue.count)
+      % THREAD_CMD_QUEUE_SIZE;
+   thr->cmd_queue.packets[tail]       = *pkt;
+   thr->cmd_queue.packets[tail].async = true;
+   thr->cmd_queue.count++;
+   slock_unlock(thr->lock);
+}
+
 static void thread_update_driver_state(thread_video_t *thr)
 {
 #if defined(HAVE_MENU)
@@ -534,7 +595,8 @@ static bool video_thread_handle_packet(
                thr->poke->set_osd_msg(thr->driver_data,
                      &video_info,
                      pkt.data.osd_message.msg,
-                     &pkt.data.osd_message.params, NULL);
+                     &pkt.data.osd_message.params,
+                     pkt.data.osd_message.font);
          }
          video_thread_reply(thr, &pkt);
          break;
@@ -580,20 +642,59 @@ static void video_thread_loop(void *data)
    for (;;)
    {
       thread_packet_t pkt;
-      bool updated = false;
+      unsigned i;
+      unsigned queued_count   = 0;
+      unsigned slot;
+      unsigned frame_width    = 0;
+      unsigned frame_height   = 0;
+      unsigned frame_pitch    = 0;
+      uint64_t frame_count    = 0;
+      char frame_msg[255];
+      bool updated            = false;
 
       slock_lock(thr->lock);
-      while (thr->send_cmd == CMD_VIDEO_NONE && !thr->frame.updated)
+      while (thr->send_cmd == CMD_VIDEO_NONE && !thr->frame.ready)
          scond_wait(thr->cond_thread, thr->lock);
-      if (thr->frame.updated)
-         updated = true;
+      if (thr->frame.ready)
+      {
+         /* Take ownership of the newest frame, give the
+          * buffer we rendered last back to the exchange. */
+         if (!thr->frame.dupe)
+         {
+            slot                   = thr->frame.ready_index;
+            thr->frame.ready_index = thr->frame.read_index;
+            thr->frame.read_index  = slot;
+         }
+         thr->frame.ready       = false;
+         thr->frame.dupe        = false;
+
+         frame_width            = thr->frame.width;
+         frame_height           = thr->frame.height;
+         frame_pitch            = thr->frame.pitch;
+         frame_count            = thr->frame.count;
+         strlcpy(frame_msg, thr->frame.msg, sizeof(frame_msg));
+
+         updated                = true;
+      }
 
       /* To avoid race condition where send_cmd is updated
        * right after the switch is checked. */
       pkt = thr->cmd_data;
 
+      for (; thr->cmd_queue.count; thr->cmd_queue.count--)
+      {
+         thr->cmd_queue.drained[queued_count++] =
+            thr->cmd_queue.packets[thr->cmd_queue.head];
+         thr->cmd_queue.head = (thr->cmd_queue.head + 1)
+            % THREAD_CMD_QUEUE_SIZE;
+      }
+
       slock_unlock(thr->lock);
 
+      /* Queued commands were sent before whatever woke us up. */
+      for (i = 0; i < queued_count; i++)
+         video_thread_handle_packet(thr, &thr->cmd_queue.drained[i]);
+
       if (video_thread_handle_packet(thr, &pkt))
          return;
 
@@ -622,9 +723,9 @@ static void video_thread_loop(void *data)
             video_driver_build_info(&video_info);
 
             ret = thr->driver->frame(thr->driver_data,
-                  thr->frame.buffer, thr->frame.width, thr->frame.height,
-                  thr->frame.count,
-                  thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL,
+                  thr->frame.buffer[thr->frame.read_index],
+                  frame_width, frame_height, frame_count,
+                  frame_pitch, *frame_msg ? frame_msg : NULL,
                   &video_info);
          }
 
@@ -646,7 +747,8 @@ static void video_thread_loop(void *data)
          thr->alive         = alive;
          thr->focus         = focus;
          thr->has_windowed  = has_windowed;
-         thr->frame.updated = false;
+         /* Stay busy if another frame was queued while rendering. */
+         thr->frame.updated = thr->frame.ready;
          thr->vp            = vp;
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
@@ -715,6 +817,7 @@ static bool video_thread_frame(void *data, const void *frame_,
       unsigned pitch, const char *msg, video_frame_info_t *video_info)
 {
    unsigned copy_stride;
+   unsigned slot;
    const uint8_t *src                  = NULL;
    uint8_t *dst                        = NULL;
    thread_video_t *thr                 = (thread_video_t*)data;
@@ -735,7 +838,17 @@ static bool video_thread_frame(void *data, const void *frame_,
          ? sizeof(uint32_t) : sizeof(uint16_t));
 
    src = (const uint8_t*)frame_;
-   dst = thr->frame.buffer;
+   dst = thr->frame.buffer[thr->frame.write_index];
+
+   /* The write buffer belongs to this thread until it is
+    * swapped in below, so the copy needs no lock. Cores using
+    * GET_CURRENT_SOFTWARE_FRAMEBUFFER already rendered into it. */
+   if (src && src != dst)
+   {
+      unsigned h;
+      for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
+         memcpy(dst, src, copy_stride);
+   }
 
    slock_lock(thr->lock);
 
@@ -760,41 +873,47 @@ static bool video_thread_frame(void *data, const void *frame_,
       }
    }
 
-   /* Drop frame if updated flag is still set, as thread is
-    * still working on last frame. */
-   if (!thr->frame.updated)
-   {
-      if (src)
-      {
-         unsigned h;
-         for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
-            memcpy(dst, src, copy_stride);
-      }
-
-      thr->frame.updated = true;
-      thr->frame.width  = width;
-      thr->frame.height = height;
-      thr->frame.count  = frame_count;
-      thr->frame.pitch  = copy_stride;
+   /* If the thread has not picked up the previous frame yet,
+    * it is replaced by this one and counted as dropped. */
+   if (thr->frame.ready)
+      thr->miss_count++;
+   else
+      thr->hit_count++;
 
-      if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
-      else
-         *thr->frame.msg = '\0';
+   /* A NULL frame means 'dupe': the video thread renders the
+    * buffer it already owns again, unless a real frame is
+    * still pending, in which case that one is shown. */
+   if (frame_)
+   {
+      slot                    = thr->frame.ready_index;
+      thr->frame.ready_index  = thr->frame.write_index;
+      thr->frame.write_index  = slot;
+      thr->frame.dupe         = false;
+   }
+   else if (!thr->frame.ready)
+      thr->frame.dupe         = true;
+
+   thr->frame.ready   = true;
+   thr->frame.updated = true;
+   thr->frame.width   = width;
+   thr->frame.height  = height;
+   thr->frame.count   = frame_count;
+   thr->frame.pitch   = copy_stride;
+
+   if (msg)
+      strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
+   else
+      *thr->frame.msg = '\0';
 
-      scond_signal(thr->cond_thread);
+   scond_signal(thr->cond_thread);
 
 #if defined(HAVE_MENU)
-      if (thr->texture.enable)
-      {
-         while (thr->frame.updated)
-            scond_wait(thr->cond_cmd, thr->lock);
-      }
-#endif
-      thr->hit_count++;
+   if (thr->texture.enable)
+   {
+      while (thr->frame.updated)
+         scond_wait(thr->cond_cmd, thr->lock);
    }
-   else
-      thr->miss_count++;
+#endif
 
    slock_unlock(thr->lock);
 
@@ -813,6 +932,7 @@ static bool video_thread_init(thread_video_t *thr,
       const video_info_t info,
       const input_driver_t **input, void **input_data)
 {
+   unsigned i;
    size_t max_size;
    thread_packet_t pkt = {CMD_INIT};
 
@@ -832,12 +952,21 @@ static bool video_thread_init(thread_video_t *thr,
    max_size                  = info.input_scale * RARCH_SCALE_BASE;
    max_size                 *= max_size;
    max_size                 *= info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
-   thr->frame.buffer         = (uint8_t*)malloc(max_size);
+   thr->frame.buffer_size    = max_size;
 
-   if (!thr->frame.buffer)
-      return false;
+   for (i = 0; i < THREAD_FRAME_SLOTS; i++)
+   {
+      thr->frame.buffer[i]   = (uint8_t*)malloc(max_size);
 
-   memset(thr->frame.buffer, 0x80, max_size);
+      if (!thr->frame.buffer[i])
+         return false;
+
+      memset(thr->frame.buffer[i], 0x80, max_size);
+   }
+
+   thr->frame.write_index    = 0;
+   thr->frame.ready_index    = 1;
+   thr->frame.read_index     = 2;
 
    thr->last_time            = cpu_features_get_time_usec();
    thr->thread               = sthread_create(video_thread_loop, thr);
@@ -893,7 +1022,7 @@ static void video_thread_set_rotation(void *data, unsigned rotation)
 
    pkt.data.i = rotation;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 /* This value is set async as stalling on the video driver for
@@ -934,6 +1063,7 @@ static bool video_thread_read_viewport(void *data, uint8_t *buffer, bool is_idle
 
 static void video_thread_free(void *data)
 {
+   unsigned i;
    thread_video_t *thr = (thread_video_t*)data;
    thread_packet_t pkt = { CMD_FREE };
 
@@ -947,7 +1077,8 @@ static void video_thread_free(void *data)
 #if defined(HAVE_MENU)
    free(thr->texture.frame);
 #endif
-   free(thr->frame.buffer);
+   for (i = 0; i < THREAD_FRAME_SLOTS; i++)
+      free(thr->frame.buffer[i]);
    slock_free(thr->frame.lock);
    slock_free(thr->lock);
    scond_free(thr->cond_cmd);
@@ -973,7 +1104,7 @@ static void thread_overlay_enable(void *data, bool state)
 
    pkt.data.b = state;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static bool thread_overlay_load(void *data,
@@ -1009,7 +1140,7 @@ static void thread_overlay_tex_geom(void *data,
    pkt.data.rect.w = w;
    pkt.data.rect.h = h;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_overlay_vertex_geom(void *data,
@@ -1027,7 +1158,7 @@ static void thread_overlay_vertex_geom(void *data,
    pkt.data.rect.w = w;
    pkt.data.rect.h = h;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_overlay_full_screen(void *data, bool enable)
@@ -1037,7 +1168,7 @@ static void thread_overlay_full_screen(void *data, bool enable)
 
    pkt.data.b = enable;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 /* We cannot wait for this to complete. Totally blocks the main thread. */
@@ -1087,7 +1218,7 @@ static void thread_set_video_mode(void *data, unsigned width, unsigned height,
    pkt.data.new_mode.height     = height;
    pkt.data.new_mode.fullscreen = fullscreen;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_set_filtering(void *data, unsigned idx, bool smooth)
@@ -1100,7 +1231,7 @@ static void thread_set_filtering(void *data, unsigned idx, bool smooth)
    pkt.data.filtering.index  = idx;
    pkt.data.filtering.smooth = smooth;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_get_video_output_size(void *data,
@@ -1126,7 +1257,7 @@ static void thread_get_video_output_prev(void *data)
    if (!thr)
       return;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_get_video_output_next(void *data)
@@ -1137,7 +1268,7 @@ static void thread_get_video_output_next(void *data)
    if (!thr)
       return;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
 }
 
 static void thread_set_aspect_ratio(void *data, unsigned aspectratio_idx)
@@ -1149,7 +1280,39 @@ static void thread_set_aspect_ratio(void *data, unsigned aspectratio_idx)
       return;
    pkt.data.i = aspectratio_idx;
 
-   video_thread_send_and_wait_user_to_thread(thr, &pkt);
+   video_thread_send_async(thr, &pkt);
+}
+
+/* Lets the core render straight into the buffer that the next
+ * video_thread_frame() call would otherwise copy into. */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   unsigned bpp;
+   enum retro_pixel_format fmt;
+   thread_video_t *thr = (thread_video_t*)data;
+
+   if (!thr || !framebuffer || thr->frame.within_thread)
+      return false;
+
+   fmt = video_driver_get_pixel_format();
+   bpp = thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
+
+   /* 0RGB1555 goes through the frontend scaler first. */
+   if (fmt != (thr->info.rgb32
+            ? RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565))
+      return false;
+
+   if ((size_t)framebuffer->width * framebuffer->height * bpp
+         > thr->frame.buffer_size)
+      return false;
+
+   framebuffer->data         = thr->frame.buffer[thr->frame.write_index];
+   framebuffer->pitch        = framebuffer->width * bpp;
+   framebuffer->format       = fmt;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+
+   return true;
 }
 
 static void thread_set_texture_frame(void *data, const void *frame,
@@ -1202,10 +1365,23 @@ static void thread_set_osd_msg(void *data,
    if (!thr)
       return;
 
-   /* TODO : find a way to determine if the calling
-    * thread is the driver thread or not. */
-   if (thr->poke && thr->poke->set_osd_msg)
-      thr->poke->set_osd_msg(thr->driver_data, video_info, msg, params, font);
+   /* Menu drivers draw their text from within the video thread. */
+   if (!thr->thread || sthread_isself(thr->thread))
+   {
+      if (thr->poke && thr->poke->set_osd_msg)
+         thr->poke->set_osd_msg(thr->driver_data, video_info, msg, params, font);
+   }
+   else if (msg && params)
+   {
+      thread_packet_t pkt = { CMD_POKE_SET_OSD_MSG };
+
+      strlcpy(pkt.data.osd_message.msg, msg,
+            sizeof(pkt.data.osd_message.msg));
+      pkt.data.osd_message.params = *(const struct font_params*)params;
+      pkt.data.osd_message.font   = font;
+
+      video_thread_send_async(thr, &pkt);
+   }
 }
 
 static uintptr_t thread_load_texture(void *video_data, void *data,
@@ -1284,7 +1460,7 @@ static const video_poke_interface_t thread_poke = {
    NULL,
 
    thread_get_current_shader,
-   NULL,                      /* get_current_software_framebuffer */
+   thread_get_current_software_framebuffer,
    NULL                       /* get_hw_render_interface */
 };
 
@@ -1435,6 +1611,7 @@ bool video_thread_font_init(const void **font_driver, void **font_handle,
       return false;
 
    pkt.type                       = CMD_FONT_INIT;
+   pkt.async                      = false;
    pkt.data.font_init.method      = func;
    pkt.data.font_init.font_driver = font_driver;
    pkt.data.font_init.font_handle = font_handle;
@@ -292,6 +292,7 @@ VIDEO IMAGE
 
 #ifdef HAVE_RTGA
 #include "../libretro-common/formats/tga/rtga.c"
+#include "../libretro-common/formats/tga/rtga_encode.c"
 #endif
 
 #ifdef HAVE_IMAGEVIEWER
@@ -299,6 +300,7 @@ VIDEO IMAGE
 #endif
 
 #include "../libretro-common/formats/image_transfer.c"
+#include "../libretro-common/formats/qoi/rqoi_encode.c"
 #ifdef HAVE_RPNG
 #include "../libretro-common/formats/png/rpng.c"
 #include "../libretro-common/formats/png/rpng_encode.c"
@@ -799,6 +801,7 @@ DRIVERS
 ============================================================ */
 #include "../gfx/video_driver.c"
 #include "../gfx/video_crt_switch.c"
+#include "../gfx/video_frame_pacing.c"
 #include "../gfx/video_display_server.c"
 #include "../gfx/video_coord_array.c"
 #include "../input/input_driver.c"
@@ -1017,8 +1020,10 @@ WIFI
 RECORDING
 ============================================================ */
 #include "../movie.c"
+#include "../benchmark.c"
 #include "../record/record_driver.c"
 #include "../record/drivers/record_null.c"
+#include "../record/drivers/record_rdiff.c"
 
 #ifdef HAVE_FFMPEG
 #include "../record/drivers/record_ffmpeg.c"
@@ -1128,6 +1133,7 @@ MENU
 #include "../menu/menu_content.c"
 
 #include "../menu/menu_networking.c"
+#include "../menu/menu_thumbnail_cache.c"
 
 #include "../menu/widgets/menu_entry.c"
 #include "../menu/widgets/menu_filebrowser.c"
@@ -1363,7 +1369,6 @@ XML
  LIBRETRODB
 ============================================================ */
 #ifdef HAVE_LIBRETRODB
-#include "../libretro-db/bintree.c"
 #include "../libretro-db/libretrodb.c"
 #include "../libretro-db/rmsgpack.c"
 #include "../libretro-db/rmsgpack_dom.c"
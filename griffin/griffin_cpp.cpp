@@ -58,6 +58,7 @@ VIDEO DRIVER
 #include "../deps/SPIRV-Cross/spirv_msl.cpp"
 #ifdef HAVE_SLANG
 #include "../gfx/drivers_shader/glslang_util.cpp"
+#include "../gfx/drivers_shader/slang_cache.cpp"
 #include "../gfx/drivers_shader/slang_preprocess.cpp"
 #include "../gfx/drivers_shader/slang_process.cpp"
 #include "../gfx/drivers_shader/slang_reflection.cpp"
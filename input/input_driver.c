@@ -1276,6 +1276,12 @@ bool input_driver_find_driver(void)
    driver_ctx_info_t drv;
    settings_t *settings = config_get_ptr();
 
+   if (rarch_ctl(RARCH_CTL_IS_HEADLESS, NULL))
+   {
+      current_input = &input_null;
+      return true;
+   }
+
    drv.label            = "input_driver";
    drv.s                = settings->arrays.input_driver;
 
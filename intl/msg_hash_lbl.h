@@ -187,6 +187,8 @@ MSG_HASH(MENU_ENUM_LABEL_CONTENT_HISTORY_SIZE,
       "content_history_size")
 MSG_HASH(MENU_ENUM_LABEL_PLAYLIST_ENTRY_REMOVE,
       "playlist_entry_remove")
+MSG_HASH(MENU_ENUM_LABEL_PLAYLIST_USE_BINARY,
+      "playlist_use_binary")
 MSG_HASH(MENU_ENUM_LABEL_CONTENT_SETTINGS,
       "quick_menu")
 MSG_HASH(MENU_ENUM_LABEL_CORE_ASSETS_DIRECTORY,
@@ -1151,6 +1153,10 @@ MSG_HASH(MENU_ENUM_LABEL_VIDEO_FORCE_SRGB_DISABLE,
       "video_force_srgb_disable")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_FRAME_DELAY,
       "video_frame_delay")
+MSG_HASH(MENU_ENUM_LABEL_VIDEO_FRAME_DELAY_AUTO,
+      "video_frame_delay_auto")
+MSG_HASH(MENU_ENUM_LABEL_VIDEO_FRAME_LIMIT_SPIN,
+      "video_frame_limit_spin")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_FULLSCREEN,
       "video_fullscreen")
 MSG_HASH(MENU_ENUM_LABEL_VIDEO_GAMMA,
@@ -551,6 +551,8 @@ MSG_HASH(
       "History List Size")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_PLAYLIST_ENTRY_REMOVE,
       "Allow to remove entries")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_PLAYLIST_USE_BINARY,
+      "Binary collections")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_CONTENT_SETTINGS,
       "Quick Menu")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_CORE_ASSETS_DIR,
@@ -1761,6 +1763,10 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FORCE_SRGB_DISABLE,
       "Force-disable sRGB FBO")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FRAME_DELAY,
       "Frame Delay")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FRAME_DELAY_AUTO,
+      "Automatic Frame Delay")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FRAME_LIMIT_SPIN,
+      "Precise Frame Limiter")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_FULLSCREEN,
       "Start in Fullscreen Mode")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_VIDEO_GAMMA,
@@ -2037,6 +2043,10 @@ MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_BLACK_FRAME_INSERTION,
       "Inserts a black frame inbetween frames. Useful for users with 120Hz screens who want to play 60Hz content to eliminate ghosting.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_FRAME_DELAY,
       "Reduces latency at the cost of a higher risk of video stuttering. Adds a delay after V-Sync (in ms).")
+MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_FRAME_DELAY_AUTO,
+      "Measures how long the core and the video driver take each frame and uses the largest frame delay that still fits in the frame period. Overrides 'Frame Delay'.")
+MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_FRAME_LIMIT_SPIN,
+      "Busy-waits for the last fraction of a millisecond before each frame instead of sleeping. Steadier frame pacing when not using V-Sync, at the cost of CPU time.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_HARD_SYNC_FRAMES,
       "Sets how many frames the CPU can run ahead of the GPU when using 'Hard GPU Sync'.")
 MSG_HASH(MENU_ENUM_SUBLABEL_VIDEO_MAX_SWAPCHAIN_IMAGES,
@@ -3099,6 +3109,8 @@ MSG_HASH(MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_ENABLE,
       "Perform tasks on a separate thread.")
 MSG_HASH(MENU_ENUM_SUBLABEL_PLAYLIST_ENTRY_REMOVE,
       "Allow the user to remove entries from collections.")
+MSG_HASH(MENU_ENUM_SUBLABEL_PLAYLIST_USE_BINARY,
+      "Store large collections in a binary format that loads faster. Collections go back to text on their next save once this is disabled.")
 MSG_HASH(MENU_ENUM_SUBLABEL_SYSTEM_DIRECTORY,
       "Sets the System directory. Cores can query for this directory to load BIOSes, system-specific configs, etc.")
 MSG_HASH(MENU_ENUM_SUBLABEL_RGUI_BROWSER_DIRECTORY,
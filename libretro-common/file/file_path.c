@@ -107,7 +107,8 @@ enum stat_mode
    IS_VALID
 };
 
-static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
+static bool path_stat(const char *path, enum stat_mode mode,
+      int64_t *size, int64_t *mtime)
 {
 #if defined(VITA) || defined(PSP)
    SceIoStat buf;
@@ -128,10 +129,12 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
     if (cellFsStat(path, &buf) < 0)
        return false;
 #elif defined(_WIN32)
-   struct _stat buf;
+   /* 64-bit sizes and times, plain _stat truncates both */
+   struct __stat64 buf;
    char *path_local;
    wchar_t *path_wide;
    DWORD file_info;
+   int stat_ret;
 
    if (!path || !*path)
       return false;
@@ -144,7 +147,7 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
    path_local = utf8_to_local_string_alloc(path);
    file_info  = GetFileAttributes(path_local);
 
-   _stat(path_local, &buf);
+   stat_ret   = _stat64(path_local, &buf);
 
    if (path_local)
      free(path_local);
@@ -152,7 +155,7 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
    path_wide = utf8_to_utf16_string_alloc(path);
    file_info = GetFileAttributesW(path_wide);
 
-   _wstat(path_wide, &buf);
+   stat_ret  = _wstat64(path_wide, &buf);
 
    if (path_wide)
       free(path_wide);
@@ -160,6 +163,13 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
 
    if (file_info == INVALID_FILE_ATTRIBUTES)
       return false;
+
+   /* _stat rejects directories with a trailing separator,
+    * which GetFileAttributes accepts. That is fine for the
+    * type checks, but without a stat there is no size or
+    * modification time to report. */
+   if (stat_ret != 0 && (size || mtime))
+      return false;
 #else
    struct stat buf;
    if (stat(path, &buf) < 0)
@@ -167,7 +177,17 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
 #endif
 
    if (size)
-      *size = (int32_t)buf.st_size;
+      *size = (int64_t)buf.st_size;
+
+   if (mtime)
+   {
+#if defined(VITA) || defined(PSP)
+      /* SceIoStat only has a broken down date. */
+      *mtime = 0;
+#else
+      *mtime = (int64_t)buf.st_mtime;
+#endif
+   }
 
    switch (mode)
    {
@@ -204,28 +224,62 @@ static bool path_stat(const char *path, enum stat_mode mode, int32_t *size)
  */
 bool path_is_directory(const char *path)
 {
-   return path_stat(path, IS_DIRECTORY, NULL);
+   return path_stat(path, IS_DIRECTORY, NULL, NULL);
 }
 
 bool path_is_character_special(const char *path)
 {
-   return path_stat(path, IS_CHARACTER_SPECIAL, NULL);
+   return path_stat(path, IS_CHARACTER_SPECIAL, NULL, NULL);
 }
 
 bool path_is_valid(const char *path)
 {
-   return path_stat(path, IS_VALID, NULL);
+   return path_stat(path, IS_VALID, NULL, NULL);
 }
 
 int32_t path_get_size(const char *path)
 {
-   int32_t filesize = 0;
-   if (path_stat(path, IS_VALID, &filesize))
-      return filesize;
+   int64_t filesize = 0;
+   if (path_stat(path, IS_VALID, &filesize, NULL))
+      return (int32_t)filesize;
+
+   return -1;
+}
+
+/**
+ * path_get_mtime:
+ * @path               : path
+ *
+ * Gets the last modification time of a file, in seconds
+ * since the epoch. Platforms that cannot report it give 0.
+ *
+ * Returns: modification time, or -1 if path does not exist.
+ */
+int64_t path_get_mtime(const char *path)
+{
+   int64_t mtime = 0;
+   if (path_stat(path, IS_VALID, NULL, &mtime))
+      return mtime;
 
    return -1;
 }
 
+/**
+ * path_get_size_mtime:
+ * @path               : path
+ * @size               : size of the file in bytes
+ * @mtime              : modification time, as path_get_mtime()
+ *
+ * Gets both with a single stat call. Unlike path_get_size(),
+ * the size is not truncated for files over 2 GB.
+ *
+ * Returns: true (1) if path exists, otherwise false (0).
+ */
+bool path_get_size_mtime(const char *path, int64_t *size, int64_t *mtime)
+{
+   return path_stat(path, IS_VALID, size, mtime);
+}
+
 static bool path_mkdir_error(int ret)
 {
 #if defined(VITA)
@@ -29,6 +29,13 @@
 #include <malloc.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define RPNG_NEON
+#endif
+
 #include <boolean.h>
 #include <formats/image.h>
 #include <formats/rpng.h>
@@ -92,6 +99,7 @@ struct rpng_process
    bool inflate_initialized;
    bool adam7_pass_initialized;
    bool pass_initialized;
+   bool streaming;
    uint8_t *prev_scanline;
    uint8_t *decoded_scanline;
    uint8_t *inflate_buf;
@@ -112,6 +120,8 @@ struct rpng_process
    unsigned pass_pos;
    uint32_t *data;
    uint32_t *palette;
+   const uint8_t *idat_next;
+   unsigned idat_left;
    void *stream;
    const struct trans_stream_backend *stream_backend;
 };
@@ -126,6 +136,10 @@ struct rpng
    bool has_trns;
    struct idat_buffer idat_buf;
    struct png_ihdr ihdr;
+   /* Non-interlaced images are inflated straight from the
+    * IDAT chunks in the file buffer, one row at a time. */
+   const uint8_t *idat_first;
+   unsigned idat_count;
    uint8_t *buff_data;
    uint32_t palette[256];
 };
@@ -159,6 +173,24 @@ static enum png_chunk_type png_chunk_type(const struct png_chunk *chunk)
    return PNG_CHUNK_NOOP;
 }
 
+static bool read_chunk_header(uint8_t *buf, struct png_chunk *chunk)
+{
+   unsigned i;
+   uint8_t dword[4];
+
+   dword[0] = '\0';
+
+   for (i = 0; i < 4; i++)
+      dword[i] = buf[i];
+
+   chunk->size = dword_be(dword);
+
+   for (i = 0; i < 4; i++)
+      chunk->type[i] = buf[i + 4];
+
+   return true;
+}
+
 static bool png_process_ihdr(struct png_ihdr *ihdr)
 {
    unsigned i;
@@ -557,7 +589,7 @@ static int png_reverse_filter_init(const struct png_ihdr *ihdr,
 
    png_pass_geom(ihdr, ihdr->width, ihdr->height, &pngp->bpp, &pngp->pitch, &pass_size);
 
-   if (pngp->total_out < pass_size)
+   if (!pngp->streaming && pngp->total_out < pass_size)
       return -1;
 
    pngp->restore_buf_size      = 0;
@@ -578,44 +610,224 @@ error:
    return -1;
 }
 
-static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
-      struct rpng_process *pngp, unsigned filter)
+/* Unfiltering runs one pixel at a time for the common 8-bit
+ * RGB/RGBA layouts, with all channels of a pixel processed at
+ * once. Everything else takes the scalar paths. */
+#if defined(__SSE2__) || defined(RPNG_NEON)
+#define RPNG_SIMD_UNFILTER(bpp) ((bpp) == 3 || (bpp) == 4)
+
+/* Constant sizes, so the copies compile to plain moves. */
+static INLINE uint32_t png_load_pixel(const uint8_t *src, unsigned bpp)
 {
-   unsigned i;
+   uint32_t v = 0;
+   if (bpp == 4)
+      memcpy(&v, src, 4);
+   else
+      memcpy(&v, src, 3);
+   return v;
+}
+
+static INLINE void png_store_pixel(uint8_t *dst, uint32_t v, unsigned bpp)
+{
+   if (bpp == 4)
+      memcpy(dst, &v, 4);
+   else
+      memcpy(dst, &v, 3);
+}
+#else
+#define RPNG_SIMD_UNFILTER(bpp) 0
+#endif
+
+#if defined(__SSE2__)
+#define PNG_LOAD(src)       _mm_cvtsi32_si128((int)png_load_pixel(src, bpp))
+#define PNG_STORE(dst, v)   png_store_pixel(dst, (uint32_t)_mm_cvtsi128_si32(v), bpp)
+#elif defined(RPNG_NEON)
+#define PNG_LOAD(src)       vcreate_u8((uint64_t)png_load_pixel(src, bpp))
+#define PNG_STORE(dst, v)   png_store_pixel(dst, vget_lane_u32(vreinterpret_u32_u8(v), 0), bpp)
+#endif
+
+static void png_reverse_filter_sub(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   if (RPNG_SIMD_UNFILTER(bpp))
+   {
+      __m128i a = _mm_setzero_si128();
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         a = _mm_add_epi8(a, PNG_LOAD(in + i));
+         PNG_STORE(out + i, a);
+      }
+      return;
+   }
+#elif defined(RPNG_NEON)
+   if (RPNG_SIMD_UNFILTER(bpp))
+   {
+      uint8x8_t a = vdup_n_u8(0);
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         a = vadd_u8(a, PNG_LOAD(in + i));
+         PNG_STORE(out + i, a);
+      }
+      return;
+   }
+#endif
+
+   for (; i < bpp; i++)
+      out[i] = in[i];
+   for (; i < pitch; i++)
+      out[i] = out[i - bpp] + in[i];
+}
+
+static void png_reverse_filter_up(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   for (; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(in + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#elif defined(RPNG_NEON)
+   for (; i + 16 <= pitch; i += 16)
+      vst1q_u8(out + i, vaddq_u8(vld1q_u8(in + i), vld1q_u8(prev + i)));
+#endif
+
+   for (; i < pitch; i++)
+      out[i] = prev[i] + in[i];
+}
+
+static void png_reverse_filter_avg(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   if (RPNG_SIMD_UNFILTER(bpp))
+   {
+      __m128i one = _mm_set1_epi8(1);
+      __m128i a   = _mm_setzero_si128();
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         __m128i b   = PNG_LOAD(prev + i);
+         /* PAVGB rounds up, PNG rounds down. */
+         __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+               _mm_and_si128(_mm_xor_si128(a, b), one));
+         a           = _mm_add_epi8(avg, PNG_LOAD(in + i));
+         PNG_STORE(out + i, a);
+      }
+      return;
+   }
+#elif defined(RPNG_NEON)
+   if (RPNG_SIMD_UNFILTER(bpp))
+   {
+      uint8x8_t a = vdup_n_u8(0);
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         a = vadd_u8(vhadd_u8(a, PNG_LOAD(prev + i)), PNG_LOAD(in + i));
+         PNG_STORE(out + i, a);
+      }
+      return;
+   }
+#endif
+
+   for (; i < bpp; i++)
+      out[i] = (prev[i] >> 1) + in[i];
+   for (; i < pitch; i++)
+      out[i] = ((out[i - bpp] + prev[i]) >> 1) + in[i];
+}
+
+static void png_reverse_filter_paeth(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   if (RPNG_SIMD_UNFILTER(bpp))
+   {
+      __m128i zero = _mm_setzero_si128();
+      __m128i a    = zero;
+      __m128i c    = zero;
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         __m128i b    = _mm_unpacklo_epi8(PNG_LOAD(prev + i), zero);
+         __m128i pa   = _mm_sub_epi16(b, c);
+         __m128i pb   = _mm_sub_epi16(a, c);
+         __m128i pc   = _mm_add_epi16(pa, pb);
+         __m128i not_a, not_b, pred;
+
+         pa    = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+         pb    = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+         pc    = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+         /* Ties go to a, then b, as in paeth(). */
+         not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+         not_b = _mm_cmpgt_epi16(pb, pc);
+         pred  = _mm_or_si128(_mm_and_si128(not_b, c), _mm_andnot_si128(not_b, b));
+         pred  = _mm_or_si128(_mm_and_si128(not_a, pred), _mm_andnot_si128(not_a, a));
+
+         a     = _mm_unpacklo_epi8(_mm_add_epi8(
+                  _mm_packus_epi16(pred, pred), PNG_LOAD(in + i)), zero);
+         c     = b;
+         PNG_STORE(out + i, _mm_packus_epi16(a, a));
+      }
+      return;
+   }
+#elif defined(RPNG_NEON)
+   if (RPNG_SIMD_UNFILTER(bpp))
+   {
+      uint8x8_t a = vdup_n_u8(0);
+      uint8x8_t c = vdup_n_u8(0);
+      for (; i + bpp <= pitch; i += bpp)
+      {
+         uint8x8_t b    = PNG_LOAD(prev + i);
+         uint16x8_t pa  = vabdl_u8(b, c);
+         uint16x8_t pb  = vabdl_u8(a, c);
+         uint16x8_t pc  = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));
+         uint8x8_t is_a = vmovn_u16(vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc)));
+         uint8x8_t is_b = vmovn_u16(vcleq_u16(pb, pc));
+         uint8x8_t pred = vbsl_u8(is_a, a, vbsl_u8(is_b, b, c));
+
+         a              = vadd_u8(pred, PNG_LOAD(in + i));
+         c              = b;
+         PNG_STORE(out + i, a);
+      }
+      return;
+   }
+#endif
+
+   for (; i < bpp; i++)
+      out[i] = paeth(0, prev[i], 0) + in[i];
+   for (; i < pitch; i++)
+      out[i] = paeth(out[i - bpp], prev[i], prev[i - bpp]) + in[i];
+}
 
+static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
+      struct rpng_process *pngp, unsigned filter, const uint8_t *in)
+{
    switch (filter)
    {
       case PNG_FILTER_NONE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
+         memcpy(pngp->decoded_scanline, in, pngp->pitch);
          break;
       case PNG_FILTER_SUB:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->decoded_scanline[i - pngp->bpp] + pngp->inflate_buf[i];
+         png_reverse_filter_sub(pngp->decoded_scanline, in,
+               pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_UP:
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->prev_scanline[i] + pngp->inflate_buf[i];
+         png_reverse_filter_up(pngp->decoded_scanline, in,
+               pngp->prev_scanline, pngp->pitch);
          break;
       case PNG_FILTER_AVERAGE:
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-         {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
+         png_reverse_filter_avg(pngp->decoded_scanline, in,
+               pngp->prev_scanline, pngp->pitch, pngp->bpp);
          break;
       case PNG_FILTER_PAETH:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = paeth(0, pngp->prev_scanline[i], 0) + pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]) + pngp->inflate_buf[i];
+         png_reverse_filter_paeth(pngp->decoded_scanline, in,
+               pngp->prev_scanline, pngp->pitch, pngp->bpp);
          break;
 
       default:
@@ -658,7 +870,7 @@ static int png_reverse_filter_regular_iterate(uint32_t **data, const struct png_
       unsigned filter = *pngp->inflate_buf++;
       pngp->restore_buf_size += 1;
       ret = png_reverse_filter_copy_line(*data,
-            ihdr, pngp, filter);
+            ihdr, pngp, filter, pngp->inflate_buf);
    }
 
    if (ret == IMAGE_PROCESS_END || ret == IMAGE_PROCESS_ERROR_END)
@@ -757,11 +969,106 @@ static int png_reverse_filter_adam7(uint32_t **data_,
    return ret;
 }
 
+static bool png_stream_next_idat(struct rpng_process *pngp)
+{
+   while (pngp->idat_left)
+   {
+      struct png_chunk chunk;
+      const uint8_t *buf = pngp->idat_next;
+
+      read_chunk_header((uint8_t*)buf, &chunk);
+      pngp->idat_next += chunk.size + 12;
+
+      /* Chunks were validated by rpng_iterate_image(). */
+      if (memcmp(chunk.type, "IDAT", 4) != 0)
+         continue;
+
+      pngp->idat_left--;
+
+      if (!chunk.size)
+         continue;
+
+      pngp->stream_backend->set_in(pngp->stream, buf + 8, chunk.size);
+      pngp->avail_in = chunk.size;
+      return true;
+   }
+
+   return false;
+}
+
+/* Inflates the next filter byte and scanline into inflate_buf,
+ * pulling in IDAT chunks as needed. */
+static bool png_stream_inflate_row(struct rpng_process *pngp)
+{
+   size_t filled   = 0;
+   size_t row_size = pngp->pitch + 1;
+
+   while (filled < row_size)
+   {
+      uint32_t rd                    = 0;
+      uint32_t wn                    = 0;
+      enum trans_stream_error terror = TRANS_STREAM_ERROR_NONE;
+
+      if (!pngp->avail_in && !png_stream_next_idat(pngp))
+         return false;
+
+      pngp->stream_backend->set_out(pngp->stream,
+            pngp->inflate_buf + filled, (uint32_t)(row_size - filled));
+
+      if (!pngp->stream_backend->trans(pngp->stream, false, &rd, &wn, &terror)
+            && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+         return false;
+
+      pngp->avail_in -= rd;
+      filled         += wn;
+
+      /* zlib stream ended before the image did */
+      if (terror == TRANS_STREAM_ERROR_NONE && filled < row_size)
+         return false;
+   }
+
+   return true;
+}
+
+static int png_reverse_filter_stream_iterate(uint32_t **data,
+      const struct png_ihdr *ihdr, struct rpng_process *pngp)
+{
+   int ret = IMAGE_PROCESS_END;
+
+   if (pngp->h < ihdr->height)
+   {
+      if (png_stream_inflate_row(pngp))
+         ret = png_reverse_filter_copy_line(*data, ihdr, pngp,
+               pngp->inflate_buf[0], pngp->inflate_buf + 1);
+      else
+         ret = IMAGE_PROCESS_ERROR_END;
+   }
+
+   if (ret == IMAGE_PROCESS_END || ret == IMAGE_PROCESS_ERROR_END)
+   {
+      png_reverse_filter_deinit(pngp);
+
+      *data                      -= pngp->data_restore_buf_size;
+      pngp->data_restore_buf_size = 0;
+      return ret;
+   }
+
+   pngp->h++;
+   *data                       += ihdr->width;
+   pngp->data_restore_buf_size += ihdr->width;
+
+   return IMAGE_PROCESS_NEXT;
+}
+
 static int png_reverse_filter_iterate(rpng_t *rpng, uint32_t **data)
 {
    if (!rpng)
       return false;
 
+   if (rpng->process && rpng->process->streaming)
+      return png_reverse_filter_stream_iterate(data,
+            &rpng->ihdr, rpng->process);
+
    if (rpng->ihdr.interlace && rpng->process)
       return png_reverse_filter_adam7(data, &rpng->ihdr, rpng->process);
 
@@ -778,6 +1085,10 @@ static int rpng_load_image_argb_process_inflate_init(rpng_t *rpng,
    bool to_continue        = (process->avail_in > 0
          && process->avail_out > 0);
 
+   /* Inflating happens row by row while unfiltering. */
+   if (process->streaming)
+      goto init_output;
+
    if (!to_continue)
       goto end;
 
@@ -797,6 +1108,7 @@ end:
    process->stream_backend->stream_free(process->stream);
    process->stream = NULL;
 
+init_output:
    *width  = rpng->ihdr.width;
    *height = rpng->ihdr.height;
 #ifdef GEKKO
@@ -875,11 +1187,24 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng, unsigned *width, uns
       return NULL;
 
    process->stream_backend = trans_stream_get_zlib_inflate_backend();
+   process->streaming      = rpng->idat_first != NULL;
 
-   png_pass_geom(&rpng->ihdr, rpng->ihdr.width,
-         rpng->ihdr.height, NULL, NULL, &process->inflate_buf_size);
-   if (rpng->ihdr.interlace == 1) /* To be sure. */
-      process->inflate_buf_size *= 2;
+   if (process->streaming)
+   {
+      unsigned pitch = 0;
+
+      /* Only a single filtered scanline is kept around. */
+      png_pass_geom(&rpng->ihdr, rpng->ihdr.width,
+            rpng->ihdr.height, NULL, &pitch, NULL);
+      process->inflate_buf_size = pitch + 1;
+   }
+   else
+   {
+      png_pass_geom(&rpng->ihdr, rpng->ihdr.width,
+            rpng->ihdr.height, NULL, NULL, &process->inflate_buf_size);
+      if (rpng->ihdr.interlace == 1) /* To be sure. */
+         process->inflate_buf_size *= 2;
+   }
 
    process->stream = process->stream_backend->stream_new();
 
@@ -894,6 +1219,15 @@ static struct rpng_process *rpng_process_init(rpng_t *rpng, unsigned *width, uns
       goto error;
 
    process->inflate_buf = inflate_buf;
+
+   if (process->streaming)
+   {
+      process->idat_next = rpng->idat_first;
+      process->idat_left = rpng->idat_count;
+      process->avail_in  = 0;
+      return process;
+   }
+
    process->avail_in = rpng->idat_buf.size;
    process->avail_out = process->inflate_buf_size;
    process->total_out = 0;
@@ -918,24 +1252,6 @@ error:
    return NULL;
 }
 
-static bool read_chunk_header(uint8_t *buf, struct png_chunk *chunk)
-{
-   unsigned i;
-   uint8_t dword[4];
-
-   dword[0] = '\0';
-
-   for (i = 0; i < 4; i++)
-      dword[i] = buf[i];
-
-   chunk->size = dword_be(dword);
-
-   for (i = 0; i < 4; i++)
-      chunk->type[i] = buf[i + 4];
-
-   return true;
-}
-
 static bool png_parse_ihdr(uint8_t *buf,
       struct png_ihdr *ihdr)
 {
@@ -1046,6 +1362,16 @@ bool rpng_iterate_image(rpng_t *rpng)
          if (!(rpng->has_ihdr) || rpng->has_iend || (rpng->ihdr.color_type == PNG_IHDR_COLOR_PLT && !(rpng->has_plte)))
             goto error;
 
+         if (!rpng->ihdr.interlace)
+         {
+            /* Left in place, see rpng_process_init(). */
+            if (!rpng->idat_first)
+               rpng->idat_first = buf;
+            rpng->idat_count++;
+            rpng->has_idat = true;
+            break;
+         }
+
          if (!png_realloc_idat(&chunk, &rpng->idat_buf))
             goto error;
 
@@ -24,12 +24,28 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <encodings/crc32.h>
+#include <features/features_cpu.h>
 #include <streams/file_stream.h>
 #include <streams/trans_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include "rpng_internal.h"
 
+/* Uncompressed bytes per band, see struct rpng_encoder. */
+#define RPNG_ENCODE_CHUNK_SIZE  (256 * 1024)
+#define RPNG_ENCODE_MAX_THREADS 16
+
+#define PNG_ADLER_BASE          65521u
+#define PNG_DEFLATE_WINDOW_BITS 15
+
 #undef GOTO_END_ERROR
 #define GOTO_END_ERROR() do { \
    fprintf(stderr, "[RPNG]: Error in line %d.\n", __LINE__); \
@@ -147,9 +163,27 @@ static void copy_bgr24_line(uint8_t *dst, const uint8_t *src, unsigned width)
 
 static unsigned count_sad(const uint8_t *data, size_t size)
 {
-   size_t i;
+   size_t i     = 0;
    unsigned cnt = 0;
-   for (i = 0; i < size; i++)
+#if defined(__SSE2__)
+   __m128i zero = _mm_setzero_si128();
+   __m128i sum  = _mm_setzero_si128();
+
+   /* |x| of a signed byte is (x ^ m) - m, with m = (x < 0) ? -1 : 0.
+    * The result fits an unsigned byte, which PSADBW sums up. */
+   for (; i + 16 <= size; i += 16)
+   {
+      __m128i x    = _mm_loadu_si128((const __m128i*)(data + i));
+      __m128i sign = _mm_cmpgt_epi8(zero, x);
+      __m128i absx = _mm_sub_epi8(_mm_xor_si128(x, sign), sign);
+      sum          = _mm_add_epi64(sum, _mm_sad_epu8(absx, zero));
+   }
+
+   cnt = (unsigned)_mm_cvtsi128_si32(sum)
+      + (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#endif
+
+   for (; i < size; i++)
       cnt += abs((int8_t)data[i]);
    return cnt;
 }
@@ -157,9 +191,15 @@ static unsigned count_sad(const uint8_t *data, size_t size)
 static unsigned filter_up(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
-   width *= bpp;
-   for (i = 0; i < width; i++)
+   unsigned i = 0;
+   width     *= bpp;
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - prev[i];
 
    return count_sad(target, width);
@@ -205,36 +245,336 @@ static unsigned filter_paeth(uint8_t *target,
    return count_sad(target, width);
 }
 
+/* Filters one row, trying every filtering method and choosing
+ * the one which has most entries close to zero.
+ *
+ * This is probably not very optimal, but it's very
+ * simple to implement.
+ */
+static void png_filter_row(uint8_t *target, const uint8_t *line,
+      const uint8_t *prev, uint8_t *scratch,
+      unsigned width, unsigned bpp)
+{
+   size_t line_size       = width * bpp;
+   uint8_t *up_filtered    = scratch;
+   uint8_t *sub_filtered   = scratch + line_size;
+   uint8_t *avg_filtered   = scratch + line_size * 2;
+   uint8_t *paeth_filtered = scratch + line_size * 3;
+
+   unsigned none_score  = count_sad(line, line_size);
+   unsigned up_score    = filter_up(up_filtered, line, prev, width, bpp);
+   unsigned sub_score   = filter_sub(sub_filtered, line, width, bpp);
+   unsigned avg_score   = filter_avg(avg_filtered, line, prev, width, bpp);
+   unsigned paeth_score = filter_paeth(paeth_filtered, line, prev, width, bpp);
+
+   uint8_t filter       = 0;
+   unsigned min_sad     = none_score;
+   const uint8_t *chosen_filtered = line;
+
+   if (sub_score < min_sad)
+   {
+      filter = 1;
+      chosen_filtered = sub_filtered;
+      min_sad = sub_score;
+   }
+
+   if (up_score < min_sad)
+   {
+      filter = 2;
+      chosen_filtered = up_filtered;
+      min_sad = up_score;
+   }
+
+   if (avg_score < min_sad)
+   {
+      filter = 3;
+      chosen_filtered = avg_filtered;
+      min_sad = avg_score;
+   }
+
+   if (paeth_score < min_sad)
+   {
+      filter = 4;
+      chosen_filtered = paeth_filtered;
+   }
+
+   *target++ = filter;
+   memcpy(target, chosen_filtered, line_size);
+}
+
+static uint32_t png_adler32(uint32_t adler, const uint8_t *data, size_t size)
+{
+   uint32_t a = adler & 0xffff;
+   uint32_t b = adler >> 16;
+
+   while (size)
+   {
+      /* Largest n such that b cannot overflow. */
+      size_t n = size < 5552 ? size : 5552;
+      size    -= n;
+
+      while (n--)
+      {
+         a += *data++;
+         b += a;
+      }
+
+      a %= PNG_ADLER_BASE;
+      b %= PNG_ADLER_BASE;
+   }
+
+   return (b << 16) | a;
+}
+
+/* Adler-32 of A followed by B, given adler32(A), adler32(B)
+ * and the length of B. Same as zlib's adler32_combine(). */
+static uint32_t png_adler32_combine(uint32_t adler1,
+      uint32_t adler2, size_t len2)
+{
+   uint32_t rem  = (uint32_t)(len2 % PNG_ADLER_BASE);
+   uint32_t sum1 = adler1 & 0xffff;
+   uint32_t sum2 = (rem * sum1) % PNG_ADLER_BASE;
+
+   sum1 += (adler2 & 0xffff) + PNG_ADLER_BASE - 1;
+   sum2 += (adler1 >> 16) + (adler2 >> 16) + PNG_ADLER_BASE - rem;
+
+   if (sum1 >= PNG_ADLER_BASE)
+      sum1 -= PNG_ADLER_BASE;
+   if (sum1 >= PNG_ADLER_BASE)
+      sum1 -= PNG_ADLER_BASE;
+   if (sum2 >= (PNG_ADLER_BASE << 1))
+      sum2 -= (PNG_ADLER_BASE << 1);
+   if (sum2 >= PNG_ADLER_BASE)
+      sum2 -= PNG_ADLER_BASE;
+
+   return (sum2 << 16) | sum1;
+}
+
+/* The image is cut into bands of rows. Every band is filtered
+ * and deflated on its own (raw deflate, ending in a sync flush),
+ * so bands can be encoded in parallel and the concatenated
+ * output still forms a single zlib stream. Each band is written
+ * out as its own IDAT chunk as soon as it (and every band before
+ * it) is done. */
+struct rpng_encode_chunk
+{
+   uint8_t *deflated;      /* IDAT header space + zlib data */
+   size_t deflated_size;
+   size_t filtered_size;
+   uint32_t adler;
+   unsigned first_row;
+   unsigned num_rows;
+   bool done;
+   bool ok;
+};
+
+struct rpng_encoder
+{
+   const uint8_t *data;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   unsigned bpp;
+
+   struct rpng_encode_chunk *chunks;
+   unsigned num_chunks;
+
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+   unsigned next_chunk;    /* next band to be encoded */
+   unsigned write_chunk;   /* next band to be written */
+   unsigned max_in_flight;
+   bool failed;
+#endif
+};
+
+static void png_convert_row(const struct rpng_encoder *enc,
+      uint8_t *dst, unsigned row)
+{
+   const uint8_t *src = enc->data + (size_t)row * enc->pitch;
+
+   if (enc->bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, enc->width);
+   else
+      copy_bgr24_line(dst, src, enc->width);
+}
+
+static bool png_encode_chunk(const struct rpng_encoder *enc,
+      struct rpng_encode_chunk *chunk, bool last)
+{
+   unsigned h;
+   uint32_t total_in       = 0;
+   uint32_t total_out      = 0;
+   bool ret                = true;
+   void *stream            = NULL;
+   enum trans_stream_error error = TRANS_STREAM_ERROR_NONE;
+   size_t line_size        = enc->width * enc->bpp;
+   size_t bound            = 0;
+   uint8_t *filtered       = NULL;
+   uint8_t *target         = NULL;
+   uint8_t *line           = (uint8_t*)malloc(line_size);
+   uint8_t *prev           = (uint8_t*)calloc(1, line_size);
+   uint8_t *scratch        = (uint8_t*)malloc(line_size * 4);
+   const struct trans_stream_backend *stream_backend =
+      trans_stream_get_zlib_deflate_backend();
+
+   chunk->filtered_size    = (line_size + 1) * chunk->num_rows;
+   filtered                = (uint8_t*)malloc(chunk->filtered_size);
+
+   if (!line || !prev || !scratch || !filtered)
+      GOTO_END_ERROR();
+
+   /* Up, average and paeth look at the unfiltered row above,
+    * which belongs to the previous band. */
+   if (chunk->first_row > 0)
+      png_convert_row(enc, prev, chunk->first_row - 1);
+
+   target = filtered;
+   for (h = 0; h < chunk->num_rows; h++, target += line_size + 1)
+   {
+      uint8_t *tmp;
+
+      png_convert_row(enc, line, chunk->first_row + h);
+      png_filter_row(target, line, prev, scratch, enc->width, enc->bpp);
+
+      tmp  = prev;
+      prev = line;
+      line = tmp;
+   }
+
+   chunk->adler = png_adler32(1, filtered, chunk->filtered_size);
+
+   /* Worst case expansion of deflate is 5 bytes per 16K block,
+    * plus a few bytes for the flush marker. The first 10 bytes
+    * are reserved for the IDAT length/type and the zlib header,
+    * the last 4 for the Adler-32 trailer. */
+   bound           = chunk->filtered_size + (chunk->filtered_size >> 12)
+      + (chunk->filtered_size >> 14) + 64;
+   chunk->deflated = (uint8_t*)malloc(10 + bound + 4);
+   if (!chunk->deflated)
+      GOTO_END_ERROR();
+
+   stream = stream_backend->stream_new();
+   if (!stream)
+      GOTO_END_ERROR();
+
+   stream_backend->define(stream, "window_bits", (uint32_t)-PNG_DEFLATE_WINDOW_BITS);
+   if (!last)
+      stream_backend->define(stream, "sync_flush", 1);
+
+   stream_backend->set_in(stream, filtered, (uint32_t)chunk->filtered_size);
+   stream_backend->set_out(stream, chunk->deflated + 10, (uint32_t)bound);
+
+   if (!stream_backend->trans(stream, true, &total_in, &total_out, &error)
+         || error != TRANS_STREAM_ERROR_NONE)
+      GOTO_END_ERROR();
+
+   chunk->deflated_size = total_out;
+
+end:
+   if (stream)
+      stream_backend->stream_free(stream);
+   free(line);
+   free(prev);
+   free(scratch);
+   free(filtered);
+   return ret;
+}
+
+static bool png_write_chunk(RFILE *file, struct rpng_encode_chunk *chunk,
+      bool first, bool last, uint32_t *adler)
+{
+   uint8_t *idat = chunk->deflated + 2;
+   size_t size   = chunk->deflated_size;
+
+   if (first)
+   {
+      /* zlib header: deflate, 32K window, best compression */
+      chunk->deflated[8] = 0x78;
+      chunk->deflated[9] = 0xda;
+      idat               = chunk->deflated;
+      size              += 2;
+      *adler             = chunk->adler;
+   }
+   else
+      *adler = png_adler32_combine(*adler, chunk->adler,
+            chunk->filtered_size);
+
+   if (last)
+   {
+      dword_write_be(idat + 8 + size, *adler);
+      size += 4;
+   }
+
+   dword_write_be(idat + 0, (uint32_t)size);
+   memcpy(idat + 4, "IDAT", 4);
+
+   return png_write_idat(file, idat, size + 8);
+}
+
+#ifdef HAVE_THREADS
+static void png_encode_worker(void *data)
+{
+   struct rpng_encoder *enc = (struct rpng_encoder*)data;
+
+   for (;;)
+   {
+      unsigned index;
+      bool ok;
+
+      slock_lock(enc->lock);
+      /* Bound memory use by not running too far ahead of the writer. */
+      while (!enc->failed && enc->next_chunk < enc->num_chunks &&
+            enc->next_chunk >= enc->write_chunk + enc->max_in_flight)
+         scond_wait(enc->cond, enc->lock);
+
+      if (enc->failed || enc->next_chunk >= enc->num_chunks)
+      {
+         slock_unlock(enc->lock);
+         break;
+      }
+      index = enc->next_chunk++;
+      slock_unlock(enc->lock);
+
+      ok = png_encode_chunk(enc, &enc->chunks[index],
+            index + 1 == enc->num_chunks);
+
+      slock_lock(enc->lock);
+      enc->chunks[index].ok   = ok;
+      enc->chunks[index].done = true;
+      if (!ok)
+         enc->failed = true;
+      scond_broadcast(enc->cond);
+      slock_unlock(enc->lock);
+   }
+}
+#endif
+
 static bool rpng_save_image(const char *path,
       const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch, unsigned bpp)
 {
-   unsigned h;
-   bool ret = true;
+   unsigned i;
+   struct rpng_encoder enc;
+   bool ret             = true;
+   uint32_t adler       = 1;
+   unsigned rows        = 0;
    struct png_ihdr ihdr = {0};
-
-   const struct trans_stream_backend *stream_backend = NULL;
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   uint32_t total_in       = 0;
-   uint32_t total_out      = 0;
-   RFILE *file             = filestream_open(path,
+#ifdef HAVE_THREADS
+   sthread_t *workers[RPNG_ENCODE_MAX_THREADS];
+   unsigned num_workers = 1;
+   unsigned num_started = 0;
+#endif
+   RFILE *file          = filestream_open(path,
          RETRO_VFS_FILE_ACCESS_WRITE,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   memset(&enc, 0, sizeof(enc));
+
    if (!file)
       GOTO_END_ERROR();
 
-   stream_backend = trans_stream_get_zlib_deflate_backend();
-
    if (filestream_write(file, png_magic, sizeof(png_magic)) != sizeof(png_magic))
       GOTO_END_ERROR();
 
@@ -245,134 +585,131 @@ static bool rpng_save_image(const char *path,
    if (!png_write_ihdr(file, &ihdr))
       GOTO_END_ERROR();
 
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
+   enc.data   = data;
+   enc.width  = width;
+   enc.height = height;
+   enc.pitch  = pitch;
+   enc.bpp    = bpp;
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+   rows       = RPNG_ENCODE_CHUNK_SIZE / (width * bpp + 1);
+   if (rows < 1)
+      rows    = 1;
+
+   enc.num_chunks = (height + rows - 1) / rows;
+   if (enc.num_chunks < 1)
+      enc.num_chunks = 1;
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
+   enc.chunks = (struct rpng_encode_chunk*)
+      calloc(enc.num_chunks, sizeof(*enc.chunks));
+   if (!enc.chunks)
       GOTO_END_ERROR();
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+   for (i = 0; i < enc.num_chunks; i++)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
-
-      /* Try every filtering method, and choose the method
-       * which has most entries as zero.
-       *
-       * This is probably not very optimal, but it's very
-       * simple to implement.
-       */
-      {
-         unsigned none_score  = count_sad(rgba_line, width * bpp);
-         unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
-         unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
-         unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
-         unsigned paeth_score = filter_paeth(paeth_filtered, rgba_line, prev_encoded, width, bpp);
-
-         uint8_t filter       = 0;
-         unsigned min_sad     = none_score;
-         const uint8_t *chosen_filtered = rgba_line;
-
-         if (sub_score < min_sad)
-         {
-            filter = 1;
-            chosen_filtered = sub_filtered;
-            min_sad = sub_score;
-         }
+      enc.chunks[i].first_row = i * rows;
+      enc.chunks[i].num_rows  = (i + 1 == enc.num_chunks)
+         ? height - i * rows : rows;
+   }
 
-         if (up_score < min_sad)
-         {
-            filter = 2;
-            chosen_filtered = up_filtered;
-            min_sad = up_score;
-         }
+#ifdef HAVE_THREADS
+   num_workers = cpu_features_get_core_amount();
+   if (num_workers > RPNG_ENCODE_MAX_THREADS)
+      num_workers = RPNG_ENCODE_MAX_THREADS;
+   if (num_workers > enc.num_chunks)
+      num_workers = enc.num_chunks;
 
-         if (avg_score < min_sad)
-         {
-            filter = 3;
-            chosen_filtered = avg_filtered;
-            min_sad = avg_score;
-         }
+   if (num_workers > 1)
+   {
+      enc.lock          = slock_new();
+      enc.cond          = scond_new();
+      enc.max_in_flight = num_workers * 2;
 
-         if (paeth_score < min_sad)
+      if (enc.lock && enc.cond)
+      {
+         for (; num_started < num_workers; num_started++)
          {
-            filter = 4;
-            chosen_filtered = paeth_filtered;
+            workers[num_started] = sthread_create(png_encode_worker, &enc);
+            if (!workers[num_started])
+               break;
          }
-
-         *encode_target++ = filter;
-         memcpy(encode_target, chosen_filtered, width * bpp);
-
-         memcpy(prev_encoded, rgba_line, width * bpp);
       }
    }
 
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
-      GOTO_END_ERROR();
+   if (num_started)
+   {
+      for (i = 0; i < enc.num_chunks; i++)
+      {
+         bool ok;
+
+         slock_lock(enc.lock);
+         while (!enc.chunks[i].done && !enc.failed)
+            scond_wait(enc.cond, enc.lock);
+         ok = enc.chunks[i].done && enc.chunks[i].ok;
+         slock_unlock(enc.lock);
+
+         if (ok)
+            ok = png_write_chunk(file, &enc.chunks[i],
+                  i == 0, i + 1 == enc.num_chunks, &adler);
+
+         free(enc.chunks[i].deflated);
+         enc.chunks[i].deflated = NULL;
+
+         slock_lock(enc.lock);
+         enc.write_chunk = i + 1;
+         if (!ok)
+            enc.failed   = true;
+         scond_broadcast(enc.cond);
+         slock_unlock(enc.lock);
+
+         if (!ok)
+            break;
+      }
 
-   stream = stream_backend->stream_new();
+      for (i = 0; i < num_started; i++)
+         sthread_join(workers[i]);
 
-   if (!stream)
-      GOTO_END_ERROR();
+      if (enc.failed)
+         GOTO_END_ERROR();
+   }
+   else
+#endif
+   {
+      for (i = 0; i < enc.num_chunks; i++)
+      {
+         bool ok = png_encode_chunk(&enc, &enc.chunks[i],
+               i + 1 == enc.num_chunks)
+            && png_write_chunk(file, &enc.chunks[i],
+                  i == 0, i + 1 == enc.num_chunks, &adler);
 
-   stream_backend->set_in(
-         stream,
-         encode_buf,
-         (unsigned)encode_buf_size);
-   stream_backend->set_out(
-         stream,
-         deflate_buf + 8,
-         (unsigned)(encode_buf_size * 2));
+         free(enc.chunks[i].deflated);
+         enc.chunks[i].deflated = NULL;
 
-   if (!stream_backend->trans(stream, true, &total_in, &total_out, NULL))
-   {
-      GOTO_END_ERROR();
+         if (!ok)
+            GOTO_END_ERROR();
+      }
    }
 
-   memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0,        ((uint32_t)total_out));
-   if (!png_write_idat(file, deflate_buf, ((size_t)total_out + 8)))
-      GOTO_END_ERROR();
-
    if (!png_write_iend(file))
       GOTO_END_ERROR();
 
 end:
    if (file)
       filestream_close(file);
-   free(encode_buf);
-   free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
-
-   if (stream_backend)
+
+   if (enc.chunks)
    {
-      if (stream)
-      {
-         if (stream_backend->stream_free)
-            stream_backend->stream_free(stream);
-      }
+      for (i = 0; i < enc.num_chunks; i++)
+         free(enc.chunks[i].deflated);
+      free(enc.chunks);
    }
+
+#ifdef HAVE_THREADS
+   if (enc.lock)
+      slock_free(enc.lock);
+   if (enc.cond)
+      scond_free(enc.cond);
+#endif
+
    return ret;
 }
 
@@ -0,0 +1,172 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rqoi_encode.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <streams/file_stream.h>
+#include <formats/rqoi.h>
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+
+#define QOI_HASH(r, g, b) (((r) * 3 + (g) * 5 + (b) * 7 + 255 * 11) & 63)
+
+static void qoi_write_be32(uint8_t *out, uint32_t v)
+{
+   out[0] = (uint8_t)(v >> 24);
+   out[1] = (uint8_t)(v >> 16);
+   out[2] = (uint8_t)(v >>  8);
+   out[3] = (uint8_t)(v >>  0);
+}
+
+bool rqoi_save_image_bgr24(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   unsigned x, y;
+   uint8_t header[14];
+   static const uint8_t padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+   /* Pixels are kept as opaque ARGB, the index starts out
+    * transparent black so it never matches by accident. */
+   uint32_t index[64];
+   uint32_t prev  = 0xff000000;
+   unsigned run   = 0;
+   bool ret       = false;
+   uint8_t *line  = NULL;
+   RFILE *file    = NULL;
+
+   if (!data || !width || !height)
+      return false;
+
+   /* Worst case is QOI_OP_RGB for every pixel. */
+   line = (uint8_t*)malloc(width * 4 + 1);
+   if (!line)
+      return false;
+
+   file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      goto end;
+
+   memcpy(header, "qoif", 4);
+   qoi_write_be32(header + 4, width);
+   qoi_write_be32(header + 8, height);
+   header[12] = 3; /* RGB */
+   header[13] = 0; /* sRGB with linear alpha */
+
+   if (filestream_write(file, header, sizeof(header)) != sizeof(header))
+      goto end;
+
+   memset(index, 0, sizeof(index));
+
+   for (y = 0; y < height; y++, data += pitch)
+   {
+      const uint8_t *src = data;
+      uint8_t *out       = line;
+      bool last_row      = (y == height - 1);
+
+      for (x = 0; x < width; x++, src += 3)
+      {
+         uint8_t r  = src[2];
+         uint8_t g  = src[1];
+         uint8_t b  = src[0];
+         uint32_t px = 0xff000000 | ((uint32_t)r << 16)
+            | ((uint32_t)g << 8) | b;
+
+         if (px == prev)
+         {
+            run++;
+            if (run == 62 || (last_row && x == width - 1))
+            {
+               *out++ = QOI_OP_RUN | (run - 1);
+               run    = 0;
+            }
+            continue;
+         }
+
+         if (run)
+         {
+            *out++ = QOI_OP_RUN | (run - 1);
+            run    = 0;
+         }
+
+         {
+            unsigned hash = QOI_HASH(r, g, b);
+
+            if (index[hash] == px)
+               *out++ = QOI_OP_INDEX | hash;
+            else
+            {
+               int8_t vr   = (int8_t)(r - (uint8_t)(prev >> 16));
+               int8_t vg   = (int8_t)(g - (uint8_t)(prev >>  8));
+               int8_t vb   = (int8_t)(b - (uint8_t)(prev >>  0));
+               int vg_r    = vr - vg;
+               int vg_b    = vb - vg;
+
+               index[hash] = px;
+
+               if (     vr > -3 && vr < 2
+                     && vg > -3 && vg < 2
+                     && vb > -3 && vb < 2)
+                  *out++ = QOI_OP_DIFF | ((vr + 2) << 4)
+                     | ((vg + 2) << 2) | (vb + 2);
+               else if (vg_r >  -9 && vg_r <  8
+                     && vg   > -33 && vg   < 32
+                     && vg_b >  -9 && vg_b <  8)
+               {
+                  *out++ = QOI_OP_LUMA | (vg + 32);
+                  *out++ = ((vg_r + 8) << 4) | (vg_b + 8);
+               }
+               else
+               {
+                  *out++ = QOI_OP_RGB;
+                  *out++ = r;
+                  *out++ = g;
+                  *out++ = b;
+               }
+            }
+         }
+
+         prev = px;
+      }
+
+      if (filestream_write(file, line, out - line) != out - line)
+         goto end;
+   }
+
+   if (filestream_write(file, padding, sizeof(padding)) != sizeof(padding))
+      goto end;
+
+   ret = true;
+
+end:
+   if (file)
+      filestream_close(file);
+   free(line);
+   return ret;
+}
@@ -0,0 +1,86 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rtga_encode.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <streams/file_stream.h>
+#include <formats/rtga.h>
+
+/**
+ * rtga_save_image_bgr24:
+ * @path               : path of the file to write.
+ * @data               : top-down BGR24 pixels.
+ * @width              : width of the image.
+ * @height             : height of the image.
+ * @pitch              : length of a row of @data, in bytes.
+ *
+ * Writes an uncompressed 24-bit truecolor TGA. There is no
+ * compression step at all, so this is the cheapest format to
+ * produce from a converted frame.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool rtga_save_image_bgr24(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   unsigned y;
+   uint8_t header[18];
+   bool ret    = false;
+   RFILE *file = NULL;
+
+   if (!data || !width || !height || width > 0xffff || height > 0xffff)
+      return false;
+
+   file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   memset(header, 0, sizeof(header));
+
+   /* Uncompressed truecolor */
+   header[2]  = 2;
+   header[12] = (uint8_t)(width  >> 0);
+   header[13] = (uint8_t)(width  >> 8);
+   header[14] = (uint8_t)(height >> 0);
+   header[15] = (uint8_t)(height >> 8);
+   header[16] = 24;
+   /* Top-left origin, rows can be written as they come. */
+   header[17] = 0x20;
+
+   if (filestream_write(file, header, sizeof(header)) != sizeof(header))
+      goto end;
+
+   for (y = 0; y < height; y++, data += pitch)
+      if (filestream_write(file, data, width * 3) != width * 3)
+         goto end;
+
+   ret = true;
+
+end:
+   filestream_close(file);
+   return ret;
+}
@@ -32,6 +32,8 @@ RETRO_BEGIN_DECLS
 
 uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len);
 
+uint32_t encoding_crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
 RETRO_END_DECLS
 
 #endif
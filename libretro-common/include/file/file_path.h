@@ -490,6 +490,30 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+/**
+ * path_get_mtime:
+ * @path               : path
+ *
+ * Gets the last modification time of a file, in seconds
+ * since the epoch. Platforms that cannot report it give 0.
+ *
+ * Returns: modification time, or -1 if path does not exist.
+ */
+int64_t path_get_mtime(const char *path);
+
+/**
+ * path_get_size_mtime:
+ * @path               : path
+ * @size               : size of the file in bytes
+ * @mtime              : modification time, as path_get_mtime()
+ *
+ * Gets both with a single stat call. Unlike path_get_size(),
+ * the size is not truncated for files over 2 GB.
+ *
+ * Returns: true (1) if path exists, otherwise false (0).
+ */
+bool path_get_size_mtime(const char *path, int64_t *size, int64_t *mtime);
+
 RETRO_END_DECLS
 
 #endif
@@ -1,7 +1,7 @@
-/* Copyright  (C) 2010-2017 The RetroArch team
+/* Copyright  (C) 2010-2018 The RetroArch team
  *
  * ---------------------------------------------------------------------------------------
- * The following license statement only applies to this file (bintree.h).
+ * The following license statement only applies to this file (rqoi.h).
  * ---------------------------------------------------------------------------------------
  *
  * Permission is hereby granted, free of charge,
@@ -20,25 +20,34 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifndef __LIBRETRODB_BINTREE_H__
-#define __LIBRETRODB_BINTREE_H__
+#ifndef __LIBRETRO_SDK_FORMAT_RQOI_H__
+#define __LIBRETRO_SDK_FORMAT_RQOI_H__
 
-#include <retro_common_api.h>
-
-RETRO_BEGIN_DECLS
-
-typedef struct bintree bintree_t;
-
-typedef int (*bintree_cmp_func)(const void *a, const void *b, void *ctx);
-typedef int (*bintree_iter_cb) (void *value, void *ctx);
+#include <stdint.h>
+#include <stddef.h>
 
-bintree_t *bintree_new(bintree_cmp_func cmp, void *ctx);
+#include <retro_common_api.h>
 
-int bintree_insert(bintree_t *t, void *value);
+#include <boolean.h>
 
-int bintree_iterate(const bintree_t *t, bintree_iter_cb cb, void *ctx);
+RETRO_BEGIN_DECLS
 
-void bintree_free(bintree_t *t);
+/**
+ * rqoi_save_image_bgr24:
+ * @path               : path of the file to write.
+ * @data               : top-down BGR24 pixels.
+ * @width              : width of the image.
+ * @height             : height of the image.
+ * @pitch              : length of a row of @data, in bytes.
+ *
+ * Writes a lossless QOI ("Quite OK Image") file. Encoding is a
+ * single pass without entropy coding, several times faster than
+ * PNG at a moderately larger size.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+bool rqoi_save_image_bgr24(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch);
 
 RETRO_END_DECLS
 
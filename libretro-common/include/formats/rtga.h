@@ -43,6 +43,9 @@ void rtga_free(rtga_t *rtga);
 
 rtga_t *rtga_alloc(void);
 
+bool rtga_save_image_bgr24(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch);
+
 RETRO_END_DECLS
 
 #endif
@@ -102,6 +102,24 @@ bool filestream_exists(const char *path);
 
 char *filestream_getline(RFILE *stream);
 
+/**
+ * filestream_map_file:
+ * @path              : path to a local file.
+ * @size              : receives the size of the mapping in bytes.
+ *
+ * Maps a whole file read-only. Only regular files on the local
+ * filesystem are mapped. This fails while a VFS interface is
+ * registered, since it may resolve paths differently, and on
+ * platforms without mmap. Callers fall back to reading the file
+ * through filestream_open() in that case.
+ *
+ * Returns: the mapping, to be released with filestream_unmap_file(),
+ * or NULL.
+ **/
+const void *filestream_map_file(const char *path, int64_t *size);
+
+void filestream_unmap_file(const void *map, int64_t size);
+
 RETRO_END_DECLS
 
 #endif
@@ -30,10 +30,17 @@
 #include "config.h"
 #endif
 
+#include <memmap.h>
 #include <streams/file_stream.h>
 #define VFS_FRONTEND
 #include <vfs/vfs_implementation.h>
 
+#ifdef HAVE_MMAN
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 static const int64_t vfs_error_return_value      = -1;
 
 static retro_vfs_get_path_t filestream_get_path_cb = NULL;
@@ -499,3 +506,46 @@ char *filestream_getline(RFILE *stream)
    newline[idx]      = '\0';
    return newline;
 }
+
+const void *filestream_map_file(const char *path, int64_t *size)
+{
+#ifdef HAVE_MMAN
+   struct stat st;
+   void *map = NULL;
+   int fd    = -1;
+
+   if (filestream_open_cb || !path || !*path)
+      return NULL;
+
+   if ((fd = open(path, O_RDONLY)) < 0)
+      return NULL;
+
+   if (     fstat(fd, &st) != 0
+         || !S_ISREG(st.st_mode)
+         || st.st_size <= 0
+         || (uint64_t)st.st_size != (uint64_t)(size_t)st.st_size)
+   {
+      close(fd);
+      return NULL;
+   }
+
+   map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+
+   if (map == MAP_FAILED)
+      return NULL;
+
+   *size = (int64_t)st.st_size;
+   return map;
+#else
+   return NULL;
+#endif
+}
+
+void filestream_unmap_file(const void *map, int64_t size)
+{
+#ifdef HAVE_MMAN
+   if (map)
+      munmap((void*)map, (size_t)size);
+#endif
+}
@@ -30,7 +30,9 @@
 struct zlib_trans_stream
 {
    bool inited;
+   bool sync_flush; /* deflate only */
    int ex; /* window_bits or level */
+   int window_bits; /* deflate only */
    z_stream z;
 };
 
@@ -39,7 +41,8 @@ static void *zlib_deflate_stream_new(void)
    struct zlib_trans_stream *ret = (struct zlib_trans_stream*)calloc(1, sizeof(struct zlib_trans_stream));
    if (!ret)
       return NULL;
-   ret->ex = 9;
+   ret->ex          = 9;
+   ret->window_bits = MAX_WBITS;
    return (void *) ret;
 }
 
@@ -82,6 +85,23 @@ static bool zlib_deflate_define(void *data, const char *prop, uint32_t val)
          z->ex = (int) val;
       return true;
    }
+   /* Negative values produce a raw deflate stream,
+    * without zlib header and trailer. */
+   else if (string_is_equal(prop, "window_bits"))
+   {
+      if (z)
+         z->window_bits = (int) val;
+      return true;
+   }
+   /* When set, flushing ends on a byte boundary with
+    * Z_SYNC_FLUSH instead of finishing the stream, so
+    * independently deflated blocks can be concatenated. */
+   else if (string_is_equal(prop, "sync_flush"))
+   {
+      if (z)
+         z->sync_flush = val != 0;
+      return true;
+   }
    return false;
 }
 
@@ -109,7 +129,8 @@ static void zlib_deflate_set_in(void *data, const uint8_t *in, uint32_t in_size)
 
    if (!z->inited)
    {
-      deflateInit(&z->z, z->ex);
+      deflateInit2(&z->z, z->ex, Z_DEFLATED, z->window_bits,
+            8, Z_DEFAULT_STRATEGY);
       z->inited = true;
    }
 }
@@ -147,6 +168,7 @@ static bool zlib_deflate_trans(
    enum trans_stream_error *error)
 {
    int zret                     = 0;
+   int flush_mode               = Z_NO_FLUSH;
    bool ret                     = false;
    uint32_t pre_avail_in        = 0;
    uint32_t pre_avail_out       = 0;
@@ -155,18 +177,25 @@ static bool zlib_deflate_trans(
 
    if (!zt->inited)
    {
-      deflateInit(z, zt->ex);
+      deflateInit2(z, zt->ex, Z_DEFLATED, zt->window_bits,
+            8, Z_DEFAULT_STRATEGY);
       zt->inited = true;
    }
 
+   if (flush)
+      flush_mode = zt->sync_flush ? Z_SYNC_FLUSH : Z_FINISH;
+
    pre_avail_in  = z->avail_in;
    pre_avail_out = z->avail_out;
-   zret          = deflate(z, flush ? Z_FINISH : Z_NO_FLUSH);
+   zret          = deflate(z, flush_mode);
 
    if (zret == Z_OK)
    {
+      /* A sync flush is complete once deflate()
+       * had output space left over. */
       if (error)
-         *error = TRANS_STREAM_ERROR_AGAIN;
+         *error = (flush_mode == Z_SYNC_FLUSH && z->avail_out != 0)
+            ? TRANS_STREAM_ERROR_NONE : TRANS_STREAM_ERROR_AGAIN;
    }
    else if (zret == Z_STREAM_END)
    {
@@ -33,9 +33,13 @@
 #include <retro_assert.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
 
 #include "libretrodb.h"
 
+#define DAT_CONVERTER_MAX_THREADS 16
+
 static void dat_converter_exit(int rc)
 {
    fflush(stdout);
@@ -68,8 +72,6 @@ typedef struct
 typedef struct dat_converter_map_t dat_converter_map_t;
 typedef struct dat_converter_list_t dat_converter_list_t;
 typedef union dat_converter_list_item_t dat_converter_list_item_t;
-typedef struct dat_converter_search_tree_t dat_converter_search_tree_t;
-typedef struct dat_converter_bt_node_t dat_converter_bt_node_t;
 
 struct dat_converter_map_t
 {
@@ -87,7 +89,11 @@ struct dat_converter_list_t
 {
    dat_converter_list_enum type;
    dat_converter_list_item_t* values;
-   dat_converter_bt_node_t* bt_root;
+   /* Keyed maps only: open addressing table of value index + 1,
+    * 0 marks a free slot */
+   int* hash_table;
+   int hash_capacity;
+   int hash_count;
    int count;
    int capacity;
 };
@@ -100,15 +106,6 @@ union dat_converter_list_item_t
    dat_converter_list_t* list;
 };
 
-
-struct dat_converter_bt_node_t
-{
-   int index;
-   uint32_t hash;
-   dat_converter_bt_node_t* right;
-   dat_converter_bt_node_t* left;
-};
-
 static dat_converter_list_t* dat_converter_list_create(
       dat_converter_list_enum type)
 {
@@ -117,23 +114,15 @@ static dat_converter_list_t* dat_converter_list_create(
    list->type                 = type;
    list->count                = 0;
    list->capacity             = (1 << 2);
-   list->bt_root              = NULL;
+   list->hash_table           = NULL;
+   list->hash_capacity        = 0;
+   list->hash_count           = 0;
    list->values               = (dat_converter_list_item_t*)malloc(
          sizeof(*list->values) * list->capacity);
 
    return list;
 }
 
-static void dat_converter_bt_node_free(dat_converter_bt_node_t* node)
-{
-   if (!node)
-      return;
-
-   dat_converter_bt_node_free(node->left);
-   dat_converter_bt_node_free(node->right);
-   free(node);
-}
-
 static void dat_converter_list_free(dat_converter_list_t* list)
 {
    if (!list)
@@ -150,7 +139,7 @@ static void dat_converter_list_free(dat_converter_list_t* list)
          if (list->values[list->count].map.type == DAT_CONVERTER_LIST_MAP)
             dat_converter_list_free(list->values[list->count].map.value.list);
       }
-      dat_converter_bt_node_free(list->bt_root);
+      free(list->hash_table);
       break;
    default:
       break;
@@ -161,44 +150,60 @@ static void dat_converter_list_free(dat_converter_list_t* list)
 }
 static void dat_converter_list_append(dat_converter_list_t* dst, void* item);
 
-static dat_converter_bt_node_t* dat_converter_bt_node_insert(
-      dat_converter_list_t* list,
-      dat_converter_bt_node_t** node,
-      dat_converter_map_t* map)
+/* Returns the hash table slot of @key, either the one holding it
+ * or the free slot it would go to. */
+static int* dat_converter_hash_slot(dat_converter_list_t* list,
+      const char* key, uint32_t hash)
 {
-   retro_assert(map->key);
-   retro_assert(list->type == DAT_CONVERTER_MAP_LIST);
+   int mask = list->hash_capacity - 1;
+   int i    = (int)(hash & (uint32_t)mask);
 
-   if (!*node)
+   while (list->hash_table[i])
    {
-      *node = calloc(1, sizeof(dat_converter_bt_node_t));
-      return *node;
+      dat_converter_map_t* map = &list->values[list->hash_table[i] - 1].map;
+
+      if (map->hash == hash && string_is_equal(map->key, key))
+         break;
+
+      i = (i + 1) & mask;
    }
 
-   int diff = (*node)->hash - map->hash;
+   return &list->hash_table[i];
+}
+
+static void dat_converter_hash_grow(dat_converter_list_t* list)
+{
+   int i;
+   int capacity = list->hash_capacity ? list->hash_capacity << 1 : (1 << 3);
 
-   if (!diff)
-      diff = strcmp(list->values[(*node)->index].map.key, map->key);
+   free(list->hash_table);
+   list->hash_table    = (int*)calloc(capacity, sizeof(*list->hash_table));
+   list->hash_capacity = capacity;
 
-   if (diff < 0)
-      return dat_converter_bt_node_insert(list, &(*node)->left, map);
-   else if (diff > 0)
-      return dat_converter_bt_node_insert(list, &(*node)->right, map);
+   for (i = 0; i < list->count; i++)
+   {
+      dat_converter_map_t* map = &list->values[i].map;
 
-   /* found match */
+      if (map->key)
+         *dat_converter_hash_slot(list, map->key, map->hash) = i + 1;
+   }
+}
 
-   if (list->values[(*node)->index].map.type == DAT_CONVERTER_LIST_MAP)
+/* Merges @map into @dst, an entry with the same key that is
+ * already in the list. */
+static void dat_converter_map_merge(dat_converter_map_t* dst,
+      dat_converter_map_t* map)
+{
+   if (dst->type == DAT_CONVERTER_LIST_MAP)
    {
       if (map->type == DAT_CONVERTER_LIST_MAP)
       {
          int i;
 
-         retro_assert(list->values[(*node)->index].map.value.list->type
-               == map->value.list->type);
+         retro_assert(dst->value.list->type == map->value.list->type);
 
          for (i = 0; i < map->value.list->count; i++)
-            dat_converter_list_append(
-                  list->values[(*node)->index].map.value.list,
+            dat_converter_list_append(dst->value.list,
                   &map->value.list->values[i]);
 
          /* set count to 0 to prevent freeing the child nodes */
@@ -207,12 +212,9 @@ static dat_converter_bt_node_t* dat_converter_bt_node_insert(
       }
    }
    else
-      list->values[(*node)->index].map = *map;
-
-   return NULL;
+      *dst = *map;
 }
 
-
 static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
 {
    if (dst->count == dst->capacity)
@@ -241,16 +243,24 @@ static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
          dst->values[dst->count].map = *map;
       else
       {
+         int* slot;
+
          map->hash = djb2_calculate(map->key);
-         dat_converter_bt_node_t* new_node =
-            dat_converter_bt_node_insert(dst, &dst->bt_root, map);
 
-         if (!new_node)
+         if ((dst->hash_count + 1) * 2 > dst->hash_capacity)
+            dat_converter_hash_grow(dst);
+
+         slot = dat_converter_hash_slot(dst, map->key, map->hash);
+
+         if (*slot)
+         {
+            dat_converter_map_merge(&dst->values[*slot - 1].map, map);
             return;
+         }
 
          dst->values[dst->count].map = *map;
-         new_node->index = dst->count;
-         new_node->hash = map->hash;
+         *slot = dst->count + 1;
+         dst->hash_count++;
       }
       break;
    }
@@ -459,30 +469,31 @@ static const char* dat_converter_get_match(
       dat_converter_list_t* list,
       dat_converter_match_key_t* match_key)
 {
-   int i;
+   int slot;
+   dat_converter_map_t* map;
 
    retro_assert(match_key);
 
-   if (list->type != DAT_CONVERTER_MAP_LIST)
+   if (list->type != DAT_CONVERTER_MAP_LIST || !list->hash_table)
       return NULL;
 
-   for (i = 0; i < list->count; i++)
-   {
-      if (list->values[i].map.hash == match_key->hash)
-      {
-         retro_assert(string_is_equal(list->values[i].map.key, match_key->value));
+   slot = *dat_converter_hash_slot(list, match_key->value, match_key->hash);
 
-         if (match_key->next)
-            return dat_converter_get_match(
-                  list->values[i].map.value.list, match_key->next);
+   if (!slot)
+      return NULL;
 
-         if ((list->values[i].map.type == DAT_CONVERTER_STRING_MAP))
-            return list->values[i].map.value.string;
+   map = &list->values[slot - 1].map;
 
+   if (match_key->next)
+   {
+      if (map->type != DAT_CONVERTER_LIST_MAP)
          return NULL;
-
-      }
+      return dat_converter_get_match(map->value.list, match_key->next);
    }
+
+   if (map->type == DAT_CONVERTER_STRING_MAP)
+      return map->value.string;
+
    return NULL;
 }
 
@@ -746,9 +757,131 @@ static int dat_converter_value_provider(
    return 0;
 }
 
+typedef struct
+{
+   const char* path;
+   char* buffer;
+   dat_converter_list_t* parsed;
+} dat_converter_file_t;
+
+typedef struct
+{
+   dat_converter_file_t* files;
+   dat_converter_match_key_t* match_key;
+   slock_t* lock;
+   int count;
+   int next;
+} dat_converter_loader_t;
+
+static void dat_converter_load_file(dat_converter_file_t* file,
+      dat_converter_match_key_t* match_key)
+{
+   size_t dat_file_size;
+   dat_converter_list_t* dat_lexer_list = NULL;
+   FILE* dat_file                       = fopen(file->path, "r");
+
+   if (!dat_file)
+   {
+      printf("could not open dat file '%s': %s\n",
+            file->path, strerror(errno));
+      dat_converter_exit(1);
+   }
+
+   fseek(dat_file, 0, SEEK_END);
+   dat_file_size = ftell(dat_file);
+   fseek(dat_file, 0, SEEK_SET);
+   file->buffer = (char*)malloc(dat_file_size + 1);
+   dat_file_size = fread(file->buffer, 1, dat_file_size, dat_file);
+   fclose(dat_file);
+   file->buffer[dat_file_size] = '\0';
+
+   printf("Parsing dat file '%s'...\n", file->path);
+   dat_lexer_list = dat_converter_lexer(file->buffer, file->path);
+   file->parsed   = dat_converter_parser(NULL, dat_lexer_list, match_key);
+
+   dat_converter_list_free(dat_lexer_list);
+}
+
+static void dat_converter_loader_thread(void* data)
+{
+   dat_converter_loader_t* loader = (dat_converter_loader_t*)data;
+
+   for (;;)
+   {
+      int i;
+
+      slock_lock(loader->lock);
+      i = loader->next++;
+      slock_unlock(loader->lock);
+
+      if (i >= loader->count)
+         break;
+
+      dat_converter_load_file(&loader->files[i], loader->match_key);
+   }
+}
+
+/* Lexes and parses every dat file, on one thread per core. Each
+ * file gets its own list, so no locking is needed while parsing. */
+static void dat_converter_load_files(dat_converter_file_t* files,
+      int count, dat_converter_match_key_t* match_key)
+{
+   int i;
+   sthread_t* threads[DAT_CONVERTER_MAX_THREADS];
+   dat_converter_loader_t loader;
+   int num_threads = (int)cpu_features_get_core_amount();
+
+   if (num_threads > count)
+      num_threads = count;
+   if (num_threads > DAT_CONVERTER_MAX_THREADS)
+      num_threads = DAT_CONVERTER_MAX_THREADS;
+
+   loader.files     = files;
+   loader.match_key = match_key;
+   loader.count     = count;
+   loader.next      = 0;
+   loader.lock      = num_threads > 1 ? slock_new() : NULL;
+
+   if (!loader.lock)
+   {
+      for (i = 0; i < count; i++)
+         dat_converter_load_file(&files[i], match_key);
+      return;
+   }
+
+   for (i = 0; i < num_threads; i++)
+      threads[i] = sthread_create(dat_converter_loader_thread, &loader);
+
+   /* Help out, this also covers threads that failed to start */
+   dat_converter_loader_thread(&loader);
+
+   for (i = 0; i < num_threads; i++)
+      if (threads[i])
+         sthread_join(threads[i]);
+
+   slock_free(loader.lock);
+}
+
+/* Appends the entries of @src to @dst in order, merging entries
+ * with the same match key, and frees @src. */
+static void dat_converter_list_merge(dat_converter_list_t* dst,
+      dat_converter_list_t* src)
+{
+   int i;
+
+   /* Skip the terminating entry every parsed list starts with */
+   for (i = 1; i < src->count; i++)
+      dat_converter_list_append(dst, &src->values[i].map);
+
+   /* the entries now belong to @dst */
+   src->count = 0;
+   dat_converter_list_free(src);
+}
+
 int main(int argc, char** argv)
 {
    const char* rdb_path;
+   const char* index_field              = NULL;
    dat_converter_match_key_t* match_key = NULL;
    RFILE* rdb_file;
 
@@ -766,48 +899,47 @@ int main(int argc, char** argv)
 
    if (argc > 1 &&** argv)
    {
+      int i;
+
       match_key = dat_converter_match_key_create(*argv);
+
+      /* Entries are unique by match key, so index the field it
+       * ends up in while the database is written */
+      for (i = 0; i < (sizeof(rdb_mappings) / sizeof(*rdb_mappings)); i++)
+      {
+         if (string_is_equal(rdb_mappings[i].dat_key, *argv)
+               && rdb_mappings[i].format != DAT_CONVERTER_RDB_TYPE_STRING
+               && rdb_mappings[i].format != DAT_CONVERTER_RDB_TYPE_UINT)
+         {
+            index_field = rdb_mappings[i].rdb_key;
+            break;
+         }
+      }
+
       argc--;
       argv++;
    }
 
+   int i;
    int dat_count                         = argc;
-   char** dat_buffers                    = (char**)
-      malloc(dat_count * sizeof(*dat_buffers));
-   char** dat_buffer                     = dat_buffers;
+   dat_converter_file_t* dat_files       = (dat_converter_file_t*)
+      calloc(dat_count, sizeof(*dat_files));
    dat_converter_list_t* dat_parser_list = NULL;
 
-   while (argc)
-   {
-      size_t dat_file_size;
-      dat_converter_list_t* dat_lexer_list = NULL;
-      FILE* dat_file                       = fopen(*argv, "r");
-
-      if (!dat_file)
-      {
-         printf("could not open dat file '%s': %s\n",
-               *argv, strerror(errno));
-         dat_converter_exit(1);
-      }
+   for (i = 0; i < dat_count; i++)
+      dat_files[i].path = argv[i];
 
-      fseek(dat_file, 0, SEEK_END);
-      dat_file_size = ftell(dat_file);
-      fseek(dat_file, 0, SEEK_SET);
-      *dat_buffer = (char*)malloc(dat_file_size + 1);
-      fread(*dat_buffer, 1, dat_file_size, dat_file);
-      fclose(dat_file);
-      (*dat_buffer)[dat_file_size] = '\0';
+   dat_converter_load_files(dat_files, dat_count, match_key);
 
-      printf("Parsing dat file '%s'...\n", *argv);
-      dat_lexer_list  = dat_converter_lexer(*dat_buffer, *argv);
-      dat_parser_list = dat_converter_parser(
-            dat_parser_list, dat_lexer_list, match_key);
-
-      dat_converter_list_free(dat_lexer_list);
-
-      argc--;
-      argv++;
-      dat_buffer++;
+   /* Merge in command line order, so the result does not depend
+    * on which file finished parsing first */
+   for (i = 0; i < dat_count; i++)
+   {
+      if (!dat_parser_list)
+         dat_parser_list = dat_files[i].parsed;
+      else
+         dat_converter_list_merge(dat_parser_list, dat_files[i].parsed);
+      dat_files[i].parsed = NULL;
    }
 
    rdb_file = filestream_open(rdb_path,
@@ -828,9 +960,9 @@ int main(int argc, char** argv)
       &dat_parser_list->values[dat_parser_list->count];
 
    dat_converter_value_provider_init();
-   libretrodb_create(rdb_file,
+   libretrodb_create_with_index(rdb_file,
          (libretrodb_value_provider)&dat_converter_value_provider,
-         &current_item);
+         &current_item, index_field);
    dat_converter_value_provider_free();
 
    filestream_close(rdb_file);
@@ -838,8 +970,8 @@ int main(int argc, char** argv)
    dat_converter_list_free(dat_parser_list);
 
    while (dat_count--)
-      free(dat_buffers[dat_count]);
-   free(dat_buffers);
+      free(dat_files[dat_count].buffer);
+   free(dat_files);
 
    dat_converter_match_key_free(match_key);
 
@@ -32,6 +32,7 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 
+#include <memmap.h>
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
 #include <string/stdstring.h>
@@ -40,34 +41,56 @@
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "query.h"
 #include "libretrodb.h"
 
 #define MAGIC_NUMBER "RARCHDB"
 
-struct node_iter_ctx
-{
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
-};
+/* Bytes of keys per index tree node */
+#define LIBRETRODB_INDEX_NODE_SIZE 256
+#define LIBRETRODB_INDEX_MIN_FANOUT 4
+#define LIBRETRODB_INDEX_MAX_LEVELS 64
 
 struct libretrodb
 {
 	RFILE *fd;
+   /* Read-only mapping of the whole file. When set, fd is NULL
+    * and all reads are served from memory. */
+   const uint8_t *map;
+   size_t map_size;
 	uint64_t root;
 	uint64_t count;
 	uint64_t first_index_offset;
    char *path;
 };
 
+/* An index is a header followed by 'count' entries of key_size
+ * key bytes and a native-endian item offset, sorted by key. Trees
+ * written by libretrodb_create_index() follow the entries with a
+ * directory of 'levels' levels, root first, in which every key is
+ * the first key of a node of 'fanout' keys on the level below.
+ * Readers that only know the sorted entries still work. */
 struct libretrodb_index
 {
 	char name[50];
+   /* Empty for indexes that do not record their field */
+   char field[50];
 	uint64_t key_size;
+   /* 0 for indexes that rely on the database item count */
+   uint64_t count;
+   uint64_t fanout;
+   uint64_t levels;
 	uint64_t next;
 };
 
+struct libretrodb_header_field
+{
+   const char *key;
+   uint64_t *uint_value;
+   char *str_value;
+   size_t str_size;
+};
+
 typedef struct libretrodb_metadata
 {
 	uint64_t count;
@@ -83,6 +106,15 @@ struct libretrodb_cursor
 {
 	int is_valid;
    RFILE *fd;
+   /* Read position when the database is mapped, NULL once
+    * an index lookup has returned its item */
+   const uint8_t *pos;
+   /* Set when the query was answered from an index; index_item
+    * is the only candidate, NULL if there is none */
+   int indexed;
+   const uint8_t *index_item;
+   /* Backs the views handed out on unmapped databases */
+   struct rmsgpack_dom_value item;
 	int eof;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
@@ -90,6 +122,93 @@ struct libretrodb_cursor
 
 static struct rmsgpack_dom_value sentinal;
 
+static void libretrodb_header_field_set(
+      const struct libretrodb_header_field *fields, unsigned count,
+      const struct rmsgpack_dom_value *key,
+      const struct rmsgpack_dom_value *value)
+{
+   unsigned i;
+
+   if (key->type != RDT_STRING)
+      return;
+
+   for (i = 0; i < count; i++)
+   {
+      const struct libretrodb_header_field *f = &fields[i];
+
+      if (key->val.string.len != strlen(f->key)
+            || memcmp(key->val.string.buff, f->key, key->val.string.len))
+         continue;
+
+      /* Small values are stored as positive fixints */
+      if (f->uint_value && value->type == RDT_UINT)
+         *f->uint_value = value->val.uint_;
+      else if (f->uint_value && value->type == RDT_INT)
+         *f->uint_value = (uint64_t)value->val.int_;
+      else if (f->str_value && value->type == RDT_STRING)
+      {
+         size_t len = value->val.string.len;
+         if (len >= f->str_size)
+            len = f->str_size - 1;
+         memcpy(f->str_value, value->val.string.buff, len);
+         f->str_value[len] = '\0';
+      }
+      return;
+   }
+}
+
+/* Reads the map at the current position of @fd into @fields.
+ * Fields that are missing keep their value. */
+static int libretrodb_read_header_fields(RFILE *fd,
+      const struct libretrodb_header_field *fields, unsigned count)
+{
+   unsigned i;
+   struct rmsgpack_dom_value map;
+   int rv = rmsgpack_dom_read(fd, &map);
+
+   if (rv < 0)
+      return rv;
+
+   if (map.type != RDT_MAP)
+   {
+      rmsgpack_dom_value_free(&map);
+      return -EINVAL;
+   }
+
+   for (i = 0; i < map.val.map.len; i++)
+      libretrodb_header_field_set(fields, count,
+            &map.val.map.items[i].key, &map.val.map.items[i].value);
+
+   rmsgpack_dom_value_free(&map);
+   return 0;
+}
+
+static unsigned libretrodb_index_fields(libretrodb_index_t *idx,
+      struct libretrodb_header_field *fields)
+{
+   memset(idx, 0, sizeof(*idx));
+   memset(fields, 0, 7 * sizeof(*fields));
+
+   fields[0].key        = "name";
+   fields[0].str_value  = idx->name;
+   fields[0].str_size   = sizeof(idx->name);
+   fields[1].key        = "field";
+   fields[1].str_value  = idx->field;
+   fields[1].str_size   = sizeof(idx->field);
+   fields[2].key        = "key_size";
+   fields[2].uint_value = &idx->key_size;
+   fields[3].key        = "count";
+   fields[3].uint_value = &idx->count;
+   fields[4].key        = "fanout";
+   fields[4].uint_value = &idx->fanout;
+   fields[5].key        = "levels";
+   fields[5].uint_value = &idx->levels;
+   fields[6].key        = "next";
+   fields[6].uint_value = &idx->next;
+
+   return 7;
+}
+
 static int libretrodb_read_metadata(RFILE *fd, libretrodb_metadata_t *md)
 {
    return rmsgpack_dom_read_into(fd, "count", &md->count, NULL);
@@ -135,18 +254,305 @@ static int libretrodb_validate_document(const struct rmsgpack_dom_value *doc)
    return rv;
 }
 
-int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
-      void *ctx)
+static int libretrodb_read_index_header(RFILE *fd, libretrodb_index_t *idx)
+{
+   struct libretrodb_header_field fields[7];
+   unsigned count = libretrodb_index_fields(idx, fields);
+   return libretrodb_read_header_fields(fd, fields, count);
+}
+
+static int libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
+{
+   rmsgpack_write_map_header(fd, 7);
+   rmsgpack_write_string(fd, "name", strlen("name"));
+   rmsgpack_write_string(fd, idx->name, (uint32_t)strlen(idx->name));
+   rmsgpack_write_string(fd, "field", strlen("field"));
+   rmsgpack_write_string(fd, idx->field, (uint32_t)strlen(idx->field));
+   rmsgpack_write_string(fd, "key_size", (uint32_t)strlen("key_size"));
+   rmsgpack_write_uint(fd, idx->key_size);
+   rmsgpack_write_string(fd, "count", strlen("count"));
+   rmsgpack_write_uint(fd, idx->count);
+   rmsgpack_write_string(fd, "fanout", strlen("fanout"));
+   rmsgpack_write_uint(fd, idx->fanout);
+   rmsgpack_write_string(fd, "levels", strlen("levels"));
+   rmsgpack_write_uint(fd, idx->levels);
+   rmsgpack_write_string(fd, "next", strlen("next"));
+   return rmsgpack_write_uint(fd, idx->next);
+}
+
+/* Index entries, each the key followed by the item offset */
+struct libretrodb_index_entries
+{
+   uint8_t *data;
+   uint64_t count;
+   uint64_t cap;
+   size_t key_size;
+};
+
+static int libretrodb_index_entries_add(
+      struct libretrodb_index_entries *entries,
+      const struct rmsgpack_dom_value *value, uint64_t item_loc)
+{
+   uint8_t *entry;
+
+   if (!value)
+   {
+      printf("field not found in item\n");
+      return -EINVAL;
+   }
+
+   if (value->type != RDT_BINARY)
+   {
+      printf("field is not binary\n");
+      return -EINVAL;
+   }
+
+   if (value->val.binary.len == 0)
+   {
+      printf("field is empty\n");
+      return -EINVAL;
+   }
+
+   if (entries->key_size == 0)
+      entries->key_size = value->val.binary.len;
+   else if (value->val.binary.len != entries->key_size)
+   {
+      printf("field is not of correct size\n");
+      return -EINVAL;
+   }
+
+   if (entries->key_size > 255)
+   {
+      printf("field is too large\n");
+      return -EINVAL;
+   }
+
+   if (entries->count == entries->cap)
+   {
+      uint64_t new_cap = entries->cap ? entries->cap * 2 : 1024;
+      uint8_t *tmp     = (uint8_t*)realloc(entries->data,
+            (size_t)(new_cap * (entries->key_size + sizeof(uint64_t))));
+
+      if (!tmp)
+         return -ENOMEM;
+
+      entries->data = tmp;
+      entries->cap  = new_cap;
+   }
+
+   entry = entries->data + entries->count
+      * (entries->key_size + sizeof(uint64_t));
+   memcpy(entry, value->val.binary.buff, entries->key_size);
+   memcpy(entry + entries->key_size, &item_loc, sizeof(uint64_t));
+   entries->count++;
+   return 0;
+}
+
+/* Sorts @count index entries by key with a bottom-up merge sort.
+ * Entries that come out of a DAT file are often in order already,
+ * those are left alone. */
+static int libretrodb_index_sort(uint8_t *entries, uint64_t count,
+      size_t key_size)
+{
+   uint64_t i, width;
+   size_t entry_size = key_size + sizeof(uint64_t);
+   uint8_t *src      = entries;
+   uint8_t *dst      = NULL;
+   uint8_t *tmp      = NULL;
+
+   for (i = 1; i < count; i++)
+      if (memcmp(entries + (i - 1) * entry_size,
+               entries + i * entry_size, key_size) > 0)
+         break;
+
+   if (i >= count)
+      return 0;
+
+   if (!(tmp = (uint8_t*)malloc((size_t)(count * entry_size))))
+      return -ENOMEM;
+
+   dst = tmp;
+
+   for (width = 1; width < count; width *= 2)
+   {
+      uint8_t *swap;
+
+      for (i = 0; i < count; i += 2 * width)
+      {
+         uint64_t mid  = (count - i > width) ? i + width : count;
+         uint64_t last = (count - mid > width) ? mid + width : count;
+         uint64_t a    = i;
+         uint64_t b    = mid;
+         uint8_t *out  = dst + i * entry_size;
+
+         while (a < mid && b < last)
+         {
+            const uint8_t *next;
+
+            if (memcmp(src + b * entry_size,
+                     src + a * entry_size, key_size) < 0)
+               next = src + b++ * entry_size;
+            else
+               next = src + a++ * entry_size;
+
+            memcpy(out, next, entry_size);
+            out += entry_size;
+         }
+
+         memcpy(out, src + a * entry_size, (size_t)((mid - a) * entry_size));
+         out += (mid - a) * entry_size;
+         memcpy(out, src + b * entry_size, (size_t)((last - b) * entry_size));
+      }
+
+      swap = src;
+      src  = dst;
+      dst  = swap;
+   }
+
+   if (src != entries)
+      memcpy(entries, src, (size_t)(count * entry_size));
+
+   free(tmp);
+   return 0;
+}
+
+/* Sorts @entries and writes them out as index @name at the current
+ * position of @fd. Nothing is written if the keys are not unique. */
+static int libretrodb_index_write(RFILE *fd, const char *name,
+      const char *field_name, struct libretrodb_index_entries *entries)
+{
+   libretrodb_index_t idx;
+   uint64_t sizes[LIBRETRODB_INDEX_MAX_LEVELS + 1];
+   uint64_t i;
+   unsigned l;
+   uint64_t count     = entries->count;
+   uint64_t dir_count = 0;
+   size_t key_size    = entries->key_size;
+   size_t entry_size  = key_size + sizeof(uint64_t);
+   uint8_t *data      = entries->data;
+   uint8_t *dir       = NULL;
+   int rv             = 0;
+
+   if (count == 0)
+   {
+      printf("database is empty\n");
+      return -EINVAL;
+   }
+
+   if ((rv = libretrodb_index_sort(data, count, key_size)) != 0)
+      return rv;
+
+   for (i = 1; i < count; i++)
+   {
+      if (!memcmp(data + (i - 1) * entry_size,
+               data + i * entry_size, key_size))
+      {
+         struct rmsgpack_dom_value field;
+
+         field.type            = RDT_BINARY;
+         field.val.binary.len  = (uint32_t)key_size;
+         field.val.binary.buff = (char*)(data + i * entry_size);
+
+         printf("Value is not unique: ");
+         rmsgpack_dom_value_print(&field);
+         printf("\n");
+         return -EINVAL;
+      }
+   }
+
+   memset(&idx, 0, sizeof(idx));
+   strlcpy(idx.name, name, sizeof(idx.name));
+   strlcpy(idx.field, field_name, sizeof(idx.field));
+   idx.key_size = key_size;
+   idx.count    = count;
+   idx.fanout   = LIBRETRODB_INDEX_NODE_SIZE / key_size;
+   if (idx.fanout < LIBRETRODB_INDEX_MIN_FANOUT)
+      idx.fanout = LIBRETRODB_INDEX_MIN_FANOUT;
+
+   /* Add directory levels until one fits in the root node */
+   sizes[0] = count;
+   while (sizes[idx.levels] > idx.fanout)
+   {
+      sizes[idx.levels + 1] = (sizes[idx.levels] + idx.fanout - 1)
+         / idx.fanout;
+      idx.levels++;
+      dir_count += sizes[idx.levels];
+   }
+
+   if (dir_count)
+   {
+      const uint8_t *below = data;
+      size_t below_size    = entry_size;
+      uint8_t *level;
+
+      if (!(dir = (uint8_t*)malloc((size_t)(dir_count * key_size))))
+         return -ENOMEM;
+
+      /* Levels are stored root first, build them bottom up */
+      level = dir + dir_count * key_size;
+
+      for (l = 1; l <= idx.levels; l++)
+      {
+         level -= sizes[l] * key_size;
+
+         for (i = 0; i < sizes[l]; i++)
+            memcpy(level + i * key_size,
+                  below + i * idx.fanout * below_size, key_size);
+
+         below      = level;
+         below_size = key_size;
+      }
+   }
+
+   idx.next = count * entry_size + dir_count * key_size;
+
+   if (     libretrodb_write_index_header(fd, &idx) < 0
+         || filestream_write(fd, data, (int64_t)(count * entry_size))
+            != (int64_t)(count * entry_size)
+         || (dir && filestream_write(fd, dir, (int64_t)(dir_count * key_size))
+            != (int64_t)(dir_count * key_size)))
+      rv = -EIO;
+
+   free(dir);
+   return rv;
+}
+
+/**
+ * libretrodb_create_with_index:
+ * @fd                  : Stream to write the database to.
+ * @value_provider      : Called for every item until it returns non-zero.
+ * @ctx                 : Passed to @value_provider.
+ * @field_name          : Binary field to index, NULL for none.
+ *
+ * Writes a database like libretrodb_create() and indexes @field_name
+ * of the items on the way, the index is named after the field. If
+ * the field cannot be indexed only the index is left out.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_create_with_index(RFILE *fd,
+      libretrodb_value_provider value_provider, void *ctx,
+      const char *field_name)
 {
    int rv;
    libretrodb_metadata_t md;
    struct rmsgpack_dom_value item;
+   struct rmsgpack_dom_value key;
+   struct libretrodb_index_entries entries = {0};
    uint64_t item_count        = 0;
    libretrodb_header_t header = {{0}};
-   ssize_t root = filestream_tell(fd);
+   ssize_t root               = filestream_tell(fd);
+   int indexed                = !string_is_empty(field_name);
 
    memcpy(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1);
 
+   if (indexed)
+   {
+      key.type            = RDT_STRING;
+      key.val.string.len  = (uint32_t)strlen(field_name);
+      key.val.string.buff = (char*)field_name;
+   }
+
    /* We write the header in the end because we need to know the size of
     * the db first */
 
@@ -156,9 +562,18 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    item.type = RDT_NULL;
    while ((rv = value_provider(ctx, &item)) == 0)
    {
+      uint64_t item_loc = (uint64_t)filestream_tell(fd);
+
       if ((rv = libretrodb_validate_document(&item)) < 0)
          goto clean;
 
+      if (indexed && libretrodb_index_entries_add(&entries,
+               rmsgpack_dom_value_map_value(&item, &key), item_loc) != 0)
+      {
+         printf("Not creating index '%s'\n", field_name);
+         indexed = 0;
+      }
+
       if ((rv = rmsgpack_dom_write(fd, &item)) < 0)
          goto clean;
 
@@ -173,39 +588,36 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(
-            fd, 0, RETRO_VFS_SEEK_POSITION_CURRENT));
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
    libretrodb_write_metadata(fd, &md);
+
+   if (indexed && libretrodb_index_write(fd,
+            field_name, field_name, &entries) != 0)
+      printf("Not creating index '%s'\n", field_name);
+
    filestream_seek(fd, root, RETRO_VFS_SEEK_POSITION_START);
    filestream_write(fd, &header, sizeof(header));
+   rv = 0;
 clean:
+   free(entries.data);
    rmsgpack_dom_value_free(&item);
    return rv;
 }
 
-static int libretrodb_read_index_header(RFILE *fd, libretrodb_index_t *idx)
-{
-   uint64_t name_len = 50;
-   return rmsgpack_dom_read_into(fd,
-         "name", idx->name, &name_len,
-         "key_size", &idx->key_size,
-         "next", &idx->next, NULL);
-}
-
-static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
+int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
+      void *ctx)
 {
-   rmsgpack_write_map_header(fd, 3);
-   rmsgpack_write_string(fd, "name", strlen("name"));
-   rmsgpack_write_string(fd, idx->name, (uint32_t)strlen(idx->name));
-   rmsgpack_write_string(fd, "key_size", (uint32_t)strlen("key_size"));
-   rmsgpack_write_uint(fd, idx->key_size);
-   rmsgpack_write_string(fd, "next", strlen("next"));
-   rmsgpack_write_uint(fd, idx->next);
+   return libretrodb_create_with_index(fd, value_provider, ctx, NULL);
 }
 
 void libretrodb_close(libretrodb_t *db)
 {
+#ifdef HAVE_MMAN
+   filestream_unmap_file(db->map, (int64_t)db->map_size);
+#endif
+   db->map      = NULL;
+   db->map_size = 0;
    if (db->fd)
       filestream_close(db->fd);
    if (!string_is_empty(db->path))
@@ -214,21 +626,164 @@ void libretrodb_close(libretrodb_t *db)
    db->fd   = NULL;
 }
 
+#ifdef HAVE_MMAN
+/* Reads the msgpack map at @ptr into @fields straight from
+ * memory. Fields that are missing keep their value. */
+static int libretrodb_buf_read_header(const uint8_t **ptr,
+      const uint8_t *end, const struct libretrodb_header_field *fields,
+      unsigned count)
+{
+   unsigned i;
+   struct rmsgpack_dom_value map, key, value;
+   int rv = rmsgpack_dom_view_read(ptr, end, &map);
+
+   if (rv < 0)
+      return rv;
+   if (map.type != RDT_MAP)
+      return -EINVAL;
+
+   for (i = 0; i < map.val.map.len; i++)
+   {
+      const uint8_t *value_pos;
+
+      if ((rv = rmsgpack_dom_view_read(ptr, end, &key)) < 0)
+         return rv;
+      value_pos = *ptr;
+      if ((rv = rmsgpack_dom_view_read(ptr, end, &value)) < 0)
+         return rv;
+
+      if (value.type == RDT_MAP || value.type == RDT_ARRAY)
+      {
+         *ptr = value_pos;
+         if ((rv = rmsgpack_dom_view_skip(ptr, end)) < 0)
+            return rv;
+         continue;
+      }
+
+      libretrodb_header_field_set(fields, count, &key, &value);
+   }
+
+   return 0;
+}
+
+/* Returns the position after the nil that terminates the items
+ * starting at @ptr, NULL if there is none. */
+static const uint8_t *libretrodb_buf_skip_items(const uint8_t *ptr,
+      const uint8_t *end)
+{
+   while (ptr < end)
+   {
+      struct rmsgpack_dom_value value;
+      const uint8_t *item = ptr;
+
+      if (rmsgpack_dom_view_read(&ptr, end, &value) < 0)
+         return NULL;
+
+      if (value.type == RDT_NULL)
+         return ptr;
+
+      ptr = item;
+      if (rmsgpack_dom_view_skip(&ptr, end) < 0)
+         return NULL;
+   }
+
+   return NULL;
+}
+
+/* Opens @path through filestream_map_file(). Returns -EINVAL
+ * for files that are not a database, any other error means the
+ * file could not be mapped and is read as a stream instead. */
+static int libretrodb_open_mapped(const char *path, libretrodb_t *db)
+{
+   libretrodb_header_t header;
+   struct libretrodb_header_field fields[1];
+   const uint8_t *ptr;
+   const uint8_t *end;
+   uint64_t metadata_offset;
+   int64_t size      = 0;
+   uint64_t count    = 0;
+   const void *map   = filestream_map_file(path, &size);
+
+   if (!map)
+      return -1;
+
+   if (size < (int64_t)sizeof(header))
+   {
+      filestream_unmap_file(map, size);
+      return -EINVAL;
+   }
+
+   memcpy(&header, map, sizeof(header));
+
+   if (memcmp(header.magic_number, MAGIC_NUMBER,
+            sizeof(header.magic_number)) != 0)
+   {
+      filestream_unmap_file(map, size);
+      return -EINVAL;
+   }
+
+   db->map              = (const uint8_t*)map;
+   db->map_size         = (size_t)size;
+   db->root             = 0;
+
+   end                  = db->map + db->map_size;
+   metadata_offset      = swap_if_little64(header.metadata_offset);
+   fields[0].key        = "count";
+   fields[0].uint_value = &count;
+   fields[0].str_value  = NULL;
+   fields[0].str_size   = 0;
+
+   /* Older converters left the metadata offset at zero, the
+    * metadata then still follows the terminating nil. */
+   if (metadata_offset < sizeof(header))
+      ptr = libretrodb_buf_skip_items(db->map + sizeof(header), end);
+   else if (metadata_offset < db->map_size)
+      ptr = db->map + (size_t)metadata_offset;
+   else
+      ptr = NULL;
+
+   /* Be as lenient as the stream reader about a broken metadata
+    * block, it only matters for index lookups. */
+   if (!ptr || libretrodb_buf_read_header(&ptr, end, fields, 1) < 0)
+      ptr = end;
+
+   db->count              = count;
+   db->first_index_offset = (uint64_t)(ptr - db->map);
+   return 0;
+}
+#endif
+
 int libretrodb_open(const char *path, libretrodb_t *db)
 {
    libretrodb_header_t header;
    libretrodb_metadata_t md;
    int rv    = 0;
-   RFILE *fd = filestream_open(path,
+   RFILE *fd = NULL;
+
+   if (!string_is_empty(db->path))
+      free(db->path);
+   db->path = NULL;
+
+#ifdef HAVE_MMAN
+   /* Map the database read-only, lookups and cursors then work
+    * directly on the mapping instead of allocating per item. */
+   if ((rv = libretrodb_open_mapped(path, db)) == 0)
+   {
+      db->path = strdup(path);
+      db->fd   = NULL;
+      return 0;
+   }
+   if (rv == -EINVAL)
+      return rv;
+#endif
+
+   fd = filestream_open(path,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
    if (!fd)
       return -errno;
 
-   if (!string_is_empty(db->path))
-      free(db->path);
-
    db->path  = strdup(path);
    db->root  = filestream_tell(fd);
 
@@ -238,15 +793,34 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER,
+            sizeof(header.magic_number)) != 0)
    {
       rv = -EINVAL;
       goto error;
    }
 
    header.metadata_offset = swap_if_little64(header.metadata_offset);
-   filestream_seek(fd, (ssize_t)header.metadata_offset,
-         RETRO_VFS_SEEK_POSITION_START);
+
+   /* Older converters left the metadata offset at zero, the
+    * metadata then still follows the terminating nil. */
+   if (header.metadata_offset < sizeof(header))
+   {
+      struct rmsgpack_dom_value item;
+
+      do
+      {
+         if (rmsgpack_dom_read(fd, &item) < 0)
+         {
+            rv = -EINVAL;
+            goto error;
+         }
+         rmsgpack_dom_value_free(&item);
+      } while (item.type != RDT_NULL);
+   }
+   else
+      filestream_seek(fd, (ssize_t)header.metadata_offset,
+            RETRO_VFS_SEEK_POSITION_START);
 
    if (libretrodb_read_metadata(fd, &md) < 0)
    {
@@ -265,20 +839,65 @@ error:
    return rv;
 }
 
+/* Indexes are looked up by name, or by the field they cover when
+ * @index_name is NULL. Indexes that do not record their field are
+ * named after it. */
+static int libretrodb_index_matches(const libretrodb_index_t *idx,
+      const char *index_name, const char *field_name)
+{
+   if (index_name)
+      return string_is_equal(index_name, idx->name);
+   if (!string_is_empty(idx->field))
+      return string_is_equal(field_name, idx->field);
+   return string_is_equal(field_name, idx->name);
+}
+
+/* Returns the number of entries in @idx, 0 if its header does not
+ * fit the data that follows it. */
+static uint64_t libretrodb_index_count(const libretrodb_t *db,
+      const libretrodb_index_t *idx)
+{
+   unsigned i;
+   uint64_t count = idx->count ? idx->count : db->count;
+   uint64_t level = count;
+   uint64_t size;
+
+   if (idx->key_size == 0 || idx->key_size > 255
+         || count > idx->next / (idx->key_size + sizeof(uint64_t)))
+      return 0;
+
+   size = count * (idx->key_size + sizeof(uint64_t));
+
+   if (idx->levels && (idx->fanout < 2
+            || idx->levels > LIBRETRODB_INDEX_MAX_LEVELS))
+      return 0;
+
+   for (i = 0; i < idx->levels; i++)
+   {
+      level = (level + idx->fanout - 1) / idx->fanout;
+      if (level > (idx->next - size) / idx->key_size)
+         return 0;
+      size += level * idx->key_size;
+   }
+
+   return count;
+}
+
 static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
-      libretrodb_index_t *idx)
+      const char *field_name, libretrodb_index_t *idx)
 {
-   ssize_t eof    = filestream_get_size(db->fd);
-   ssize_t offset = filestream_seek(db->fd,
+   int64_t eof    = filestream_get_size(db->fd);
+   int64_t offset = filestream_seek(db->fd,
          (ssize_t)db->first_index_offset,
          RETRO_VFS_SEEK_POSITION_START);
 
    /* TODO: this should use filestream_eof instead */
    while (offset < eof)
    {
-      libretrodb_read_index_header(db->fd, idx);
+      if (libretrodb_read_index_header(db->fd, idx) < 0)
+         return -1;
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
+      if (libretrodb_index_matches(idx, index_name, field_name))
          return 0;
 
       filestream_seek(db->fd, (ssize_t)idx->next,
@@ -289,52 +908,189 @@ static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
    return -1;
 }
 
-static int binsearch(const void *buff, const void *item,
+#ifdef HAVE_MMAN
+static const uint8_t *libretrodb_find_index_mapped(libretrodb_t *db,
+      const char *index_name, const char *field_name,
+      libretrodb_index_t *idx)
+{
+   struct libretrodb_header_field fields[7];
+   const uint8_t *end = db->map + db->map_size;
+   const uint8_t *ptr = db->map + (size_t)db->first_index_offset;
+
+   while (ptr < end)
+   {
+      unsigned count = libretrodb_index_fields(idx, fields);
+
+      if (libretrodb_buf_read_header(&ptr, end, fields, count) < 0)
+         return NULL;
+
+      if ((uint64_t)(end - ptr) < idx->next)
+         return NULL;
+
+      if (libretrodb_index_matches(idx, index_name, field_name))
+         return ptr;
+
+      ptr += idx->next;
+   }
+
+   return NULL;
+}
+#endif
+
+static int binsearch(const uint8_t *buff, const void *item,
       uint64_t count, uint8_t field_size, uint64_t *offset)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = memcmp(current, item, field_size);
+   size_t item_size = field_size + sizeof(uint64_t);
+   uint64_t lo      = 0;
+   uint64_t hi      = count;
 
-   if (rv == 0)
+   while (lo < hi)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
+      uint64_t mid           = lo + (hi - lo) / 2;
+      const uint8_t *current = buff + mid * item_size;
+      int rv                 = memcmp(current, item, field_size);
+
+      if (rv == 0)
+      {
+         memcpy(offset, current + field_size, sizeof(uint64_t));
+         return 0;
+      }
+
+      if (rv > 0)
+         hi = mid;
+      else
+         lo = mid + 1;
    }
 
-   if (count == 0)
+   return -1;
+}
+
+/* Looks up @key in the @count entries of index @data. The directory
+ * narrows the search down to a single node of entries, so only one
+ * node per level is touched instead of log2(count) scattered ones. */
+static int libretrodb_index_search(const uint8_t *data,
+      const libretrodb_index_t *idx, uint64_t count,
+      const void *key, uint64_t *offset)
+{
+   unsigned i;
+   uint64_t sizes[LIBRETRODB_INDEX_MAX_LEVELS + 1];
+   size_t key_size      = (size_t)idx->key_size;
+   size_t entry_size    = key_size + sizeof(uint64_t);
+   const uint8_t *level = data + count * entry_size;
+   uint64_t node        = 0;
+   uint64_t first       = 0;
+   uint64_t last        = count;
+
+   sizes[0] = count;
+   for (i = 1; i <= idx->levels; i++)
+      sizes[i] = (sizes[i - 1] + idx->fanout - 1) / idx->fanout;
+
+   /* Follow the last key not greater than @key from the root down */
+   for (i = (unsigned)idx->levels; i > 0; i--)
+   {
+      const uint8_t *keys = level + node * idx->fanout * key_size;
+      uint64_t lo         = 0;
+      uint64_t hi         = sizes[i] - node * idx->fanout;
+
+      if (hi > idx->fanout)
+         hi = idx->fanout;
+
+      while (lo < hi)
+      {
+         uint64_t mid = lo + (hi - lo) / 2;
+
+         if (memcmp(keys + mid * key_size, key, key_size) <= 0)
+            lo = mid + 1;
+         else
+            hi = mid;
+      }
+
+      if (lo == 0)
+         return -1;
+
+      level += sizes[i] * key_size;
+      node   = node * idx->fanout + lo - 1;
+   }
+
+   if (idx->levels)
+   {
+      first = node * idx->fanout;
+      if (last - first > idx->fanout)
+         last = first + idx->fanout;
+   }
+
+   return binsearch(data + first * entry_size, key, last - first,
+         (uint8_t)key_size, offset);
+}
+
+#ifdef HAVE_MMAN
+/* Searches the index in place, no copy of it is made. A non-zero
+ * @key_len has to match the key size of the index.
+ * Returns 0 if found, 1 if the key is not in the index and -1 if
+ * there is no usable index. */
+static int libretrodb_find_item_mapped(libretrodb_t *db,
+      const char *index_name, const char *field_name,
+      const void *key, size_t key_len, const uint8_t **item)
+{
+   libretrodb_index_t idx;
+   uint64_t offset;
+   uint64_t count;
+   const uint8_t *data = libretrodb_find_index_mapped(db,
+         index_name, field_name, &idx);
+
+   if (!data || !(count = libretrodb_index_count(db, &idx)))
+      return -1;
+
+   if (key_len && key_len != idx.key_size)
       return -1;
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+   if (libretrodb_index_search(data, &idx, count, key, &offset) != 0
+         || offset >= db->map_size)
+      return 1;
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+   *item = db->map + (size_t)offset;
+   return 0;
 }
+#endif
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       const void *key, struct rmsgpack_dom_value *out)
 {
    libretrodb_index_t idx;
    int rv;
-   void *buff;
+   uint8_t *buff;
    uint64_t offset;
-   ssize_t bufflen, nread = 0;
+   uint64_t count;
+   int64_t bufflen, nread = 0;
+
+#ifdef HAVE_MMAN
+   if (db->map)
+   {
+      const uint8_t *item = NULL;
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
+      if (libretrodb_find_item_mapped(db, index_name, NULL,
+               key, 0, &item) != 0)
+         return -1;
+
+      return rmsgpack_dom_read_buf(&item, db->map + db->map_size, out);
+   }
+#endif
+
+   if (libretrodb_find_index(db, index_name, NULL, &idx) < 0)
+      return -1;
+
+   if (!(count = libretrodb_index_count(db, &idx)))
       return -1;
 
    bufflen = idx.next;
-   buff = malloc(bufflen);
+   buff = (uint8_t*)malloc((size_t)bufflen);
 
    if (!buff)
       return -ENOMEM;
 
    while (nread < bufflen)
    {
-      void *buff_ = (uint64_t *)buff + nread;
-      rv = (int)filestream_read(db->fd, buff_, bufflen - nread);
+      rv = (int)filestream_read(db->fd, buff + nread, bufflen - nread);
 
       if (rv <= 0)
       {
@@ -344,12 +1100,14 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       nread += rv;
    }
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
+   rv = libretrodb_index_search(buff, &idx, count, key, &offset);
    free(buff);
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset,
-            RETRO_VFS_SEEK_POSITION_START);
+   if (rv != 0)
+      return -1;
+
+   filestream_seek(db->fd, (ssize_t)offset,
+         RETRO_VFS_SEEK_POSITION_START);
 
    return rmsgpack_dom_read(db->fd, out);
 }
@@ -365,11 +1123,92 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
    cursor->eof = 0;
+
+   if (cursor->db->map)
+   {
+      if (cursor->indexed)
+         cursor->pos = cursor->index_item;
+      else
+         cursor->pos = cursor->db->map + (size_t)(cursor->db->root
+               + sizeof(libretrodb_header_t));
+      return 0;
+   }
+
    return (int)filestream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          RETRO_VFS_SEEK_POSITION_START);
 }
 
+/* Advances a cursor on a mapped database to the next item
+ * matching its query. The compiled query runs on the raw item,
+ * only queries it cannot express decode the item first. */
+static int libretrodb_cursor_next_mapped(libretrodb_cursor_t *cursor,
+      libretrodb_view_t *view, const uint8_t **item)
+{
+   int rv;
+   const uint8_t *end = cursor->db->map + cursor->db->map_size;
+
+   for (;;)
+   {
+      struct rmsgpack_dom_value header;
+      const uint8_t *start = cursor->pos;
+
+      if (!start)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      if ((rv = rmsgpack_dom_view_read(&cursor->pos, end, &header)) < 0)
+         return rv;
+
+      if (header.type == RDT_NULL)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      if (header.type != RDT_MAP)
+         return -EINVAL;
+
+      view->pos   = cursor->pos;
+      view->end   = end;
+      view->item  = NULL;
+      view->len   = header.val.map.len;
+      view->index = 0;
+
+      cursor->pos = start;
+      if ((rv = rmsgpack_dom_view_skip(&cursor->pos, end)) < 0)
+         return rv;
+
+      if (cursor->indexed)
+         cursor->pos = NULL;
+
+      if (cursor->query)
+      {
+         libretrodb_view_t probe = *view;
+         int match = libretrodb_query_filter_view(cursor->query, &probe);
+
+         if (match < 0)
+         {
+            struct rmsgpack_dom_value doc;
+            const uint8_t *ptr = start;
+
+            if ((rv = rmsgpack_dom_read_buf(&ptr, end, &doc)) < 0)
+               return rv;
+            match = libretrodb_query_filter(cursor->query, &doc);
+            rmsgpack_dom_value_free(&doc);
+         }
+
+         if (!match)
+            continue;
+      }
+
+      *item = start;
+      return 0;
+   }
+}
+
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out)
 {
@@ -378,6 +1217,18 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
    if (cursor->eof)
       return EOF;
 
+   if (cursor->db->map)
+   {
+      libretrodb_view_t view;
+      const uint8_t *item = NULL;
+
+      if ((rv = libretrodb_cursor_next_mapped(cursor, &view, &item)) != 0)
+         return rv;
+
+      return rmsgpack_dom_read_buf(&item,
+            cursor->db->map + cursor->db->map_size, out);
+   }
+
 retry:
    rv = rmsgpack_dom_read(cursor->fd, out);
    if (rv < 0)
@@ -401,6 +1252,97 @@ retry:
    return 0;
 }
 
+/**
+ * libretrodb_cursor_read_view:
+ * @cursor              : Handle to database cursor.
+ * @view                : View of the next matching item.
+ *
+ * Reads the next item matching the cursor query without
+ * decoding it. Walk its fields with libretrodb_view_next().
+ * The view stays valid until the next read from @cursor.
+ *
+ * Returns: 0 if successful, EOF at the end of the
+ * database, otherwise negative.
+ **/
+int libretrodb_cursor_read_view(libretrodb_cursor_t *cursor,
+      libretrodb_view_t *view)
+{
+   int rv;
+   const uint8_t *item = NULL;
+
+   rmsgpack_dom_value_free(&cursor->item);
+   cursor->item.type = RDT_NULL;
+
+   if (cursor->eof)
+      return EOF;
+
+   if (!cursor->db->map)
+   {
+      if ((rv = libretrodb_cursor_read_item(cursor, &cursor->item)) != 0)
+         return rv;
+      if (cursor->item.type != RDT_MAP)
+         return -EINVAL;
+
+      view->pos   = NULL;
+      view->end   = NULL;
+      view->item  = &cursor->item;
+      view->len   = cursor->item.val.map.len;
+      view->index = 0;
+      return 0;
+   }
+
+   return libretrodb_cursor_next_mapped(cursor, view, &item);
+}
+
+/**
+ * libretrodb_view_next:
+ * @view                : View returned by libretrodb_cursor_read_view().
+ * @key                 : Key of the next field.
+ * @value               : Value of the next field.
+ *
+ * Decodes the next field of @view. Both @key and @value are
+ * borrowed: strings point into the database and are not
+ * NUL-terminated. Nested maps and arrays are only reported with
+ * their length when the database is mapped.
+ *
+ * Returns: 0 if successful, EOF after the last field,
+ * otherwise negative.
+ **/
+int libretrodb_view_next(libretrodb_view_t *view,
+      struct rmsgpack_dom_value *key, struct rmsgpack_dom_value *value)
+{
+   int rv;
+   const uint8_t *value_pos;
+
+   if (view->index >= view->len)
+      return EOF;
+
+   if (view->item)
+   {
+      *key   = view->item->val.map.items[view->index].key;
+      *value = view->item->val.map.items[view->index].value;
+      view->index++;
+      return 0;
+   }
+
+   if ((rv = rmsgpack_dom_view_read(&view->pos, view->end, key)) < 0)
+      return rv;
+
+   value_pos = view->pos;
+   if ((rv = rmsgpack_dom_view_read(&view->pos, view->end, value)) < 0)
+      return rv;
+
+   if (value->type == RDT_MAP || value->type == RDT_ARRAY)
+   {
+      view->pos = value_pos;
+      if ((rv = rmsgpack_dom_view_skip(&view->pos, view->end)) < 0)
+         return rv;
+   }
+
+   view->index++;
+   return 0;
+}
+
 /**
  * libretrodb_cursor_close:
  * @cursor              : Handle to database cursor.
@@ -418,7 +1360,13 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
-   cursor->is_valid = 0;
+   rmsgpack_dom_value_free(&cursor->item);
+
+   cursor->item.type  = RDT_NULL;
+   cursor->pos        = NULL;
+   cursor->indexed    = 0;
+   cursor->index_item = NULL;
+   cursor->is_valid   = 0;
    cursor->eof      = 1;
    cursor->fd       = NULL;
    cursor->db       = NULL;
@@ -442,151 +1390,189 @@ int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
    if (!db || string_is_empty(db->path))
       return -errno;
 
-   fd = filestream_open(db->path,
-         RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   /* Mapped databases need no file handle per cursor */
+   if (!db->map)
+   {
+      fd = filestream_open(db->path,
+            RETRO_VFS_FILE_ACCESS_READ,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-   if (!fd)
-      return -errno;
+      if (!fd)
+         return -errno;
+   }
 
-   cursor->fd       = fd;
-   cursor->db       = db;
-   cursor->is_valid = 1;
-   libretrodb_cursor_reset(cursor);
-   cursor->query    = q;
+   cursor->fd         = fd;
+   cursor->db         = db;
+   cursor->item.type  = RDT_NULL;
+   cursor->indexed    = 0;
+   cursor->index_item = NULL;
+   cursor->is_valid   = 1;
+   cursor->query      = q;
+
+#ifdef HAVE_MMAN
+   /* Answer an equality on an indexed field from the index. Index
+    * keys are unique, so at most one item can match. */
+   if (q && db->map)
+   {
+      unsigned i;
+      const char *field                      = NULL;
+      const struct rmsgpack_dom_value *value = NULL;
 
-   if (q)
-      libretrodb_query_inc_ref(q);
+      for (i = 0; libretrodb_query_get_equality(q, i, &field, &value) == 0; i++)
+      {
+         int rv;
 
-   return 0;
-}
+         if (value->type != RDT_BINARY || !value->val.binary.len)
+            continue;
 
-static int node_iter(void *value, void *ctx)
-{
-   struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
+         rv = libretrodb_find_item_mapped(db, NULL, field,
+               value->val.binary.buff, value->val.binary.len,
+               &cursor->index_item);
 
-   if (filestream_write(nictx->db->fd, value,
-            (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
-      return 0;
+         if (rv >= 0)
+         {
+            cursor->indexed = 1;
+            break;
+         }
+      }
+   }
+#endif
 
-   return -1;
-}
+   libretrodb_cursor_reset(cursor);
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
-{
-   return filestream_tell(db->fd);
+   if (q)
+      libretrodb_query_inc_ref(q);
+
+   return 0;
 }
 
-static int node_compare(const void *a, const void *b, void *ctx)
+/* Offset of the item the next read from @cursor returns, only
+ * meaningful for cursors without a query. */
+static uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor)
 {
-   return memcmp(a, b, *(uint8_t *)ctx);
+   if (cursor->db->map)
+      return (uint64_t)(cursor->pos - cursor->db->map);
+   return (uint64_t)filestream_tell(cursor->fd);
 }
 
-int libretrodb_create_index(libretrodb_t *db,
-      const char *name, const char *field_name)
+/* Collects an index entry for @field_name of every item */
+static int libretrodb_index_collect(libretrodb_t *db,
+      const char *field_name, struct libretrodb_index_entries *entries)
 {
-   struct node_iter_ctx nictx;
-   struct rmsgpack_dom_value key;
-   libretrodb_index_t idx;
-   struct rmsgpack_dom_value item;
-   libretrodb_cursor_t cur          = {0};
-   struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
-   uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
-   bintree_t *tree                  = bintree_new(node_compare, &field_size);
-
-   item.type                        = RDT_NULL;
-
-   if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
-      goto clean;
+   libretrodb_view_t view;
+   libretrodb_cursor_t cur = {0};
+   size_t field_len        = strlen(field_name);
+   int rv                  = libretrodb_cursor_open(db, &cur, NULL);
 
-   key.type            = RDT_STRING;
-   key.val.string.len  = (uint32_t)strlen(field_name);
-   key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
+   if (rv != 0)
+      return rv;
 
-   while (libretrodb_cursor_read_item(&cur, &item) == 0)
+   for (;;)
    {
-      if (item.type != RDT_MAP)
-      {
-         printf("Only map keys are supported\n");
-         goto clean;
-      }
+      struct rmsgpack_dom_value key, value;
+      uint64_t item_loc = libretrodb_cursor_tell(&cur);
+      int found         = 0;
 
-      field = rmsgpack_dom_value_map_value(&item, &key);
-
-      if (!field)
+      if ((rv = libretrodb_cursor_read_view(&cur, &view)) != 0)
       {
-         printf("field not found in item\n");
-         goto clean;
+         if (rv == EOF)
+            rv = 0;
+         else if (rv == -EINVAL)
+            printf("Only map keys are supported\n");
+         break;
       }
 
-      if (field->type != RDT_BINARY)
+      while (libretrodb_view_next(&view, &key, &value) == 0)
       {
-         printf("field is not binary\n");
-         goto clean;
+         if (     key.type == RDT_STRING
+               && key.val.string.len == field_len
+               && !memcmp(key.val.string.buff, field_name, field_len))
+         {
+            found = 1;
+            break;
+         }
       }
 
-      if (field->val.binary.len == 0)
-      {
-         printf("field is empty\n");
-         goto clean;
-      }
+      if ((rv = libretrodb_index_entries_add(entries,
+                  found ? &value : NULL, item_loc)) != 0)
+         break;
+   }
 
-      if (field_size == 0)
-         field_size = field->val.binary.len;
-      else if (field->val.binary.len != field_size)
-      {
-         printf("field is not of correct size\n");
-         goto clean;
-      }
+   libretrodb_cursor_close(&cur);
+   return rv;
+}
 
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
+/**
+ * libretrodb_create_index:
+ * @db                  : Handle to database.
+ * @name                : Name of the new index.
+ * @field_name          : Binary field to index.
+ *
+ * Appends an index on @field_name to the database file and
+ * reopens @db so that it is used. Every item needs a value of
+ * the same size for the field and the values have to be unique.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_create_index(libretrodb_t *db,
+      const char *name, const char *field_name)
+{
+   libretrodb_index_t idx;
+   struct libretrodb_index_entries entries = {0};
+   char *path = NULL;
+   RFILE *fd  = NULL;
+   int rv     = 0;
 
-      memcpy(buff, field->val.binary.buff, field_size);
+   if (!db || string_is_empty(db->path)
+         || string_is_empty(name) || string_is_empty(field_name))
+      return -EINVAL;
 
-      buff_u64 = (uint64_t *)buff + field_size;
+#ifdef HAVE_MMAN
+   if (db->map)
+      rv = libretrodb_find_index_mapped(db, name, NULL, &idx) ? 0 : -1;
+   else
+#endif
+      rv = libretrodb_find_index(db, name, NULL, &idx);
 
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+   if (rv == 0)
+   {
+      printf("Index already exists: %s\n", name);
+      return -EEXIST;
+   }
 
-      if (bintree_insert(tree, buff) != 0)
-      {
-         printf("Value is not unique: ");
-         rmsgpack_dom_value_print(field);
-         printf("\n");
-         goto clean;
-      }
-      buff     = NULL;
-      rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
+   if ((rv = libretrodb_index_collect(db, field_name, &entries)) != 0)
+      goto clean;
+
+   fd = filestream_open(db->path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!fd)
+   {
+      rv = -errno;
+      goto clean;
    }
 
-   filestream_seek(db->fd, 0, RETRO_VFS_SEEK_POSITION_END);
+   filestream_seek(fd, 0, RETRO_VFS_SEEK_POSITION_END);
 
-   strncpy(idx.name, name, 50);
+   if ((rv = libretrodb_index_write(fd, name, field_name, &entries)) != 0)
+      goto clean;
 
-   idx.name[49] = '\0';
-   idx.key_size = field_size;
-   idx.next     = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
+   filestream_close(fd);
+   fd = NULL;
 
-   nictx.db  = db;
-   nictx.idx = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
+   /* Reopen so that the mapping and the stream see the new index */
+   path = strdup(db->path);
+   libretrodb_close(db);
+   rv   = libretrodb_open(path, db);
 
 clean:
-   rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
-   if (cur.is_valid)
-      libretrodb_cursor_close(&cur);
-   if (tree)
-      bintree_free(tree);
-   free(tree);
-   return 0;
+   if (fd)
+      filestream_close(fd);
+   free(path);
+   free(entries.data);
+   return rv;
 }
 
 libretrodb_cursor_t *libretrodb_cursor_new(void)
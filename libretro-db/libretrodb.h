@@ -43,14 +43,55 @@ typedef struct libretrodb_cursor libretrodb_cursor_t;
 
 typedef struct libretrodb_index libretrodb_index_t;
 
+/* Undecoded item read through a cursor. On mapped databases it
+ * points straight into the mapping, otherwise it walks an item
+ * decoded and owned by the cursor. */
+typedef struct libretrodb_view
+{
+   const uint8_t *pos;
+   const uint8_t *end;
+   const struct rmsgpack_dom_value *item;
+   uint32_t len;
+   uint32_t index;
+} libretrodb_view_t;
+
 typedef int (*libretrodb_value_provider)(void *ctx, struct rmsgpack_dom_value *out);
 
 int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider, void *ctx);
 
+/**
+ * libretrodb_create_with_index:
+ * @fd                  : Stream to write the database to.
+ * @value_provider      : Called for every item until it returns non-zero.
+ * @ctx                 : Passed to @value_provider.
+ * @field_name          : Binary field to index, NULL for none.
+ *
+ * Writes a database like libretrodb_create() and indexes @field_name
+ * of the items on the way, the index is named after the field. If
+ * the field cannot be indexed only the index is left out.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_create_with_index(RFILE *fd,
+      libretrodb_value_provider value_provider, void *ctx,
+      const char *field_name);
+
 void libretrodb_close(libretrodb_t *db);
 
 int libretrodb_open(const char *path, libretrodb_t *db);
 
+/**
+ * libretrodb_create_index:
+ * @db                  : Handle to database.
+ * @name                : Name of the new index.
+ * @field_name          : Binary field to index.
+ *
+ * Appends an index on @field_name to the database file and
+ * reopens @db so that it is used. Every item needs a value of
+ * the same size for the field and the values have to be unique.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
 int libretrodb_create_index(libretrodb_t *db, const char *name,
       const char *field_name);
 
@@ -105,6 +146,38 @@ void libretrodb_query_free(void *q);
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_cursor_read_view:
+ * @cursor              : Handle to database cursor.
+ * @view                : View of the next matching item.
+ *
+ * Reads the next item matching the cursor query without
+ * decoding it. Walk its fields with libretrodb_view_next().
+ * The view stays valid until the next read from @cursor.
+ *
+ * Returns: 0 if successful, EOF at the end of the
+ * database, otherwise negative.
+ **/
+int libretrodb_cursor_read_view(libretrodb_cursor_t *cursor,
+      libretrodb_view_t *view);
+
+/**
+ * libretrodb_view_next:
+ * @view                : View returned by libretrodb_cursor_read_view().
+ * @key                 : Key of the next field.
+ * @value               : Value of the next field.
+ *
+ * Decodes the next field of @view. Both @key and @value are
+ * borrowed: strings point into the database and are not
+ * NUL-terminated. Nested maps and arrays are only reported with
+ * their length when the database is mapped.
+ *
+ * Returns: 0 if successful, EOF after the last field,
+ * otherwise negative.
+ **/
+int libretrodb_view_next(libretrodb_view_t *view,
+      struct rmsgpack_dom_value *key, struct rmsgpack_dom_value *value);
+
 RETRO_END_DECLS
 
 #endif
@@ -21,19 +21,151 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 
 #include <string/stdstring.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 
+/* Number of keys looked up by walking the whole database */
+#define BENCH_SCAN_SAMPLES 16
+
+static const struct rmsgpack_dom_value *bench_field(
+      const struct rmsgpack_dom_value *item, const char *field_name)
+{
+   struct rmsgpack_dom_value key;
+
+   if (item->type != RDT_MAP)
+      return NULL;
+
+   key.type            = RDT_STRING;
+   key.val.string.len  = (uint32_t)strlen(field_name);
+   key.val.string.buff = (char*)field_name;
+
+   return rmsgpack_dom_value_map_value(item, &key);
+}
+
+/* Times index lookups of every key of @field_name against lookups
+ * that walk the database. */
+static int bench(libretrodb_t *db, libretrodb_cursor_t *cur,
+      const char *index_name, const char *field_name)
+{
+   struct rmsgpack_dom_value item;
+   clock_t start;
+   double index_time, scan_time;
+   unsigned i, samples;
+   uint8_t *keys     = NULL;
+   unsigned count    = 0;
+   unsigned cap      = 0;
+   unsigned misses   = 0;
+   uint32_t key_size = 0;
+   int rv            = libretrodb_cursor_open(db, cur, NULL);
+
+   if (rv != 0)
+   {
+      printf("Could not open cursor: %s\n", strerror(-rv));
+      return rv;
+   }
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      const struct rmsgpack_dom_value *field = bench_field(&item, field_name);
+
+      if (field && field->type == RDT_BINARY && field->val.binary.len
+            && (!key_size || field->val.binary.len == key_size))
+      {
+         key_size = field->val.binary.len;
+
+         if (count == cap)
+         {
+            uint8_t *tmp;
+            cap = cap ? cap * 2 : 1024;
+            tmp = (uint8_t*)realloc(keys, (size_t)cap * key_size);
+            if (!tmp)
+            {
+               rmsgpack_dom_value_free(&item);
+               libretrodb_cursor_close(cur);
+               free(keys);
+               return -ENOMEM;
+            }
+            keys = tmp;
+         }
+
+         memcpy(keys + (size_t)count * key_size,
+               field->val.binary.buff, key_size);
+         count++;
+      }
+
+      rmsgpack_dom_value_free(&item);
+   }
+
+   libretrodb_cursor_close(cur);
+
+   if (!count)
+   {
+      printf("No binary values for field '%s'\n", field_name);
+      free(keys);
+      return -EINVAL;
+   }
+
+   start = clock();
+   for (i = 0; i < count; i++)
+   {
+      if (libretrodb_find_entry(db, index_name,
+               keys + (size_t)i * key_size, &item) != 0)
+      {
+         misses++;
+         continue;
+      }
+      rmsgpack_dom_value_free(&item);
+   }
+   index_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+   samples = count < BENCH_SCAN_SAMPLES ? count : BENCH_SCAN_SAMPLES;
+   start   = clock();
+   for (i = 0; i < samples; i++)
+   {
+      const uint8_t *key = keys + (size_t)(i * (count / samples)) * key_size;
+
+      if ((rv = libretrodb_cursor_open(db, cur, NULL)) != 0)
+         break;
+
+      while (libretrodb_cursor_read_item(cur, &item) == 0)
+      {
+         const struct rmsgpack_dom_value *field = bench_field(&item, field_name);
+         int found = field && field->type == RDT_BINARY
+            && field->val.binary.len == key_size
+            && !memcmp(field->val.binary.buff, key, key_size);
+
+         rmsgpack_dom_value_free(&item);
+         if (found)
+            break;
+      }
+
+      libretrodb_cursor_close(cur);
+   }
+   scan_time = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+   printf("%u keys, %u not found in index '%s'\n",
+         count, misses, index_name);
+   printf("index: %.3f us per lookup\n", index_time * 1e6 / count);
+   printf("scan:  %.3f us per lookup (%u samples)\n",
+         scan_time * 1e6 / samples, samples);
+
+   free(keys);
+   return 0;
+}
+
 int main(int argc, char ** argv)
 {
    int rv;
    libretrodb_t *db;
    libretrodb_cursor_t *cur;
-   libretrodb_query_t *q;
+   libretrodb_query_t *q = NULL;
    struct rmsgpack_dom_value item;
    const char *command, *path, *query_exp, *error;
 
@@ -43,6 +175,7 @@ int main(int argc, char ** argv)
       printf("Available Commands:\n");
       printf("\tlist\n");
       printf("\tcreate-index <index name> <field name>\n");
+      printf("\tbench <index name> <field name>\n");
       printf("\tfind <query expression>\n");
       printf("\tget-names <query expression>\n");
       return 1;
@@ -159,6 +292,7 @@ int main(int argc, char ** argv)
    else if (memcmp(command, "create-index", 12) == 0)
    {
       const char * index_name, * field_name;
+      clock_t start;
 
       if (argc != 5)
       {
@@ -169,7 +303,25 @@ int main(int argc, char ** argv)
       index_name = argv[3];
       field_name = argv[4];
 
-      libretrodb_create_index(db, index_name, field_name);
+      start = clock();
+      if ((rv = libretrodb_create_index(db, index_name, field_name)) != 0)
+      {
+         printf("Could not create index: %s\n", strerror(-rv));
+         goto error;
+      }
+      printf("Created index '%s' in %.3f s\n", index_name,
+            (double)(clock() - start) / CLOCKS_PER_SEC);
+   }
+   else if (memcmp(command, "bench", 5) == 0)
+   {
+      if (argc != 5)
+      {
+         printf("Usage: %s <db file> bench <index name> <field name>\n", argv[0]);
+         goto error;
+      }
+
+      if (bench(db, cur, argv[3], argv[4]) != 0)
+         goto error;
    }
    else
    {
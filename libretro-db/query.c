@@ -39,6 +39,8 @@
 
 #define MAX_ERROR_LEN   256
 #define QUERY_MAX_ARGS  50
+/* A table holds at most this many distinct fields */
+#define QUERY_MAX_FIELDS (QUERY_MAX_ARGS / 2)
 
 struct buffer
 {
@@ -78,10 +80,48 @@ struct argument
    } a;
 };
 
+/* Operations of a compiled query program. */
+enum query_op
+{
+   QOP_TABLE = 0,
+   QOP_AND,
+   QOP_OR,
+   QOP_EQUALS,
+   QOP_GLOB,
+   QOP_BETWEEN,
+   QOP_IS_TRUE,
+   QOP_FALSE
+};
+
+/* One node of a query flattened in prefix order. The children of
+ * a TABLE, AND or OR node directly follow it, each child spans
+ * 'size' instructions. Constants are borrowed from the parse tree. */
+struct query_insn
+{
+   enum query_op op;
+   unsigned field;
+   unsigned argc;
+   unsigned size;
+   const struct rmsgpack_dom_value *arg;
+   const struct rmsgpack_dom_value *arg2;
+};
+
+struct query_program
+{
+   /* Top-level fields the query reads, in slot order */
+   const struct rmsgpack_dom_value *fields[QUERY_MAX_FIELDS];
+   unsigned field_count;
+   struct query_insn *insns;
+   unsigned count;
+   unsigned cap;
+};
+
 struct query
 {
    unsigned ref_count;
    struct invocation root;
+   /* NULL when the query can only be interpreted on a full DOM */
+   struct query_program *program;
 };
 
 struct registered_func
@@ -901,6 +941,267 @@ success:
    return buff;
 }
 
+static int query_program_push(struct query_program *p,
+      enum query_op op, unsigned field)
+{
+   struct query_insn *insn;
+
+   if (p->count == p->cap)
+   {
+      unsigned cap              = p->cap ? p->cap * 2 : 16;
+      struct query_insn *insns  = (struct query_insn*)
+         realloc(p->insns, cap * sizeof(*insns));
+
+      if (!insns)
+         return -1;
+
+      p->insns = insns;
+      p->cap   = cap;
+   }
+
+   insn        = &p->insns[p->count];
+   insn->op    = op;
+   insn->field = field;
+   insn->argc  = 0;
+   insn->size  = 1;
+   insn->arg   = NULL;
+   insn->arg2  = NULL;
+   return (int)p->count++;
+}
+
+static int query_program_add_arg(struct query_program *p,
+      const struct argument *arg, unsigned field)
+{
+   unsigned i;
+   const struct invocation *inv;
+   int at = query_program_push(p, QOP_FALSE, field);
+
+   if (at < 0)
+      return -1;
+
+   if (arg->type == AT_VALUE)
+   {
+      p->insns[at].op  = QOP_EQUALS;
+      p->insns[at].arg = &arg->a.value;
+      return 0;
+   }
+
+   inv = &arg->a.invocation;
+
+   /* Mirror the argument checks of the query_func_* callbacks,
+    * calls they always reject compile to QOP_FALSE. */
+   if (     inv->func == query_func_operator_and
+         || inv->func == query_func_operator_or)
+   {
+      p->insns[at].op   = (inv->func == query_func_operator_and)
+         ? QOP_AND : QOP_OR;
+      p->insns[at].argc = inv->argc;
+
+      for (i = 0; i < inv->argc; i++)
+      {
+         if (query_program_add_arg(p, &inv->argv[i], field) != 0)
+            return -1;
+      }
+   }
+   else if (inv->func == query_func_glob)
+   {
+      if (     inv->argc == 1
+            && inv->argv[0].type == AT_VALUE
+            && inv->argv[0].a.value.type == RDT_STRING)
+      {
+         p->insns[at].op  = QOP_GLOB;
+         p->insns[at].arg = &inv->argv[0].a.value;
+      }
+   }
+   else if (inv->func == query_func_between)
+   {
+      if (     inv->argc == 2
+            && inv->argv[0].type == AT_VALUE
+            && inv->argv[1].type == AT_VALUE
+            && inv->argv[0].a.value.type == RDT_INT
+            && inv->argv[1].a.value.type == RDT_INT)
+      {
+         p->insns[at].op   = QOP_BETWEEN;
+         p->insns[at].arg  = &inv->argv[0].a.value;
+         p->insns[at].arg2 = &inv->argv[1].a.value;
+      }
+   }
+   else if (inv->func == query_func_is_true)
+   {
+      if (inv->argc == 0)
+         p->insns[at].op = QOP_IS_TRUE;
+   }
+   else
+   {
+      /* Nested tables need the decoded sub-document */
+      return -1;
+   }
+
+   p->insns[at].size = p->count - at;
+   return 0;
+}
+
+static void query_program_free(struct query_program *p)
+{
+   if (!p)
+      return;
+   free(p->insns);
+   free(p);
+}
+
+/**
+ * query_program_new:
+ * @root                : Parsed query.
+ *
+ * Flattens a query on top-level fields into a program that
+ * can be run against undecoded items.
+ *
+ * Returns: the program, or NULL if the query has to be
+ * interpreted.
+ **/
+static struct query_program *query_program_new(
+      const struct invocation *root)
+{
+   unsigned i, j;
+   struct query_program *p = NULL;
+
+   if (root->func != query_func_all_map)
+      return NULL;
+
+   if (!(p = (struct query_program*)calloc(1, sizeof(*p))))
+      return NULL;
+
+   if (query_program_push(p, QOP_TABLE, 0) < 0)
+      goto error;
+
+   if (root->argc % 2 != 0)
+   {
+      p->insns[0].op = QOP_FALSE;
+      return p;
+   }
+
+   for (i = 0; i < root->argc; i += 2)
+   {
+      const struct rmsgpack_dom_value *key = &root->argv[i].a.value;
+
+      if (root->argv[i].type != AT_VALUE)
+      {
+         p->insns[0].op = QOP_FALSE;
+         p->count       = 1;
+         return p;
+      }
+
+      for (j = 0; j < p->field_count; j++)
+      {
+         if (rmsgpack_dom_value_cmp(p->fields[j], key) == 0)
+            break;
+      }
+
+      if (j == p->field_count)
+         p->fields[p->field_count++] = key;
+
+      if (query_program_add_arg(p, &root->argv[i + 1], j) != 0)
+         goto error;
+
+      p->insns[0].argc++;
+   }
+
+   p->insns[0].size = p->count;
+   return p;
+
+error:
+   query_program_free(p);
+   return NULL;
+}
+
+static int query_program_equals(const struct rmsgpack_dom_value *input,
+      const struct rmsgpack_dom_value *value)
+{
+   /* Same coercion as func_equals() */
+   if (input->type == RDT_UINT && value->type == RDT_INT)
+      return input->val.uint_ == (uint64_t)value->val.int_;
+   return rmsgpack_dom_value_cmp(input, value) == 0;
+}
+
+static int query_program_glob(const struct rmsgpack_dom_value *input,
+      const char *pattern)
+{
+   int rv;
+   char tmp[256];
+   char *s = tmp;
+
+   if (input->type != RDT_STRING)
+      return 0;
+
+   /* Strings of undecoded items are not NUL-terminated */
+   if (input->val.string.len >= sizeof(tmp))
+   {
+      if (!(s = (char*)malloc(input->val.string.len + 1)))
+         return 0;
+   }
+
+   memcpy(s, input->val.string.buff, input->val.string.len);
+   s[input->val.string.len] = '\0';
+
+   rv = rl_fnmatch(pattern, s, 0) == 0;
+
+   if (s != tmp)
+      free(s);
+   return rv;
+}
+
+static int query_program_eval(const struct query_insn *insn,
+      const struct rmsgpack_dom_value *values)
+{
+   unsigned i;
+   const struct query_insn *child    = insn + 1;
+   const struct rmsgpack_dom_value *input = &values[insn->field];
+
+   switch (insn->op)
+   {
+      case QOP_TABLE:
+         for (i = 0; i < insn->argc; i++, child += child->size)
+         {
+            if (!query_program_eval(child, values))
+               return 0;
+         }
+         return 1;
+      case QOP_AND:
+         for (i = 0; i < insn->argc; i++, child += child->size)
+         {
+            if (!query_program_eval(child, values))
+               return 0;
+         }
+         return insn->argc > 0;
+      case QOP_OR:
+         for (i = 0; i < insn->argc; i++, child += child->size)
+         {
+            if (query_program_eval(child, values))
+               return 1;
+         }
+         return 0;
+      case QOP_EQUALS:
+         return query_program_equals(input, insn->arg);
+      case QOP_GLOB:
+         return query_program_glob(input, insn->arg->val.string.buff);
+      case QOP_BETWEEN:
+         /* Same comparisons as query_func_between() */
+         if (input->type == RDT_INT)
+            return input->val.int_ >= insn->arg->val.int_
+               && input->val.int_ <= insn->arg2->val.int_;
+         if (input->type == RDT_UINT)
+            return (unsigned)input->val.int_ >= insn->arg->val.uint_
+               && input->val.int_ <= insn->arg2->val.int_;
+         return 0;
+      case QOP_IS_TRUE:
+         return input->type == RDT_BOOL && input->val.bool_;
+      case QOP_FALSE:
+         break;
+   }
+
+   return 0;
+}
+
 void libretrodb_query_free(void *q)
 {
    unsigned i;
@@ -914,8 +1215,10 @@ void libretrodb_query_free(void *q)
       query_argument_free(&real_q->root.argv[i]);
 
    free(real_q->root.argv);
+   query_program_free(real_q->program);
    real_q->root.argv = NULL;
    real_q->root.argc = 0;
+   real_q->program   = NULL;
    free(real_q);
 }
 
@@ -955,6 +1258,8 @@ void *libretrodb_query_compile(libretrodb_t *db,
       goto error;
    }
 
+   q->program = query_program_new(&q->root);
+
    return q;
 
 error:
@@ -974,6 +1279,107 @@ int libretrodb_query_filter(libretrodb_query_t *q,
       struct rmsgpack_dom_value *v)
 {
    struct invocation inv = ((struct query *)q)->root;
-   struct rmsgpack_dom_value res = inv.func(*v, inv.argc, inv.argv);
+   struct rmsgpack_dom_value res;
+
+   if (((struct query *)q)->program && v->type == RDT_MAP)
+   {
+      libretrodb_view_t view;
+
+      view.pos   = NULL;
+      view.end   = NULL;
+      view.item  = v;
+      view.len   = v->val.map.len;
+      view.index = 0;
+
+      return libretrodb_query_filter_view(q, &view);
+   }
+
+   res = inv.func(*v, inv.argc, inv.argv);
    return (res.type == RDT_BOOL && res.val.bool_);
 }
+
+/**
+ * libretrodb_query_filter_view:
+ * @q                   : Compiled query.
+ * @view                : Item to test, consumed by the call.
+ *
+ * Runs the compiled program of @q on an undecoded item. Only the
+ * fields the query references are looked at.
+ *
+ * Returns: 1 if the item matches, 0 if it does not, -1 if the
+ * query can only be evaluated on a decoded item.
+ **/
+int libretrodb_query_filter_view(libretrodb_query_t *q,
+      struct libretrodb_view *view)
+{
+   unsigned i;
+   struct rmsgpack_dom_value key, value;
+   struct rmsgpack_dom_value values[QUERY_MAX_FIELDS];
+   unsigned found                = 0;
+   const struct query_program *p = ((struct query *)q)->program;
+
+   if (!p)
+      return -1;
+
+   /* All missing fields are nil */
+   for (i = 0; i < p->field_count; i++)
+      values[i].type = RDT_NULL;
+
+   while (found < p->field_count
+         && libretrodb_view_next(view, &key, &value) == 0)
+   {
+      for (i = 0; i < p->field_count; i++)
+      {
+         if (rmsgpack_dom_value_cmp(p->fields[i], &key) != 0)
+            continue;
+         if (values[i].type == RDT_NULL)
+         {
+            values[i] = value;
+            found++;
+         }
+         break;
+      }
+   }
+
+   return query_program_eval(p->insns, values);
+}
+
+/**
+ * libretrodb_query_get_equality:
+ * @q                   : Compiled query.
+ * @i                   : Index of the predicate.
+ * @field               : Name of the field.
+ * @value               : Value the field has to be equal to.
+ *
+ * Enumerates the plain 'field: value' predicates every match has
+ * to satisfy, so that callers can answer them from an index.
+ *
+ * Returns: 0 if there is an @i-th predicate, otherwise -1.
+ **/
+int libretrodb_query_get_equality(libretrodb_query_t *q, unsigned i,
+      const char **field, const struct rmsgpack_dom_value **value)
+{
+   const struct query_insn *insn;
+   const struct query_program *p = ((struct query *)q)->program;
+   unsigned n                    = 0;
+
+   if (!p || p->insns[0].op != QOP_TABLE)
+      return -1;
+
+   for (insn = &p->insns[1]; insn < p->insns + p->count;
+         insn += insn->size)
+   {
+      if (insn->op != QOP_EQUALS
+            || p->fields[insn->field]->type != RDT_STRING)
+         continue;
+
+      if (n++ == i)
+      {
+         *field = p->fields[insn->field]->val.string.buff;
+         *value = insn->arg;
+         return 0;
+      }
+   }
+
+   return -1;
+}
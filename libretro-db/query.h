@@ -38,6 +38,14 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+struct libretrodb_view;
+
+int libretrodb_query_filter_view(libretrodb_query_t *q,
+      struct libretrodb_view *view);
+
+int libretrodb_query_get_equality(libretrodb_query_t *q, unsigned i,
+      const char **field, const struct rmsgpack_dom_value **value);
+
 RETRO_END_DECLS
 
 #endif
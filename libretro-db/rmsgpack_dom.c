@@ -503,3 +503,311 @@ clean:
    rmsgpack_dom_value_free(&map);
    return 0;
 }
+
+static int dom_view_read_uint(const uint8_t **ptr, const uint8_t *end,
+      size_t size, uint64_t *out)
+{
+   size_t i;
+   uint64_t value   = 0;
+   const uint8_t *p = *ptr;
+
+   if ((size_t)(end - p) < size)
+      return -EINVAL;
+
+   for (i = 0; i < size; i++)
+      value = (value << 8) | p[i];
+
+   *ptr = p + size;
+   *out = value;
+   return 0;
+}
+
+/**
+ * rmsgpack_dom_view_read:
+ * @ptr                 : Read position inside a msgpack buffer.
+ * @end                 : End of the buffer.
+ * @out                 : Decoded value.
+ *
+ * Decodes the value at @ptr without copying it. Strings and binaries
+ * point into the buffer and strings are not NUL-terminated. For maps
+ * and arrays only the length is filled in (items is NULL); their
+ * contents follow at the updated @ptr.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_view_read(const uint8_t **ptr, const uint8_t *end,
+      struct rmsgpack_dom_value *out)
+{
+   uint64_t tmp     = 0;
+   const uint8_t *p = *ptr;
+   uint8_t type;
+
+   if (p >= end)
+      return -EINVAL;
+
+   type = *p++;
+
+   if (type < _MPF_FIXMAP)
+   {
+      out->type     = RDT_INT;
+      out->val.int_ = type;
+   }
+   else if (type < _MPF_FIXARRAY)
+   {
+      out->type          = RDT_MAP;
+      out->val.map.len   = type - _MPF_FIXMAP;
+      out->val.map.items = NULL;
+   }
+   else if (type < _MPF_FIXSTR)
+   {
+      out->type            = RDT_ARRAY;
+      out->val.array.len   = type - _MPF_FIXARRAY;
+      out->val.array.items = NULL;
+   }
+   else if (type < _MPF_NIL)
+   {
+      tmp = type - _MPF_FIXSTR;
+      goto string;
+   }
+   else if (type > _MPF_MAP32)
+   {
+      out->type     = RDT_INT;
+      out->val.int_ = (int8_t)type;
+   }
+   else
+   {
+      switch (type)
+      {
+         case _MPF_NIL:
+            out->type = RDT_NULL;
+            break;
+         case _MPF_FALSE:
+         case _MPF_TRUE:
+            out->type      = RDT_BOOL;
+            out->val.bool_ = (type == _MPF_TRUE);
+            break;
+         case _MPF_BIN8:
+         case _MPF_BIN16:
+         case _MPF_BIN32:
+            if (dom_view_read_uint(&p, end,
+                     (size_t)1 << (type - _MPF_BIN8), &tmp) < 0)
+               return -EINVAL;
+            if ((uint64_t)(end - p) < tmp)
+               return -EINVAL;
+            out->type            = RDT_BINARY;
+            out->val.binary.len  = (uint32_t)tmp;
+            out->val.binary.buff = (char*)p;
+            p                   += tmp;
+            break;
+         case _MPF_UINT8:
+         case _MPF_UINT16:
+         case _MPF_UINT32:
+         case _MPF_UINT64:
+            if (dom_view_read_uint(&p, end,
+                     (size_t)1 << (type - _MPF_UINT8), &tmp) < 0)
+               return -EINVAL;
+            out->type      = RDT_UINT;
+            out->val.uint_ = tmp;
+            break;
+         case _MPF_INT8:
+         case _MPF_INT16:
+         case _MPF_INT32:
+         case _MPF_INT64:
+            if (dom_view_read_uint(&p, end,
+                     (size_t)1 << (type - _MPF_INT8), &tmp) < 0)
+               return -EINVAL;
+            out->type = RDT_INT;
+            switch (type)
+            {
+               case _MPF_INT8:
+                  out->val.int_ = (int8_t)tmp;
+                  break;
+               case _MPF_INT16:
+                  out->val.int_ = (int16_t)tmp;
+                  break;
+               case _MPF_INT32:
+                  out->val.int_ = (int32_t)tmp;
+                  break;
+               default:
+                  out->val.int_ = (int64_t)tmp;
+                  break;
+            }
+            break;
+         case _MPF_STR8:
+         case _MPF_STR16:
+         case _MPF_STR32:
+            if (dom_view_read_uint(&p, end,
+                     (size_t)1 << (type - _MPF_STR8), &tmp) < 0)
+               return -EINVAL;
+            goto string;
+         case _MPF_ARRAY16:
+         case _MPF_ARRAY32:
+            if (dom_view_read_uint(&p, end,
+                     (size_t)2 << (type - _MPF_ARRAY16), &tmp) < 0)
+               return -EINVAL;
+            out->type            = RDT_ARRAY;
+            out->val.array.len   = (uint32_t)tmp;
+            out->val.array.items = NULL;
+            break;
+         case _MPF_MAP16:
+         case _MPF_MAP32:
+            if (dom_view_read_uint(&p, end,
+                     (size_t)2 << (type - _MPF_MAP16), &tmp) < 0)
+               return -EINVAL;
+            out->type          = RDT_MAP;
+            out->val.map.len   = (uint32_t)tmp;
+            out->val.map.items = NULL;
+            break;
+         default:
+            /* Floats and extension types are never written */
+            return -EINVAL;
+      }
+   }
+
+   *ptr = p;
+   return 0;
+
+string:
+   if ((uint64_t)(end - p) < tmp)
+      return -EINVAL;
+   out->type            = RDT_STRING;
+   out->val.string.len  = (uint32_t)tmp;
+   out->val.string.buff = (char*)p;
+   *ptr                 = p + tmp;
+   return 0;
+}
+
+/**
+ * rmsgpack_dom_view_skip:
+ * @ptr                 : Read position inside a msgpack buffer.
+ * @end                 : End of the buffer.
+ *
+ * Advances @ptr past one complete value, including the
+ * contents of maps and arrays.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_view_skip(const uint8_t **ptr, const uint8_t *end)
+{
+   struct rmsgpack_dom_value v;
+   uint64_t pending = 1;
+
+   while (pending > 0)
+   {
+      int rv = rmsgpack_dom_view_read(ptr, end, &v);
+
+      if (rv < 0)
+         return rv;
+
+      pending--;
+
+      if (v.type == RDT_MAP)
+         pending += 2 * (uint64_t)v.val.map.len;
+      else if (v.type == RDT_ARRAY)
+         pending += v.val.array.len;
+   }
+
+   return 0;
+}
+
+static int dom_read_buf(const uint8_t **ptr, const uint8_t *end,
+      struct rmsgpack_dom_value *out, unsigned depth)
+{
+   unsigned i;
+   char *buff = NULL;
+   int rv     = rmsgpack_dom_view_read(ptr, end, out);
+
+   if (rv < 0)
+   {
+      out->type = RDT_NULL;
+      return rv;
+   }
+
+   switch (out->type)
+   {
+      case RDT_STRING:
+      case RDT_BINARY:
+         /* string and binary share their layout */
+         buff = (char*)malloc(out->val.string.len + 1);
+         if (!buff)
+         {
+            out->type = RDT_NULL;
+            return -ENOMEM;
+         }
+         memcpy(buff, out->val.string.buff, out->val.string.len);
+         buff[out->val.string.len] = '\0';
+         out->val.string.buff      = buff;
+         break;
+      case RDT_MAP:
+         if (depth >= MAX_DEPTH
+               || out->val.map.len > (uint64_t)(end - *ptr))
+         {
+            out->type = RDT_NULL;
+            return -EINVAL;
+         }
+         out->val.map.items = (struct rmsgpack_dom_pair*)
+            calloc(out->val.map.len, sizeof(struct rmsgpack_dom_pair));
+         if (!out->val.map.items && out->val.map.len)
+         {
+            out->type = RDT_NULL;
+            return -ENOMEM;
+         }
+         for (i = 0; i < out->val.map.len; i++)
+         {
+            if (     (rv = dom_read_buf(ptr, end,
+                        &out->val.map.items[i].key,   depth + 1)) < 0
+                  || (rv = dom_read_buf(ptr, end,
+                        &out->val.map.items[i].value, depth + 1)) < 0)
+               goto error;
+         }
+         break;
+      case RDT_ARRAY:
+         if (depth >= MAX_DEPTH
+               || out->val.array.len > (uint64_t)(end - *ptr))
+         {
+            out->type = RDT_NULL;
+            return -EINVAL;
+         }
+         out->val.array.items = (struct rmsgpack_dom_value*)
+            calloc(out->val.array.len, sizeof(struct rmsgpack_dom_value));
+         if (!out->val.array.items && out->val.array.len)
+         {
+            out->type = RDT_NULL;
+            return -ENOMEM;
+         }
+         for (i = 0; i < out->val.array.len; i++)
+         {
+            if ((rv = dom_read_buf(ptr, end,
+                        &out->val.array.items[i], depth + 1)) < 0)
+               goto error;
+         }
+         break;
+      default:
+         break;
+   }
+
+   return 0;
+
+error:
+   rmsgpack_dom_value_free(out);
+   out->type = RDT_NULL;
+   return rv;
+}
+
+/**
+ * rmsgpack_dom_read_buf:
+ * @ptr                 : Read position inside a msgpack buffer.
+ * @end                 : End of the buffer.
+ * @out                 : Decoded value.
+ *
+ * Same as rmsgpack_dom_read(), but decodes from memory. The
+ * resulting value owns its data and must be released with
+ * rmsgpack_dom_value_free().
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_buf(const uint8_t **ptr, const uint8_t *end,
+      struct rmsgpack_dom_value *out)
+{
+   return dom_read_buf(ptr, end, out, 0);
+}
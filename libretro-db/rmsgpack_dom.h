@@ -95,6 +95,14 @@ int rmsgpack_dom_write(RFILE *fd, const struct rmsgpack_dom_value *obj);
 
 int rmsgpack_dom_read_into(RFILE *fd, ...);
 
+int rmsgpack_dom_read_buf(const uint8_t **ptr, const uint8_t *end,
+      struct rmsgpack_dom_value *out);
+
+int rmsgpack_dom_view_read(const uint8_t **ptr, const uint8_t *end,
+      struct rmsgpack_dom_value *out);
+
+int rmsgpack_dom_view_skip(const uint8_t **ptr, const uint8_t *end);
+
 RETRO_END_DECLS
 
 #endif
@@ -1095,16 +1095,37 @@ static void xmb_update_savestate_thumbnail_path(void *data, unsigned i)
    menu_entry_free(&entry);
 }
 
+/* Thumbnails are never drawn wider than their nominal width
+ * nor taller than the screen, so there is no point in keeping
+ * more pixels around. Rounded up so that small window resizes
+ * keep hitting the same thumbnail cache entries. */
+static void xmb_thumbnail_max_size(float thumbnail_width,
+      unsigned *max_width, unsigned *max_height)
+{
+   unsigned height = 0;
+
+   video_driver_get_size(NULL, &height);
+
+   *max_width  = ((unsigned)thumbnail_width + 63) & ~63;
+   *max_height = (height + 63) & ~63;
+}
+
 static void xmb_update_thumbnail_image(void *data)
 {
-   xmb_handle_t *xmb = (xmb_handle_t*)data;
+   unsigned max_width  = 0;
+   unsigned max_height = 0;
+   xmb_handle_t *xmb   = (xmb_handle_t*)data;
    if (!xmb)
       return;
 
    if (!(string_is_empty(xmb->thumbnail_file_path)))
    {
+      xmb_thumbnail_max_size(xmb->thumbnail_width,
+            &max_width, &max_height);
+
       if (filestream_exists(xmb->thumbnail_file_path))
-         task_push_image_load(xmb->thumbnail_file_path,
+         task_push_image_load_thumbnail(xmb->thumbnail_file_path,
+               max_width, max_height,
                menu_display_handle_thumbnail_upload, NULL);
       else
          xmb->thumbnail = 0;
@@ -1115,8 +1136,12 @@ static void xmb_update_thumbnail_image(void *data)
 
    if (!(string_is_empty(xmb->left_thumbnail_file_path)))
    {
+      xmb_thumbnail_max_size(xmb->left_thumbnail_width,
+            &max_width, &max_height);
+
       if (filestream_exists(xmb->left_thumbnail_file_path))
-         task_push_image_load(xmb->left_thumbnail_file_path,
+         task_push_image_load_thumbnail(xmb->left_thumbnail_file_path,
+               max_width, max_height,
                menu_display_handle_left_thumbnail_upload, NULL);
       else
          xmb->left_thumbnail = 0;
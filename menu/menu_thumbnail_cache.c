@@ -0,0 +1,299 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <compat/strl.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+#include <rhash.h>
+
+#include "menu_thumbnail_cache.h"
+#include "../verbosity.h"
+
+#define MENU_THUMBNAIL_CACHE_FLAG_RGBA (1 << 0)
+
+/* Entry layout (native endian), 32 bytes of header
+ * followed by width * height 32-bit pixels exactly as
+ * the video driver uploads them, so an entry can be
+ * read (or mapped) straight into a texture_image. */
+struct menu_thumbnail_cache_header
+{
+   char magic[4];
+   uint32_t version;
+   uint32_t width;
+   uint32_t height;
+   int64_t source_mtime;
+   int32_t source_size;
+   uint32_t flags;
+};
+
+static bool menu_thumbnail_cache_entry_path(char *s, size_t len,
+      const char *cache_dir, const char *path,
+      unsigned max_width, unsigned max_height, bool supports_rgba)
+{
+   char key[PATH_MAX_LENGTH + 64];
+   char hash[65];
+   char dir[PATH_MAX_LENGTH];
+
+   if (string_is_empty(cache_dir) || string_is_empty(path))
+      return false;
+
+   snprintf(key, sizeof(key), "%s\n%ux%u\n%d",
+         path, max_width, max_height, supports_rgba ? 1 : 0);
+
+   hash[0] = '\0';
+   sha256_hash(hash, (const uint8_t*)key, strlen(key));
+
+   fill_pathname_join(dir, cache_dir, "thumbnails", sizeof(dir));
+   fill_pathname_join(s, dir, hash, len);
+   strlcat(s, ".rth", len);
+
+   return true;
+}
+
+bool menu_thumbnail_cache_load(const char *cache_dir, const char *path,
+      unsigned max_width, unsigned max_height, bool supports_rgba,
+      struct texture_image *out_img)
+{
+   char entry_path[PATH_MAX_LENGTH];
+   struct menu_thumbnail_cache_header header;
+   uint32_t flags        = supports_rgba
+      ? MENU_THUMBNAIL_CACHE_FLAG_RGBA : 0;
+   int64_t pixels_size   = 0;
+   uint32_t *pixels      = NULL;
+   RFILE *file           = NULL;
+
+   if (!menu_thumbnail_cache_entry_path(entry_path, sizeof(entry_path),
+            cache_dir, path, max_width, max_height, supports_rgba))
+      return false;
+
+   if (!filestream_exists(entry_path))
+      return false;
+
+   file = filestream_open(entry_path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   if (filestream_read(file, &header, sizeof(header)) != sizeof(header))
+      goto error;
+
+   pixels_size = (int64_t)header.width * header.height * sizeof(uint32_t);
+
+   if (     memcmp(header.magic, "RTHC", sizeof(header.magic))
+         || header.version != MENU_THUMBNAIL_CACHE_VERSION
+         || header.flags   != flags
+         || !header.width || !header.height
+         || filestream_get_size(file) != (int64_t)sizeof(header) + pixels_size)
+      goto error;
+
+   /* The source was replaced or touched since the entry
+    * was written; decode it again. */
+   if (     header.source_mtime != path_get_mtime(path)
+         || header.source_size  != path_get_size(path))
+      goto error;
+
+   pixels = (uint32_t*)malloc((size_t)pixels_size);
+
+   if (!pixels || filestream_read(file, pixels, pixels_size) != pixels_size)
+      goto error;
+
+   filestream_close(file);
+
+   out_img->width         = header.width;
+   out_img->height        = header.height;
+   out_img->pixels        = pixels;
+   out_img->supports_rgba = supports_rgba;
+
+   return true;
+
+error:
+   free(pixels);
+   filestream_close(file);
+   return false;
+}
+
+bool menu_thumbnail_cache_store(const char *cache_dir, const char *path,
+      unsigned max_width, unsigned max_height,
+      const struct texture_image *img)
+{
+   char entry_path[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   char dir[PATH_MAX_LENGTH];
+   struct menu_thumbnail_cache_header header;
+   int64_t pixels_size = 0;
+   RFILE *file         = NULL;
+
+   if (!img || !img->pixels || !img->width || !img->height)
+      return false;
+
+   if (!menu_thumbnail_cache_entry_path(entry_path, sizeof(entry_path),
+            cache_dir, path, max_width, max_height, img->supports_rgba))
+      return false;
+
+   fill_pathname_basedir(dir, entry_path, sizeof(dir));
+
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+   {
+      RARCH_WARN("[thumbnail cache]: Cannot create directory \"%s\".\n", dir);
+      return false;
+   }
+
+   memcpy(header.magic, "RTHC", sizeof(header.magic));
+   header.version      = MENU_THUMBNAIL_CACHE_VERSION;
+   header.width        = img->width;
+   header.height       = img->height;
+   header.source_mtime = path_get_mtime(path);
+   header.source_size  = path_get_size(path);
+   header.flags        = img->supports_rgba
+      ? MENU_THUMBNAIL_CACHE_FLAG_RGBA : 0;
+
+   if (header.source_size < 0)
+      return false;
+
+   pixels_size         = (int64_t)img->width * img->height * sizeof(uint32_t);
+
+   /* Write to a temporary file first, so a menu scrolling
+    * past the entry never reads a half written one. */
+   strlcpy(tmp_path, entry_path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   if (     filestream_write(file, &header, sizeof(header)) != sizeof(header)
+         || filestream_write(file, img->pixels, pixels_size) != pixels_size)
+   {
+      filestream_close(file);
+      filestream_delete(tmp_path);
+      return false;
+   }
+
+   filestream_close(file);
+
+   if (filestream_rename(tmp_path, entry_path) != 0)
+   {
+      /* Some platforms refuse to rename over an existing file. */
+      filestream_delete(entry_path);
+      if (filestream_rename(tmp_path, entry_path) != 0)
+      {
+         filestream_delete(tmp_path);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool menu_thumbnail_downscale(struct texture_image *img,
+      unsigned max_width, unsigned max_height)
+{
+   unsigned x, y;
+   unsigned dst_width, dst_height;
+   uint32_t *dst = NULL;
+
+   if (!img || !img->pixels || !max_width || !max_height)
+      return true;
+
+   if (img->width <= max_width && img->height <= max_height)
+      return true;
+
+   /* Fit the longer side relative to the box, then
+    * derive the other one from the source aspect. */
+   if ((uint64_t)img->width * max_height > (uint64_t)img->height * max_width)
+   {
+      dst_width  = max_width;
+      dst_height = (unsigned)(((uint64_t)img->height * max_width
+               + img->width / 2) / img->width);
+   }
+   else
+   {
+      dst_height = max_height;
+      dst_width  = (unsigned)(((uint64_t)img->width * max_height
+               + img->height / 2) / img->height);
+   }
+
+   if (!dst_width)
+      dst_width  = 1;
+   if (!dst_height)
+      dst_height = 1;
+
+   dst = (uint32_t*)malloc(dst_width * dst_height * sizeof(uint32_t));
+
+   if (!dst)
+      return false;
+
+   /* Box filter: every destination pixel is the average of
+    * the source pixels it covers. Each byte lane is averaged
+    * separately, so this works for both ARGB and ABGR. */
+   for (y = 0; y < dst_height; y++)
+   {
+      unsigned y0 = (unsigned)((uint64_t)y       * img->height / dst_height);
+      unsigned y1 = (unsigned)((uint64_t)(y + 1) * img->height / dst_height);
+
+      if (y1 <= y0)
+         y1 = y0 + 1;
+
+      for (x = 0; x < dst_width; x++)
+      {
+         unsigned sx, sy;
+         uint32_t sum[4] = {0};
+         unsigned x0     = (unsigned)((uint64_t)x       * img->width / dst_width);
+         unsigned x1     = (unsigned)((uint64_t)(x + 1) * img->width / dst_width);
+         unsigned count;
+
+         if (x1 <= x0)
+            x1 = x0 + 1;
+
+         count = (x1 - x0) * (y1 - y0);
+
+         for (sy = y0; sy < y1; sy++)
+         {
+            const uint32_t *src = img->pixels + sy * img->width;
+
+            for (sx = x0; sx < x1; sx++)
+            {
+               uint32_t col = src[sx];
+               sum[0] += (col >>  0) & 0xff;
+               sum[1] += (col >>  8) & 0xff;
+               sum[2] += (col >> 16) & 0xff;
+               sum[3] += (col >> 24) & 0xff;
+            }
+         }
+
+         dst[y * dst_width + x] =
+              (((sum[0] + count / 2) / count) <<  0)
+            | (((sum[1] + count / 2) / count) <<  8)
+            | (((sum[2] + count / 2) / count) << 16)
+            | (((sum[3] + count / 2) / count) << 24);
+      }
+   }
+
+   free(img->pixels);
+   img->pixels = dst;
+   img->width  = dst_width;
+   img->height = dst_height;
+
+   return true;
+}
@@ -0,0 +1,83 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MENU_THUMBNAIL_CACHE_H
+#define _MENU_THUMBNAIL_CACHE_H
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include <formats/image.h>
+
+RETRO_BEGIN_DECLS
+
+#define MENU_THUMBNAIL_CACHE_VERSION 1
+
+/**
+ * menu_thumbnail_cache_load:
+ * @cache_dir          : cache directory, thumbnails are kept
+ *                       in its "thumbnails" subdirectory.
+ * @path               : path of the source image.
+ * @max_width          : width the image was fitted into.
+ * @max_height         : height the image was fitted into.
+ * @supports_rgba      : pixel order the video driver expects.
+ * @out_img            : receives the cached pixels.
+ *
+ * Looks up a decoded, downscaled copy of @path. Entries whose
+ * source file changed since they were written are ignored.
+ *
+ * Returns: true (1) on a cache hit, otherwise false (0).
+ **/
+bool menu_thumbnail_cache_load(const char *cache_dir, const char *path,
+      unsigned max_width, unsigned max_height, bool supports_rgba,
+      struct texture_image *out_img);
+
+/**
+ * menu_thumbnail_cache_store:
+ * @cache_dir          : cache directory.
+ * @path               : path of the source image.
+ * @max_width          : width the image was fitted into.
+ * @max_height         : height the image was fitted into.
+ * @img                : decoded, color converted pixels.
+ *
+ * Writes @img to the cache so the next lookup of @path at the
+ * same size skips decoding.
+ *
+ * Returns: true (1) if the entry was written, otherwise false (0).
+ **/
+bool menu_thumbnail_cache_store(const char *cache_dir, const char *path,
+      unsigned max_width, unsigned max_height,
+      const struct texture_image *img);
+
+/**
+ * menu_thumbnail_downscale:
+ * @img                : image to scale in place.
+ * @max_width          : maximum width.
+ * @max_height         : maximum height.
+ *
+ * Box filters @img down until it fits @max_width x @max_height,
+ * keeping its aspect ratio. Images that already fit are left
+ * untouched.
+ *
+ * Returns: false (0) if memory could not be allocated.
+ **/
+bool menu_thumbnail_downscale(struct texture_image *img,
+      unsigned max_width, unsigned max_height);
+
+RETRO_END_DECLS
+
+#endif
@@ -22,11 +22,16 @@
 #include <compat/strl.h>
 #include <retro_endianness.h>
 #include <streams/interface_stream.h>
+#ifdef HAVE_ZLIB
+#include <streams/trans_stream.h>
+#endif
 
 #include "configuration.h"
 #include "movie.h"
 #include "core.h"
 #include "content.h"
+#include "audio/audio_driver.h"
+#include "gfx/video_driver.h"
 #include "retroarch.h"
 #include "msg_hash.h"
 #include "verbosity.h"
@@ -34,9 +39,72 @@
 #include "command.h"
 #include "file_path_special.h"
 
+/* BSV2 layout, all fields little endian except the magic,
+ * which is stored like the BSV1 one:
+ *
+ *   header      uint32_t[BSV2_HEADER_WORDS]
+ *   block       repeated, one per keyframe interval
+ *   index       "BSVI", count, count * { first frame, frames,
+ *               offset (low, high) }
+ *
+ * Each block starts with uint32_t[BSV2_BLOCK_WORDS], followed
+ * by the keyframe savestate taken before its first frame and
+ * by the input of its frames. Input is stored as runs of
+ * identical frames: varint run length, varint word count,
+ * then the words themselves as int16_t.
+ *
+ * The header points at the index. A recording which was not
+ * closed properly has no index; it is rebuilt by walking the
+ * blocks on playback. */
+#define BSV2_HEADER_WORDS        8
+#define BSV2_BLOCK_WORDS         6
+#define BSV2_INDEX_MAGIC         0x49565342 /* "BSVI" */
+#define BSV2_KEYFRAME_INTERVAL   300
+
+#define BSV2_HDR_MAGIC           0
+#define BSV2_HDR_CRC             1
+#define BSV2_HDR_STATE_SIZE      2
+#define BSV2_HDR_INTERVAL        3
+#define BSV2_HDR_FRAMES          4
+#define BSV2_HDR_FLAGS           5
+#define BSV2_HDR_INDEX_LO        6
+#define BSV2_HDR_INDEX_HI        7
+
+#define BSV2_BLK_FIRST_FRAME     0
+#define BSV2_BLK_FRAMES          1
+#define BSV2_BLK_STATE_SIZE      2
+#define BSV2_BLK_STORED_SIZE     3
+#define BSV2_BLK_INPUT_SIZE      4
+#define BSV2_BLK_FLAGS           5
+
+/* Keyframe state is deflated. */
+#define BSV2_BLOCK_DEFLATED      0x1
+
+struct bsv_index_entry
+{
+   uint32_t first_frame;
+   uint32_t frames;
+   uint64_t offset;
+};
+
+/* The keyframe interval currently being played back
+ * or recorded, kept in memory. */
+struct bsv_block
+{
+   uint32_t first_frame;
+   uint32_t frames;
+   /* Offset into 'words' of each frame's input,
+    * frame_start[frames] is the end of the last one. */
+   uint32_t *frame_start;
+   int16_t *words;
+   size_t word_count;
+   size_t word_cap;
+};
+
 struct bsv_movie
 {
    intfstream_t *file;
+   unsigned version;
 
    /* A ring buffer keeping track of positions
     * in the file for each frame. */
@@ -47,8 +115,21 @@ struct bsv_movie
    size_t min_file_pos;
 
    size_t state_size;
+   /* BSV1: the initial state.
+    * BSV2: the keyframe of the current block. */
    uint8_t *state;
 
+   struct bsv_block block;
+   struct bsv_index_entry *index;
+   size_t index_count;
+   size_t index_cap;
+   uint32_t keyframe_interval;
+   uint32_t frame;
+   uint32_t frame_count;
+   size_t word_ptr;
+   uint64_t write_pos;
+   bool seeking;
+
    bool playback;
    bool first_rewind;
    bool did_rewind;
@@ -71,6 +152,660 @@ struct bsv_state
 static bsv_movie_t     *bsv_movie_state_handle = NULL;
 static struct bsv_state bsv_movie_state;
 
+static void bsv2_put_varint(uint8_t **out, uint32_t val)
+{
+   uint8_t *p = *out;
+
+   while (val >= 0x80)
+   {
+      *p++  = (uint8_t)(val | 0x80);
+      val >>= 7;
+   }
+   *p++ = (uint8_t)val;
+   *out = p;
+}
+
+static bool bsv2_get_varint(const uint8_t **in, const uint8_t *end,
+      uint32_t *val)
+{
+   const uint8_t *p = *in;
+   unsigned shift   = 0;
+   uint32_t ret     = 0;
+
+   while (p < end && shift < 32)
+   {
+      uint8_t c = *p++;
+      ret      |= (uint32_t)(c & 0x7f) << shift;
+      if (!(c & 0x80))
+      {
+         *val = ret;
+         *in  = p;
+         return true;
+      }
+      shift += 7;
+   }
+
+   return false;
+}
+
+static bool bsv2_block_reserve(struct bsv_block *block, size_t count)
+{
+   int16_t *words = NULL;
+   size_t cap     = block->word_cap ? block->word_cap : 1024;
+
+   if (count <= block->word_cap)
+      return true;
+
+   while (cap < count)
+      cap *= 2;
+
+   if (!(words = (int16_t*)realloc(block->words, cap * sizeof(*words))))
+      return false;
+
+   block->words    = words;
+   block->word_cap = cap;
+   return true;
+}
+
+static bool bsv2_frames_equal(const struct bsv_block *block,
+      uint32_t a, uint32_t b)
+{
+   uint32_t len = block->frame_start[a + 1] - block->frame_start[a];
+
+   if (len != block->frame_start[b + 1] - block->frame_start[b])
+      return false;
+
+   return !memcmp(block->words + block->frame_start[a],
+         block->words + block->frame_start[b], len * sizeof(int16_t));
+}
+
+/**
+ * bsv2_encode_input:
+ * @block                : Block to encode.
+ * @size                 : Size of the encoded input.
+ *
+ * Encodes the input of @block as runs of identical frames.
+ *
+ * Returns: encoded input, to be freed by the caller.
+ **/
+static uint8_t *bsv2_encode_input(const struct bsv_block *block,
+      size_t *size)
+{
+   uint32_t i   = 0;
+   uint8_t *buf = (uint8_t*)malloc(block->frames * 10
+         + block->word_count * sizeof(int16_t) + 1);
+   uint8_t *p   = buf;
+
+   if (!buf)
+      return NULL;
+
+   while (i < block->frames)
+   {
+      uint32_t j;
+      uint32_t k;
+      uint32_t len = block->frame_start[i + 1] - block->frame_start[i];
+
+      for (j = i + 1; j < block->frames; j++)
+         if (!bsv2_frames_equal(block, i, j))
+            break;
+
+      bsv2_put_varint(&p, j - i);
+      bsv2_put_varint(&p, len);
+
+      for (k = 0; k < len; k++)
+      {
+         uint16_t word = (uint16_t)block->words[block->frame_start[i] + k];
+         *p++          = (uint8_t)word;
+         *p++          = (uint8_t)(word >> 8);
+      }
+
+      i = j;
+   }
+
+   *size = p - buf;
+   return buf;
+}
+
+static bool bsv2_decode_input(struct bsv_block *block,
+      const uint8_t *data, size_t size, uint32_t frames)
+{
+   const uint8_t *end = data + size;
+
+   block->frames         = 0;
+   block->word_count     = 0;
+   block->frame_start[0] = 0;
+
+   while (data < end)
+   {
+      uint32_t run, len, i;
+      int16_t *words = NULL;
+
+      if (     !bsv2_get_varint(&data, end, &run)
+            || !bsv2_get_varint(&data, end, &len))
+         return false;
+      if (!run || run > frames - block->frames
+            || len > (size_t)(end - data) / 2)
+         return false;
+      if (!bsv2_block_reserve(block, block->word_count + (size_t)run * len))
+         return false;
+
+      words = block->words + block->word_count;
+      for (i = 0; i < len; i++, data += 2)
+         words[i] = (int16_t)(data[0] | (data[1] << 8));
+
+      for (i = 0; i < run; i++)
+      {
+         if (i)
+            memcpy(block->words + block->word_count, words,
+                  len * sizeof(int16_t));
+         block->word_count                       += len;
+         block->frame_start[++block->frames]      = (uint32_t)block->word_count;
+      }
+   }
+
+   return block->frames == frames;
+}
+
+#ifdef HAVE_ZLIB
+static bool bsv2_deflate_state(const uint8_t *in, uint32_t in_size,
+      uint8_t *out, uint32_t *out_size)
+{
+   uint32_t rd, wn;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+   const struct trans_stream_backend *backend =
+      trans_stream_get_zlib_deflate_backend();
+   void *stream                = backend->stream_new();
+   bool ret                    = false;
+
+   if (!stream)
+      return false;
+
+   /* Keyframes are taken while the game runs,
+    * favour speed over ratio. */
+   backend->define(stream, "level", 1);
+   backend->set_in(stream, in, in_size);
+   backend->set_out(stream, out, *out_size);
+
+   if (backend->trans(stream, true, &rd, &wn, &err)
+         && err == TRANS_STREAM_ERROR_NONE)
+   {
+      *out_size = wn;
+      ret       = true;
+   }
+
+   backend->stream_free(stream);
+   return ret;
+}
+
+static bool bsv2_inflate_state(const uint8_t *in, uint32_t in_size,
+      uint8_t *out, uint32_t out_size)
+{
+   uint32_t rd, wn;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+   const struct trans_stream_backend *backend =
+      trans_stream_get_zlib_inflate_backend();
+   void *stream                = backend->stream_new();
+   bool ret                    = false;
+
+   if (!stream)
+      return false;
+
+   backend->set_in(stream, in, in_size);
+   backend->set_out(stream, out, out_size);
+
+   if (backend->trans(stream, true, &rd, &wn, &err)
+         && err == TRANS_STREAM_ERROR_NONE)
+      ret = (wn == out_size);
+
+   backend->stream_free(stream);
+   return ret;
+}
+#endif
+
+static bool bsv2_write_words(intfstream_t *file,
+      const uint32_t *words, unsigned count)
+{
+   unsigned i;
+   uint32_t buf[BSV2_HEADER_WORDS];
+
+   for (i = 0; i < count; i++)
+      buf[i] = swap_if_big32(words[i]);
+
+   return intfstream_write(file, buf, count * sizeof(uint32_t))
+      == (int64_t)(count * sizeof(uint32_t));
+}
+
+static bool bsv2_read_words(intfstream_t *file,
+      uint32_t *words, unsigned count)
+{
+   unsigned i;
+
+   if (intfstream_read(file, words, count * sizeof(uint32_t))
+         != (int64_t)(count * sizeof(uint32_t)))
+      return false;
+
+   for (i = 0; i < count; i++)
+      words[i] = swap_if_big32(words[i]);
+
+   return true;
+}
+
+static bool bsv2_index_append(bsv_movie_t *handle,
+      uint32_t first_frame, uint32_t frames, uint64_t offset)
+{
+   struct bsv_index_entry *entry = NULL;
+
+   if (handle->index_count == handle->index_cap)
+   {
+      size_t cap = handle->index_cap ? handle->index_cap * 2 : 64;
+      struct bsv_index_entry *index = (struct bsv_index_entry*)
+         realloc(handle->index, cap * sizeof(*index));
+
+      if (!index)
+         return false;
+
+      handle->index     = index;
+      handle->index_cap = cap;
+   }
+
+   entry              = &handle->index[handle->index_count++];
+   entry->first_frame = first_frame;
+   entry->frames      = frames;
+   entry->offset      = offset;
+   return true;
+}
+
+/* Returns the index entry of the block holding @frame.
+ * The frame after the last one belongs to the last block. */
+static size_t bsv2_index_find(const bsv_movie_t *handle, uint32_t frame)
+{
+   size_t lo = 0;
+   size_t hi = handle->index_count;
+
+   while (hi - lo > 1)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      if (handle->index[mid].first_frame <= frame)
+         lo = mid;
+      else
+         hi = mid;
+   }
+
+   return lo;
+}
+
+/**
+ * bsv2_load_block:
+ * @handle               : Movie handle.
+ * @i                    : Index entry of the block.
+ * @load_state           : Also read the keyframe into handle->state.
+ *
+ * Reads a block from the movie file into handle->block.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool bsv2_load_block(bsv_movie_t *handle, size_t i, bool load_state)
+{
+   uint32_t hdr[BSV2_BLOCK_WORDS];
+   uint8_t *buf                        = NULL;
+   const struct bsv_index_entry *entry = &handle->index[i];
+   bool ret                            = false;
+
+   intfstream_seek(handle->file, (int64_t)entry->offset, SEEK_SET);
+
+   if (!bsv2_read_words(handle->file, hdr, BSV2_BLOCK_WORDS))
+      return false;
+   if (     hdr[BSV2_BLK_FIRST_FRAME] != entry->first_frame
+         || hdr[BSV2_BLK_FRAMES]      != entry->frames
+         || hdr[BSV2_BLK_FRAMES]       > handle->keyframe_interval
+         || hdr[BSV2_BLK_STATE_SIZE] != handle->state_size)
+      return false;
+
+   if (load_state && handle->state_size)
+   {
+      uint32_t stored = hdr[BSV2_BLK_STORED_SIZE];
+
+      if (hdr[BSV2_BLK_FLAGS] & BSV2_BLOCK_DEFLATED)
+      {
+#ifdef HAVE_ZLIB
+         if (!(buf = (uint8_t*)malloc(stored)))
+            return false;
+         if (intfstream_read(handle->file, buf, stored) != stored
+               || !bsv2_inflate_state(buf, stored,
+                  handle->state, (uint32_t)handle->state_size))
+            goto end;
+         free(buf);
+         buf = NULL;
+#else
+         RARCH_ERR("[BSV]: Movie keyframes are compressed, but zlib support is not built in.\n");
+         return false;
+#endif
+      }
+      else if (stored != handle->state_size
+            || intfstream_read(handle->file, handle->state, stored) != stored)
+         return false;
+   }
+   else
+      intfstream_seek(handle->file, hdr[BSV2_BLK_STORED_SIZE], SEEK_CUR);
+
+   if (!(buf = (uint8_t*)malloc(hdr[BSV2_BLK_INPUT_SIZE] + 1)))
+      return false;
+   if (intfstream_read(handle->file, buf, hdr[BSV2_BLK_INPUT_SIZE])
+         != hdr[BSV2_BLK_INPUT_SIZE])
+      goto end;
+   if (!bsv2_decode_input(&handle->block, buf,
+            hdr[BSV2_BLK_INPUT_SIZE], hdr[BSV2_BLK_FRAMES]))
+      goto end;
+
+   handle->block.first_frame = entry->first_frame;
+   ret                       = true;
+
+end:
+   free(buf);
+   if (!ret)
+      RARCH_ERR("[BSV]: Could not read movie block at frame %u.\n",
+            entry->first_frame);
+   return ret;
+}
+
+/* Writes out the block being recorded and adds it to the index. */
+static bool bsv2_flush_block(bsv_movie_t *handle)
+{
+   uint32_t hdr[BSV2_BLOCK_WORDS];
+   size_t input_size            = 0;
+   const uint8_t *state         = handle->state;
+   uint32_t stored              = (uint32_t)handle->state_size;
+   uint8_t *packed              = NULL;
+   uint8_t *input               = bsv2_encode_input(&handle->block,
+         &input_size);
+   bool ret                     = false;
+
+   if (!input)
+      return false;
+
+   hdr[BSV2_BLK_FIRST_FRAME]    = handle->block.first_frame;
+   hdr[BSV2_BLK_FRAMES]         = handle->block.frames;
+   hdr[BSV2_BLK_STATE_SIZE]     = (uint32_t)handle->state_size;
+   hdr[BSV2_BLK_FLAGS]          = 0;
+
+#ifdef HAVE_ZLIB
+   if (handle->state_size && (packed = (uint8_t*)malloc(handle->state_size)))
+   {
+      uint32_t packed_size      = (uint32_t)handle->state_size;
+
+      if (bsv2_deflate_state(handle->state, (uint32_t)handle->state_size,
+               packed, &packed_size) && packed_size < handle->state_size)
+      {
+         state                  = packed;
+         stored                 = packed_size;
+         hdr[BSV2_BLK_FLAGS]   |= BSV2_BLOCK_DEFLATED;
+      }
+   }
+#endif
+
+   hdr[BSV2_BLK_STORED_SIZE]    = stored;
+   hdr[BSV2_BLK_INPUT_SIZE]     = (uint32_t)input_size;
+
+   intfstream_seek(handle->file, (int64_t)handle->write_pos, SEEK_SET);
+
+   if (     bsv2_write_words(handle->file, hdr, BSV2_BLOCK_WORDS)
+         && intfstream_write(handle->file, state, stored) == stored
+         && intfstream_write(handle->file, input, input_size)
+         == (int64_t)input_size
+         && bsv2_index_append(handle, handle->block.first_frame,
+            handle->block.frames, handle->write_pos))
+   {
+      handle->write_pos        += sizeof(hdr) + stored + input_size;
+      ret                       = true;
+   }
+   else
+      RARCH_ERR("[BSV]: Could not write movie block at frame %u.\n",
+            handle->block.first_frame);
+
+   free(packed);
+   free(input);
+   return ret;
+}
+
+/* Starts a new block at the current frame, taking its keyframe. */
+static void bsv2_start_block(bsv_movie_t *handle)
+{
+   handle->block.first_frame    = handle->frame;
+   handle->block.frames         = 0;
+   handle->block.word_count     = 0;
+   handle->block.frame_start[0] = 0;
+   handle->word_ptr             = 0;
+
+   if (handle->state_size)
+   {
+      retro_ctx_serialize_info_t serial_info;
+
+      serial_info.data = handle->state;
+      serial_info.size = handle->state_size;
+
+      core_serialize(&serial_info);
+   }
+}
+
+/* Drops recorded input from @frame onwards. @frame has to be
+ * within the block in memory. */
+static void bsv2_truncate_block(bsv_movie_t *handle, uint32_t frame)
+{
+   struct bsv_block *block = &handle->block;
+
+   block->frames           = frame - block->first_frame;
+   block->word_count       = block->frame_start[block->frames];
+   handle->frame           = frame;
+   handle->word_ptr        = block->word_count;
+}
+
+/* Makes the block holding @frame the current one, reading it
+ * from the file if needed. When recording, anything after
+ * @frame is discarded. */
+static bool bsv2_goto_frame(bsv_movie_t *handle, uint32_t frame,
+      bool load_state)
+{
+   struct bsv_block *block = &handle->block;
+   bool in_block           = frame >= block->first_frame
+      && frame <= block->first_frame + block->frames;
+
+   if (!handle->playback && frame >= block->first_frame)
+      in_block = true;
+
+   if (!in_block || (load_state && handle->playback))
+   {
+      size_t i = bsv2_index_find(handle, frame);
+
+      /* The keyframe is rewritten along with the block. */
+      if (!handle->playback)
+         load_state = true;
+
+      if (!handle->index_count || !bsv2_load_block(handle, i, load_state))
+         return false;
+
+      if (!handle->playback)
+      {
+         handle->write_pos   = handle->index[i].offset;
+         handle->index_count = i;
+      }
+   }
+
+   if (!handle->playback)
+      bsv2_truncate_block(handle, frame);
+   else
+   {
+      handle->frame    = frame;
+      handle->word_ptr = block->frame_start[frame - block->first_frame];
+   }
+
+   return true;
+}
+
+static bool bsv2_init_playback(bsv_movie_t *handle, const uint32_t *hdr)
+{
+   uint32_t i;
+   uint32_t frame              = 0;
+   uint64_t index_offset       = hdr[BSV2_HDR_INDEX_LO]
+      | ((uint64_t)hdr[BSV2_HDR_INDEX_HI] << 32);
+
+   handle->version             = 2;
+   handle->state_size          = hdr[BSV2_HDR_STATE_SIZE];
+   handle->keyframe_interval   = hdr[BSV2_HDR_INTERVAL];
+
+   if (!handle->keyframe_interval || handle->keyframe_interval > (1 << 20))
+      return false;
+
+   if (     !(handle->block.frame_start = (uint32_t*)calloc(
+               handle->keyframe_interval + 1, sizeof(uint32_t)))
+         || (handle->state_size
+            && !(handle->state = (uint8_t*)malloc(handle->state_size))))
+      return false;
+
+   if (index_offset)
+   {
+      uint32_t count[2];
+
+      intfstream_seek(handle->file, (int64_t)index_offset, SEEK_SET);
+
+      if (     !bsv2_read_words(handle->file, count, 2)
+            || count[0] != BSV2_INDEX_MAGIC)
+         index_offset = 0;
+      else
+      {
+         for (i = 0; i < count[1]; i++)
+         {
+            uint32_t entry[4];
+
+            if (!bsv2_read_words(handle->file, entry, 4)
+                  || entry[0] != frame
+                  || !bsv2_index_append(handle, entry[0], entry[1],
+                     entry[2] | ((uint64_t)entry[3] << 32)))
+               break;
+            frame += entry[1];
+         }
+
+         if (i != count[1])
+         {
+            handle->index_count = 0;
+            frame               = 0;
+            index_offset        = 0;
+         }
+      }
+   }
+
+   if (!index_offset)
+   {
+      /* No index, the recording was not closed properly.
+       * Walk the blocks to rebuild it. */
+      uint64_t pos = BSV2_HEADER_WORDS * sizeof(uint32_t);
+
+      RARCH_WARN("[BSV]: Movie has no index, rebuilding it.\n");
+
+      for (;;)
+      {
+         uint32_t blk[BSV2_BLOCK_WORDS];
+         uint64_t next;
+
+         intfstream_seek(handle->file, (int64_t)pos, SEEK_SET);
+         if (     !bsv2_read_words(handle->file, blk, BSV2_BLOCK_WORDS)
+               || blk[BSV2_BLK_FIRST_FRAME] != frame
+               || blk[BSV2_BLK_FRAMES] > handle->keyframe_interval)
+            break;
+
+         next = pos + sizeof(blk) + blk[BSV2_BLK_STORED_SIZE]
+            + blk[BSV2_BLK_INPUT_SIZE];
+         if ((int64_t)next > intfstream_get_size(handle->file))
+            break;
+
+         if (!bsv2_index_append(handle, frame, blk[BSV2_BLK_FRAMES], pos))
+            return false;
+
+         frame += blk[BSV2_BLK_FRAMES];
+         pos    = next;
+
+         /* Only the last block can be partial. */
+         if (blk[BSV2_BLK_FRAMES] < handle->keyframe_interval)
+            break;
+      }
+   }
+
+   handle->frame_count = frame;
+
+   if (!handle->index_count || !bsv2_load_block(handle, 0, true))
+   {
+      RARCH_ERR("%s\n", msg_hash_to_str(MSG_COULD_NOT_READ_STATE_FROM_MOVIE));
+      return false;
+   }
+
+   if (handle->state_size)
+   {
+      retro_ctx_size_info_t info;
+
+      core_serialize_size(&info);
+
+      if (info.size == handle->state_size)
+      {
+         retro_ctx_serialize_info_t serial_info;
+
+         serial_info.data_const = handle->state;
+         serial_info.size       = handle->state_size;
+         core_unserialize(&serial_info);
+      }
+      else
+         RARCH_WARN("%s\n",
+               msg_hash_to_str(MSG_MOVIE_FORMAT_DIFFERENT_SERIALIZER_VERSION));
+   }
+
+   handle->frame    = 0;
+   handle->word_ptr = 0;
+
+   RARCH_LOG("[BSV]: Movie has %u frames in %u blocks.\n",
+         handle->frame_count, (unsigned)handle->index_count);
+
+   return true;
+}
+
+/* Writes out the pending block and the index, then points
+ * the header at the index. */
+static void bsv2_finalize(bsv_movie_t *handle)
+{
+   size_t i;
+   uint32_t words[4];
+   uint64_t index_offset;
+
+   if (handle->block.frames || !handle->index_count)
+      if (!bsv2_flush_block(handle))
+         return;
+
+   index_offset = handle->write_pos;
+
+   intfstream_seek(handle->file, (int64_t)index_offset, SEEK_SET);
+
+   words[0] = BSV2_INDEX_MAGIC;
+   words[1] = (uint32_t)handle->index_count;
+   if (!bsv2_write_words(handle->file, words, 2))
+      return;
+
+   for (i = 0; i < handle->index_count; i++)
+   {
+      words[0] = handle->index[i].first_frame;
+      words[1] = handle->index[i].frames;
+      words[2] = (uint32_t)handle->index[i].offset;
+      words[3] = (uint32_t)(handle->index[i].offset >> 32);
+      if (!bsv2_write_words(handle->file, words, 4))
+         return;
+   }
+
+   words[0] = handle->block.first_frame + handle->block.frames;
+   words[1] = 0;
+   words[2] = (uint32_t)index_offset;
+   words[3] = (uint32_t)(index_offset >> 32);
+
+   intfstream_seek(handle->file,
+         BSV2_HDR_FRAMES * sizeof(uint32_t), SEEK_SET);
+   bsv2_write_words(handle->file, words, 4);
+}
+
 static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
 {
    uint32_t state_size       = 0;
@@ -90,6 +825,26 @@ static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
    handle->playback          = true;
 
    intfstream_read(handle->file, header, sizeof(uint32_t) * 4);
+
+   if (swap_if_little32(header[MAGIC_INDEX]) == BSV2_MAGIC)
+   {
+      uint32_t hdr[BSV2_HEADER_WORDS];
+
+      intfstream_seek(handle->file, 0, SEEK_SET);
+      if (!bsv2_read_words(handle->file, hdr, BSV2_HEADER_WORDS))
+         return false;
+
+      content_crc = content_get_crc();
+
+      if (content_crc != 0)
+         if (hdr[BSV2_HDR_CRC] != content_crc)
+            RARCH_WARN("%s.\n", msg_hash_to_str(MSG_CRC32_CHECKSUM_MISMATCH));
+
+      return bsv2_init_playback(handle, hdr);
+   }
+
+   handle->version           = 1;
+
    /* Compatibility with old implementation that
     * used incorrect documentation. */
    if (swap_if_little32(header[MAGIC_INDEX]) != BSV_MAGIC
@@ -153,11 +908,9 @@ static bool bsv_movie_init_playback(bsv_movie_t *handle, const char *path)
 static bool bsv_movie_init_record(bsv_movie_t *handle, const char *path)
 {
    retro_ctx_size_info_t info;
-   uint32_t state_size       = 0;
-   uint32_t content_crc      = 0;
-   uint32_t header[4]        = {0};
+   uint32_t hdr[BSV2_HEADER_WORDS] = {0};
    intfstream_t *file        = intfstream_open_file(path,
-         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
    if (!file)
@@ -166,48 +919,34 @@ static bool bsv_movie_init_record(bsv_movie_t *handle, const char *path)
       return false;
    }
 
-   handle->file             = file;
-
-   content_crc              = content_get_crc();
-
-   /* This value is supposed to show up as
-    * BSV1 in a HEX editor, big-endian. */
-   header[MAGIC_INDEX]      = swap_if_little32(BSV_MAGIC);
-   header[CRC_INDEX]        = swap_if_big32(content_crc);
+   handle->file              = file;
+   handle->version           = 2;
+   handle->keyframe_interval = BSV2_KEYFRAME_INTERVAL;
 
    core_serialize_size(&info);
 
-   state_size               = (unsigned)info.size;
+   handle->state_size        = info.size;
 
-   header[STATE_SIZE_INDEX] = swap_if_big32(state_size);
-#if 0
-   RARCH_ERR("----- debug %u -----\n", header[0]);
-   RARCH_ERR("----- debug %u -----\n", header[1]);
-   RARCH_ERR("----- debug %u -----\n", header[2]);
-   RARCH_ERR("----- debug %u -----\n", header[3]);
-#endif
+   /* Shows up as BSV2 in a HEX editor, like BSV1 does. */
+   hdr[BSV2_HDR_MAGIC]       = swap_if_big32(swap_if_little32(BSV2_MAGIC));
+   hdr[BSV2_HDR_CRC]         = content_get_crc();
+   hdr[BSV2_HDR_STATE_SIZE]  = (uint32_t)handle->state_size;
+   hdr[BSV2_HDR_INTERVAL]    = handle->keyframe_interval;
 
-   intfstream_write(handle->file, header, 4 * sizeof(uint32_t));
+   if (!bsv2_write_words(handle->file, hdr, BSV2_HEADER_WORDS))
+      return false;
 
-   handle->min_file_pos     = sizeof(header) + state_size;
-   handle->state_size       = state_size;
+   handle->write_pos         = sizeof(hdr);
 
-   if (state_size)
-   {
-      retro_ctx_serialize_info_t serial_info;
-
-      handle->state = (uint8_t*)malloc(state_size);
-      if (!handle->state)
-         return false;
-
-      serial_info.data = handle->state;
-      serial_info.size = state_size;
+   if (!(handle->block.frame_start = (uint32_t*)calloc(
+               handle->keyframe_interval + 1, sizeof(uint32_t))))
+      return false;
 
-      core_serialize(&serial_info);
+   if (handle->state_size
+         && !(handle->state = (uint8_t*)malloc(handle->state_size)))
+      return false;
 
-      intfstream_write(handle->file,
-            handle->state, state_size);
-   }
+   bsv2_start_block(handle);
 
    return true;
 }
@@ -217,11 +956,17 @@ static void bsv_movie_free(bsv_movie_t *handle)
    if (!handle)
       return;
 
+   if (handle->version == 2 && !handle->playback && handle->block.frame_start)
+      bsv2_finalize(handle);
+
    intfstream_close(handle->file);
    free(handle->file);
 
    free(handle->state);
    free(handle->frame_pos);
+   free(handle->index);
+   free(handle->block.frame_start);
+   free(handle->block.words);
    free(handle);
 }
 
@@ -242,6 +987,9 @@ static bsv_movie_t *bsv_movie_init_internal(const char *path,
    else if (!bsv_movie_init_record(handle, path))
       goto error;
 
+   if (handle->version == 2)
+      return handle;
+
    /* Just pick something really large
     * ~1 million frames rewind should do the trick. */
    if (!(frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
@@ -262,16 +1010,87 @@ error:
 /* Used for rewinding while playback/record. */
 void bsv_movie_set_frame_start(void)
 {
-   if (bsv_movie_state_handle)
+   if (bsv_movie_state_handle && bsv_movie_state_handle->version == 1)
       bsv_movie_state_handle->frame_pos[bsv_movie_state_handle->frame_ptr]
          = intfstream_tell(bsv_movie_state_handle->file);
 }
 
+/* Returns false if recording failed and has to stop. */
+static bool bsv2_frame_end(bsv_movie_t *handle)
+{
+   struct bsv_block *block = &handle->block;
+
+   if (!handle->playback && !handle->seeking)
+   {
+      /* Recording, close the frame. */
+      block->frame_start[++block->frames] = (uint32_t)block->word_count;
+      handle->frame++;
+      handle->word_ptr                    = block->word_count;
+
+      if (block->frames >= handle->keyframe_interval)
+      {
+         if (!bsv2_flush_block(handle))
+         {
+            /* Drop the block so finalizing only indexes
+             * what actually made it to the file. */
+            block->frames     = 0;
+            block->word_count = 0;
+            return false;
+         }
+         bsv2_start_block(handle);
+      }
+      return true;
+   }
+
+   handle->frame++;
+
+   if (handle->frame - block->first_frame < block->frames)
+   {
+      handle->word_ptr = block->frame_start[handle->frame - block->first_frame];
+      return true;
+   }
+
+   if (!handle->playback)
+   {
+      /* Replayed all recorded input, back to recording. */
+      handle->word_ptr = block->word_count;
+      return true;
+   }
+
+   if (handle->frame >= handle->frame_count)
+   {
+      handle->word_ptr = block->word_count;
+      bsv_movie_state.movie_end = true;
+      return true;
+   }
+
+   if (!bsv2_goto_frame(handle, handle->frame, false))
+      bsv_movie_state.movie_end = true;
+   return true;
+}
+
 void bsv_movie_set_frame_end(void)
 {
    if (!bsv_movie_state_handle)
       return;
 
+   if (bsv_movie_state_handle->version == 2)
+   {
+      if (!bsv2_frame_end(bsv_movie_state_handle))
+      {
+         runloop_msg_queue_push(
+               msg_hash_to_str(MSG_MOVIE_RECORD_STOPPED), 2, 180, true);
+         RARCH_ERR("%s\n", msg_hash_to_str(MSG_MOVIE_RECORD_STOPPED));
+
+         command_event(CMD_EVENT_BSV_MOVIE_DEINIT, NULL);
+         return;
+      }
+      bsv_movie_state_handle->first_rewind =
+         !bsv_movie_state_handle->did_rewind;
+      bsv_movie_state_handle->did_rewind   = false;
+      return;
+   }
+
    bsv_movie_state_handle->frame_ptr    =
       (bsv_movie_state_handle->frame_ptr + 1)
       & bsv_movie_state_handle->frame_mask;
@@ -281,10 +1100,33 @@ void bsv_movie_set_frame_end(void)
    bsv_movie_state_handle->did_rewind   = false;
 }
 
+static void bsv2_frame_rewind(bsv_movie_t *handle)
+{
+   /* See bsv_movie_frame_rewind(). */
+   uint32_t back   = handle->first_rewind ? 1 : 2;
+   uint32_t target = handle->frame > back ? handle->frame - back : 0;
+
+   if (!bsv2_goto_frame(handle, target, false))
+      return;
+
+   if (target == 0 && !handle->playback)
+   {
+      /* Rewound to the start, reset the starting point. */
+      handle->frame = 0;
+      bsv2_start_block(handle);
+   }
+}
+
 static void bsv_movie_frame_rewind(bsv_movie_t *handle)
 {
    handle->did_rewind = true;
 
+   if (handle->version == 2)
+   {
+      bsv2_frame_rewind(handle);
+      return;
+   }
+
    if (     (handle->frame_ptr <= 1)
          && (handle->frame_pos[0] == handle->min_file_pos))
    {
@@ -395,6 +1237,25 @@ bool bsv_movie_init(void)
 
 bool bsv_movie_get_input(int16_t *bsv_data)
 {
+   if (bsv_movie_state_handle->version == 2)
+   {
+      bsv_movie_t *handle     = bsv_movie_state_handle;
+      struct bsv_block *block = &handle->block;
+      uint32_t idx            = handle->frame - block->first_frame;
+
+      if (handle->playback && handle->frame >= handle->frame_count)
+         return false;
+
+      /* The core may poll more input than was recorded,
+       * the rest reads as zero. */
+      if (idx < block->frames && handle->word_ptr < block->frame_start[idx + 1])
+         *bsv_data = block->words[handle->word_ptr++];
+      else
+         *bsv_data = 0;
+
+      return true;
+   }
+
    if (intfstream_read(bsv_movie_state_handle->file, bsv_data, 1) != 1)
       return false;
 
@@ -405,12 +1266,74 @@ bool bsv_movie_get_input(int16_t *bsv_data)
 
 bool bsv_movie_is_playback_on(void)
 {
-   return bsv_movie_state_handle && bsv_movie_state.movie_playback;
+   return bsv_movie_state_handle && (bsv_movie_state.movie_playback
+         || bsv_movie_state_handle->seeking);
 }
 
 bool bsv_movie_is_playback_off(void)
 {
-   return bsv_movie_state_handle && !bsv_movie_state.movie_playback;
+   return bsv_movie_state_handle && !bsv_movie_state.movie_playback
+      && !bsv_movie_state_handle->seeking;
+}
+
+bool bsv_movie_seek(uint32_t frame)
+{
+   retro_ctx_serialize_info_t serial_info;
+   bool video_active   = false;
+   bsv_movie_t *handle = bsv_movie_state_handle;
+
+   if (!handle)
+      return false;
+
+   if (handle->version != 2)
+   {
+      RARCH_WARN("[BSV]: Seeking needs a BSV2 movie.\n");
+      return false;
+   }
+
+   if (frame > (handle->playback ? handle->frame_count : handle->frame))
+   {
+      RARCH_WARN("[BSV]: Cannot seek past the end of the movie.\n");
+      return false;
+   }
+
+   if (!bsv2_goto_frame(handle, frame, true))
+      return false;
+
+   /* Restore the keyframe and replay from it silently. */
+   if (handle->state_size)
+   {
+      serial_info.data_const = handle->state;
+      serial_info.size       = handle->state_size;
+      core_unserialize(&serial_info);
+   }
+
+   handle->frame      = handle->block.first_frame;
+   handle->word_ptr   = 0;
+   handle->seeking    = true;
+   video_active       = video_driver_is_active();
+
+   video_driver_unset_active();
+   audio_driver_suspend();
+
+   while (handle->frame < frame)
+   {
+      core_run();
+      bsv2_frame_end(handle);
+   }
+
+   audio_driver_resume();
+   if (video_active)
+      video_driver_set_active();
+
+   handle->seeking            = false;
+   handle->first_rewind       = true;
+   handle->did_rewind         = false;
+   bsv_movie_state.movie_end  = false;
+
+   RARCH_LOG("[BSV]: Seeked to frame %u.\n", frame);
+
+   return true;
 }
 
 bool bsv_movie_is_end_of_file(void)
@@ -455,6 +1378,15 @@ bool bsv_movie_ctl(enum bsv_ctl_state state, void *data)
          {
             int16_t *bsv_data = (int16_t*)data;
 
+            if (bsv_movie_state_handle->version == 2)
+            {
+               struct bsv_block *block = &bsv_movie_state_handle->block;
+
+               if (bsv2_block_reserve(block, block->word_count + 1))
+                  block->words[block->word_count++] = *bsv_data;
+               break;
+            }
+
             *bsv_data = swap_if_big16(*bsv_data);
             intfstream_write(bsv_movie_state_handle->file, bsv_data, 1);
          }
@@ -26,6 +26,7 @@
 RETRO_BEGIN_DECLS
 
 #define BSV_MAGIC          0x42535631
+#define BSV2_MAGIC         0x42535632
 
 #define MAGIC_INDEX        0
 #define SERIALIZER_INDEX   1
@@ -76,6 +77,18 @@ bool bsv_movie_get_input(int16_t *bsv_data);
 
 bool bsv_movie_is_end_of_file(void);
 
+/**
+ * bsv_movie_seek:
+ * @frame                : Frame to seek to.
+ *
+ * Restores the closest keyframe before @frame and replays
+ * the movie up to it. When recording, input after @frame
+ * is discarded and recording continues from there.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool bsv_movie_seek(uint32_t frame);
+
 bool bsv_movie_ctl(enum bsv_ctl_state state, void *data);
 
 bool bsv_movie_check(void);
@@ -703,6 +703,8 @@ enum msg_hash_enums
    MENU_LABEL(VIDEO_GPU_SCREENSHOT),
    MENU_LABEL(VIDEO_BLACK_FRAME_INSERTION),
    MENU_LABEL(VIDEO_FRAME_DELAY),
+   MENU_LABEL(VIDEO_FRAME_DELAY_AUTO),
+   MENU_LABEL(VIDEO_FRAME_LIMIT_SPIN),
    MENU_LABEL(VIDEO_VSYNC),
    MENU_LABEL(VIDEO_HARD_SYNC),
    MENU_LABEL(VIDEO_HARD_SYNC_FRAMES),
@@ -857,6 +859,7 @@ enum msg_hash_enums
    MENU_LABEL(HISTORY_LIST_ENABLE),
    MENU_LABEL(CONTENT_HISTORY_SIZE),
    MENU_LABEL(PLAYLIST_ENTRY_REMOVE),
+   MENU_LABEL(PLAYLIST_USE_BINARY),
    MENU_LABEL(PLAYLIST_ENTRY_RENAME),
    MENU_LABEL(GOTO_FAVORITES),
    MENU_LABEL(GOTO_MUSIC),
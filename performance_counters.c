@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -24,6 +25,7 @@
 #endif
 
 #include <compat/strl.h>
+#include <streams/file_stream.h>
 
 #include "performance_counters.h"
 
@@ -41,6 +43,53 @@ static struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
 static unsigned perf_ptr_rarch;
 static unsigned perf_ptr_libretro;
 
+/* Per-frame statistics. retro_perf_counter is part of the libretro
+ * API, so they are kept on the side: once per frame the ticks each
+ * counter gained are added to a histogram and to a ring of recent
+ * frames.
+ *
+ * Histograms are log-linear, each power of two is split into
+ * PERF_HIST_SUB buckets, which keeps percentiles within 25%. */
+#define PERF_HIST_SUB_BITS    2
+#define PERF_HIST_SUB         (1 << PERF_HIST_SUB_BITS)
+#define PERF_HIST_BUCKETS     (64 * PERF_HIST_SUB)
+#define PERF_TRACE_FRAMES     1024
+/* Frontend counters first, then the core's. */
+#define PERF_SLOTS            (2 * MAX_COUNTERS)
+
+struct perf_histogram
+{
+   retro_perf_tick_t last_total;
+   retro_perf_tick_t last_calls;
+   retro_perf_tick_t max;
+   uint64_t frames;
+   uint32_t buckets[PERF_HIST_BUCKETS];
+};
+
+struct perf_trace_frame
+{
+   retro_time_t begin;
+   retro_time_t end;
+   /* Ticks gained by each slot during the frame. */
+   uint32_t ticks[PERF_SLOTS];
+};
+
+struct perf_stats
+{
+   struct perf_histogram slots[PERF_SLOTS];
+   /* Frame times, in microseconds. */
+   struct perf_histogram frame_time;
+   struct perf_trace_frame trace[PERF_TRACE_FRAMES];
+   uint64_t frame_count;
+   /* End of the previous frame, 0 if no frame was run
+    * since the last call to performance_counters_idle(). */
+   retro_time_t last_frame;
+   retro_time_t start_usec;
+   retro_perf_tick_t start_ticks;
+};
+
+static struct perf_stats *perf_stats;
+
 struct retro_perf_counter **retro_get_perf_counter_rarch(void)
 {
    return perf_counters_rarch;
@@ -83,13 +132,356 @@ void performance_counter_register(struct retro_perf_counter *perf)
    perf->registered = true;
 }
 
+/**
+ * performance_counters_idle:
+ *
+ * To be called on iterations that do not run the core
+ * (menu, paused), so that the time spent there is not
+ * counted as part of the next frame.
+ **/
+void performance_counters_idle(void)
+{
+   if (perf_stats)
+      perf_stats->last_frame = 0;
+}
+
+/**
+ * performance_counters_deinit:
+ *
+ * Frees the histograms and the frame trace.
+ **/
+void performance_counters_deinit(void)
+{
+   free(perf_stats);
+   perf_stats = NULL;
+}
+
 void performance_counters_clear(void)
 {
    perf_ptr_libretro = 0;
    memset(perf_counters_libretro, 0, sizeof(perf_counters_libretro));
+
+   if (perf_stats)
+   {
+      unsigned i;
+      for (i = MAX_COUNTERS; i < PERF_SLOTS; i++)
+         memset(&perf_stats->slots[i], 0, sizeof(perf_stats->slots[i]));
+   }
+}
+
+static unsigned perf_hist_bucket(retro_perf_tick_t val)
+{
+   unsigned msb = 0;
+
+   if (val < PERF_HIST_SUB)
+      return (unsigned)val;
+
+   while (val >> (msb + 1))
+      msb++;
+
+   return ((msb - PERF_HIST_SUB_BITS + 1) << PERF_HIST_SUB_BITS)
+      | (unsigned)((val >> (msb - PERF_HIST_SUB_BITS)) & (PERF_HIST_SUB - 1));
+}
+
+/* Largest value falling into @bucket. */
+static retro_perf_tick_t perf_hist_bucket_max(unsigned bucket)
+{
+   unsigned shift;
+   retro_perf_tick_t base;
+
+   if (bucket < PERF_HIST_SUB)
+      return bucket;
+
+   shift = (bucket >> PERF_HIST_SUB_BITS) - 1;
+   base  = (retro_perf_tick_t)(PERF_HIST_SUB + (bucket & (PERF_HIST_SUB - 1)))
+      << shift;
+
+   return base + (((retro_perf_tick_t)1 << shift) - 1);
+}
+
+static void perf_hist_add(struct perf_histogram *hist, retro_perf_tick_t val)
+{
+   hist->buckets[perf_hist_bucket(val)]++;
+   hist->frames++;
+   if (val > hist->max)
+      hist->max = val;
+}
+
+static retro_perf_tick_t perf_hist_percentile(
+      const struct perf_histogram *hist, unsigned percent)
+{
+   unsigned i;
+   uint64_t seen   = 0;
+   uint64_t target = (hist->frames * percent + 99) / 100;
+
+   if (!hist->frames)
+      return 0;
+
+   for (i = 0; i < PERF_HIST_BUCKETS; i++)
+   {
+      seen += hist->buckets[i];
+      if (seen >= target)
+      {
+         retro_perf_tick_t val = perf_hist_bucket_max(i);
+         return val < hist->max ? val : hist->max;
+      }
+   }
+
+   return hist->max;
+}
+
+static struct retro_perf_counter *perf_slot_counter(unsigned slot)
+{
+   if (slot < MAX_COUNTERS)
+      return slot < perf_ptr_rarch ? perf_counters_rarch[slot] : NULL;
+   slot -= MAX_COUNTERS;
+   return slot < perf_ptr_libretro ? perf_counters_libretro[slot] : NULL;
+}
+
+/**
+ * performance_counters_frame:
+ *
+ * Samples all counters, to be called once per frame.
+ * Ticks gained since the last call go to the counters'
+ * histograms and to the trace of recent frames.
+ **/
+void performance_counters_frame(void)
+{
+   unsigned i;
+   struct perf_trace_frame *frame = NULL;
+   retro_time_t now               = 0;
+
+   if (!rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL))
+      return;
+
+   now = cpu_features_get_time_usec();
+
+   if (!perf_stats)
+   {
+      if (!(perf_stats = (struct perf_stats*)calloc(1, sizeof(*perf_stats))))
+         return;
+      perf_stats->start_usec  = now;
+      perf_stats->start_ticks = cpu_features_get_perf_counter();
+   }
+
+   frame        = &perf_stats->trace[
+      perf_stats->frame_count++ % PERF_TRACE_FRAMES];
+   frame->begin = perf_stats->last_frame ? perf_stats->last_frame : now;
+   frame->end   = now;
+
+   if (perf_stats->last_frame)
+      perf_hist_add(&perf_stats->frame_time,
+            (retro_perf_tick_t)(now - perf_stats->last_frame));
+   perf_stats->last_frame = now;
+
+   for (i = 0; i < PERF_SLOTS; i++)
+   {
+      retro_perf_tick_t delta;
+      struct perf_histogram *hist     = &perf_stats->slots[i];
+      struct retro_perf_counter *perf = perf_slot_counter(i);
+
+      frame->ticks[i] = 0;
+
+      if (!perf)
+         continue;
+
+      /* Counters can be reset behind our back. */
+      if (perf->total < hist->last_total || perf->call_cnt < hist->last_calls)
+      {
+         hist->last_total = perf->total;
+         hist->last_calls = perf->call_cnt;
+         continue;
+      }
+
+      if (perf->call_cnt == hist->last_calls)
+         continue;
+
+      delta            = perf->total - hist->last_total;
+      hist->last_total = perf->total;
+      hist->last_calls = perf->call_cnt;
+
+      perf_hist_add(hist, delta);
+      frame->ticks[i]  = delta > 0xffffffff ? 0xffffffff : (uint32_t)delta;
+   }
+}
+
+static double perf_ticks_per_usec(void)
+{
+   retro_time_t usec = cpu_features_get_time_usec() - perf_stats->start_usec;
+
+   if (usec <= 0)
+      return 1.0;
+
+   return (double)(cpu_features_get_perf_counter()
+         - perf_stats->start_ticks) / usec;
+}
+
+static void perf_json_string(RFILE *file, const char *str)
+{
+   filestream_printf(file, "\"");
+   for (; *str; str++)
+   {
+      if (*str == '"' || *str == '\\')
+         filestream_printf(file, "\\%c", *str);
+      else if ((unsigned char)*str < 0x20)
+         filestream_printf(file, "\\u%04x", (unsigned char)*str);
+      else
+         filestream_printf(file, "%c", *str);
+   }
+   filestream_printf(file, "\"");
 }
 
-static void log_counters(struct retro_perf_counter **counters, unsigned num)
+static void perf_json_histogram(RFILE *file,
+      const struct perf_histogram *hist)
+{
+   unsigned i;
+   bool first = true;
+
+   filestream_printf(file,
+         "\"frames\": %llu, \"p50\": %llu, \"p90\": %llu, "
+         "\"p99\": %llu, \"max\": %llu, \"histogram\": [",
+         (unsigned long long)hist->frames,
+         (unsigned long long)perf_hist_percentile(hist, 50),
+         (unsigned long long)perf_hist_percentile(hist, 90),
+         (unsigned long long)perf_hist_percentile(hist, 99),
+         (unsigned long long)hist->max);
+
+   /* [ upper bound of bucket, frames ] */
+   for (i = 0; i < PERF_HIST_BUCKETS; i++)
+   {
+      if (!hist->buckets[i])
+         continue;
+      filestream_printf(file, "%s[%llu, %u]", first ? "" : ", ",
+            (unsigned long long)perf_hist_bucket_max(i), hist->buckets[i]);
+      first = false;
+   }
+
+   filestream_printf(file, "]");
+}
+
+/**
+ * performance_counters_export_json:
+ * @path               : File to write to.
+ *
+ * Writes all counters with their per-frame histograms and
+ * percentiles as JSON. Counter values are in the units the
+ * counter accumulates, usually ticks. Frame times are in
+ * microseconds.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool performance_counters_export_json(const char *path)
+{
+   unsigned i;
+   bool first = true;
+   RFILE *file = NULL;
+
+   if (!perf_stats)
+      return false;
+
+   if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   filestream_printf(file, "{\n  \"ticks_per_usec\": %.3f,\n",
+         perf_ticks_per_usec());
+   filestream_printf(file, "  \"frame_time_usec\": { ");
+   perf_json_histogram(file, &perf_stats->frame_time);
+   filestream_printf(file, " },\n  \"counters\": [");
+
+   for (i = 0; i < PERF_SLOTS; i++)
+   {
+      struct retro_perf_counter *perf = perf_slot_counter(i);
+
+      if (!perf)
+         continue;
+
+      filestream_printf(file, "%s\n    { \"name\": ", first ? "" : ",");
+      perf_json_string(file, perf->ident ? perf->ident : "");
+      filestream_printf(file,
+            ", \"source\": \"%s\", \"calls\": %llu, \"total\": %llu, ",
+            i < MAX_COUNTERS ? "frontend" : "core",
+            (unsigned long long)perf->call_cnt,
+            (unsigned long long)perf->total);
+      perf_json_histogram(file, &perf_stats->slots[i]);
+      filestream_printf(file, " }");
+      first = false;
+   }
+
+   filestream_printf(file, "\n  ]\n}\n");
+   filestream_close(file);
+   return true;
+}
+
+/**
+ * performance_counters_export_trace:
+ * @path               : File to write to.
+ *
+ * Writes the most recent frames in the Chrome trace event
+ * format, for chrome://tracing or Perfetto. Frames are
+ * duration events, counters are counter events holding what
+ * they gained during the frame.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+bool performance_counters_export_trace(const char *path)
+{
+   uint64_t f, first_frame;
+   RFILE *file          = NULL;
+
+   if (!perf_stats)
+      return false;
+
+   if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   first_frame    = perf_stats->frame_count > PERF_TRACE_FRAMES
+      ? perf_stats->frame_count - PERF_TRACE_FRAMES : 0;
+
+   filestream_printf(file, "{\"traceEvents\": [\n");
+   filestream_printf(file,
+         "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+         "\"args\": {\"name\": \"RetroArch\", "
+         "\"ticks_per_usec\": %.3f}}", perf_ticks_per_usec());
+
+   for (f = first_frame; f < perf_stats->frame_count; f++)
+   {
+      unsigned i;
+      const struct perf_trace_frame *frame =
+         &perf_stats->trace[f % PERF_TRACE_FRAMES];
+      retro_time_t ts = frame->begin - perf_stats->start_usec;
+
+      filestream_printf(file,
+            ",\n{\"name\": \"frame\", \"ph\": \"X\", \"pid\": 1, "
+            "\"tid\": 1, \"ts\": %lld, \"dur\": %lld, "
+            "\"args\": {\"frame\": %llu}}",
+            (long long)ts, (long long)(frame->end - frame->begin),
+            (unsigned long long)f);
+
+      for (i = 0; i < PERF_SLOTS; i++)
+      {
+         struct retro_perf_counter *perf = perf_slot_counter(i);
+
+         if (!perf || !perf_stats->slots[i].frames)
+            continue;
+
+         filestream_printf(file, ",\n{\"name\": ");
+         perf_json_string(file, perf->ident ? perf->ident : "");
+         filestream_printf(file,
+               ", \"ph\": \"C\", \"pid\": 1, \"ts\": %lld, "
+               "\"args\": {\"value\": %u}}",
+               (long long)ts, frame->ticks[i]);
+      }
+   }
+
+   filestream_printf(file, "\n]}\n");
+   filestream_close(file);
+   return true;
+}
+
+static void log_counters(struct retro_perf_counter **counters, unsigned num,
+      unsigned slot)
 {
    unsigned i;
    for (i = 0; i < num; i++)
@@ -101,6 +493,15 @@ static void log_counters(struct retro_perf_counter **counters, unsigned num)
                (uint64_t)counters[i]->total /
                (uint64_t)counters[i]->call_cnt,
                (uint64_t)counters[i]->call_cnt);
+
+         if (perf_stats && perf_stats->slots[slot + i].frames)
+         {
+            const struct perf_histogram *hist = &perf_stats->slots[slot + i];
+            RARCH_LOG("[PERF]:   per frame: p50 %llu, p99 %llu, max %llu ticks.\n",
+                  (unsigned long long)perf_hist_percentile(hist, 50),
+                  (unsigned long long)perf_hist_percentile(hist, 99),
+                  (unsigned long long)hist->max);
+         }
       }
    }
 }
@@ -111,13 +512,19 @@ void rarch_perf_log(void)
       return;
 
    RARCH_LOG("[PERF]: Performance counters (RetroArch):\n");
-   log_counters(perf_counters_rarch, perf_ptr_rarch);
+   log_counters(perf_counters_rarch, perf_ptr_rarch, 0);
+
+   if (perf_stats && perf_stats->frame_time.frames)
+      RARCH_LOG("[PERF]: Frame time: p50 %llu, p99 %llu, max %llu usec.\n",
+            (unsigned long long)perf_hist_percentile(&perf_stats->frame_time, 50),
+            (unsigned long long)perf_hist_percentile(&perf_stats->frame_time, 99),
+            (unsigned long long)perf_stats->frame_time.max);
 }
 
 void retro_perf_log(void)
 {
    RARCH_LOG("[PERF]: Performance counters (libretro):\n");
-   log_counters(perf_counters_libretro, perf_ptr_libretro);
+   log_counters(perf_counters_libretro, perf_ptr_libretro, MAX_COUNTERS);
 }
 
 void rarch_timer_tick(rarch_timer_t *timer)
@@ -57,6 +57,16 @@ void rarch_perf_log(void);
 
 void rarch_perf_register(struct retro_perf_counter *perf);
 
+void performance_counters_frame(void);
+
+void performance_counters_idle(void);
+
+void performance_counters_deinit(void);
+
+bool performance_counters_export_json(const char *path);
+
+bool performance_counters_export_trace(const char *path);
+
 #define performance_counter_init(perf, name) \
    perf.ident = name; \
    if (!perf.registered) \
@@ -17,22 +17,56 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 #include <libretro.h>
 #include <boolean.h>
+#include <memmap.h>
+#include <retro_endianness.h>
+#include <retro_miscellaneous.h>
 #include <compat/posix_string.h>
+#include <encodings/crc32.h>
 #include <string/stdstring.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
 #include <file/file_path.h>
 
 #include "playlist.h"
+#include "configuration.h"
 #include "verbosity.h"
 
 #ifndef PLAYLIST_ENTRIES
 #define PLAYLIST_ENTRIES 6
 #endif
 
+/* Binary playlists replace the text format in place when
+ * playlist_use_binary is enabled. They start with a
+ * playlist_bin_header, followed by an offset table holding
+ * PLAYLIST_ENTRIES string offsets per entry (0 means no string)
+ * and a pool of NUL-terminated strings. Changes are appended after the
+ * pool as journal batches and replayed on load. All integers are
+ * little-endian 32-bit. */
+#define PLAYLIST_BIN_MAGIC         "RAPLBIN"
+#define PLAYLIST_BIN_VERSION       1
+#define PLAYLIST_BIN_HEADER_SIZE   24
+#define PLAYLIST_JOURNAL_MAGIC     0x4e524a50 /* "PJRN" */
+#define PLAYLIST_JOURNAL_HEAD_SIZE 12
+
+/* Text playlists with at least this many entries are converted
+ * to the binary format when they are loaded, if enabled. */
+#ifndef PLAYLIST_BIN_MIN_ENTRIES
+#define PLAYLIST_BIN_MIN_ENTRIES 1000
+#endif
+
+enum playlist_journal_op
+{
+   PLAYLIST_OP_INSERT = 1,
+   PLAYLIST_OP_SET,
+   PLAYLIST_OP_DELETE,
+   PLAYLIST_OP_MOVE,
+   PLAYLIST_OP_CLEAR
+};
+
 struct playlist_entry
 {
    char *path;
@@ -41,6 +75,32 @@ struct playlist_entry
    char *core_name;
    char *db_name;
    char *crc32;
+#ifdef HAVE_MMAN
+   /* Offsets into the mapped binary playlist, set until the
+    * entry is first accessed and decoded. */
+   const uint32_t *record;
+#endif
+};
+
+#ifdef HAVE_MMAN
+/* Changes not yet appended to a binary playlist. String offsets
+ * in ops are 1-based offsets into strings until written. */
+struct playlist_journal
+{
+   char *strings;
+   uint32_t *ops;
+   size_t strings_size;
+   size_t strings_cap;
+   size_t ops_count;
+   size_t ops_cap;
+};
+#endif
+
+struct playlist_index_slot
+{
+   uint32_t hash;
+   /* Slot of the entry plus one, 0 if unused */
+   size_t slot;
 };
 
 struct content_playlist
@@ -51,6 +111,33 @@ struct content_playlist
 
    char *conf_path;
    struct playlist_entry *entries;
+
+   /* entries points into slots, leaving room to push
+    * new entries to the front without moving the rest. */
+   struct playlist_entry *slots;
+   size_t alloc;
+
+   /* Open addressing index of entries by case-folded path.
+    * Rebuilt on the next lookup once index_valid is cleared. */
+   bool index_valid;
+   struct playlist_index_slot *index;
+   size_t index_cap;
+   size_t index_count;
+
+#ifdef HAVE_MMAN
+   bool binary;
+   /* The journal can no longer describe the changes,
+    * rewrite the whole file on the next write. */
+   bool rewrite;
+   const uint8_t *map;
+   size_t map_size;
+   /* map was read into memory rather than mapped */
+   bool map_alloc;
+   uint32_t *records;
+   size_t base_size;
+   size_t journal_size;
+   struct playlist_journal journal;
+#endif
 };
 static playlist_t *playlist_cached = NULL;
 
@@ -58,6 +145,958 @@ typedef int (playlist_sort_fun_t)(
       const struct playlist_entry *a,
       const struct playlist_entry *b);
 
+static void playlist_entry_fields(struct playlist_entry *entry,
+      char **fields[PLAYLIST_ENTRIES])
+{
+   fields[0] = &entry->path;
+   fields[1] = &entry->label;
+   fields[2] = &entry->core_path;
+   fields[3] = &entry->core_name;
+   fields[4] = &entry->crc32;
+   fields[5] = &entry->db_name;
+}
+
+#ifdef HAVE_MMAN
+static uint32_t playlist_bin_read_u32(const uint8_t *ptr)
+{
+   uint32_t value;
+   memcpy(&value, ptr, sizeof(value));
+   return swap_if_big32(value);
+}
+
+static void playlist_bin_write_u32(uint8_t *ptr, uint32_t value)
+{
+   value = swap_if_big32(value);
+   memcpy(ptr, &value, sizeof(value));
+}
+
+/* Points the entry strings into the mapping. Offsets outside of
+ * the file or strings without a terminator are dropped. */
+static void playlist_bin_decode(playlist_t *playlist,
+      struct playlist_entry *entry)
+{
+   unsigned i;
+   char **fields[PLAYLIST_ENTRIES];
+   const uint32_t *record = entry->record;
+
+   entry->record = NULL;
+   playlist_entry_fields(entry, fields);
+
+   for (i = 0; i < PLAYLIST_ENTRIES; i++)
+   {
+      uint32_t offset = record[i];
+
+      *fields[i]      = NULL;
+
+      if (  offset >= PLAYLIST_BIN_HEADER_SIZE
+         && offset <  playlist->map_size
+         && memchr(playlist->map + offset, '\0',
+            playlist->map_size - offset))
+         *fields[i] = (char*)(playlist->map + offset);
+   }
+}
+#endif
+
+static struct playlist_entry *playlist_entry_at(
+      playlist_t *playlist, size_t idx)
+{
+   struct playlist_entry *entry = &playlist->entries[idx];
+#ifdef HAVE_MMAN
+   if (entry->record)
+      playlist_bin_decode(playlist, entry);
+#endif
+   return entry;
+}
+
+static void playlist_free_string(playlist_t *playlist, char *str)
+{
+   if (!str)
+      return;
+#ifdef HAVE_MMAN
+   /* Decoded strings live in the mapping */
+   if (     playlist->map
+         && (const uint8_t*)str >= playlist->map
+         && (const uint8_t*)str <  playlist->map + playlist->map_size)
+      return;
+#endif
+   free(str);
+}
+
+/* FNV-1a over the case-folded path, so case sensitive and
+ * insensitive lookups can share the same index. */
+static uint32_t playlist_path_hash(const char *path)
+{
+   uint32_t hash = 2166136261u;
+
+   if (path)
+      for (; *path; path++)
+      {
+         hash ^= (uint32_t)tolower((unsigned char)*path);
+         hash *= 16777619u;
+      }
+
+   return hash;
+}
+
+static size_t playlist_slot(playlist_t *playlist, size_t idx)
+{
+   return (size_t)(playlist->entries - playlist->slots) + idx;
+}
+
+static void playlist_index_insert(playlist_t *playlist,
+      size_t idx, uint32_t hash)
+{
+   size_t mask = playlist->index_cap - 1;
+   size_t i    = hash & mask;
+
+   while (playlist->index[i].slot)
+      i = (i + 1) & mask;
+
+   playlist->index[i].hash = hash;
+   playlist->index[i].slot = playlist_slot(playlist, idx) + 1;
+   playlist->index_count++;
+}
+
+static bool playlist_index_build(playlist_t *playlist)
+{
+   size_t i;
+   size_t cap = 64;
+
+   while (cap < playlist->size * 2 + 2)
+      cap *= 2;
+
+   if (cap != playlist->index_cap)
+   {
+      free(playlist->index);
+      playlist->index_cap = 0;
+      playlist->index     = (struct playlist_index_slot*)
+         malloc(cap * sizeof(*playlist->index));
+      if (!playlist->index)
+         return false;
+      playlist->index_cap = cap;
+   }
+
+   memset(playlist->index, 0, cap * sizeof(*playlist->index));
+   playlist->index_count = 0;
+
+   for (i = 0; i < playlist->size; i++)
+      playlist_index_insert(playlist, i,
+            playlist_path_hash(playlist_entry_at(playlist, i)->path));
+
+   playlist->index_valid = true;
+   return true;
+}
+
+/* Looks up the index slot of the entry at idx */
+static struct playlist_index_slot *playlist_index_lookup(
+      playlist_t *playlist, size_t idx, size_t slot)
+{
+   size_t mask   = playlist->index_cap - 1;
+   uint32_t hash = playlist_path_hash(playlist_entry_at(playlist, idx)->path);
+   size_t i      = hash & mask;
+
+   for (; playlist->index[i].slot; i = (i + 1) & mask)
+      if (playlist->index[i].slot == slot + 1)
+         return &playlist->index[i];
+
+   return NULL;
+}
+
+static void playlist_index_add(playlist_t *playlist, size_t idx)
+{
+   if (!playlist->index_valid)
+      return;
+
+   if ((playlist->index_count + 1) * 2 > playlist->index_cap)
+   {
+      playlist->index_valid = false;
+      return;
+   }
+
+   playlist_index_insert(playlist, idx,
+         playlist_path_hash(playlist_entry_at(playlist, idx)->path));
+}
+
+static void playlist_index_remove(playlist_t *playlist, size_t idx)
+{
+   size_t i, j, mask;
+   struct playlist_index_slot *slot = NULL;
+
+   if (!playlist->index_valid)
+      return;
+
+   slot = playlist_index_lookup(playlist, idx, playlist_slot(playlist, idx));
+   if (!slot)
+   {
+      playlist->index_valid = false;
+      return;
+   }
+
+   /* Shift the following entries of the probe sequence back */
+   mask = playlist->index_cap - 1;
+   i    = (size_t)(slot - playlist->index);
+
+   for (j = (i + 1) & mask; playlist->index[j].slot; j = (j + 1) & mask)
+   {
+      size_t k = playlist->index[j].hash & mask;
+
+      if (i <= j ? (k <= i || k > j) : (k <= i && k > j))
+      {
+         playlist->index[i] = playlist->index[j];
+         i                  = j;
+      }
+   }
+
+   playlist->index[i].slot = 0;
+   playlist->index_count--;
+}
+
+/**
+ * playlist_index_shift:
+ * @playlist            : Playlist handle.
+ * @idx                 : Index of the first moved entry.
+ * @count               : Number of moved entries.
+ * @delta               : Distance the entries were moved by.
+ *
+ * Updates the index after entries were moved within slots.
+ **/
+static void playlist_index_shift(playlist_t *playlist,
+      size_t idx, size_t count, ptrdiff_t delta)
+{
+   size_t n;
+
+   if (!playlist->index_valid)
+      return;
+
+   /* Update in the direction of the move so that no
+    * two entries are ever recorded at the same slot. */
+   for (n = 0; n < count; n++)
+   {
+      size_t i    = delta > 0 ? idx + count - 1 - n : idx + n;
+      size_t slot = playlist_slot(playlist, i);
+      struct playlist_index_slot *entry = playlist_index_lookup(
+            playlist, i, slot - delta);
+
+      if (!entry)
+      {
+         playlist->index_valid = false;
+         return;
+      }
+
+      entry->slot = slot + 1;
+   }
+}
+
+/* Without core_path, matches the path exactly. With core_path,
+ * matches the way playlist_push detects duplicates. */
+static bool playlist_entry_matches(const struct playlist_entry *entry,
+      const char *path, const char *core_path)
+{
+   if (!core_path)
+      return string_is_equal(entry->path, path);
+
+   if (!path || !entry->path)
+   {
+      if (path || entry->path)
+         return false;
+   }
+#ifdef _WIN32
+   /*prevent duplicates on case-insensitive operating systems*/
+   else if (!string_is_equal_noncase(path, entry->path))
+#else
+   else if (!string_is_equal(path, entry->path))
+#endif
+      return false;
+
+   /* Core name can have changed while still being the same core.
+    * Differentiate based on the core path only. */
+   return string_is_equal(entry->core_path, core_path);
+}
+
+/**
+ * playlist_find:
+ * @playlist            : Playlist handle.
+ * @path                : Path of playlist entry.
+ * @core_path           : Core path of playlist entry, or NULL
+ *                        to match on the path alone.
+ * @idx                 : Index of the first matching entry.
+ *
+ * Returns: true if an entry was found, otherwise false.
+ **/
+static bool playlist_find(playlist_t *playlist,
+      const char *path, const char *core_path, size_t *idx)
+{
+   size_t i;
+   size_t found = playlist->size;
+
+   if (playlist->index_valid || playlist_index_build(playlist))
+   {
+      size_t mask   = playlist->index_cap - 1;
+      size_t base   = playlist_slot(playlist, 0);
+      uint32_t hash = playlist_path_hash(path);
+
+      for (i = hash & mask; playlist->index[i].slot; i = (i + 1) & mask)
+      {
+         size_t pos;
+
+         if (playlist->index[i].hash != hash)
+            continue;
+
+         pos = playlist->index[i].slot - 1 - base;
+         if (pos < found && playlist_entry_matches(
+                  playlist_entry_at(playlist, pos), path, core_path))
+            found = pos;
+      }
+   }
+   else
+   {
+      for (i = 0; i < playlist->size; i++)
+         if (playlist_entry_matches(
+                  playlist_entry_at(playlist, i), path, core_path))
+         {
+            found = i;
+            break;
+         }
+   }
+
+   if (found >= playlist->size)
+      return false;
+
+   *idx = found;
+   return true;
+}
+
+/* Makes room for one entry in front of entries. */
+static bool playlist_reserve_front(playlist_t *playlist)
+{
+   size_t gap;
+
+   if (playlist->entries > playlist->slots)
+      return true;
+
+   /* Leave room for as many pushes as there are entries,
+    * so moving them is amortized over those pushes. */
+   gap = playlist->size > 16 ? playlist->size : 16;
+
+   if (playlist->size + gap > playlist->alloc)
+   {
+      struct playlist_entry *slots = (struct playlist_entry*)
+         calloc(playlist->size + gap, sizeof(*slots));
+
+      if (!slots)
+         return false;
+
+      memcpy(slots + gap, playlist->entries,
+            playlist->size * sizeof(*slots));
+      free(playlist->slots);
+
+      playlist->slots = slots;
+      playlist->alloc = playlist->size + gap;
+   }
+   else
+   {
+      gap = playlist->alloc - playlist->size;
+      memmove(playlist->slots + gap, playlist->entries,
+            playlist->size * sizeof(*playlist->slots));
+   }
+
+   playlist->entries     = playlist->slots + gap;
+   playlist->index_valid = false;
+   return true;
+}
+
+#ifdef HAVE_MMAN
+static bool playlist_journal_push(struct playlist_journal *journal,
+      uint32_t value)
+{
+   if (journal->ops_count == journal->ops_cap)
+   {
+      size_t cap    = journal->ops_cap ? journal->ops_cap * 2 : 64;
+      uint32_t *ops = (uint32_t*)realloc(journal->ops,
+            cap * sizeof(*ops));
+
+      if (!ops)
+         return false;
+
+      journal->ops     = ops;
+      journal->ops_cap = cap;
+   }
+
+   journal->ops[journal->ops_count++] = value;
+   return true;
+}
+
+static bool playlist_journal_push_string(struct playlist_journal *journal,
+      const char *str)
+{
+   size_t len;
+
+   if (!str)
+      return playlist_journal_push(journal, 0);
+
+   len = strlen(str) + 1;
+
+   if (journal->strings_size + len > journal->strings_cap)
+   {
+      size_t cap    = journal->strings_cap ? journal->strings_cap : 1024;
+      char *strings = NULL;
+
+      while (cap < journal->strings_size + len)
+         cap *= 2;
+
+      strings = (char*)realloc(journal->strings, cap);
+      if (!strings)
+         return false;
+
+      journal->strings     = strings;
+      journal->strings_cap = cap;
+   }
+
+   memcpy(journal->strings + journal->strings_size, str, len);
+
+   if (!playlist_journal_push(journal,
+            (uint32_t)journal->strings_size + 1))
+      return false;
+
+   journal->strings_size += len;
+   return true;
+}
+
+static void playlist_journal_reset(struct playlist_journal *journal)
+{
+   journal->strings_size = 0;
+   journal->ops_count    = 0;
+}
+
+/**
+ * playlist_journal_record:
+ * @playlist            : Playlist handle.
+ * @op                  : Operation, one of enum playlist_journal_op.
+ * @idx                 : Index the operation applies to.
+ * @arg                 : Destination index for PLAYLIST_OP_MOVE.
+ * @entry               : New entry contents for PLAYLIST_OP_INSERT
+ *                        and PLAYLIST_OP_SET.
+ *
+ * Queues a change to a binary playlist for the next
+ * playlist_write_file. Falls back to rewriting the file
+ * once the journal outgrows the playlist itself.
+ **/
+static void playlist_journal_record(playlist_t *playlist,
+      unsigned op, size_t idx, size_t arg,
+      struct playlist_entry *entry)
+{
+   bool ret                         = true;
+   struct playlist_journal *journal = &playlist->journal;
+
+   if (!playlist->binary || playlist->rewrite)
+      return;
+
+   ret = playlist_journal_push(journal, op);
+
+   switch (op)
+   {
+      case PLAYLIST_OP_INSERT:
+      case PLAYLIST_OP_SET:
+         {
+            unsigned i;
+            char **fields[PLAYLIST_ENTRIES];
+
+            playlist_entry_fields(entry, fields);
+
+            ret = ret && playlist_journal_push(journal, (uint32_t)idx);
+            for (i = 0; i < PLAYLIST_ENTRIES; i++)
+               ret = ret && playlist_journal_push_string(journal, *fields[i]);
+         }
+         break;
+      case PLAYLIST_OP_DELETE:
+         ret = ret && playlist_journal_push(journal, (uint32_t)idx);
+         break;
+      case PLAYLIST_OP_MOVE:
+         ret = ret && playlist_journal_push(journal, (uint32_t)idx);
+         ret = ret && playlist_journal_push(journal, (uint32_t)arg);
+         break;
+   }
+
+   if (!ret || playlist->journal_size + journal->strings_size
+         + journal->ops_count * sizeof(uint32_t) > playlist->base_size)
+   {
+      playlist->rewrite = true;
+      playlist_journal_reset(journal);
+   }
+}
+
+/**
+ * playlist_journal_replay:
+ * @payload             : Journal batch payload.
+ * @size                : Size of @payload in bytes.
+ * @records             : Offset table, grown as needed.
+ * @count               : Number of entries in @records.
+ * @cap                 : Allocated entries in @records.
+ *
+ * Applies one journal batch to the offset table.
+ *
+ * Returns: true if the whole batch was valid and applied.
+ **/
+static bool playlist_journal_replay(const uint8_t *payload, size_t size,
+      uint32_t **records, size_t *count, size_t *cap)
+{
+   const uint8_t *ptr = payload + sizeof(uint32_t);
+   const uint8_t *end = payload + size;
+   size_t record_size = PLAYLIST_ENTRIES * sizeof(uint32_t);
+
+   if (size < sizeof(uint32_t) ||
+         playlist_bin_read_u32(payload) > size - sizeof(uint32_t))
+      return false;
+
+   ptr += playlist_bin_read_u32(payload);
+
+   while (ptr < end)
+   {
+      unsigned i;
+      uint32_t idx, to;
+      uint32_t tmp[PLAYLIST_ENTRIES];
+      uint32_t *table = NULL;
+      uint32_t op     = 0;
+
+      if (end - ptr < (ptrdiff_t)sizeof(uint32_t))
+         return false;
+      op   = playlist_bin_read_u32(ptr);
+      ptr += sizeof(uint32_t);
+
+      if (op == PLAYLIST_OP_CLEAR)
+      {
+         *count = 0;
+         continue;
+      }
+
+      if (end - ptr < (ptrdiff_t)sizeof(uint32_t))
+         return false;
+      idx  = playlist_bin_read_u32(ptr);
+      ptr += sizeof(uint32_t);
+
+      switch (op)
+      {
+         case PLAYLIST_OP_INSERT:
+         case PLAYLIST_OP_SET:
+            if (end - ptr < (ptrdiff_t)record_size)
+               return false;
+            if (op == PLAYLIST_OP_SET ? idx >= *count : idx > *count)
+               return false;
+
+            if (op == PLAYLIST_OP_INSERT)
+            {
+               if (*count == *cap)
+               {
+                  size_t new_cap = *cap ? *cap * 2 : 64;
+
+                  table = (uint32_t*)realloc(*records,
+                        new_cap * record_size);
+                  if (!table)
+                     return false;
+
+                  *records = table;
+                  *cap     = new_cap;
+               }
+
+               memmove(*records + (idx + 1) * PLAYLIST_ENTRIES,
+                     *records + idx * PLAYLIST_ENTRIES,
+                     (*count - idx) * record_size);
+               (*count)++;
+            }
+
+            table = *records + idx * PLAYLIST_ENTRIES;
+            for (i = 0; i < PLAYLIST_ENTRIES; i++, ptr += sizeof(uint32_t))
+               table[i] = playlist_bin_read_u32(ptr);
+            break;
+         case PLAYLIST_OP_DELETE:
+            if (idx >= *count)
+               return false;
+
+            memmove(*records + idx * PLAYLIST_ENTRIES,
+                  *records + (idx + 1) * PLAYLIST_ENTRIES,
+                  (*count - idx - 1) * record_size);
+            (*count)--;
+            break;
+         case PLAYLIST_OP_MOVE:
+            if (end - ptr < (ptrdiff_t)sizeof(uint32_t))
+               return false;
+            to   = playlist_bin_read_u32(ptr);
+            ptr += sizeof(uint32_t);
+
+            if (idx >= *count || to >= *count)
+               return false;
+
+            memcpy(tmp, *records + idx * PLAYLIST_ENTRIES, record_size);
+            if (idx > to)
+               memmove(*records + (to + 1) * PLAYLIST_ENTRIES,
+                     *records + to * PLAYLIST_ENTRIES,
+                     (idx - to) * record_size);
+            else
+               memmove(*records + idx * PLAYLIST_ENTRIES,
+                     *records + (idx + 1) * PLAYLIST_ENTRIES,
+                     (to - idx) * record_size);
+            memcpy(*records + to * PLAYLIST_ENTRIES, tmp, record_size);
+            break;
+         default:
+            return false;
+      }
+   }
+
+   return true;
+}
+
+/**
+ * playlist_bin_append:
+ * @playlist            : Playlist handle.
+ *
+ * Appends the pending changes to a binary playlist
+ * as a single journal batch.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool playlist_bin_append(playlist_t *playlist)
+{
+   size_t i, payload_size, total;
+   struct playlist_journal *journal = &playlist->journal;
+   size_t batch_offset              = playlist->base_size
+      + playlist->journal_size;
+   size_t strings_offset            = batch_offset
+      + PLAYLIST_JOURNAL_HEAD_SIZE + sizeof(uint32_t);
+   uint8_t *buf                     = NULL;
+   uint8_t *ops                     = NULL;
+   RFILE *file                      = NULL;
+   bool ret                         = false;
+
+   if (!journal->ops_count)
+      return true;
+
+   payload_size = sizeof(uint32_t) + journal->strings_size
+      + journal->ops_count * sizeof(uint32_t);
+   total        = PLAYLIST_JOURNAL_HEAD_SIZE + payload_size;
+
+   if ((uint64_t)batch_offset + total > UINT32_MAX)
+      return false;
+
+   buf = (uint8_t*)malloc(total);
+   if (!buf)
+      return false;
+
+   playlist_bin_write_u32(buf + 12, (uint32_t)journal->strings_size);
+   if (journal->strings_size)
+      memcpy(buf + 16, journal->strings, journal->strings_size);
+
+   /* Rebase string offsets onto the file */
+   ops = buf + 16 + journal->strings_size;
+   for (i = 0; i < journal->ops_count; )
+   {
+      unsigned j;
+      uint32_t op = journal->ops[i];
+
+      playlist_bin_write_u32(ops + i++ * sizeof(uint32_t), op);
+
+      switch (op)
+      {
+         case PLAYLIST_OP_INSERT:
+         case PLAYLIST_OP_SET:
+            playlist_bin_write_u32(ops + i * sizeof(uint32_t),
+                  journal->ops[i]);
+            i++;
+            for (j = 0; j < PLAYLIST_ENTRIES; j++, i++)
+            {
+               uint32_t offset = journal->ops[i];
+               if (offset)
+                  offset += (uint32_t)strings_offset - 1;
+               playlist_bin_write_u32(ops + i * sizeof(uint32_t), offset);
+            }
+            break;
+         case PLAYLIST_OP_DELETE:
+            playlist_bin_write_u32(ops + i * sizeof(uint32_t),
+                  journal->ops[i]);
+            i++;
+            break;
+         case PLAYLIST_OP_MOVE:
+            for (j = 0; j < 2; j++, i++)
+               playlist_bin_write_u32(ops + i * sizeof(uint32_t),
+                     journal->ops[i]);
+            break;
+      }
+   }
+
+   playlist_bin_write_u32(buf,     PLAYLIST_JOURNAL_MAGIC);
+   playlist_bin_write_u32(buf + 4, (uint32_t)payload_size);
+   playlist_bin_write_u32(buf + 8,
+         encoding_crc32(0, buf + 12, payload_size));
+
+   file = filestream_open(playlist->conf_path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (file)
+   {
+      if (     filestream_seek(file, (int64_t)batch_offset,
+               RETRO_VFS_SEEK_POSITION_START) == 0
+            && filestream_write(file, buf, total) == (int64_t)total)
+         ret = true;
+      filestream_close(file);
+   }
+
+   free(buf);
+
+   if (!ret)
+      return false;
+
+   playlist->journal_size += total;
+   playlist_journal_reset(journal);
+   return true;
+}
+
+static bool playlist_bin_enabled(void)
+{
+   settings_t *settings = config_get_ptr();
+   return settings && settings->bools.playlist_use_binary;
+}
+
+/**
+ * playlist_bin_write:
+ * @playlist            : Playlist handle.
+ *
+ * Writes the whole playlist in the binary format, replacing
+ * the playlist file and its journal.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool playlist_bin_write(playlist_t *playlist)
+{
+   size_t i;
+   char tmp_path[PATH_MAX_LENGTH];
+   uint8_t *buf         = NULL;
+   uint8_t *table       = NULL;
+   size_t table_offset  = PLAYLIST_BIN_HEADER_SIZE;
+   size_t pool_offset   = table_offset
+      + playlist->size * PLAYLIST_ENTRIES * sizeof(uint32_t);
+   uint64_t total       = pool_offset;
+   RFILE *file          = NULL;
+   bool ret             = false;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      unsigned j;
+      char **fields[PLAYLIST_ENTRIES];
+
+      playlist_entry_fields(playlist_entry_at(playlist, i), fields);
+
+      for (j = 0; j < PLAYLIST_ENTRIES; j++)
+         if (*fields[j])
+            total += strlen(*fields[j]) + 1;
+   }
+
+   if (total > UINT32_MAX)
+      return false;
+
+   buf = (uint8_t*)malloc((size_t)total);
+   if (!buf)
+      return false;
+
+   memcpy(buf, PLAYLIST_BIN_MAGIC, sizeof(PLAYLIST_BIN_MAGIC));
+   playlist_bin_write_u32(buf + 8,  PLAYLIST_BIN_VERSION);
+   playlist_bin_write_u32(buf + 12, (uint32_t)playlist->size);
+   playlist_bin_write_u32(buf + 16, (uint32_t)table_offset);
+   playlist_bin_write_u32(buf + 20, (uint32_t)total);
+
+   table = buf + table_offset;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      unsigned j;
+      char **fields[PLAYLIST_ENTRIES];
+
+      playlist_entry_fields(&playlist->entries[i], fields);
+
+      for (j = 0; j < PLAYLIST_ENTRIES; j++, table += sizeof(uint32_t))
+      {
+         size_t len;
+
+         if (!*fields[j])
+         {
+            playlist_bin_write_u32(table, 0);
+            continue;
+         }
+
+         len = strlen(*fields[j]) + 1;
+         memcpy(buf + pool_offset, *fields[j], len);
+         playlist_bin_write_u32(table, (uint32_t)pool_offset);
+         pool_offset += len;
+      }
+   }
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", playlist->conf_path);
+
+   file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (file)
+   {
+      ret = filestream_write(file, buf, total) == (int64_t)total;
+      if (filestream_close(file) != 0)
+         ret = false;
+
+      if (ret)
+         ret = filestream_rename(tmp_path, playlist->conf_path) == 0;
+      if (!ret)
+         filestream_delete(tmp_path);
+   }
+
+   free(buf);
+
+   if (!ret)
+      return false;
+
+   /* Strings still point into the old mapping,
+    * which stays around until playlist_free. */
+   playlist->binary       = true;
+   playlist->rewrite      = false;
+   playlist->base_size    = (size_t)total;
+   playlist->journal_size = 0;
+   playlist_journal_reset(&playlist->journal);
+   return true;
+}
+
+/**
+ * playlist_bin_read:
+ * @playlist            : Playlist handle.
+ * @path                : Path to playlist file.
+ *
+ * Maps a binary playlist and replays its journal. Entries are
+ * decoded from the mapping when they are first accessed.
+ *
+ * Returns: false if @path is not a binary playlist.
+ **/
+static bool playlist_bin_read(playlist_t *playlist, const char *path)
+{
+   size_t i, table_size;
+   uint32_t count, table_offset, journal_offset;
+   const uint8_t *ptr    = NULL;
+   const uint8_t *end    = NULL;
+   int64_t size          = 0;
+   size_t records_count  = 0;
+   size_t records_cap    = 0;
+   bool map_alloc        = false;
+   const void *map       = filestream_map_file(path, &size);
+
+   if (!map)
+   {
+      /* Files that cannot be mapped, e.g. with a VFS in
+       * place, are read into memory if they are binary. */
+      char magic[sizeof(PLAYLIST_BIN_MAGIC)];
+      void *buf     = NULL;
+      RFILE *file   = filestream_open(path,
+            RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+      bool is_bin   = false;
+
+      if (!file)
+         return false;
+
+      is_bin = filestream_read(file, magic, sizeof(magic))
+         == (int64_t)sizeof(magic)
+         && memcmp(magic, PLAYLIST_BIN_MAGIC, sizeof(magic)) == 0;
+      filestream_close(file);
+
+      if (!is_bin || !filestream_read_file(path, &buf, &size))
+         return false;
+
+      map       = buf;
+      map_alloc = true;
+   }
+
+   if (     size < PLAYLIST_BIN_HEADER_SIZE
+         || (uint64_t)size > UINT32_MAX
+         || memcmp(map, PLAYLIST_BIN_MAGIC, sizeof(PLAYLIST_BIN_MAGIC)) != 0)
+   {
+      if (map_alloc)
+         free((void*)map);
+      else
+         filestream_unmap_file(map, size);
+      return false;
+   }
+
+   playlist->binary    = true;
+   playlist->map       = (const uint8_t*)map;
+   playlist->map_size  = (size_t)size;
+   playlist->map_alloc = map_alloc;
+   end                = playlist->map + playlist->map_size;
+
+   count              = playlist_bin_read_u32(playlist->map + 12);
+   table_offset       = playlist_bin_read_u32(playlist->map + 16);
+   journal_offset     = playlist_bin_read_u32(playlist->map + 20);
+   table_size         = (size_t)count * PLAYLIST_ENTRIES * sizeof(uint32_t);
+
+   if (     playlist_bin_read_u32(playlist->map + 8) != PLAYLIST_BIN_VERSION
+         || table_offset < PLAYLIST_BIN_HEADER_SIZE
+         || journal_offset > playlist->map_size
+         || table_offset > journal_offset
+         || table_size > journal_offset - table_offset)
+   {
+      RARCH_ERR("Invalid binary playlist: %s\n", path);
+      playlist->rewrite = true;
+      return true;
+   }
+
+   records_cap       = count ? count : 1;
+   playlist->records = (uint32_t*)malloc(records_cap
+         * PLAYLIST_ENTRIES * sizeof(uint32_t));
+   if (!playlist->records)
+   {
+      playlist->rewrite = true;
+      return true;
+   }
+
+   ptr = playlist->map + table_offset;
+   for (i = 0; i < (size_t)count * PLAYLIST_ENTRIES; i++)
+      playlist->records[i] = playlist_bin_read_u32(
+            ptr + i * sizeof(uint32_t));
+   records_count = count;
+
+   for (ptr = playlist->map + journal_offset;
+         end - ptr >= PLAYLIST_JOURNAL_HEAD_SIZE; )
+   {
+      uint32_t size = playlist_bin_read_u32(ptr + 4);
+
+      if (     playlist_bin_read_u32(ptr) != PLAYLIST_JOURNAL_MAGIC
+            || size > (size_t)(end - ptr) - PLAYLIST_JOURNAL_HEAD_SIZE
+            || playlist_bin_read_u32(ptr + 8) != encoding_crc32(0,
+               ptr + PLAYLIST_JOURNAL_HEAD_SIZE, size)
+            || !playlist_journal_replay(ptr + PLAYLIST_JOURNAL_HEAD_SIZE,
+               size, &playlist->records, &records_count, &records_cap))
+         break;
+
+      ptr += PLAYLIST_JOURNAL_HEAD_SIZE + size;
+   }
+
+   playlist->base_size    = journal_offset;
+   playlist->journal_size = (size_t)(ptr - (playlist->map + journal_offset));
+
+   /* Never append past a torn batch or entries we dropped */
+   if (ptr != end)
+   {
+      RARCH_WARN("Ignoring incomplete playlist journal: %s\n", path);
+      playlist->rewrite = true;
+   }
+
+   if (records_count > playlist->cap)
+   {
+      records_count     = playlist->cap;
+      playlist->rewrite = true;
+   }
+
+   for (i = 0; i < records_count; i++)
+      playlist->entries[i].record = playlist->records + i * PLAYLIST_ENTRIES;
+   playlist->size = records_count;
+
+   return true;
+}
+#endif
+
 uint32_t playlist_get_size(playlist_t *playlist)
 {
    if (!playlist)
@@ -89,21 +1128,25 @@ void playlist_get_index(playlist_t *playlist,
       const char **crc32,
       const char **db_name)
 {
+   struct playlist_entry *entry = NULL;
+
    if (!playlist)
       return;
 
+   entry = playlist_entry_at(playlist, idx);
+
    if (path)
-      *path      = playlist->entries[idx].path;
+      *path      = entry->path;
    if (label)
-      *label     = playlist->entries[idx].label;
+      *label     = entry->label;
    if (core_path)
-      *core_path = playlist->entries[idx].core_path;
+      *core_path = entry->core_path;
    if (core_name)
-      *core_name = playlist->entries[idx].core_name;
+      *core_name = entry->core_name;
    if (db_name)
-      *db_name   = playlist->entries[idx].db_name;
+      *db_name   = entry->db_name;
    if (crc32)
-      *crc32     = playlist->entries[idx].crc32;
+      *crc32     = entry->crc32;
 }
 
 /**
@@ -119,11 +1162,19 @@ void playlist_delete_index(playlist_t *playlist,
    if (!playlist)
       return;
 
+   playlist_index_remove(playlist, idx);
+
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
-         (playlist->size - idx) * sizeof(struct playlist_entry));
+         (playlist->size - idx - 1) * sizeof(struct playlist_entry));
 
    playlist->size     = playlist->size - 1;
    playlist->modified = true;
+
+   playlist_index_shift(playlist, idx, playlist->size - idx, -1);
+
+#ifdef HAVE_MMAN
+   playlist_journal_record(playlist, PLAYLIST_OP_DELETE, idx, 0, NULL);
+#endif
 }
 
 void playlist_get_index_by_path(playlist_t *playlist,
@@ -134,28 +1185,25 @@ void playlist_get_index_by_path(playlist_t *playlist,
       char **db_name)
 {
    size_t i;
-   if (!playlist)
+   struct playlist_entry *entry = NULL;
+
+   if (!playlist || !playlist_find(playlist, search_path, NULL, &i))
       return;
 
-   for (i = 0; i < playlist->size; i++)
-   {
-      if (!string_is_equal(playlist->entries[i].path, search_path))
-         continue;
+   entry = playlist_entry_at(playlist, i);
 
-      if (path)
-         *path      = playlist->entries[i].path;
-      if (label)
-         *label     = playlist->entries[i].label;
-      if (core_path)
-         *core_path = playlist->entries[i].core_path;
-      if (core_name)
-         *core_name = playlist->entries[i].core_name;
-      if (db_name)
-         *db_name   = playlist->entries[i].db_name;
-      if (crc32)
-         *crc32     = playlist->entries[i].crc32;
-      break;
-   }
+   if (path)
+      *path      = entry->path;
+   if (label)
+      *label     = entry->label;
+   if (core_path)
+      *core_path = entry->core_path;
+   if (core_name)
+      *core_name = entry->core_name;
+   if (db_name)
+      *db_name   = entry->db_name;
+   if (crc32)
+      *crc32     = entry->crc32;
 }
 
 bool playlist_entry_exists(playlist_t *playlist,
@@ -166,36 +1214,28 @@ bool playlist_entry_exists(playlist_t *playlist,
    if (!playlist)
       return false;
 
-   for (i = 0; i < playlist->size; i++)
-      if (string_is_equal(playlist->entries[i].path, path))
-         return true;
-
-   return false;
+   return playlist_find(playlist, path, NULL, &i);
 }
 
 /**
  * playlist_free_entry:
+ * @playlist            : Playlist handle.
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
-   if (entry->path != NULL)
-      free(entry->path);
-   if (entry->label != NULL)
-      free(entry->label);
-   if (entry->core_path != NULL)
-      free(entry->core_path);
-   if (entry->core_name != NULL)
-      free(entry->core_name);
-   if (entry->db_name != NULL)
-      free(entry->db_name);
-   if (entry->crc32 != NULL)
-      free(entry->crc32);
+   playlist_free_string(playlist, entry->path);
+   playlist_free_string(playlist, entry->label);
+   playlist_free_string(playlist, entry->core_path);
+   playlist_free_string(playlist, entry->core_name);
+   playlist_free_string(playlist, entry->db_name);
+   playlist_free_string(playlist, entry->crc32);
 
    entry->path      = NULL;
    entry->label     = NULL;
@@ -203,6 +1243,9 @@ static void playlist_free_entry(struct playlist_entry *entry)
    entry->core_name = NULL;
    entry->db_name   = NULL;
    entry->crc32     = NULL;
+#ifdef HAVE_MMAN
+   entry->record    = NULL;
+#endif
 }
 
 void playlist_update(playlist_t *playlist, size_t idx,
@@ -212,60 +1255,66 @@ void playlist_update(playlist_t *playlist, size_t idx,
       const char *db_name)
 {
    struct playlist_entry *entry = NULL;
+   bool modified                = false;
 
-   if (!playlist || idx > playlist->size)
+   if (!playlist || idx >= playlist->size)
       return;
 
-   entry            = &playlist->entries[idx];
+   entry            = playlist_entry_at(playlist, idx);
 
    if (path && (path != entry->path))
    {
-      if (entry->path != NULL)
-         free(entry->path);
+      playlist_index_remove(playlist, idx);
+      playlist_free_string(playlist, entry->path);
       entry->path        = strdup(path);
-      playlist->modified = true;
+      modified           = true;
+      playlist_index_add(playlist, idx);
    }
 
    if (label && (label != entry->label))
    {
-      if (entry->label != NULL)
-         free(entry->label);
+      playlist_free_string(playlist, entry->label);
       entry->label       = strdup(label);
-      playlist->modified = true;
+      modified           = true;
    }
 
    if (core_path && (core_path != entry->core_path))
    {
-      if (entry->core_path != NULL)
-         free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
       entry->core_path   = NULL;
       entry->core_path   = strdup(core_path);
-      playlist->modified = true;
+      modified           = true;
    }
 
    if (core_name && (core_name != entry->core_name))
    {
-      if (entry->core_name != NULL)
-         free(entry->core_name);
+      playlist_free_string(playlist, entry->core_name);
       entry->core_name   = strdup(core_name);
-      playlist->modified = true;
+      modified           = true;
    }
 
    if (db_name && (db_name != entry->db_name))
    {
-      if (entry->db_name != NULL)
-         free(entry->db_name);
+      playlist_free_string(playlist, entry->db_name);
       entry->db_name     = strdup(db_name);
-      playlist->modified = true;
+      modified           = true;
    }
 
    if (crc32 && (crc32 != entry->crc32))
    {
-      if (entry->crc32 != NULL)
-         free(entry->crc32);
+      playlist_free_string(playlist, entry->crc32);
       entry->crc32       = strdup(crc32);
-      playlist->modified = true;
+      modified           = true;
    }
+
+   if (!modified)
+      return;
+
+   playlist->modified = true;
+
+#ifdef HAVE_MMAN
+   playlist_journal_record(playlist, PLAYLIST_OP_SET, idx, 0, entry);
+#endif
 }
 
 /**
@@ -309,28 +1358,9 @@ bool playlist_push(playlist_t *playlist,
    if (!playlist)
       return false;
 
-   for (i = 0; i < playlist->size; i++)
+   if (playlist_find(playlist, path, core_path, &i))
    {
       struct playlist_entry tmp;
-      bool equal_path;
-
-      equal_path = (!path && !playlist->entries[i].path) ||
-         (path && playlist->entries[i].path &&
-#ifdef _WIN32
-          /*prevent duplicates on case-insensitive operating systems*/
-          string_is_equal_noncase(path,playlist->entries[i].path)
-#else
-          string_is_equal(path,playlist->entries[i].path)
-#endif
-          );
-
-      /* Core name can have changed while still being the same core.
-       * Differentiate based on the core path only. */
-      if (!equal_path)
-         continue;
-
-      if (!string_is_equal(playlist->entries[i].core_path, core_path))
-         continue;
 
       /* If top entry, we don't want to push a new entry since
        * the top and the entry to be pushed are the same. */
@@ -338,27 +1368,45 @@ bool playlist_push(playlist_t *playlist,
          return false;
 
       /* Seen it before, bump to top. */
+      playlist_index_remove(playlist, i);
+
       tmp = playlist->entries[i];
       memmove(playlist->entries + 1, playlist->entries,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
 
+      playlist_index_shift(playlist, 1, i, 1);
+      playlist_index_add(playlist, 0);
+
+#ifdef HAVE_MMAN
+      playlist_journal_record(playlist, PLAYLIST_OP_MOVE, i, 0, NULL);
+#endif
+
       goto success;
    }
 
+   if (!playlist_reserve_front(playlist))
+      return false;
+
    if (playlist->size == playlist->cap)
    {
       struct playlist_entry *entry = &playlist->entries[playlist->cap - 1];
 
+      playlist_index_remove(playlist, playlist->cap - 1);
+
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
       playlist->size--;
+
+#ifdef HAVE_MMAN
+      playlist_journal_record(playlist, PLAYLIST_OP_DELETE,
+            playlist->cap - 1, 0, NULL);
+#endif
    }
 
    if (playlist->entries)
    {
-      memmove(playlist->entries + 1, playlist->entries,
-            (playlist->cap - 1) * sizeof(struct playlist_entry));
+      playlist->entries--;
 
       playlist->entries[0].path         = NULL;
       playlist->entries[0].label        = NULL;
@@ -366,6 +1414,9 @@ bool playlist_push(playlist_t *playlist,
       playlist->entries[0].core_name    = NULL;
       playlist->entries[0].db_name      = NULL;
       playlist->entries[0].crc32        = NULL;
+#ifdef HAVE_MMAN
+      playlist->entries[0].record       = NULL;
+#endif
       if (!string_is_empty(path))
          playlist->entries[0].path      = strdup(path);
       if (!string_is_empty(label))
@@ -382,20 +1433,116 @@ bool playlist_push(playlist_t *playlist,
 
    playlist->size++;
 
+   playlist_index_add(playlist, 0);
+
+#ifdef HAVE_MMAN
+   playlist_journal_record(playlist, PLAYLIST_OP_INSERT, 0, 0,
+         &playlist->entries[0]);
+#endif
+
 success:
    playlist->modified = true;
 
    return true;
 }
 
-void playlist_write_file(playlist_t *playlist)
+static void playlist_write_entries(playlist_t *playlist, RFILE *file)
 {
    size_t i;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry = playlist_entry_at(playlist, i);
+
+      filestream_printf(file, "%s\n%s\n%s\n%s\n%s\n%s\n",
+            entry->path    ? entry->path    : "",
+            entry->label   ? entry->label   : "",
+            entry->core_path,
+            entry->core_name,
+            entry->crc32   ? entry->crc32   : "",
+            entry->db_name ? entry->db_name : ""
+            );
+   }
+}
+
+#ifdef HAVE_MMAN
+/**
+ * playlist_bin_write_text:
+ * @playlist            : Playlist handle.
+ *
+ * Turns a binary playlist back into a text one. The text is
+ * written next to the playlist and renamed over it, since
+ * entries may still be read from the old file's mapping.
+ *
+ * Returns: true if successful, otherwise false.
+ **/
+static bool playlist_bin_write_text(playlist_t *playlist)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   RFILE *file = NULL;
+   bool ret    = false;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", playlist->conf_path);
+
+   file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   playlist_write_entries(playlist, file);
+
+   ret = filestream_close(file) == 0
+      && filestream_rename(tmp_path, playlist->conf_path) == 0;
+
+   if (!ret)
+   {
+      filestream_delete(tmp_path);
+      return false;
+   }
+
+   playlist->binary       = false;
+   playlist->rewrite      = false;
+   playlist->journal_size = 0;
+   playlist_journal_reset(&playlist->journal);
+   return true;
+}
+#endif
+
+void playlist_write_file(playlist_t *playlist)
+{
    RFILE *file = NULL;
 
    if (!playlist || !playlist->modified)
       return;
 
+#ifdef HAVE_MMAN
+   if (playlist->binary)
+   {
+      bool ret;
+
+      /* Compact the journal into a new file if appending
+       * is not possible or no longer worth it. Once the
+       * option is disabled the playlist goes back to text. */
+      if (playlist_bin_enabled())
+         ret = (!playlist->rewrite && playlist_bin_append(playlist))
+            || playlist_bin_write(playlist);
+      else
+         ret = playlist_bin_write_text(playlist);
+
+      if (!ret)
+      {
+         RARCH_ERR("Failed to write to playlist file: %s\n", playlist->conf_path);
+         return;
+      }
+
+      playlist->modified = false;
+
+      RARCH_LOG("Written to playlist file: %s\n", playlist->conf_path);
+      return;
+   }
+#endif
+
    file = filestream_open(playlist->conf_path,
          RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
@@ -405,15 +1552,7 @@ void playlist_write_file(playlist_t *playlist)
       return;
    }
 
-   for (i = 0; i < playlist->size; i++)
-      filestream_printf(file, "%s\n%s\n%s\n%s\n%s\n%s\n",
-            playlist->entries[i].path    ? playlist->entries[i].path    : "",
-            playlist->entries[i].label   ? playlist->entries[i].label   : "",
-            playlist->entries[i].core_path,
-            playlist->entries[i].core_name,
-            playlist->entries[i].crc32   ? playlist->entries[i].crc32   : "",
-            playlist->entries[i].db_name ? playlist->entries[i].db_name : ""
-            );
+   playlist_write_entries(playlist, file);
 
    playlist->modified = false;
 
@@ -435,22 +1574,34 @@ void playlist_free(playlist_t *playlist)
    if (!playlist)
       return;
 
-   if (playlist->conf_path != NULL)
-      free(playlist->conf_path);
-
-   playlist->conf_path = NULL;
-
    for (i = 0; i < playlist->size; i++)
    {
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
 
-   free(playlist->entries);
+   if (playlist->conf_path != NULL)
+      free(playlist->conf_path);
+
+   playlist->conf_path = NULL;
+
+   free(playlist->slots);
+   free(playlist->index);
+   playlist->slots   = NULL;
    playlist->entries = NULL;
 
+#ifdef HAVE_MMAN
+   if (playlist->map_alloc)
+      free((void*)playlist->map);
+   else
+      filestream_unmap_file(playlist->map, (int64_t)playlist->map_size);
+   free(playlist->records);
+   free(playlist->journal.strings);
+   free(playlist->journal.ops);
+#endif
+
    free(playlist);
 }
 
@@ -471,9 +1622,14 @@ void playlist_clear(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
-   playlist->size = 0;
+   playlist->size        = 0;
+   playlist->index_valid = false;
+
+#ifdef HAVE_MMAN
+   playlist_journal_record(playlist, PLAYLIST_OP_CLEAR, 0, 0, NULL);
+#endif
 }
 
 /**
@@ -496,7 +1652,14 @@ static bool playlist_read_file(
 {
    unsigned i;
    char buf[PLAYLIST_ENTRIES][1024];
-   intfstream_t *file = intfstream_open_file(
+   intfstream_t *file = NULL;
+
+#ifdef HAVE_MMAN
+   if (playlist_bin_read(playlist, path))
+      return true;
+#endif
+
+   file = intfstream_open_file(
          path, RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
@@ -552,6 +1715,19 @@ static bool playlist_read_file(
 end:
    intfstream_close(file);
    free(file);
+
+#ifdef HAVE_MMAN
+   /* Large playlists are kept in the binary format from now on */
+   if (     playlist->size >= PLAYLIST_BIN_MIN_ENTRIES
+         && playlist_bin_enabled())
+   {
+      if (playlist_bin_write(playlist))
+         RARCH_LOG("Converted playlist to binary format: %s\n", path);
+      else
+         RARCH_WARN("Failed to convert playlist to binary format: %s\n", path);
+   }
+#endif
+
    return true;
 }
 
@@ -590,7 +1766,7 @@ bool playlist_init_cached(const char *path, size_t size)
 playlist_t *playlist_init(const char *path, size_t size)
 {
    struct playlist_entry *entries = NULL;
-   playlist_t           *playlist = (playlist_t*)malloc(sizeof(*playlist));
+   playlist_t           *playlist = (playlist_t*)calloc(1, sizeof(*playlist));
    if (!playlist)
       return NULL;
 
@@ -606,6 +1782,8 @@ playlist_t *playlist_init(const char *path, size_t size)
    playlist->cap       = size;
    playlist->conf_path = strdup(path);
    playlist->entries   = entries;
+   playlist->slots     = entries;
+   playlist->alloc     = size;
 
    playlist_read_file(playlist, path);
 
@@ -626,7 +1804,33 @@ static int playlist_qsort_func(const struct playlist_entry *a,
 
 void playlist_qsort(playlist_t *playlist)
 {
+   size_t i;
+
+   /* Labels are needed for every entry */
+   for (i = 0; i < playlist->size; i++)
+      playlist_entry_at(playlist, i);
+
+#ifdef HAVE_MMAN
+   /* Reordering cannot be journaled, so leave
+    * sorted binary playlists untouched. */
+   if (playlist->binary)
+   {
+      for (i = 1; i < playlist->size; i++)
+         if (playlist_qsort_func(&playlist->entries[i - 1],
+                  &playlist->entries[i]) > 0)
+            break;
+
+      if (i >= playlist->size)
+         return;
+
+      playlist->rewrite = true;
+      playlist_journal_reset(&playlist->journal);
+   }
+#endif
+
    qsort(playlist->entries, playlist->size,
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
+
+   playlist->index_valid = false;
 }
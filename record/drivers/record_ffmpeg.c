@@ -22,6 +22,7 @@
 #include <compat/msvc.h>
 
 #include <boolean.h>
+#include <features/features_cpu.h>
 #include <queues/fifo_queue.h>
 #include <rthreads/rthreads.h>
 #include <gfx/scaler/scaler.h>
@@ -412,6 +413,12 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    {
       /* By default, lossless video. */
       av_dict_set(&params->video_opts, "qp", "0", 0);
+
+      /* Nothing has to keep up with the core when rendering
+       * a movie, spend the time on a smaller file instead. */
+      if (param->offline)
+         av_dict_set(&params->video_opts, "preset", "veryslow",
+               AV_DICT_DONT_OVERWRITE);
       codec = avcodec_find_encoder_by_name("libx264rgb");
    }
 
@@ -538,14 +545,14 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
 }
 
 static bool ffmpeg_init_config(struct ff_config_param *params,
-      const char *config)
+      const char *config, bool offline)
 {
    struct config_file_entry entry;
    char pix_fmt[64] = {0};
 
    params->out_pix_fmt = PIX_FMT_NONE;
    params->scale_factor = 1;
-   params->threads = 1;
+   params->threads = offline ? cpu_features_get_core_amount() : 1;
    params->frame_drop_ratio = 1;
    params->audio_enable = true;
 
@@ -796,7 +803,8 @@ static void *ffmpeg_new(const struct ffemu_params *params)
 
    handle->params = *params;
 
-   if (!ffmpeg_init_config(&handle->config, params->config))
+   if (!ffmpeg_init_config(&handle->config, params->config,
+            params->offline))
       goto error;
 
    if (!ffmpeg_init_muxer_pre(handle))
@@ -0,0 +1,666 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Lightweight lossless recording. Every frame is stored as
+ * the XOR against the previous one, with runs of unchanged
+ * bytes skipped, next to raw PCM audio. Encoding costs little
+ * more than a memcmp of the frame, so it can run on hardware
+ * where FFmpeg cannot keep up. Use tools/rdiff-convert to
+ * turn a recording into a regular video file afterwards. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_endianness.h>
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
+#include <queues/fifo_queue.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "record_rdiff.h"
+#include "../record_driver.h"
+#include "../../verbosity.h"
+
+/* Frames which can be queued up for the encoder thread. */
+#define RDIFF_SLOTS 8
+
+/* Shorter runs of unchanged bytes are folded into the
+ * surrounding literal, the token overhead would eat the gain. */
+#define RDIFF_MIN_SKIP 8
+
+/* Seconds between keyframes. A damaged chunk only corrupts
+ * the picture up to the next one. */
+#define RDIFF_KEYFRAME_SECONDS 10
+
+struct rdiff_slot
+{
+   uint8_t *data;
+   size_t capacity;
+   unsigned width;
+   unsigned height;
+   bool is_dupe;
+};
+
+typedef struct rdiff
+{
+   RFILE *file;
+   unsigned bpp;
+   unsigned keyframe_interval;
+   unsigned frames_since_key;
+   bool failed;
+
+   /* Last encoded frame, packed. */
+   uint8_t *prev;
+   size_t prev_capacity;
+   unsigned prev_width;
+   unsigned prev_height;
+
+   uint8_t *encode_buf;
+   size_t encode_capacity;
+
+   int16_t *audio_buf;
+
+   struct rdiff_slot slots[RDIFF_SLOTS];
+   fifo_buffer_t *audio_fifo;
+
+#ifdef HAVE_THREADS
+   /* Slots [tail, tail + count) belong to the encoder
+    * thread, the others to the pushing thread. */
+   unsigned head;
+   unsigned tail;
+   unsigned count;
+   bool alive;
+
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   scond_t *free_cond;
+#endif
+} rdiff_t;
+
+static bool rdiff_write(rdiff_t *handle, const void *data, size_t size)
+{
+   if (handle->failed)
+      return false;
+
+   if (size && filestream_write(handle->file, data, size) != (int64_t)size)
+   {
+      RARCH_ERR("[rdiff]: Failed to write recording, stopping.\n");
+      handle->failed = true;
+      return false;
+   }
+
+   return true;
+}
+
+static bool rdiff_write_chunk(rdiff_t *handle, uint32_t type,
+      uint32_t info0, uint32_t info1, const void *data, size_t size)
+{
+   struct rdiff_chunk_header chunk;
+
+   chunk.type  = swap_if_big32(type);
+   chunk.size  = swap_if_big32((uint32_t)size);
+   chunk.info0 = swap_if_big32(info0);
+   chunk.info1 = swap_if_big32(info1);
+
+   if (!rdiff_write(handle, &chunk, sizeof(chunk)))
+      return false;
+   return rdiff_write(handle, data, size);
+}
+
+static bool rdiff_reserve(uint8_t **buf, size_t *capacity, size_t size)
+{
+   uint8_t *tmp = NULL;
+
+   if (*capacity >= size)
+      return true;
+
+   tmp = (uint8_t*)realloc(*buf, size);
+   if (!tmp)
+      return false;
+
+   *buf      = tmp;
+   *capacity = size;
+   return true;
+}
+
+static INLINE uint8_t *rdiff_put_varint(uint8_t *out, size_t val)
+{
+   while (val >= 0x80)
+   {
+      *out++ = (uint8_t)(val | 0x80);
+      val  >>= 7;
+   }
+   *out++ = (uint8_t)val;
+   return out;
+}
+
+/* Length of the run of equal bytes at the start of @a and @b. */
+static INLINE size_t rdiff_same(const uint8_t *a, const uint8_t *b,
+      size_t size)
+{
+   size_t i = 0;
+
+   for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+   {
+      uint64_t va, vb;
+      memcpy(&va, a + i, sizeof(va));
+      memcpy(&vb, b + i, sizeof(vb));
+      if (va != vb)
+         break;
+   }
+
+   while (i < size && a[i] == b[i])
+      i++;
+
+   return i;
+}
+
+/* Length of the run of zero bytes at the start of @a. */
+static INLINE size_t rdiff_zero(const uint8_t *a, size_t size)
+{
+   size_t i = 0;
+
+   while (i < size && !a[i])
+      i++;
+
+   return i;
+}
+
+/**
+ * rdiff_encode:
+ * @out                : Output buffer.
+ * @out_size           : Size of @out.
+ * @cur                : Frame to encode.
+ * @prev               : Previous frame, or NULL for a keyframe.
+ * @size               : Size of both frames in bytes.
+ *
+ * Returns: size of the encoded delta, or 0 if it would
+ * not fit in @out.
+ **/
+static size_t rdiff_encode(uint8_t *out, size_t out_size,
+      const uint8_t *cur, const uint8_t *prev, size_t size)
+{
+   uint8_t *dst = out;
+   uint8_t *end = out + out_size;
+   size_t i     = 0;
+
+   while (i < size)
+   {
+      size_t j;
+      size_t skip  = prev ? rdiff_same(cur + i, prev + i, size - i)
+         : rdiff_zero(cur + i, size - i);
+      size_t start = i + skip;
+
+      i = start;
+
+      /* Extend the literal until a run worth skipping. */
+      while (i < size)
+      {
+         size_t run;
+
+         while (i < size && (prev ? cur[i] != prev[i] : cur[i] != 0))
+            i++;
+
+         if (i >= size)
+            break;
+
+         run = prev
+            ? rdiff_same(cur + i, prev + i, MIN(size - i, RDIFF_MIN_SKIP))
+            : rdiff_zero(cur + i, MIN(size - i, RDIFF_MIN_SKIP));
+
+         if (run >= RDIFF_MIN_SKIP || i + run >= size)
+            break;
+
+         i += run;
+      }
+
+      if ((size_t)(end - dst) < 20 + (i - start))
+         return 0;
+
+      dst = rdiff_put_varint(dst, skip);
+      dst = rdiff_put_varint(dst, i - start);
+
+      if (prev)
+      {
+         for (j = start; j < i; j++)
+            *dst++ = cur[j] ^ prev[j];
+      }
+      else
+      {
+         memcpy(dst, cur + start, i - start);
+         dst += i - start;
+      }
+   }
+
+   return dst - out;
+}
+
+static void rdiff_flush_audio(rdiff_t *handle, size_t bytes)
+{
+   size_t frame_size = 2 * sizeof(int16_t);
+
+   if (!bytes)
+      return;
+
+   rdiff_write_chunk(handle, RDIFF_CHUNK_AUDIO,
+         (uint32_t)(bytes / frame_size), 0, handle->audio_buf, bytes);
+}
+
+static void rdiff_encode_slot(rdiff_t *handle, struct rdiff_slot *slot)
+{
+   uint8_t *tmp;
+   size_t tmp_capacity;
+   size_t encoded;
+   size_t size    = (size_t)slot->width * slot->height * handle->bpp;
+   uint32_t dims  = slot->width | (slot->height << 16);
+   uint32_t flags = 0;
+   bool keyframe  = !handle->prev
+      || slot->width  != handle->prev_width
+      || slot->height != handle->prev_height
+      || handle->frames_since_key >= handle->keyframe_interval;
+
+   if (slot->is_dupe)
+   {
+      if (handle->prev)
+         rdiff_write_chunk(handle, RDIFF_CHUNK_VIDEO,
+               handle->prev_width | (handle->prev_height << 16),
+               RDIFF_FRAME_DUPE, NULL, 0);
+      return;
+   }
+
+   if (!rdiff_reserve(&handle->encode_buf, &handle->encode_capacity, size))
+   {
+      handle->failed = true;
+      return;
+   }
+
+   encoded = rdiff_encode(handle->encode_buf, size, slot->data,
+         keyframe ? NULL : handle->prev, size);
+
+   if (keyframe)
+   {
+      flags                    |= RDIFF_FRAME_KEY;
+      handle->frames_since_key  = 0;
+   }
+   handle->frames_since_key++;
+
+   if (encoded)
+      rdiff_write_chunk(handle, RDIFF_CHUNK_VIDEO, dims, flags,
+            handle->encode_buf, encoded);
+   else if (keyframe)
+      rdiff_write_chunk(handle, RDIFF_CHUNK_VIDEO, dims,
+            flags | RDIFF_FRAME_RAW, slot->data, size);
+   else
+   {
+      /* Delta did not compress, store the plain XOR. */
+      size_t i;
+      for (i = 0; i < size; i++)
+         handle->encode_buf[i] = slot->data[i] ^ handle->prev[i];
+      rdiff_write_chunk(handle, RDIFF_CHUNK_VIDEO, dims,
+            flags | RDIFF_FRAME_RAW, handle->encode_buf, size);
+   }
+
+   /* The encoded frame becomes the reference for the next one. */
+   tmp                   = handle->prev;
+   tmp_capacity          = handle->prev_capacity;
+   handle->prev          = slot->data;
+   handle->prev_capacity = slot->capacity;
+   handle->prev_width    = slot->width;
+   handle->prev_height   = slot->height;
+   slot->data            = tmp;
+   slot->capacity        = tmp_capacity;
+}
+
+/* Packs the frame into @slot. Negative pitches (bottom-up
+ * GPU readbacks) end up top-down as well. */
+static bool rdiff_fill_slot(rdiff_t *handle, struct rdiff_slot *slot,
+      const struct ffemu_video_data *data)
+{
+   unsigned y;
+   size_t row = (size_t)data->width * handle->bpp;
+
+   slot->is_dupe = data->is_dupe || !data->data;
+   slot->width   = data->width;
+   slot->height  = data->height;
+
+   if (slot->is_dupe)
+      return true;
+
+   if (data->width > 0xffff || data->height > 0xffff)
+      return false;
+
+   if (!rdiff_reserve(&slot->data, &slot->capacity, row * data->height))
+      return false;
+
+   for (y = 0; y < data->height; y++)
+      memcpy(slot->data + y * row,
+            (const uint8_t*)data->data + (ptrdiff_t)y * data->pitch, row);
+
+   return true;
+}
+
+static size_t rdiff_take_audio(rdiff_t *handle)
+{
+   size_t bytes = 0;
+
+   if (!handle->audio_fifo)
+      return 0;
+
+   bytes = fifo_read_avail(handle->audio_fifo);
+   if (bytes)
+      fifo_read(handle->audio_fifo, handle->audio_buf, bytes);
+   return bytes;
+}
+
+#ifdef HAVE_THREADS
+static void rdiff_thread(void *data)
+{
+   rdiff_t *handle = (rdiff_t*)data;
+
+   for (;;)
+   {
+      size_t audio_bytes       = 0;
+      struct rdiff_slot *slot  = NULL;
+
+      slock_lock(handle->lock);
+      while (handle->alive && !handle->count
+            && !fifo_read_avail(handle->audio_fifo))
+         scond_wait(handle->cond, handle->lock);
+
+      if (!handle->alive && !handle->count
+            && !fifo_read_avail(handle->audio_fifo))
+      {
+         slock_unlock(handle->lock);
+         break;
+      }
+
+      audio_bytes = rdiff_take_audio(handle);
+      if (handle->count)
+         slot     = &handle->slots[handle->tail];
+      scond_signal(handle->free_cond);
+      slock_unlock(handle->lock);
+
+      rdiff_flush_audio(handle, audio_bytes);
+
+      if (!slot)
+         continue;
+
+      rdiff_encode_slot(handle, slot);
+
+      slock_lock(handle->lock);
+      handle->tail = (handle->tail + 1) % RDIFF_SLOTS;
+      handle->count--;
+      scond_signal(handle->free_cond);
+      slock_unlock(handle->lock);
+   }
+}
+#endif
+
+static bool rdiff_push_video(void *data,
+      const struct ffemu_video_data *video_data)
+{
+   struct rdiff_slot *slot = NULL;
+   rdiff_t *handle         = (rdiff_t*)data;
+
+   if (!handle || handle->failed)
+      return false;
+
+#ifdef HAVE_THREADS
+   slock_lock(handle->lock);
+   while (handle->count == RDIFF_SLOTS)
+      scond_wait(handle->free_cond, handle->lock);
+   slot = &handle->slots[handle->head];
+   slock_unlock(handle->lock);
+
+   if (!rdiff_fill_slot(handle, slot, video_data))
+      return false;
+
+   slock_lock(handle->lock);
+   handle->head = (handle->head + 1) % RDIFF_SLOTS;
+   handle->count++;
+   scond_signal(handle->cond);
+   slock_unlock(handle->lock);
+#else
+   slot = &handle->slots[0];
+
+   if (!rdiff_fill_slot(handle, slot, video_data))
+      return false;
+
+   rdiff_flush_audio(handle, rdiff_take_audio(handle));
+   rdiff_encode_slot(handle, slot);
+#endif
+
+   return !handle->failed;
+}
+
+static bool rdiff_push_audio(void *data,
+      const struct ffemu_audio_data *audio_data)
+{
+   const uint8_t *buf = NULL;
+   size_t bytes       = 0;
+   rdiff_t *handle    = (rdiff_t*)data;
+
+   if (!handle || handle->failed)
+      return false;
+
+   buf   = (const uint8_t*)audio_data->data;
+   bytes = audio_data->frames * 2 * sizeof(int16_t);
+
+   while (bytes)
+   {
+      size_t avail;
+
+#ifdef HAVE_THREADS
+      slock_lock(handle->lock);
+      while (!(avail = fifo_write_avail(handle->audio_fifo)
+               & ~(2 * sizeof(int16_t) - 1)))
+         scond_wait(handle->free_cond, handle->lock);
+#else
+      avail = fifo_write_avail(handle->audio_fifo)
+         & ~(2 * sizeof(int16_t) - 1);
+      if (!avail)
+         rdiff_flush_audio(handle, rdiff_take_audio(handle));
+      avail = fifo_write_avail(handle->audio_fifo)
+         & ~(2 * sizeof(int16_t) - 1);
+#endif
+
+      avail = MIN(avail, bytes);
+      fifo_write(handle->audio_fifo, buf, avail);
+
+#ifdef HAVE_THREADS
+      scond_signal(handle->cond);
+      slock_unlock(handle->lock);
+#endif
+
+      buf   += avail;
+      bytes -= avail;
+   }
+
+   return true;
+}
+
+static bool rdiff_finalize(void *data)
+{
+   rdiff_t *handle = (rdiff_t*)data;
+
+   if (!handle)
+      return false;
+
+#ifdef HAVE_THREADS
+   if (handle->thread)
+   {
+      slock_lock(handle->lock);
+      handle->alive = false;
+      scond_signal(handle->cond);
+      slock_unlock(handle->lock);
+
+      sthread_join(handle->thread);
+      handle->thread = NULL;
+   }
+#endif
+
+   rdiff_flush_audio(handle, rdiff_take_audio(handle));
+
+   return !handle->failed;
+}
+
+static void rdiff_free(void *data)
+{
+   unsigned i;
+   rdiff_t *handle = (rdiff_t*)data;
+
+   if (!handle)
+      return;
+
+   rdiff_finalize(handle);
+
+   if (handle->file)
+      filestream_close(handle->file);
+
+#ifdef HAVE_THREADS
+   slock_free(handle->lock);
+   scond_free(handle->cond);
+   scond_free(handle->free_cond);
+#endif
+
+   for (i = 0; i < RDIFF_SLOTS; i++)
+      free(handle->slots[i].data);
+
+   if (handle->audio_fifo)
+      fifo_free(handle->audio_fifo);
+
+   free(handle->audio_buf);
+   free(handle->encode_buf);
+   free(handle->prev);
+   free(handle);
+}
+
+static void *rdiff_new(const struct ffemu_params *params)
+{
+   struct rdiff_file_header header;
+   size_t audio_size  = 0;
+   rdiff_t *handle    = NULL;
+   uint32_t pix_fmt   = RDIFF_PIX_RGB565;
+
+   if (!params || !params->filename || params->channels != 2)
+      return NULL;
+
+   handle = (rdiff_t*)calloc(1, sizeof(*handle));
+   if (!handle)
+      return NULL;
+
+   switch (params->pix_fmt)
+   {
+      case FFEMU_PIX_RGB565:
+         handle->bpp = 2;
+         pix_fmt     = RDIFF_PIX_RGB565;
+         break;
+      case FFEMU_PIX_BGR24:
+         handle->bpp = 3;
+         pix_fmt     = RDIFF_PIX_BGR24;
+         break;
+      case FFEMU_PIX_ARGB8888:
+         handle->bpp = 4;
+         pix_fmt     = RDIFF_PIX_XRGB8888;
+         break;
+      default:
+         goto error;
+   }
+
+   handle->keyframe_interval = (unsigned)(params->fps
+         * RDIFF_KEYFRAME_SECONDS);
+   if (!handle->keyframe_interval)
+      handle->keyframe_interval = 1;
+
+   /* About half a second of audio. */
+   audio_size         = ((size_t)(params->samplerate / 2) + 1)
+      * 2 * sizeof(int16_t);
+   handle->audio_fifo = fifo_new(audio_size);
+   handle->audio_buf  = (int16_t*)malloc(audio_size);
+   if (!handle->audio_fifo || !handle->audio_buf)
+      goto error;
+
+   handle->file = filestream_open(params->filename,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!handle->file)
+   {
+      RARCH_ERR("[rdiff]: Cannot open \"%s\" for writing.\n",
+            params->filename);
+      goto error;
+   }
+
+   memcpy(header.magic, RDIFF_MAGIC, sizeof(header.magic));
+   header.version        = swap_if_big32(RDIFF_VERSION);
+   header.flags          = swap_if_big32(is_little_endian()
+         ? 0 : RDIFF_FLAG_BIG_ENDIAN);
+   header.pix_fmt        = swap_if_big32(pix_fmt);
+   header.fps_num        = swap_if_big32((uint32_t)
+         (params->fps * 1000000.0 + 0.5));
+   header.samplerate_num = swap_if_big32((uint32_t)
+         (params->samplerate * 1000.0 + 0.5));
+   header.channels       = swap_if_big32(params->channels);
+   header.aspect_num     = swap_if_big32((uint32_t)
+         (params->aspect_ratio * 1000000.0f + 0.5f));
+
+   if (!rdiff_write(handle, &header, sizeof(header)))
+      goto error;
+
+#ifdef HAVE_THREADS
+   handle->lock      = slock_new();
+   handle->cond      = scond_new();
+   handle->free_cond = scond_new();
+   handle->alive     = true;
+
+   if (!handle->lock || !handle->cond || !handle->free_cond)
+      goto error;
+
+   handle->thread    = sthread_create(rdiff_thread, handle);
+   if (!handle->thread)
+      goto error;
+#endif
+
+   RARCH_LOG("[rdiff]: Recording to \"%s\".\n", params->filename);
+
+   return handle;
+
+error:
+#ifdef HAVE_THREADS
+   handle->alive = false;
+#endif
+   rdiff_free(handle);
+   return NULL;
+}
+
+const record_driver_t ffemu_rdiff = {
+   rdiff_new,
+   rdiff_free,
+   rdiff_push_video,
+   rdiff_push_audio,
+   rdiff_finalize,
+   "rdiff",
+};
@@ -0,0 +1,88 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RECORD_RDIFF_H
+#define __RECORD_RDIFF_H
+
+#include <stdint.h>
+
+/* On-disk layout of the "rdiff" recording format.
+ * All header fields are little endian.
+ *
+ * File header (struct rdiff_file_header), followed by
+ * any number of chunks, each a struct rdiff_chunk_header
+ * followed by 'size' bytes of payload.
+ *
+ * Video chunks hold one frame, packed (pitch == width * bpp)
+ * and top-down, as the XOR of the frame with the previous
+ * one. Keyframes are XORed against an all-zero frame. The
+ * delta is either stored as-is (RDIFF_FRAME_RAW) or as a
+ * sequence of tokens:
+ *
+ *   varint skip, varint count, count literal bytes
+ *
+ * 'skip' bytes of the delta are zero, the following 'count'
+ * bytes are given. Varints are LEB128.
+ *
+ * Audio chunks hold interleaved signed 16-bit PCM.
+ *
+ * Pixel data and PCM samples are stored in the byte order of
+ * the machine that recorded them, see RDIFF_FLAG_BIG_ENDIAN. */
+
+#define RDIFF_MAGIC          "RDIF"
+#define RDIFF_VERSION        1
+
+#define RDIFF_CHUNK_VIDEO    0x46564452 /* "RDVF" */
+#define RDIFF_CHUNK_AUDIO    0x55414452 /* "RDAU" */
+
+/* rdiff_file_header::flags */
+#define RDIFF_FLAG_BIG_ENDIAN 0x1
+
+/* rdiff_chunk_header::info1 of video chunks */
+#define RDIFF_FRAME_KEY      0x1
+#define RDIFF_FRAME_DUPE     0x2
+#define RDIFF_FRAME_RAW      0x4
+
+enum rdiff_pix_format
+{
+   RDIFF_PIX_RGB565 = 0,
+   RDIFF_PIX_BGR24,
+   RDIFF_PIX_XRGB8888
+};
+
+struct rdiff_file_header
+{
+   char magic[4];
+   uint32_t version;
+   uint32_t flags;
+   uint32_t pix_fmt;
+   uint32_t fps_num;         /* fps * 1000000 */
+   uint32_t samplerate_num;  /* samplerate * 1000 */
+   uint32_t channels;
+   uint32_t aspect_num;      /* aspect ratio * 1000000 */
+};
+
+/* Video: info0 = width | (height << 16), info1 = RDIFF_FRAME_*.
+ * Duplicate frames carry no payload.
+ * Audio: info0 = frames, info1 = 0. */
+struct rdiff_chunk_header
+{
+   uint32_t type;
+   uint32_t size;
+   uint32_t info0;
+   uint32_t info1;
+};
+
+#endif
@@ -41,6 +41,7 @@ static const record_driver_t *record_drivers[] = {
 #ifdef HAVE_FFMPEG
    &ffemu_ffmpeg,
 #endif
+   &ffemu_rdiff,
    &ffemu_null,
    NULL,
 };
@@ -51,6 +52,8 @@ size_t      recording_gpu_width                = 0;
 size_t      recording_gpu_height               = 0;
 static bool recording_enable                   = false;
 static bool recording_use_output_dir           = false;
+static bool recording_offline                  = false;
+static char recording_offline_filter[PATH_MAX_LENGTH] = {0};
 
 static const record_driver_t *recording_driver = NULL;
 void *recording_data                           = NULL;
@@ -162,7 +165,8 @@ const record_driver_t *ffemu_find_backend(const char *ident)
  * @data                    : Recording data handle.
  * @params                  : Recording info parameters.
  *
- * Finds first suitable recording context driver and initializes.
+ * Initializes the record driver selected in the settings,
+ * falling back to the first one which initializes.
  *
  * Returns: true (1) if successful, otherwise false (0).
  **/
@@ -170,10 +174,30 @@ bool record_driver_init_first(const record_driver_t **backend, void **data,
       const struct ffemu_params *params)
 {
    unsigned i;
+   settings_t *settings          = config_get_ptr();
+   const record_driver_t *wanted = settings
+      ? ffemu_find_backend(settings->arrays.record_driver) : NULL;
+
+   if (wanted)
+   {
+      void *handle = wanted->init(params);
+
+      if (handle)
+      {
+         *backend = wanted;
+         *data    = handle;
+         return true;
+      }
+   }
 
    for (i = 0; record_drivers[i]; i++)
    {
-      void *handle = record_drivers[i]->init(params);
+      void *handle = NULL;
+
+      if (record_drivers[i] == wanted)
+         continue;
+
+      handle = record_drivers[i]->init(params);
 
       if (!handle)
          continue;
@@ -291,6 +315,55 @@ void recording_set_state(bool state)
    recording_enable = state;
 }
 
+/**
+ * recording_set_offline:
+ * @state              : true if frames come from a movie replay.
+ *
+ * Offline recordings always include the softfilter output
+ * and let the record driver favour quality over speed.
+ **/
+void recording_set_offline(bool state)
+{
+   recording_offline = state;
+}
+
+bool recording_is_offline(void)
+{
+   return recording_offline;
+}
+
+/**
+ * recording_set_offline_filter:
+ * @path               : Softfilter plugin to render with, or NULL.
+ *
+ * Offline recordings can use a softfilter of their own,
+ * typically an upscaling one, without touching the
+ * configured filter.
+ **/
+void recording_set_offline_filter(const char *path)
+{
+   if (string_is_empty(path))
+      recording_offline_filter[0] = '\0';
+   else
+      strlcpy(recording_offline_filter, path,
+            sizeof(recording_offline_filter));
+}
+
+/**
+ * recording_get_filter_path:
+ *
+ * Returns: the softfilter plugin to use, either the offline
+ * recording override or the configured one.
+ **/
+const char *recording_get_filter_path(void)
+{
+   settings_t *settings = config_get_ptr();
+
+   if (recording_offline && !string_is_empty(recording_offline_filter))
+      return recording_offline_filter;
+   return settings->paths.path_softfilter_plugin;
+}
+
 void recording_push_audio(const int16_t *data, size_t samples)
 {
    struct ffemu_audio_data ffemu_data;
@@ -361,6 +434,7 @@ bool recording_init(void)
    params.pix_fmt    = (video_driver_get_pixel_format() == RETRO_PIXEL_FORMAT_XRGB8888) ?
       FFEMU_PIX_ARGB8888 : FFEMU_PIX_RGB565;
    params.config     = NULL;
+   params.offline    = recording_offline;
 
    if (!string_is_empty(global->record.config))
       params.config = global->record.config;
@@ -422,7 +496,7 @@ bool recording_init(void)
       else
          params.aspect_ratio = (float)params.out_width / params.out_height;
 
-      if (settings->bools.video_post_filter_record
+      if ((settings->bools.video_post_filter_record || recording_offline)
             && video_driver_frame_filter_alive())
       {
          unsigned max_width  = 0;
@@ -63,6 +63,10 @@ struct ffemu_params
 
    /* Path to config. Optional. */
    const char *config;
+
+   /* Frames come from a movie replay rather than live play,
+    * so encoding speed may be traded for quality. */
+   bool offline;
 };
 
 struct ffemu_video_data
@@ -91,6 +95,7 @@ typedef struct record_driver
 } record_driver_t;
 
 extern const record_driver_t ffemu_ffmpeg;
+extern const record_driver_t ffemu_rdiff;
 extern const record_driver_t ffemu_null;
 
 /**
@@ -164,6 +169,14 @@ bool *recording_is_enabled(void);
 
 void recording_set_state(bool state);
 
+void recording_set_offline(bool state);
+
+bool recording_is_offline(void);
+
+void recording_set_offline_filter(const char *path);
+
+const char *recording_get_filter_path(void);
+
 void recording_push_audio(const int16_t *data, size_t samples);
 
 void *recording_driver_get_data_ptr(void);
@@ -114,6 +114,8 @@
 #include "managers/state_manager.h"
 #include "tasks/tasks_internal.h"
 #include "performance_counters.h"
+#include "gfx/video_frame_pacing.h"
+#include "benchmark.h"
 
 #include "version.h"
 #include "version_git.h"
@@ -165,7 +167,10 @@ enum
    RA_OPT_VERSION,
    RA_OPT_EOF_EXIT,
    RA_OPT_LOG_FILE,
-   RA_OPT_MAX_FRAMES
+   RA_OPT_MAX_FRAMES,
+   RA_OPT_RENDER,
+   RA_OPT_RENDER_FILTER,
+   RA_OPT_BENCHMARK
 };
 
 enum  runloop_state
@@ -234,6 +239,7 @@ static bool rarch_first_start                              = true;
 static bool runloop_force_nonblock                         = false;
 static bool runloop_paused                                 = false;
 static bool runloop_idle                                   = false;
+static bool runloop_headless                               = false;
 static bool runloop_exec                                   = false;
 static bool runloop_slowmotion                             = false;
 static bool runloop_fastmotion                             = false;
@@ -266,6 +272,7 @@ static unsigned runloop_max_frames                         = 0;
 static retro_usec_t runloop_frame_time_last                = 0;
 static retro_time_t frame_limit_minimum_time               = 0.0;
 static retro_time_t frame_limit_last_time                  = 0.0;
+static retro_time_t frame_limit_spin_target                = 0;
 
 extern bool input_driver_flushing_input;
 
@@ -548,6 +555,28 @@ static void retroarch_print_help(const char *arg0)
          "the beginning.");
    puts("      --eof-exit        Exit upon reaching the end of the "
          "BSV movie file.");
+   puts("      --render          Play back the movie given with -P without "
+         "video or audio\n"
+        "                        output, as fast as possible, record it to "
+        "the file given\n"
+        "                        with -r and exit. Any softfilter is applied "
+        "to the recording.\n"
+        "                        Only works for deterministic, software "
+        "rendered cores.");
+   puts("      --render-filter=FILE\n"
+        "                        Apply softfilter FILE, e.g. an upscaling "
+        "one, to the --render\n"
+        "                        recording instead of the configured "
+        "softfilter.");
+   puts("      --benchmark=NUMBER\n"
+        "                        Run the specified number of frames "
+        "without video or audio\n"
+        "                        output, as fast as possible, then print "
+        "frames per second,\n"
+        "                        timings of the core callbacks and hashes "
+        "of the last frame\n"
+        "                        and of the core state. A movie given "
+        "with -P is replayed.");
    puts("  -M, --sram-mode=MODE  SRAM handling mode. MODE can be "
          "'noload-nosave',\n"
         "                        'noload-save', 'load-nosave' or "
@@ -621,6 +650,10 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
 {
    const char *optstring = NULL;
    bool explicit_menu    = false;
+   bool play_movie       = false;
+   bool render_movie     = false;
+   bool benchmark_movie  = false;
+   const char *render_filter = NULL;
    global_t  *global     = global_get_ptr();
 
    const struct option opts[] = {
@@ -664,6 +697,9 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
       { "subsystem",    1, NULL, RA_OPT_SUBSYSTEM },
       { "max-frames",   1, NULL, RA_OPT_MAX_FRAMES },
       { "eof-exit",     0, NULL, RA_OPT_EOF_EXIT },
+      { "render",       0, NULL, RA_OPT_RENDER },
+      { "render-filter", 1, NULL, RA_OPT_RENDER_FILTER },
+      { "benchmark",    1, NULL, RA_OPT_BENCHMARK },
       { "version",      0, NULL, RA_OPT_VERSION },
 #ifdef HAVE_FILE_LOGGER
       { "log-file",     1, NULL, RA_OPT_LOG_FILE },
@@ -922,6 +958,7 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
          case 'P':
          case 'R':
             bsv_movie_set_start_path(optarg);
+            play_movie = (c == 'P');
 
             if (c == 'P')
                bsv_movie_ctl(BSV_MOVIE_CTL_SET_START_PLAYBACK, NULL);
@@ -1096,6 +1133,19 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
             bsv_movie_ctl(BSV_MOVIE_CTL_SET_END_EOF, NULL);
             break;
 
+         case RA_OPT_RENDER:
+            render_movie = true;
+            break;
+
+         case RA_OPT_RENDER_FILTER:
+            render_filter = optarg;
+            break;
+
+         case RA_OPT_BENCHMARK:
+            runloop_max_frames  = (unsigned)strtoul(optarg, NULL, 10);
+            benchmark_movie     = true;
+            break;
+
          case RA_OPT_VERSION:
             retroarch_print_version();
             exit(0);
@@ -1128,6 +1178,45 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
          PACKAGE_VERSION, retroarch_git_version);
 #endif
 
+   if (render_movie)
+   {
+      bool *recording_enabled = recording_is_enabled();
+
+      if (!play_movie || !recording_enabled || !*recording_enabled)
+      {
+         RARCH_ERR("--render needs a movie to play (-P) and a file "
+               "to record to (-r).\n");
+         retroarch_fail(1, "retroarch_parse_input()");
+      }
+
+      /* Capture cost during play was only the movie,
+       * the expensive part happens here, unthrottled. */
+      rarch_ctl(RARCH_CTL_SET_HEADLESS, NULL);
+      bsv_movie_ctl(BSV_MOVIE_CTL_SET_END_EOF, NULL);
+      recording_set_offline(true);
+      recording_set_offline_filter(render_filter);
+   }
+   else if (render_filter)
+   {
+      RARCH_ERR("--render-filter only applies to --render.\n");
+      retroarch_fail(1, "retroarch_parse_input()");
+   }
+
+   if (benchmark_movie)
+   {
+      if (!runloop_max_frames)
+      {
+         RARCH_ERR("--benchmark needs a number of frames to run.\n");
+         retroarch_fail(1, "retroarch_parse_input()");
+      }
+
+      /* Run unthrottled on the null drivers. A movie given
+       * with -P is replayed and may end the run early. */
+      rarch_ctl(RARCH_CTL_SET_HEADLESS, NULL);
+      bsv_movie_ctl(BSV_MOVIE_CTL_SET_END_EOF, NULL);
+      benchmark_init(runloop_max_frames);
+   }
+
    if (explicit_menu)
    {
       if (optind < argc)
@@ -1752,6 +1841,8 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
             frame_limit_last_time    = cpu_features_get_time_usec();
             frame_limit_minimum_time = (retro_time_t)roundf(1000000.0f
                   / (av_info->timing.fps * fastforward_ratio));
+
+            video_frame_pacing_reset();
          }
          break;
       case RARCH_CTL_GET_PERFCNT:
@@ -1826,6 +1917,11 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
          break;
       case RARCH_CTL_IS_IDLE:
          return runloop_idle;
+      case RARCH_CTL_IS_HEADLESS:
+         return runloop_headless;
+      case RARCH_CTL_SET_HEADLESS:
+         runloop_headless = true;
+         break;
       case RARCH_CTL_SET_IDLE:
          {
             bool *ptr = (bool*)data;
@@ -1866,6 +1962,7 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
          return runloop_shutdown_initiated;
       case RARCH_CTL_DATA_DEINIT:
          task_queue_deinit();
+         screenshot_deinit();
          break;
       case RARCH_CTL_IS_CORE_OPTION_UPDATED:
          if (!runloop_core_options)
@@ -2622,6 +2719,8 @@ static enum runloop_state runloop_check_state(
          if (runloop_exec)
             runloop_exec = false;
 
+         benchmark_report();
+
          if (runloop_core_shutdown_initiated && settings->bools.load_dummy_on_core_shutdown)
          {
             content_ctx_info_t content_info;
@@ -3258,6 +3357,14 @@ int runloop_iterate(unsigned *sleep_ms)
    settings_t *settings                         = config_get_ptr();
    unsigned max_users                           = *(input_driver_get_uint(INPUT_ACTION_MAX_USERS));
 
+   /* The frontend slept the whole milliseconds of the last
+    * frame limiter wait, spin off what is left of it. */
+   if (frame_limit_spin_target)
+   {
+      video_frame_pacing_spin_until(frame_limit_spin_target);
+      frame_limit_spin_target = 0;
+   }
+
    if (runloop_frame_time.callback)
    {
       /* Updates frame timing if frame timing callback is in use by the core.
@@ -3296,18 +3403,22 @@ int runloop_iterate(unsigned *sleep_ms)
          return -1;
       case RUNLOOP_STATE_POLLED_AND_SLEEP:
          runloop_netplay_pause();
+         performance_counters_idle();
          *sleep_ms = 10;
          return 1;
       case RUNLOOP_STATE_SLEEP:
          retro_ctx.poll_cb();
          runloop_netplay_pause();
+         performance_counters_idle();
          *sleep_ms = 10;
          return 1;
       case RUNLOOP_STATE_END:
          runloop_netplay_pause();
+         performance_counters_idle();
          goto end;
       case RUNLOOP_STATE_MENU_ITERATE:
          runloop_netplay_pause();
+         performance_counters_idle();
          return 0;
       case RUNLOOP_STATE_ITERATE:
          break;
@@ -3334,8 +3445,20 @@ int runloop_iterate(unsigned *sleep_ms)
       input_push_analog_dpad(auto_binds,    dpad_mode);
    }
 
-   if ((settings->uints.video_frame_delay > 0) && !input_nonblock_state)
-      retro_sleep(settings->uints.video_frame_delay);
+   if (!input_nonblock_state && !runloop_headless)
+   {
+      unsigned frame_delay = settings->uints.video_frame_delay;
+
+      if (settings->bools.video_frame_delay_auto)
+         frame_delay = video_frame_pacing_get_auto_delay(
+               settings->floats.video_refresh_rate);
+
+      if (frame_delay > 0)
+         retro_sleep(frame_delay);
+   }
+
+   video_frame_pacing_core_run_begin();
+   benchmark_core_run_begin();
 
 #ifdef HAVE_RUNAHEAD
    /* Run Ahead Feature replaces the call to core_run in this loop */
@@ -3349,6 +3472,10 @@ int runloop_iterate(unsigned *sleep_ms)
 #endif
       core_run();
 
+   benchmark_core_run_end();
+   video_frame_pacing_core_run_end();
+   performance_counters_frame();
+
 #ifdef HAVE_CHEEVOS
    if (runloop_check_cheevos())
       cheevos_test();
@@ -3382,21 +3509,32 @@ int runloop_iterate(unsigned *sleep_ms)
    if (runloop_autosave)
       autosave_unlock();
 
-   if (settings->floats.fastforward_ratio)
+   if (settings->floats.fastforward_ratio && !runloop_headless)
       end:
    {
-      retro_time_t to_sleep_ms  = (
-            (frame_limit_last_time + frame_limit_minimum_time)
-            - cpu_features_get_time_usec()) / 1000;
+      retro_time_t target_time  = frame_limit_last_time
+         + frame_limit_minimum_time;
+      retro_time_t remaining    = target_time
+         - cpu_features_get_time_usec();
+      retro_time_t to_sleep_ms  = remaining / 1000;
 
       if (to_sleep_ms > 0)
       {
          *sleep_ms = (unsigned)to_sleep_ms;
          /* Combat jitter a bit. */
          frame_limit_last_time += frame_limit_minimum_time;
+         if (settings->bools.video_frame_limit_spin)
+            frame_limit_spin_target = target_time;
          return 1;
       }
 
+      if (remaining > 0 && settings->bools.video_frame_limit_spin)
+      {
+         video_frame_pacing_spin_until(target_time);
+         frame_limit_last_time = target_time;
+         return 0;
+      }
+
       frame_limit_last_time  = cpu_features_get_time_usec();
    }
 
@@ -89,6 +89,10 @@ enum rarch_ctl_state
    RARCH_CTL_IS_IDLE,
    RARCH_CTL_SET_IDLE,
 
+   /* Null video, audio and input drivers, no frame throttling. */
+   RARCH_CTL_IS_HEADLESS,
+   RARCH_CTL_SET_HEADLESS,
+
    RARCH_CTL_GET_WINDOWED_SCALE,
    RARCH_CTL_SET_WINDOWED_SCALE,
 
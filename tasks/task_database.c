@@ -17,6 +17,7 @@
 
 #include <compat/strcasestr.h>
 #include <compat/strl.h>
+#include <features/features_cpu.h>
 #include <retro_miscellaneous.h>
 #include <retro_endianness.h>
 #include <string/stdstring.h>
@@ -26,6 +27,9 @@
 #include <streams/file_stream.h>
 #include <streams/chd_stream.h>
 #include <streams/interface_stream.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include "tasks_internal.h"
 
 #include "../core_info.h"
@@ -43,17 +47,31 @@
 #define COLLECTION_SIZE                99999
 #endif
 
+/* Upper bound on hashing workers, and number of files that
+ * may be in flight between the walker and the matcher. */
+#define DATABASE_SCAN_MAX_WORKERS      8
+#define DATABASE_SCAN_QUEUE_SIZE       64
+
+typedef struct database_scan_pipeline database_scan_pipeline_t;
+
 typedef struct database_state_handle
 {
    uint32_t crc;
    uint32_t archive_crc;
    size_t list_index;
-   size_t entry_index;
+   size_t files;
+   uint64_t bytes;
+   retro_time_t start_time;
    uint8_t *buf;
    char archive_name[511];
    char serial[4096];
-   database_info_list_t *info;
+   /* Index of each database in 'list', loaded on first use. */
+   database_index_t **index;
    struct string_list *list;
+   /* Hashing workers, or NULL when files are hashed inline. */
+   database_scan_pipeline_t *pipeline;
+   /* Hashes from previous scans, directory scans only. */
+   database_scan_cache_t *cache;
 } database_state_handle_t;
 
 typedef struct db_handle
@@ -338,14 +356,18 @@ static int task_database_chd_get_serial(const char *name, char* serial)
    return result;
 }
 
-static int intfstream_get_crc(intfstream_t *fd, uint32_t *crc)
+static int intfstream_get_crc(intfstream_t *fd, uint32_t *crc,
+      uint64_t *bytes)
 {
    int64_t read = 0;
    uint32_t acc = 0;
    uint8_t buffer[4096];
 
    while ((read = intfstream_read(fd, buffer, sizeof(buffer))) > 0)
-      acc = encoding_crc32(acc, buffer, (size_t)read);
+   {
+      acc     = encoding_crc32(acc, buffer, (size_t)read);
+      *bytes += (uint64_t)read;
+   }
 
    if (read < 0)
       return 0;
@@ -356,7 +378,7 @@ static int intfstream_get_crc(intfstream_t *fd, uint32_t *crc)
 }
 
 static bool intfstream_file_get_crc(const char *name,
-      uint64_t offset, size_t size, uint32_t *crc)
+      uint64_t offset, size_t size, uint32_t *crc, uint64_t *bytes)
 {
    int rv;
    intfstream_t *fd  = intfstream_open_file(name,
@@ -397,7 +419,7 @@ static bool intfstream_file_get_crc(const char *name,
          goto error;
    }
 
-   rv = intfstream_get_crc(fd, crc);
+   rv = intfstream_get_crc(fd, crc, bytes);
    intfstream_close(fd);
    free(fd);
    free(data);
@@ -414,7 +436,8 @@ error:
    return 0;
 }
 
-static int task_database_cue_get_crc(const char *name, uint32_t *crc)
+static int task_database_cue_get_crc(const char *name, uint32_t *crc,
+      uint64_t *bytes)
 {
    char *track_path = (char *)malloc(PATH_MAX_LENGTH);
    uint64_t offset  = 0;
@@ -439,7 +462,8 @@ static int task_database_cue_get_crc(const char *name, uint32_t *crc)
 
    RARCH_LOG("%s\n", msg_hash_to_str(MSG_READING_FIRST_DATA_TRACK));
 
-   rv = intfstream_file_get_crc(track_path, offset, (size_t)size, crc);
+   rv = intfstream_file_get_crc(track_path, offset, (size_t)size,
+         crc, bytes);
    if (rv == 1)
    {
       RARCH_LOG("CUE '%s' crc: %x\n", name, *crc);
@@ -448,7 +472,8 @@ static int task_database_cue_get_crc(const char *name, uint32_t *crc)
    return rv;
 }
 
-static int task_database_gdi_get_crc(const char *name, uint32_t *crc)
+static int task_database_gdi_get_crc(const char *name, uint32_t *crc,
+      uint64_t *bytes)
 {
    char *track_path = (char *)malloc(PATH_MAX_LENGTH);
    int rv           = 0;
@@ -469,7 +494,7 @@ static int task_database_gdi_get_crc(const char *name, uint32_t *crc)
 
    RARCH_LOG("%s\n", msg_hash_to_str(MSG_READING_FIRST_DATA_TRACK));
 
-   rv = intfstream_file_get_crc(track_path, 0, SIZE_MAX, crc);
+   rv = intfstream_file_get_crc(track_path, 0, SIZE_MAX, crc, bytes);
    if (rv == 1)
    {
       RARCH_LOG("GDI '%s' crc: %x\n", name, *crc);
@@ -478,7 +503,8 @@ static int task_database_gdi_get_crc(const char *name, uint32_t *crc)
    return rv;
 }
 
-static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
+static bool task_database_chd_get_crc(const char *name, uint32_t *crc,
+      uint64_t *bytes)
 {
    int rv;
    intfstream_t *fd = intfstream_open_chd_track(
@@ -489,7 +515,7 @@ static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
    if (!fd)
       return 0;
 
-   rv = intfstream_get_crc(fd, crc);
+   rv = intfstream_get_crc(fd, crc, bytes);
    if (rv == 1)
    {
       RARCH_LOG("CHD '%s' crc: %x\n", name, *crc);
@@ -502,29 +528,39 @@ static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
    return rv;
 }
 
-static void task_database_cue_prune(database_info_handle_t *db,
-      const char *name)
+/**
+ * task_database_sheet_files:
+ * @name               : path to a .cue or .gdi file.
+ * @type               : FILE_TYPE_CUE or FILE_TYPE_GDI.
+ *
+ * Reads the track files referenced by a cue or gdi sheet.
+ *
+ * Returns: list of referenced paths, or NULL.
+ **/
+static struct string_list *task_database_sheet_files(const char *name,
+      enum msg_file_type type)
 {
-   size_t i;
-   char       *path = (char *)malloc(PATH_MAX_LENGTH + 1);
-   intfstream_t *fd = intfstream_open_file(name,
+   union string_list_elem_attr attr;
+   struct string_list *files = NULL;
+   char       *path          = (char *)malloc(PATH_MAX_LENGTH + 1);
+   intfstream_t *fd          = intfstream_open_file(name,
          RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-   if (!fd)
+   attr.i = 0;
+
+   if (!fd || !path || !(files = string_list_new()))
       goto end;
 
-   while (cue_next_file(fd, name, path, PATH_MAX_LENGTH))
+   for (;;)
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
-      {
-         if (db->list->elems[i].data
-               && !strcmp(path, db->list->elems[i].data))
-         {
-            RARCH_LOG("Pruning file referenced by cue: %s\n", path);
-            free(db->list->elems[i].data);
-            db->list->elems[i].data = NULL;
-         }
-      }
+      bool found = (type == FILE_TYPE_CUE)
+         ? cue_next_file(fd, name, path, PATH_MAX_LENGTH)
+         : gdi_next_file(fd, name, path, PATH_MAX_LENGTH);
+
+      if (!found)
+         break;
+
+      string_list_append(files, path, attr);
    }
 
 end:
@@ -534,34 +570,54 @@ end:
       free(fd);
    }
    free(path);
+   return files;
 }
 
-static void gdi_prune(database_info_handle_t *db, const char *name)
+/**
+ * task_database_prune_files:
+ * @list               : content list being scanned.
+ * @start              : first index of @list to prune.
+ * @files              : paths to drop, from task_database_sheet_files.
+ * @type               : FILE_TYPE_CUE or FILE_TYPE_GDI.
+ *
+ * Drops the tracks of a sheet from the scan, so they
+ * are only matched through the sheet itself.
+ **/
+static void task_database_prune_files(struct string_list *list,
+      size_t start, const struct string_list *files,
+      enum msg_file_type type)
 {
-   size_t i;
-   char       *path = (char *)malloc(PATH_MAX_LENGTH + 1);
-   intfstream_t *fd = intfstream_open_file(name,
-         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   size_t i, j;
 
-   if (!fd)
-      goto end;
+   if (!files)
+      return;
 
-   while (gdi_next_file(fd, name, path, PATH_MAX_LENGTH))
+   for (j = 0; j < files->size; j++)
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < list->size; ++i)
       {
-         if (db->list->elems[i].data && !strcmp(path, db->list->elems[i].data))
+         if (list->elems[i].data
+               && !strcmp(files->elems[j].data, list->elems[i].data))
          {
-            RARCH_LOG("Pruning file referenced by gdi: %s\n", path);
-            free(db->list->elems[i].data);
-            db->list->elems[i].data = NULL;
+            RARCH_LOG("Pruning file referenced by %s: %s\n",
+                  type == FILE_TYPE_CUE ? "cue" : "gdi",
+                  files->elems[j].data);
+            free(list->elems[i].data);
+            list->elems[i].data = NULL;
          }
       }
    }
+}
 
-end:
-   free(fd);
-   free(path);
+static void task_database_sheet_prune(struct string_list *list,
+      size_t start, const char *name, enum msg_file_type type)
+{
+   struct string_list *files = task_database_sheet_files(name, type);
+
+   task_database_prune_files(list, start, files, type);
+
+   if (files)
+      string_list_free(files);
 }
 
 static enum msg_file_type extension_to_file_type(const char *ext)
@@ -608,73 +664,542 @@ static enum msg_file_type extension_to_file_type(const char *ext)
    return FILE_TYPE_NONE;
 }
 
-static int task_database_iterate_playlist(
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+/**
+ * task_database_get_hash:
+ * @name                 : path of the content file.
+ * @type                 : lookup to perform with the result.
+ * @crc                  : CRC32 of the content.
+ * @archive_crc          : CRC32 of the archive itself, if compressed.
+ * @serial               : disc serial, at least 4096 bytes.
+ * @bytes                : incremented by the number of bytes hashed.
+ *
+ * Reads a content file and extracts whatever the database lookup
+ * needs - a serial for disc images that carry one, a CRC32 for
+ * everything else. Touches nothing but its arguments, so it may run
+ * on a hashing worker.
+ *
+ * Returns: 0 if the file should be skipped, otherwise 1.
+ **/
+static int task_database_get_hash(const char *name,
+      enum database_type *type, uint32_t *crc, uint32_t *archive_crc,
+      char *serial, uint64_t *bytes)
 {
    switch (extension_to_file_type(path_get_extension(name)))
    {
       case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
+         *type = DATABASE_TYPE_CRC_LOOKUP;
          /* first check crc of archive itself */
          return intfstream_file_get_crc(name,
-               0, SIZE_MAX, &db_state->archive_crc);
+               0, SIZE_MAX, archive_crc, bytes);
 #else
          break;
 #endif
       case FILE_TYPE_CUE:
-         task_database_cue_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_cue_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         serial[0] = '\0';
+         if (task_database_cue_get_serial(name, serial))
+            *type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_cue_get_crc(name, &db_state->crc);
+            *type = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_cue_get_crc(name, crc, bytes);
          }
          break;
       case FILE_TYPE_GDI:
-         gdi_prune(db, name);
-         db_state->serial[0] = '\0';
+         serial[0] = '\0';
          /* There are no serial databases, so don't bother with
             serials at the moment */
-         if (0 && task_database_gdi_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (0 && task_database_gdi_get_serial(name, serial))
+            *type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_gdi_get_crc(name, &db_state->crc);
+            *type = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_gdi_get_crc(name, crc, bytes);
          }
          break;
       /* Consider Wii WBFS files similar to ISO files. */
       case FILE_TYPE_WBFS:
       case FILE_TYPE_ISO:
-         db_state->serial[0] = '\0';
-         intfstream_file_get_serial(name, 0, SIZE_MAX, db_state->serial);
-         database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         serial[0] = '\0';
+         intfstream_file_get_serial(name, 0, SIZE_MAX, serial);
+         *type = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_CHD:
-         db_state->serial[0] = '\0';
-         if (task_database_chd_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         serial[0] = '\0';
+         if (task_database_chd_get_serial(name, serial))
+            *type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_chd_get_crc(name, &db_state->crc);
+            *type = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_chd_get_crc(name, crc, bytes);
          }
          break;
       case FILE_TYPE_LUTRO:
-         database_info_set_type(db, DATABASE_TYPE_ITERATE_LUTRO);
+         *type = DATABASE_TYPE_ITERATE_LUTRO;
          break;
       default:
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         return intfstream_file_get_crc(name, 0, SIZE_MAX, &db_state->crc);
+         *type = DATABASE_TYPE_CRC_LOOKUP;
+         return intfstream_file_get_crc(name, 0, SIZE_MAX, crc, bytes);
    }
 
    return 1;
 }
 
+/* The hash of a cue or gdi sheet comes from the tracks it
+ * references, so their sizes and times are folded in as well. */
+static bool task_database_get_content_stat(const char *name,
+      int64_t *size, int64_t *mtime)
+{
+   bool ret          = true;
+   char *path        = NULL;
+   intfstream_t *fd  = NULL;
+   enum msg_file_type type;
+
+   if (path_contains_compressed_file(name)
+         || !path_get_size_mtime(name, size, mtime))
+      return false;
+
+   type = extension_to_file_type(path_get_extension(name));
+
+   if (type != FILE_TYPE_CUE && type != FILE_TYPE_GDI)
+      return true;
+
+   if (!(fd = intfstream_open_file(name,
+               RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   path = (char*)malloc(PATH_MAX_LENGTH + 1);
+
+   while (type == FILE_TYPE_CUE
+         ? cue_next_file(fd, name, path, PATH_MAX_LENGTH)
+         : gdi_next_file(fd, name, path, PATH_MAX_LENGTH))
+   {
+      int64_t track_size  = 0;
+      int64_t track_mtime = 0;
+
+      if (!path_get_size_mtime(path, &track_size, &track_mtime))
+      {
+         ret = false;
+         break;
+      }
+
+      *size += track_size;
+      if (track_mtime > *mtime)
+         *mtime = track_mtime;
+   }
+
+   intfstream_close(fd);
+   free(fd);
+   free(path);
+   return ret;
+}
+
+/**
+ * task_database_get_hash_cached:
+ * @cache                : scan cache, may be NULL.
+ *
+ * As task_database_get_hash(), but skips reading files whose
+ * size and modification time match the scan cache, and records
+ * the hash of those it had to read.
+ **/
+static int task_database_get_hash_cached(database_scan_cache_t *cache,
+      const char *name, enum database_type *type, uint32_t *crc,
+      uint32_t *archive_crc, char *serial, uint64_t *bytes)
+{
+   int ret;
+   int64_t size  = 0;
+   int64_t mtime = 0;
+
+   if (!cache || !task_database_get_content_stat(name, &size, &mtime))
+      return task_database_get_hash(name, type, crc, archive_crc,
+            serial, bytes);
+
+   if (database_scan_cache_find(cache, name, size, mtime,
+            type, crc, archive_crc, serial, 4096))
+      return 1;
+
+   if ((ret = task_database_get_hash(name, type, crc, archive_crc,
+               serial, bytes)))
+      database_scan_cache_update(cache, name, size, mtime,
+            *type, *crc, *archive_crc, serial);
+
+   return ret;
+}
+
+static int task_database_iterate_playlist(
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name)
+{
+   int ret;
+   enum database_type type = database_info_get_type(db);
+
+   switch (extension_to_file_type(path_get_extension(name)))
+   {
+      case FILE_TYPE_CUE:
+      case FILE_TYPE_GDI:
+         task_database_sheet_prune(db->list, db->list_ptr, name,
+               extension_to_file_type(path_get_extension(name)));
+         break;
+      default:
+         break;
+   }
+
+   ret = task_database_get_hash_cached(db_state->cache, name, &type,
+         &db_state->crc, &db_state->archive_crc, db_state->serial,
+         &db_state->bytes);
+   database_info_set_type(db, type);
+   db_state->files++;
+
+   return ret;
+}
+
+#ifdef HAVE_THREADS
+/* A directory scan is split in three stages so that file I/O
+ * overlaps: a walker feeds content paths into a bounded ring,
+ * hashing workers compute CRCs and serials for them, and the task
+ * handler consumes the results in walk order to match them against
+ * the databases and write the playlists. */
+
+typedef struct database_scan_slot
+{
+   bool ready;
+   int ret;
+   enum database_type type;
+   uint32_t crc;
+   uint32_t archive_crc;
+   size_t list_ptr;
+   char *path;
+   char serial[4096];
+} database_scan_slot_t;
+
+struct database_scan_pipeline
+{
+   bool quit;
+   bool walk_done;
+   unsigned num_workers;
+   /* Ring sequence numbers: 'head' is the next slot the matcher
+    * consumes, 'hash' the next one a worker picks up and 'tail'
+    * the next one the walker fills. */
+   size_t head;
+   size_t hash;
+   size_t tail;
+   size_t walk_ptr;
+   uint64_t bytes;
+   struct string_list *list;
+   database_scan_cache_t *cache;
+   slock_t *lock;
+   scond_t *walker_cond;
+   scond_t *worker_cond;
+   scond_t *matcher_cond;
+   sthread_t *walker;
+   sthread_t *workers[DATABASE_SCAN_MAX_WORKERS];
+   database_scan_slot_t slots[DATABASE_SCAN_QUEUE_SIZE];
+};
+
+static void database_scan_walker_thread(void *data)
+{
+   database_scan_pipeline_t *pipe = (database_scan_pipeline_t*)data;
+
+   slock_lock(pipe->lock);
+
+   while (!pipe->quit)
+   {
+      enum msg_file_type type;
+      database_scan_slot_t *slot = NULL;
+      char *path                 = NULL;
+      size_t list_ptr            = pipe->walk_ptr;
+
+      if (pipe->tail - pipe->head >= DATABASE_SCAN_QUEUE_SIZE)
+      {
+         scond_wait(pipe->walker_cond, pipe->lock);
+         continue;
+      }
+
+      if (list_ptr >= pipe->list->size)
+      {
+         /* Archives that fail to match get their contents
+          * appended to the list by the matcher, so the walk
+          * is only over once every file has been consumed. */
+         if (pipe->head == pipe->tail)
+            break;
+         scond_wait(pipe->walker_cond, pipe->lock);
+         continue;
+      }
+
+      pipe->walk_ptr++;
+
+      if (!pipe->list->elems[list_ptr].data)
+         continue;
+
+      /* The matcher may grow the list while the lock is
+       * dropped, so work on a copy of the path. */
+      path = strdup(pipe->list->elems[list_ptr].data);
+      type = path_contains_compressed_file(path)
+         ? FILE_TYPE_NONE
+         : extension_to_file_type(path_get_extension(path));
+
+      if (type == FILE_TYPE_CUE || type == FILE_TYPE_GDI)
+      {
+         /* Reading the sheet can be slow, don't hold up
+          * the workers and the matcher meanwhile. */
+         struct string_list *files = NULL;
+
+         slock_unlock(pipe->lock);
+         files = task_database_sheet_files(path, type);
+         slock_lock(pipe->lock);
+
+         task_database_prune_files(pipe->list, list_ptr, files, type);
+
+         if (files)
+            string_list_free(files);
+      }
+
+      /* Only the walker fills the ring, so the slot
+       * checked for above is still free. */
+      slot           = &pipe->slots[pipe->tail % DATABASE_SCAN_QUEUE_SIZE];
+      slot->ready    = false;
+      slot->list_ptr = list_ptr;
+      slot->path     = path;
+      pipe->tail++;
+
+      scond_signal(pipe->worker_cond);
+   }
+
+   pipe->walk_done = true;
+   scond_broadcast(pipe->worker_cond);
+   scond_signal(pipe->matcher_cond);
+   slock_unlock(pipe->lock);
+}
+
+static void database_scan_worker_thread(void *data)
+{
+   database_scan_pipeline_t *pipe = (database_scan_pipeline_t*)data;
+
+   slock_lock(pipe->lock);
+
+   while (!pipe->quit)
+   {
+      uint64_t bytes             = 0;
+      database_scan_slot_t *slot = NULL;
+
+      if (pipe->hash == pipe->tail)
+      {
+         if (pipe->walk_done)
+            break;
+         scond_wait(pipe->worker_cond, pipe->lock);
+         continue;
+      }
+
+      slot = &pipe->slots[pipe->hash++ % DATABASE_SCAN_QUEUE_SIZE];
+      slock_unlock(pipe->lock);
+
+      slot->type        = DATABASE_TYPE_ITERATE;
+      slot->crc         = 0;
+      slot->archive_crc = 0;
+      slot->serial[0]   = '\0';
+
+      if (path_contains_compressed_file(slot->path))
+      {
+#ifdef HAVE_COMPRESSION
+         slot->type = DATABASE_TYPE_CRC_LOOKUP;
+         slot->crc  = file_archive_get_file_crc32(slot->path);
+#endif
+         slot->ret  = slot->crc != 0;
+      }
+      else
+         slot->ret  = task_database_get_hash_cached(pipe->cache,
+               slot->path, &slot->type, &slot->crc, &slot->archive_crc,
+               slot->serial, &bytes);
+
+      slock_lock(pipe->lock);
+      slot->ready  = true;
+      pipe->bytes += bytes;
+      scond_signal(pipe->matcher_cond);
+   }
+
+   slock_unlock(pipe->lock);
+}
+
+static void database_scan_pipeline_free(database_scan_pipeline_t *pipe)
+{
+   unsigned i;
+
+   if (!pipe)
+      return;
+
+   if (pipe->lock)
+   {
+      slock_lock(pipe->lock);
+      pipe->quit = true;
+      if (pipe->walker_cond)
+         scond_broadcast(pipe->walker_cond);
+      if (pipe->worker_cond)
+         scond_broadcast(pipe->worker_cond);
+      slock_unlock(pipe->lock);
+   }
+
+   if (pipe->walker)
+      sthread_join(pipe->walker);
+   for (i = 0; i < pipe->num_workers; i++)
+      sthread_join(pipe->workers[i]);
+
+   for (i = 0; i < DATABASE_SCAN_QUEUE_SIZE; i++)
+      free(pipe->slots[i].path);
+
+   if (pipe->matcher_cond)
+      scond_free(pipe->matcher_cond);
+   if (pipe->worker_cond)
+      scond_free(pipe->worker_cond);
+   if (pipe->walker_cond)
+      scond_free(pipe->walker_cond);
+   if (pipe->lock)
+      slock_free(pipe->lock);
+   free(pipe);
+}
+
+/**
+ * database_scan_pipeline_new:
+ * @list                 : content files to scan. The matcher may
+ *                         append to it while the pipeline runs, under
+ *                         database_scan_pipeline_lock().
+ * @cache                : scan cache to consult and update, may be NULL.
+ *
+ * Starts a walker and one hashing worker per core, up to
+ * DATABASE_SCAN_MAX_WORKERS.
+ *
+ * Returns: the pipeline, or NULL if threads could not be created.
+ **/
+static database_scan_pipeline_t *database_scan_pipeline_new(
+      struct string_list *list, database_scan_cache_t *cache)
+{
+   unsigned i;
+   unsigned num_workers           = cpu_features_get_core_amount();
+   database_scan_pipeline_t *pipe = (database_scan_pipeline_t*)
+      calloc(1, sizeof(*pipe));
+
+   if (!pipe)
+      return NULL;
+
+   if (num_workers < 2)
+      num_workers = 2;
+   if (num_workers > DATABASE_SCAN_MAX_WORKERS)
+      num_workers = DATABASE_SCAN_MAX_WORKERS;
+
+   pipe->list         = list;
+   pipe->cache        = cache;
+   pipe->lock         = slock_new();
+   pipe->walker_cond  = scond_new();
+   pipe->worker_cond  = scond_new();
+   pipe->matcher_cond = scond_new();
+
+   if (!pipe->lock || !pipe->walker_cond
+         || !pipe->worker_cond || !pipe->matcher_cond)
+      goto error;
+
+   if (!(pipe->walker = sthread_create(database_scan_walker_thread, pipe)))
+      goto error;
+
+   for (i = 0; i < num_workers; i++)
+   {
+      if (!(pipe->workers[i] = sthread_create(
+                  database_scan_worker_thread, pipe)))
+         goto error;
+      pipe->num_workers++;
+   }
+
+   RARCH_LOG("Scanning with %u hashing workers.\n", num_workers);
+
+   return pipe;
+
+error:
+   database_scan_pipeline_free(pipe);
+   return NULL;
+}
+
+static void database_scan_pipeline_lock(database_scan_pipeline_t *pipe)
+{
+   if (pipe)
+      slock_lock(pipe->lock);
+}
+
+static void database_scan_pipeline_unlock(database_scan_pipeline_t *pipe)
+{
+   if (pipe)
+      slock_unlock(pipe->lock);
+}
+
+/**
+ * database_scan_pipeline_next:
+ * @pipe                 : scan pipeline.
+ * @db                   : content list handle, its list_ptr and type
+ *                         are set from the result.
+ * @db_state             : receives the CRCs / serial of the result.
+ *
+ * Takes the next hashed file, in walk order. Only blocks for a
+ * short while when the task queue runs on its own thread, so a
+ * scan never stalls the main loop.
+ *
+ * Returns: 1 if a file is ready, 2 if it is ready but could not be
+ * read and should be skipped, 0 if the caller should try again
+ * later, -1 once every file has been consumed.
+ **/
+static int database_scan_pipeline_next(database_scan_pipeline_t *pipe,
+      database_info_handle_t *db, database_state_handle_t *db_state)
+{
+   int ret                    = 1;
+   database_scan_slot_t *slot = NULL;
+
+   slock_lock(pipe->lock);
+
+   slot = &pipe->slots[pipe->head % DATABASE_SCAN_QUEUE_SIZE];
+
+   if (pipe->walk_done && pipe->head == pipe->tail)
+      ret = -1;
+   else if (pipe->head == pipe->tail || !slot->ready)
+   {
+      if (task_queue_is_threaded())
+         scond_wait_timeout(pipe->matcher_cond, pipe->lock, 100000);
+      ret = 0;
+   }
+
+   db_state->bytes = pipe->bytes;
+
+   slock_unlock(pipe->lock);
+
+   if (ret != 1)
+      return ret;
+
+   db->list_ptr          = slot->list_ptr;
+   db->type              = slot->type;
+   db_state->crc         = slot->crc;
+   db_state->archive_crc = slot->archive_crc;
+   strlcpy(db_state->serial, slot->serial, sizeof(db_state->serial));
+   db_state->files++;
+
+   return slot->ret ? 1 : 2;
+}
+
+/**
+ * database_scan_pipeline_release:
+ * @pipe                 : scan pipeline.
+ *
+ * Hands the slot taken by database_scan_pipeline_next() back to the
+ * walker, once the file has been matched.
+ **/
+static void database_scan_pipeline_release(database_scan_pipeline_t *pipe)
+{
+   database_scan_slot_t *slot = NULL;
+
+   slock_lock(pipe->lock);
+   slot       = &pipe->slots[pipe->head % DATABASE_SCAN_QUEUE_SIZE];
+   free(slot->path);
+   slot->path = NULL;
+   pipe->head++;
+   scond_signal(pipe->walker_cond);
+   slock_unlock(pipe->lock);
+}
+#endif
+
 static int database_info_list_iterate_end_no_match(
       database_info_handle_t *db,
       database_state_handle_t *db_state,
@@ -715,8 +1240,14 @@ static int database_info_list_iterate_end_no_match(
                   path_size - path_len);
             }
 
+#ifdef HAVE_THREADS
+            database_scan_pipeline_lock(db_state->pipeline);
+#endif
             string_list_append(db->list, new_path,
                archive_list->elems[i].attr);
+#ifdef HAVE_THREADS
+            database_scan_pipeline_unlock(db_state->pipeline);
+#endif
 
             free(new_path);
          }
@@ -726,7 +1257,6 @@ static int database_info_list_iterate_end_no_match(
    }
 
    db_state->list_index  = 0;
-   db_state->entry_index = 0;
 
    if (db_state->crc != 0)
       db_state->crc = 0;
@@ -743,28 +1273,34 @@ static int task_database_iterate_next(database_info_handle_t *db)
    return -1;
 }
 
-static int database_info_list_iterate_new(database_state_handle_t *db_state,
-      const char *query)
+static database_index_t *task_database_get_index(
+      database_state_handle_t *db_state)
 {
-   const char *new_database = database_info_get_current_name(db_state);
+   database_index_t *index  = db_state->index[db_state->list_index];
+   const char *new_database = NULL;
+
+   if (index)
+      return index;
+
+   new_database = database_info_get_current_name(db_state);
 
 #ifndef RARCH_INTERNAL
    fprintf(stderr, "Check database [%d/%d] : %s\n", (unsigned)db_state->list_index,
          (unsigned)db_state->list->size, new_database);
 #endif
-   if (db_state->info)
-   {
-      database_info_list_free(db_state->info);
-      free(db_state->info);
-   }
-   db_state->info = database_info_list_new(new_database, query);
-   return 0;
+
+   if (!(index = database_index_new(new_database)))
+      RARCH_WARN("Could not read database \"%s\".\n", new_database);
+
+   db_state->index[db_state->list_index] = index;
+   return index;
 }
 
 static int database_info_list_iterate_found_match(
       db_handle_t *_db,
       database_state_handle_t *db_state,
       database_info_handle_t *db,
+      const database_info_t *db_info_entry,
       const char *archive_name
       )
 {
@@ -777,8 +1313,6 @@ static int database_info_list_iterate_found_match(
       database_info_get_current_name(db_state);
    const char         *entry_path =
       database_info_get_current_element_name(db);
-   database_info_t *db_info_entry =
-      &db_state->info->list[db_state->entry_index];
    char *hash;
 
    db_crc[0]                      = '\0';
@@ -851,10 +1385,6 @@ static int database_info_list_iterate_found_match(
    playlist_write_file(playlist);
    playlist_free(playlist);
 
-   database_info_list_free(db_state->info);
-   free(db_state->info);
-
-   db_state->info = NULL;
    db_state->crc  = 0;
 
    free(entry_path_str);
@@ -867,31 +1397,20 @@ static int database_info_list_iterate_found_match(
    if (db_state->list_index != 0)
    {
       struct string_list_elem entry = db_state->list->elems[db_state->list_index];
+      database_index_t *index       = db_state->index[db_state->list_index];
       memmove(&db_state->list->elems[1],
               &db_state->list->elems[0],
               sizeof(entry) * db_state->list_index);
+      memmove(&db_state->index[1],
+              &db_state->index[0],
+              sizeof(index) * db_state->list_index);
       db_state->list->elems[0] = entry;
+      db_state->index[0]       = index;
    }
 
    return 0;
 }
 
-/* End of entries in database info list and didn't find a
- * match, go to the next database. */
-static int database_info_list_iterate_next(
-      database_state_handle_t *db_state
-      )
-{
-   db_state->list_index++;
-   db_state->entry_index = 0;
-
-   database_info_list_free(db_state->info);
-   free(db_state->info);
-   db_state->info        = NULL;
-
-   return 1;
-}
-
 static int task_database_iterate_crc_lookup(
       db_handle_t *_db,
       database_state_handle_t *db_state,
@@ -899,73 +1418,43 @@ static int task_database_iterate_crc_lookup(
       const char *name,
       const char *archive_entry)
 {
+   database_index_t *index              = NULL;
+   const database_info_t *db_info_entry = NULL;
 
    if (!db_state->list ||
          (unsigned)db_state->list_index == (unsigned)db_state->list->size)
       return database_info_list_iterate_end_no_match(db, db_state, name);
 
-   if (db_state->entry_index == 0)
+   /* don't scan files that can't be in this database */
+   if (!(path_contains_compressed_file(name) &&
+      core_info_database_match_archive_member(
+      db_state->list->elems[db_state->list_index].data)) &&
+       !core_info_database_supports_content_path(
+      db_state->list->elems[db_state->list_index].data, name))
    {
-      char query[50];
-
-      query[0] = '\0';
-
-      /* don't scan files that can't be in this database */
-      if (!(path_contains_compressed_file(name) &&
-         core_info_database_match_archive_member(
-         db_state->list->elems[db_state->list_index].data)) &&
-          !core_info_database_supports_content_path(
-         db_state->list->elems[db_state->list_index].data, name))
-         return database_info_list_iterate_next(db_state);
-
-      snprintf(query, sizeof(query),
-            "{crc:or(b\"%08X\",b\"%08X\")}",
-            db_state->crc, db_state->archive_crc);
-
-      database_info_list_iterate_new(db_state, query);
+      db_state->list_index++;
+      return 1;
    }
 
-   if (db_state->info)
+   if ((index = task_database_get_index(db_state)))
    {
-      database_info_t *db_info_entry =
-         &db_state->info->list[db_state->entry_index];
-
-      if (db_info_entry && db_info_entry->crc32)
-      {
 #if 0
-         RARCH_LOG("CRC32: 0x%08X , entry CRC32: 0x%08X (%s).\n",
-               db_state->crc, db_info_entry->crc32, db_info_entry->name);
+      RARCH_LOG("CRC32: 0x%08X, archive CRC32: 0x%08X.\n",
+            db_state->crc, db_state->archive_crc);
 #endif
-         if (db_state->archive_crc == db_info_entry->crc32)
-            return database_info_list_iterate_found_match(
-                  _db,
-                  db_state, db, NULL);
-         if (db_state->crc == db_info_entry->crc32)
-            return database_info_list_iterate_found_match(
-                  _db,
-                  db_state, db, archive_entry);
-      }
-   }
-
-   db_state->entry_index++;
-
-   if (db_state->info)
-   {
-      if (db_state->entry_index >= db_state->info->count)
-         return database_info_list_iterate_next(db_state);
+      if ((db_info_entry = database_index_find_crc(index,
+                  db_state->archive_crc)))
+         return database_info_list_iterate_found_match(
+               _db, db_state, db, db_info_entry, NULL);
+      if ((db_info_entry = database_index_find_crc(index,
+                  db_state->crc)))
+         return database_info_list_iterate_found_match(
+               _db, db_state, db, db_info_entry, archive_entry);
    }
 
-   /* If we haven't reached the end of the database list yet,
-    * continue iterating. */
-   if (db_state->list_index < db_state->list->size)
-      return 1;
-
-   database_info_list_free(db_state->info);
-
-   if (db_state->info)
-      free(db_state->info);
-
-   return 0;
+   /* No match, go to the next database. */
+   db_state->list_index++;
+   return 1;
 }
 
 static int task_database_iterate_playlist_archive(
@@ -1037,61 +1526,27 @@ static int task_database_iterate_serial_lookup(
       database_state_handle_t *db_state,
       database_info_handle_t *db, const char *name)
 {
+   database_index_t *index              = NULL;
+   const database_info_t *db_info_entry = NULL;
+
    if (!db_state->list ||
          (unsigned)db_state->list_index == (unsigned)db_state->list->size)
       return database_info_list_iterate_end_no_match(db, db_state, name);
 
-   if (db_state->entry_index == 0)
-   {
-      char query[50];
-      char *serial_buf =
-         bin_to_hex_alloc((uint8_t*)db_state->serial, strlen(db_state->serial) * sizeof(uint8_t));
-
-      if (!serial_buf)
-         return 1;
-
-      query[0] = '\0';
-
-      snprintf(query, sizeof(query), "{'serial': b'%s'}", serial_buf);
-      database_info_list_iterate_new(db_state, query);
-
-      free(serial_buf);
-   }
-
-   if (db_state->info)
+   if ((index = task_database_get_index(db_state)))
    {
-      database_info_t *db_info_entry = &db_state->info->list[
-         db_state->entry_index];
-
-      if (db_info_entry && db_info_entry->serial)
-      {
 #if 0
-         RARCH_LOG("serial: %s , entry serial: %s (%s).\n",
-                   db_state->serial, db_info_entry->serial,
-                   db_info_entry->name);
+      RARCH_LOG("serial: %s.\n", db_state->serial);
 #endif
-         if (string_is_equal(db_state->serial, db_info_entry->serial))
-            return database_info_list_iterate_found_match(_db,
-                  db_state, db, NULL);
-      }
-   }
-
-   db_state->entry_index++;
-
-   if (db_state->info)
-   {
-      if (db_state->entry_index >= db_state->info->count)
-         return database_info_list_iterate_next(db_state);
+      if ((db_info_entry = database_index_find_serial(index,
+                  db_state->serial)))
+         return database_info_list_iterate_found_match(_db,
+               db_state, db, db_info_entry, NULL);
    }
 
-   /* If we haven't reached the end of the database list yet,
-    * continue iterating. */
-   if (db_state->list_index < db_state->list->size)
-      return 1;
-
-   database_info_list_free(db_state->info);
-   free(db_state->info);
-   return 0;
+   /* No match, go to the next database. */
+   db_state->list_index++;
+   return 1;
 }
 
 static int task_database_iterate(
@@ -1139,6 +1594,38 @@ static void task_database_cleanup_state(
    db_state->buf = NULL;
 }
 
+static void task_database_scan_finished(db_handle_t *db)
+{
+   const char *msg                   = NULL;
+   database_state_handle_t *db_state = &db->state;
+   retro_time_t elapsed              = cpu_features_get_time_usec()
+      - db_state->start_time;
+
+   if (elapsed <= 0)
+      elapsed = 1;
+
+   if (db->is_directory)
+      database_scan_cache_prune(db_state->cache, db->fullpath);
+
+   RARCH_LOG("Scanned %u files, %.1f MB in %.2f s (%.1f MB/s).\n",
+         (unsigned)db_state->files,
+         db_state->bytes / (1024.0 * 1024.0),
+         elapsed / 1000000.0,
+         (db_state->bytes / (1024.0 * 1024.0))
+         / (elapsed / 1000000.0));
+
+   if (db->is_directory)
+      msg = msg_hash_to_str(MSG_SCANNING_OF_DIRECTORY_FINISHED);
+   else
+      msg = msg_hash_to_str(MSG_SCANNING_OF_FILE_FINISHED);
+#ifdef RARCH_INTERNAL
+   runloop_msg_queue_push(msg, 0, 180, true);
+#else
+   fprintf(stderr, "msg: %s\n", msg);
+#endif
+   ui_companion_driver_notify_refresh();
+}
+
 static void task_database_handler(retro_task_t *task)
 {
    const char *name                 = NULL;
@@ -1230,13 +1717,61 @@ static void task_database_handler(retro_task_t *task)
                }
             }
          }
+         if (dbstate && dbstate->list && !dbstate->index)
+            dbstate->index = (database_index_t**)calloc(
+                  dbstate->list->size, sizeof(*dbstate->index));
+         if (dbstate && !dbstate->index && dbstate->list)
+         {
+            dir_list_free(dbstate->list);
+            dbstate->list = NULL;
+         }
+         if (db->is_directory && !string_is_empty(db->playlist_directory))
+         {
+            char *cache_path = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+
+            fill_pathname_join(cache_path, db->playlist_directory,
+                  file_path_str(FILE_PATH_CONTENT_SCAN_CACHE),
+                  PATH_MAX_LENGTH * sizeof(char));
+            dbstate->cache = database_scan_cache_new(cache_path);
+            free(cache_path);
+         }
+         dbstate->start_time = cpu_features_get_time_usec();
+#ifdef HAVE_THREADS
+         if (db->is_directory && dbinfo->list && dbinfo->list->size > 1)
+            dbstate->pipeline = database_scan_pipeline_new(dbinfo->list,
+                  dbstate->cache);
+#endif
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
+#ifdef HAVE_THREADS
+         if (dbstate->pipeline)
+         {
+            switch (database_scan_pipeline_next(dbstate->pipeline,
+                     dbinfo, dbstate))
+            {
+               case -1:
+                  task_database_scan_finished(db);
+                  goto task_finished;
+               case 0:
+                  return;
+               case 2:
+                  dbinfo->status = DATABASE_STATUS_ITERATE_NEXT;
+                  return;
+               default:
+                  break;
+            }
+
+            task_database_cleanup_state(dbstate);
+            dbstate->list_index = 0;
+            task_database_iterate_start(dbinfo,
+                  database_info_get_current_element_name(dbinfo));
+            break;
+         }
+#endif
          name = database_info_get_current_element_name(dbinfo);
          task_database_cleanup_state(dbstate);
          dbstate->list_index  = 0;
-         dbstate->entry_index = 0;
          task_database_iterate_start(dbinfo, name);
          break;
       case DATABASE_STATUS_ITERATE:
@@ -1247,6 +1782,15 @@ static void task_database_handler(retro_task_t *task)
          }
          break;
       case DATABASE_STATUS_ITERATE_NEXT:
+#ifdef HAVE_THREADS
+         if (dbstate->pipeline)
+         {
+            database_scan_pipeline_release(dbstate->pipeline);
+            dbinfo->status = DATABASE_STATUS_ITERATE_START;
+            dbinfo->type   = DATABASE_TYPE_ITERATE;
+            break;
+         }
+#endif
          if (task_database_iterate_next(dbinfo) == 0)
          {
             dbinfo->status = DATABASE_STATUS_ITERATE_START;
@@ -1254,17 +1798,7 @@ static void task_database_handler(retro_task_t *task)
          }
          else
          {
-            const char *msg = NULL;
-            if (db->is_directory)
-               msg = msg_hash_to_str(MSG_SCANNING_OF_DIRECTORY_FINISHED);
-            else
-               msg = msg_hash_to_str(MSG_SCANNING_OF_FILE_FINISHED);
-#ifdef RARCH_INTERNAL
-            runloop_msg_queue_push(msg, 0, 180, true);
-#else
-            fprintf(stderr, "msg: %s\n", msg);
-#endif
-            ui_companion_driver_notify_refresh();
+            task_database_scan_finished(db);
             goto task_finished;
          }
          break;
@@ -1281,6 +1815,21 @@ task_finished:
 
    if (dbstate)
    {
+#ifdef HAVE_THREADS
+      database_scan_pipeline_free(dbstate->pipeline);
+#endif
+      if (dbstate->cache)
+      {
+         database_scan_cache_write(dbstate->cache);
+         database_scan_cache_free(dbstate->cache);
+      }
+      if (dbstate->index)
+      {
+         size_t i;
+         for (i = 0; i < dbstate->list->size; i++)
+            database_index_free(dbstate->index[i]);
+         free(dbstate->index);
+      }
       if (dbstate->list)
          dir_list_free(dbstate->list);
    }
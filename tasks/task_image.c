@@ -19,13 +19,18 @@
 #include <errno.h>
 
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
 #include <compat/strl.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 
+#include "../configuration.h"
 #include "../gfx/video_driver.h"
 #include "../file_path_special.h"
+#ifdef HAVE_MENU
+#include "../menu/menu_thumbnail_cache.h"
+#endif
 #include "../verbosity.h"
 
 #include "tasks_internal.h"
@@ -45,10 +50,14 @@ struct nbio_image_handle
    bool is_blocking;
    bool is_blocking_on_processing;
    bool is_finished;
+   bool cache_checked;
    int processing_final_state;
    unsigned processing_pos_increment;
    unsigned pos_increment;
+   unsigned max_width;
+   unsigned max_height;
    size_t size;
+   char *cache_dir;
    void *handle;
    transfer_cb_t  cb;
    struct texture_image ti;
@@ -157,6 +166,10 @@ static void task_image_cleanup(nbio_handle_t *nbio)
 
       image->handle                 = NULL;
       image->cb                     = NULL;
+
+      if (image->cache_dir)
+         free(image->cache_dir);
+      image->cache_dir              = NULL;
    }
    if (!string_is_empty(nbio->path))
       free(nbio->path);
@@ -270,6 +283,16 @@ bool task_image_load_handler(retro_task_t *task)
    {
       struct texture_image *img = (struct texture_image*)malloc(sizeof(struct texture_image));
 
+#ifdef HAVE_MENU
+      if (image->max_width && image->max_height)
+      {
+         menu_thumbnail_downscale(&image->ti,
+               image->max_width, image->max_height);
+         menu_thumbnail_cache_store(image->cache_dir, nbio->path,
+               image->max_width, image->max_height, &image->ti);
+      }
+#endif
+
       if (img)
       {
          img->width         = image->ti.width;
@@ -286,7 +309,46 @@ bool task_image_load_handler(retro_task_t *task)
    return true;
 }
 
-bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *user_data)
+#ifdef HAVE_MENU
+static void task_image_thumbnail_load_handler(retro_task_t *task)
+{
+   nbio_handle_t            *nbio  = (nbio_handle_t*)task->state;
+   struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+
+   /* Try the thumbnail cache before the file is even opened,
+    * a hit skips reading and decoding the source entirely. */
+   if (image && !image->cache_checked)
+   {
+      struct texture_image ti;
+
+      image->cache_checked = true;
+
+      /* Same pixel order the decoder would have produced. */
+      if (menu_thumbnail_cache_load(image->cache_dir, nbio->path,
+               image->max_width, image->max_height,
+               image->ti.supports_rgba, &ti))
+      {
+         struct texture_image *img = (struct texture_image*)
+            malloc(sizeof(struct texture_image));
+
+         if (img)
+            *img = ti;
+         else
+            image_texture_free(&ti);
+
+         task_set_data(task, img);
+         task_set_finished(task, true);
+         return;
+      }
+   }
+
+   task_file_load_handler(task);
+}
+#endif
+
+static bool task_push_image_load_internal(const char *fullpath,
+      unsigned max_width, unsigned max_height,
+      retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
    struct nbio_image_handle   *image = NULL;
@@ -323,10 +385,14 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
    image->is_blocking                = false;
    image->is_blocking_on_processing  = false;
    image->is_finished                = false;
+   image->cache_checked              = false;
    image->processing_final_state     = 0;
    image->processing_pos_increment   = 0;
    image->pos_increment              = 0;
+   image->max_width                  = max_width;
+   image->max_height                 = max_height;
    image->size                       = 0;
+   image->cache_dir                  = NULL;
    image->handle                     = NULL;
 
    image->ti.width                   = 0;
@@ -360,6 +426,18 @@ bool task_push_image_load(const char *fullpath, retro_task_callback_t cb, void *
 
    t->state           = nbio;
    t->handler         = task_file_load_handler;
+
+#ifdef HAVE_MENU
+   if (max_width && max_height)
+   {
+      settings_t *settings = config_get_ptr();
+
+      if (!string_is_empty(settings->paths.directory_cache))
+         image->cache_dir = strdup(settings->paths.directory_cache);
+
+      t->handler      = task_image_thumbnail_load_handler;
+   }
+#endif
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
@@ -384,3 +462,19 @@ error_msg:
 
    return false;
 }
+
+bool task_push_image_load(const char *fullpath,
+      retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_internal(fullpath, 0, 0, cb, user_data);
+}
+
+#ifdef HAVE_MENU
+bool task_push_image_load_thumbnail(const char *fullpath,
+      unsigned max_width, unsigned max_height,
+      retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_internal(fullpath,
+         max_width, max_height, cb, user_data);
+}
+#endif
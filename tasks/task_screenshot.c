@@ -29,18 +29,25 @@
 #include <file/file_path.h>
 #include <compat/strl.h>
 #include <string/stdstring.h>
+#include <streams/file_stream.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
+#include <formats/rqoi.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #ifdef HAVE_RBMP
 #include <formats/rbmp.h>
 #endif
 
+#ifdef HAVE_RTGA
+#include <formats/rtga.h>
+#endif
+
 #ifdef HAVE_RPNG
 #include <formats/rpng.h>
-#define IMG_EXT "png"
-#else
-#define IMG_EXT "bmp"
 #endif
 
 #include "../defaults.h"
@@ -54,58 +61,284 @@
 
 #include "tasks_internal.h"
 
+/* Screenshots still being converted or written. Each one
+ * holds a copy of its frame, so this bounds the memory
+ * a burst of screenshot hotkey presses can take. */
+#define SCREENSHOT_MAX_IN_FLIGHT 8
+
+enum screenshot_format
+{
+   SCREENSHOT_FORMAT_PNG = 0,
+   SCREENSHOT_FORMAT_BMP,
+   SCREENSHOT_FORMAT_TGA,
+   SCREENSHOT_FORMAT_QOI
+};
+
 typedef struct screenshot_task_state screenshot_task_state_t;
 
 struct screenshot_task_state
 {
    bool bgr24;
+   bool bottom_up;
    bool silence;
    bool is_idle;
    bool is_paused;
    bool history_list_enable;
-   int pitch;
+   bool ret;
+   enum screenshot_format format;
+   unsigned pitch;
    unsigned width;
    unsigned height;
    unsigned pixel_format_type;
-   uint8_t *out_buffer;
-   const void *frame;
+   unsigned id;
+   size_t frame_size;
+   uint8_t *frame;
    char filename[PATH_MAX_LENGTH];
    char shotname[256];
    void *userbuf;
    struct scaler_ctx scaler;
+#ifdef HAVE_THREADS
+   bool done;
+   sthread_t *thread;
+#endif
+};
+
+struct screenshot_buffer
+{
+   uint8_t *data;
+   size_t size;
 };
 
+/* Frame copies are recycled, so repeated screenshots do not
+ * hit the allocator on the main thread. */
+static struct screenshot_buffer screenshot_pool[SCREENSHOT_MAX_IN_FLIGHT];
+static unsigned screenshot_pool_count;
+static unsigned screenshot_in_flight;
+/* Set by screenshot_deinit while screenshots are still being
+ * written; the last one to finish frees the lock. */
+static bool screenshot_deinit_pending;
+static unsigned screenshot_count;
+static char screenshot_last_name[256];
+static unsigned screenshot_name_index;
+
+#ifdef HAVE_THREADS
+static slock_t *screenshot_lock;
+#define SCREENSHOT_LOCK() slock_lock(screenshot_lock)
+#define SCREENSHOT_UNLOCK() slock_unlock(screenshot_lock)
+#else
+#define SCREENSHOT_LOCK()
+#define SCREENSHOT_UNLOCK()
+#endif
+
+static const char *screenshot_format_ext(enum screenshot_format format)
+{
+   switch (format)
+   {
+      case SCREENSHOT_FORMAT_BMP:
+         return "bmp";
+      case SCREENSHOT_FORMAT_TGA:
+         return "tga";
+      case SCREENSHOT_FORMAT_QOI:
+         return "qoi";
+      case SCREENSHOT_FORMAT_PNG:
+      default:
+         break;
+   }
+
+   return "png";
+}
+
+static enum screenshot_format screenshot_get_format(const char *name)
+{
+   if (string_is_equal(name, "qoi"))
+      return SCREENSHOT_FORMAT_QOI;
+#ifdef HAVE_RTGA
+   if (string_is_equal(name, "tga"))
+      return SCREENSHOT_FORMAT_TGA;
+#endif
+#ifdef HAVE_RBMP
+   if (string_is_equal(name, "bmp"))
+      return SCREENSHOT_FORMAT_BMP;
+#endif
+
+#if defined(HAVE_RPNG)
+   return SCREENSHOT_FORMAT_PNG;
+#elif defined(HAVE_RBMP)
+   return SCREENSHOT_FORMAT_BMP;
+#else
+   return SCREENSHOT_FORMAT_QOI;
+#endif
+}
+
 /**
- * task_screenshot_handler:
- * @task : the task being worked on
+ * screenshot_buffer_acquire:
+ * @state              : screenshot the buffer is for.
+ * @size               : number of bytes needed.
  *
- * Saves a screenshot to disk.
+ * Hands out a recycled frame buffer of at least @size bytes.
+ *
+ * Returns: false (0) if too many screenshots are in flight
+ * or memory could not be allocated.
  **/
-static void task_screenshot_handler(retro_task_t *task)
+static bool screenshot_buffer_acquire(screenshot_task_state_t *state,
+      size_t size)
 {
-#ifdef HAVE_RBMP
-   enum rbmp_source_type bmp_type = RBMP_SOURCE_TYPE_DONT_CARE;
+   struct screenshot_buffer buf;
+
+#ifdef HAVE_THREADS
+   if (!screenshot_lock)
+      screenshot_lock = slock_new();
 #endif
-   screenshot_task_state_t *state = (screenshot_task_state_t*)task->state;
-   struct scaler_ctx *scaler      = (struct scaler_ctx*)&state->scaler;
-   bool ret                       = false;
 
-   if (task_get_progress(task) == 100)
+   SCREENSHOT_LOCK();
+
+   if (screenshot_in_flight >= SCREENSHOT_MAX_IN_FLIGHT)
    {
-      task_set_finished(task, true);
+      SCREENSHOT_UNLOCK();
+      return false;
+   }
 
-      if (state->userbuf)
-         free(state->userbuf);
+   screenshot_deinit_pending = false;
+   screenshot_in_flight++;
+   state->id = screenshot_count++;
 
-      free(state);
+   buf.data = NULL;
+   buf.size = 0;
+
+   if (screenshot_pool_count)
+      buf = screenshot_pool[--screenshot_pool_count];
+
+   SCREENSHOT_UNLOCK();
+
+   if (buf.size < size)
+   {
+      uint8_t *data = (uint8_t*)realloc(buf.data, size);
+
+      if (!data)
+      {
+         free(buf.data);
+
+         SCREENSHOT_LOCK();
+         screenshot_in_flight--;
+         SCREENSHOT_UNLOCK();
+         return false;
+      }
+
+      buf.data = data;
+      buf.size = size;
+   }
+
+   state->frame      = buf.data;
+   state->frame_size = buf.size;
+
+   return true;
+}
+
+static void screenshot_buffer_release(screenshot_task_state_t *state)
+{
+   bool last = false;
+
+   SCREENSHOT_LOCK();
+
+   if (screenshot_deinit_pending)
+      free(state->frame);
+   else if (state->frame)
+   {
+      screenshot_pool[screenshot_pool_count].data = state->frame;
+      screenshot_pool[screenshot_pool_count].size = state->frame_size;
+      screenshot_pool_count++;
+   }
+
+   screenshot_in_flight--;
+   last = screenshot_deinit_pending && !screenshot_in_flight;
+
+   SCREENSHOT_UNLOCK();
+
+   state->frame      = NULL;
+   state->frame_size = 0;
+
+#ifdef HAVE_THREADS
+   /* The writer thread has been joined by now, so nothing
+    * else can be holding the lock. */
+   if (last)
+   {
+      slock_free(screenshot_lock);
+      screenshot_lock           = NULL;
+      screenshot_deinit_pending = false;
+   }
+#endif
+   (void)last;
+}
+
+/**
+ * screenshot_deinit:
+ *
+ * Frees the recycled frame buffers. If screenshots are still
+ * being written, their frames and the lock are freed by the
+ * last one to finish instead.
+ **/
+void screenshot_deinit(void)
+{
+   unsigned i;
+   bool in_flight = false;
+
+#ifdef HAVE_THREADS
+   if (!screenshot_lock)
       return;
+#endif
+
+   SCREENSHOT_LOCK();
+
+   for (i = 0; i < screenshot_pool_count; i++)
+   {
+      free(screenshot_pool[i].data);
+      screenshot_pool[i].data = NULL;
+      screenshot_pool[i].size = 0;
    }
 
-#ifdef HAVE_RBMP
-    (void)bmp_type;
+   screenshot_pool_count     = 0;
+   in_flight                 = screenshot_in_flight > 0;
+   screenshot_deinit_pending = in_flight;
+
+   SCREENSHOT_UNLOCK();
+
+#ifdef HAVE_THREADS
+   if (!in_flight)
+   {
+      slock_free(screenshot_lock);
+      screenshot_lock = NULL;
+   }
 #endif
+   (void)in_flight;
+}
+
+/**
+ * screenshot_encode:
+ * @state              : screenshot to write.
+ *
+ * Converts the captured frame to BGR24 and writes it in the
+ * requested format. Only touches @state, so it can run on
+ * any thread.
+ *
+ * Returns: true (1) if the image was written, otherwise false (0).
+ **/
+static bool screenshot_encode(screenshot_task_state_t *state)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   char tmp_ext[32];
+   const uint8_t *in         = state->frame;
+   int in_pitch              = (int)state->pitch;
+   unsigned out_pitch        = state->width * 3;
+   struct scaler_ctx *scaler = &state->scaler;
+   uint8_t *out              = NULL;
+   bool ret                  = false;
+   /* BMP is the only format here that stores rows bottom-up. */
+   bool want_bottom_up       = (state->format == SCREENSHOT_FORMAT_BMP);
+
+   out = (uint8_t*)malloc(out_pitch * state->height);
+   if (!out)
+      return false;
 
-#if defined(HAVE_RPNG)
    if (state->bgr24)
       scaler->in_fmt   = SCALER_FMT_BGR24;
    else if (state->pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888)
@@ -113,38 +346,120 @@ static void task_screenshot_handler(retro_task_t *task)
    else
       scaler->in_fmt   = SCALER_FMT_RGB565;
 
-   video_frame_convert_to_bgr24(
-         scaler,
-         state->out_buffer,
-         (const uint8_t*)state->frame + ((int)state->height - 1)
-         * state->pitch,
-         state->width, state->height,
-         -state->pitch);
-
-   scaler_ctx_gen_reset(&state->scaler);
-
-   ret = rpng_save_image_bgr24(
-         state->filename,
-         state->out_buffer,
-         state->width,
-         state->height,
-         state->width * 3
-         );
-
-   free(state->out_buffer);
-#elif defined(HAVE_RBMP)
-   if (state->bgr24)
-      bmp_type = RBMP_SOURCE_TYPE_BGR24;
-   else if (state->pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888)
-      bmp_type = RBMP_SOURCE_TYPE_XRGB888;
-
-   ret = rbmp_save_image(state->filename,
-         state->frame,
-         state->width,
-         state->height,
-         state->pitch,
-         bmp_type);
+   if (state->bottom_up != want_bottom_up)
+   {
+      in       += (state->height - 1) * state->pitch;
+      in_pitch  = -in_pitch;
+   }
+
+   video_frame_convert_to_bgr24(scaler, out, in,
+         state->width, state->height, in_pitch);
+
+   scaler_ctx_gen_reset(scaler);
+
+   /* Encode next to the target and rename when done, so
+    * nothing ever sees a half written screenshot and
+    * screenshots with the same name cannot interleave. */
+   snprintf(tmp_ext, sizeof(tmp_ext), ".%u.tmp", state->id);
+   strlcpy(tmp_path, state->filename, sizeof(tmp_path));
+   strlcat(tmp_path, tmp_ext, sizeof(tmp_path));
+
+   switch (state->format)
+   {
+      case SCREENSHOT_FORMAT_PNG:
+#ifdef HAVE_RPNG
+         ret = rpng_save_image_bgr24(tmp_path, out,
+               state->width, state->height, out_pitch);
+#endif
+         break;
+      case SCREENSHOT_FORMAT_BMP:
+#ifdef HAVE_RBMP
+         ret = rbmp_save_image(tmp_path, out,
+               state->width, state->height, out_pitch,
+               RBMP_SOURCE_TYPE_BGR24);
+#endif
+         break;
+      case SCREENSHOT_FORMAT_TGA:
+#ifdef HAVE_RTGA
+         ret = rtga_save_image_bgr24(tmp_path, out,
+               state->width, state->height, out_pitch);
+#endif
+         break;
+      case SCREENSHOT_FORMAT_QOI:
+         ret = rqoi_save_image_bgr24(tmp_path, out,
+               state->width, state->height, out_pitch);
+         break;
+   }
+
+   free(out);
+
+   if (ret && filestream_rename(tmp_path, state->filename) != 0)
+   {
+      /* Some platforms refuse to rename over an existing file. */
+      filestream_delete(state->filename);
+      ret = filestream_rename(tmp_path, state->filename) == 0;
+   }
+
+   if (!ret)
+      filestream_delete(tmp_path);
+
+   return ret;
+}
+
+#ifdef HAVE_THREADS
+static void screenshot_thread(void *data)
+{
+   screenshot_task_state_t *state = (screenshot_task_state_t*)data;
+   bool ret                       = screenshot_encode(state);
+
+   SCREENSHOT_LOCK();
+   state->ret  = ret;
+   state->done = true;
+   SCREENSHOT_UNLOCK();
+}
+#endif
+
+static void screenshot_state_free(screenshot_task_state_t *state)
+{
+   screenshot_buffer_release(state);
+
+   if (state->userbuf)
+      free(state->userbuf);
+
+   free(state);
+}
+
+/**
+ * task_screenshot_handler:
+ * @task : the task being worked on
+ *
+ * Waits for the screenshot to be written (or writes it
+ * when threads are unavailable) and reports the result.
+ **/
+static void task_screenshot_handler(retro_task_t *task)
+{
+   screenshot_task_state_t *state = (screenshot_task_state_t*)task->state;
+   bool ret                       = false;
+
+#ifdef HAVE_THREADS
+   if (state->thread)
+   {
+      bool done;
+
+      SCREENSHOT_LOCK();
+      done = state->done;
+      ret  = state->ret;
+      SCREENSHOT_UNLOCK();
+
+      if (!done)
+         return;
+
+      sthread_join(state->thread);
+      state->thread = NULL;
+   }
+   else
 #endif
+      ret = screenshot_encode(state);
 
 #ifdef HAVE_IMAGEVIEWER
    if (  ret                        &&
@@ -159,33 +474,62 @@ static void task_screenshot_handler(retro_task_t *task)
             "imageviewer");
 #endif
 
-   task_set_progress(task, 100);
-
    if (!ret)
    {
       char *msg = strdup(msg_hash_to_str(MSG_FAILED_TO_TAKE_SCREENSHOT));
       runloop_msg_queue_push(msg, 1, state->is_paused ? 1 : 180, true);
       free(msg);
    }
+
+   task_set_progress(task, 100);
+   task_set_finished(task, true);
+
+   screenshot_state_free(state);
+   task->state = NULL;
 }
 
-/* Take frame bottom-up. */
+/* Names automatically generated within the same second
+ * would collide, so number them. */
+static void screenshot_dated_filename(char *s, const char *name_base,
+      const char *ext, size_t len)
+{
+   char name[256];
+   char suffix[16];
+
+   fill_str_dated_filename(name, name_base, ext, sizeof(name));
+
+   if (!string_is_equal(name, screenshot_last_name))
+   {
+      strlcpy(screenshot_last_name, name, sizeof(screenshot_last_name));
+      screenshot_name_index = 0;
+      strlcpy(s, name, len);
+      return;
+   }
+
+   path_remove_extension(name);
+   snprintf(suffix, sizeof(suffix), "-%u.", ++screenshot_name_index);
+   strlcpy(s, name, len);
+   strlcat(s, suffix, len);
+   strlcat(s, ext, len);
+}
+
+/**
+ * screenshot_dump:
+ *
+ * Queues a captured frame for conversion and writing. The
+ * frame in @state->frame is either bottom-up BGR24 read back
+ * from the viewport or a top-down copy of the core's frame.
+ **/
 static bool screenshot_dump(
       const char *name_base,
-      const void *frame,
-      unsigned width,
-      unsigned height,
-      int pitch, bool bgr24,
-      void *userbuf, bool savestate,
+      screenshot_task_state_t *state,
+      bool savestate,
       bool is_idle,
       bool is_paused)
 {
    char screenshot_path[PATH_MAX_LENGTH];
-   uint8_t *buf                   = NULL;
    settings_t *settings           = config_get_ptr();
-   retro_task_t *task             = (retro_task_t*)calloc(1, sizeof(*task));
-   screenshot_task_state_t *state = (screenshot_task_state_t*)
-         calloc(1, sizeof(*state));
+   retro_task_t *task             = NULL;
    const char *screenshot_dir     = settings->paths.directory_screenshot;
 
    screenshot_path[0]             = '\0';
@@ -199,45 +543,49 @@ static bool screenshot_dump(
 
    state->is_idle             = is_idle;
    state->is_paused           = is_paused;
-   state->bgr24               = bgr24;
-   state->height              = height;
-   state->width               = width;
-   state->pitch               = pitch;
-   state->frame               = frame;
-   state->userbuf             = userbuf;
    state->silence             = savestate;
    state->history_list_enable = settings->bools.history_list_enable;
-   state->pixel_format_type   = video_driver_get_pixel_format();
 
    if (savestate)
-      snprintf(state->filename,
-            sizeof(state->filename), "%s.png", name_base);
+   {
+      /* Menus look for savestate thumbnails as PNG, but not
+       * every build can write one; name the file after the
+       * format actually used. */
+      state->format = screenshot_get_format("png");
+      snprintf(state->filename, sizeof(state->filename), "%s.%s",
+            name_base, screenshot_format_ext(state->format));
+   }
    else
    {
+      const char *ext = NULL;
+
+      state->format   = screenshot_get_format(
+            settings->arrays.screenshot_format);
+      ext             = screenshot_format_ext(state->format);
+
       if (settings->bools.auto_screenshot_filename)
-         fill_str_dated_filename(state->shotname, path_basename(name_base),
-               IMG_EXT, sizeof(state->shotname));
+         screenshot_dated_filename(state->shotname, path_basename(name_base),
+               ext, sizeof(state->shotname));
       else
          snprintf(state->shotname, sizeof(state->shotname),
-               "%s.png", path_basename(name_base));
+               "%s.%s", path_basename(name_base), ext);
 
       fill_pathname_join(state->filename, screenshot_dir,
             state->shotname, sizeof(state->filename));
    }
 
-#if defined(HAVE_RPNG)
-   buf = (uint8_t*)malloc(width * height * 3);
-   if (!buf)
-   {
-      if (task)
-         free(task);
-      free(state);
+   task = (retro_task_t*)calloc(1, sizeof(*task));
+   if (!task)
       return false;
-   }
-   state->out_buffer = buf;
+
+#ifdef HAVE_THREADS
+   /* Start converting right away; the task only waits for
+    * the result, so the main thread never encodes. */
+   state->done       = false;
+   state->thread     = sthread_create(screenshot_thread, state);
 #endif
 
-   task->type        = TASK_TYPE_BLOCKING;
+   task->type        = TASK_TYPE_NONE;
    task->state       = state;
    task->handler     = task_screenshot_handler;
 
@@ -249,13 +597,23 @@ static bool screenshot_dump(
    return true;
 }
 
+static screenshot_task_state_t *screenshot_state_new(void)
+{
+   screenshot_task_state_t *state = (screenshot_task_state_t*)
+      calloc(1, sizeof(*state));
+
+   if (state)
+      state->pixel_format_type = video_driver_get_pixel_format();
+
+   return state;
+}
+
 #if !defined(VITA)
 static bool take_screenshot_viewport(const char *name_base, bool savestate,
       bool is_idle, bool is_paused)
 {
    struct video_viewport vp;
-   uint8_t *buffer                       = NULL;
-   bool retval                           = false;
+   screenshot_task_state_t *state        = NULL;
 
    vp.x                                  = 0;
    vp.y                                  = 0;
@@ -269,26 +627,35 @@ static bool take_screenshot_viewport(const char *name_base, bool savestate,
    if (!vp.width || !vp.height)
       return false;
 
-   buffer = (uint8_t*)malloc(vp.width * vp.height * 3);
+   state = screenshot_state_new();
+   if (!state)
+      return false;
 
-   if (!buffer)
+   if (!screenshot_buffer_acquire(state, vp.width * vp.height * 3))
+   {
+      free(state);
       return false;
+   }
 
-   if (!video_driver_read_viewport(buffer, is_idle))
+   /* The readback itself has to stay on the video thread. */
+   if (!video_driver_read_viewport(state->frame, is_idle))
       goto error;
 
    /* Data read from viewport is in bottom-up order, suitable for BMP. */
-   if (!screenshot_dump(name_base,
-            buffer, vp.width, vp.height,
-            vp.width * 3, true, buffer, savestate, is_idle, is_paused))
+   state->bgr24     = true;
+   state->bottom_up = true;
+   state->width     = vp.width;
+   state->height    = vp.height;
+   state->pitch     = vp.width * 3;
+
+   if (!screenshot_dump(name_base, state, savestate, is_idle, is_paused))
       goto error;
 
    return true;
 
 error:
-   if (buffer)
-      free(buffer);
-   return retval;
+   screenshot_state_free(state);
+   return false;
 }
 #endif
 
@@ -296,19 +663,46 @@ static bool take_screenshot_raw(const char *name_base, void *userbuf,
       bool savestate, bool is_idle, bool is_paused)
 {
    size_t pitch;
-   unsigned width, height;
+   unsigned y, width, height, bpp;
    const void *data                      = NULL;
+   screenshot_task_state_t *state        = NULL;
 
    video_driver_cached_frame_get(&data, &width, &height, &pitch);
 
-   /* Negative pitch is needed as screenshot takes bottom-up,
-    * but we use top-down.
-    */
-   if (!screenshot_dump(name_base,
-         (const uint8_t*)data + (height - 1) * pitch,
-         width, height, (int)(-pitch), false, userbuf, savestate, is_idle, is_paused))
+   if (!data || !width || !height)
+      return false;
+
+   state = screenshot_state_new();
+   if (!state)
       return false;
 
+   bpp = (state->pixel_format_type == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+
+   /* The core may overwrite its frame before the workers get
+    * to it, so copy it, packed, into a pooled buffer. */
+   if (!screenshot_buffer_acquire(state, width * height * bpp))
+   {
+      free(state);
+      return false;
+   }
+
+   for (y = 0; y < height; y++)
+      memcpy(state->frame + y * width * bpp,
+            (const uint8_t*)data + y * pitch, width * bpp);
+
+   state->width     = width;
+   state->height    = height;
+   state->pitch     = width * bpp;
+   state->userbuf   = userbuf;
+
+   if (!screenshot_dump(name_base, state, savestate, is_idle, is_paused))
+   {
+      /* Still owned by the caller on failure. */
+      state->userbuf = NULL;
+      screenshot_state_free(state);
+      return false;
+   }
+
    return true;
 }
 
@@ -124,6 +124,15 @@ bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port);
 bool task_push_image_load(const char *fullpath,
       retro_task_callback_t cb, void *userdata);
 
+#ifdef HAVE_MENU
+/* Like task_push_image_load(), but fits the image into
+ * @max_width x @max_height and keeps the result in the
+ * on-disk thumbnail cache. */
+bool task_push_image_load_thumbnail(const char *fullpath,
+      unsigned max_width, unsigned max_height,
+      retro_task_callback_t cb, void *userdata);
+#endif
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
@@ -225,6 +234,8 @@ bool task_audio_mixer_load_handler(retro_task_t *task);
 
 bool take_screenshot(const char *path, bool silence, bool has_valid_framebuffer);
 
+void screenshot_deinit(void);
+
 bool event_load_save_files(void);
 
 bool event_save_files(void);
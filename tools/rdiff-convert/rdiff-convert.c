@@ -0,0 +1,612 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Converts recordings of the "rdiff" record driver into an
+ * uncompressed AVI (BGR24 video, 16-bit PCM audio), which
+ * any player or encoder can read. To get something smaller:
+ *
+ *   rdiff-convert game.rdiff game.avi
+ *   ffmpeg -i game.avi -c:v libx264 -crf 18 -c:a aac game.mkv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <boolean.h>
+
+#include "../../record/drivers/record_rdiff.h"
+
+#define AVIF_HASINDEX   0x10
+#define AVIIF_KEYFRAME  0x10
+
+/* RIFF sizes are 32-bit. */
+#define AVI_MAX_SIZE    0xfff00000ULL
+
+struct rdiff_info
+{
+   struct rdiff_file_header header;
+   unsigned max_width;
+   unsigned max_height;
+   unsigned video_frames;
+   unsigned keyframes;
+   uint64_t audio_frames;
+   uint64_t audio_chunks;
+   uint64_t payload;
+};
+
+struct avi_index_entry
+{
+   uint32_t id;
+   uint32_t flags;
+   uint32_t offset;
+   uint32_t size;
+};
+
+static uint32_t get_le32(const void *data)
+{
+   const uint8_t *p = (const uint8_t*)data;
+   return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_le16(FILE *file, uint16_t val)
+{
+   fputc(val & 0xff, file);
+   fputc(val >> 8, file);
+}
+
+static void put_le32(FILE *file, uint32_t val)
+{
+   put_le16(file, val & 0xffff);
+   put_le16(file, val >> 16);
+}
+
+static void put_fourcc(FILE *file, const char *fourcc)
+{
+   fwrite(fourcc, 1, 4, file);
+}
+
+static void patch_le32(FILE *file, long pos, uint32_t val)
+{
+   long cur = ftell(file);
+   fseek(file, pos, SEEK_SET);
+   put_le32(file, val);
+   fseek(file, cur, SEEK_SET);
+}
+
+static bool read_chunk(FILE *file, struct rdiff_chunk_header *chunk)
+{
+   uint8_t raw[sizeof(*chunk)];
+
+   if (fread(raw, 1, sizeof(raw), file) != sizeof(raw))
+      return false;
+
+   chunk->type  = get_le32(raw + 0);
+   chunk->size  = get_le32(raw + 4);
+   chunk->info0 = get_le32(raw + 8);
+   chunk->info1 = get_le32(raw + 12);
+   return true;
+}
+
+static bool read_info(FILE *file, struct rdiff_info *info)
+{
+   uint8_t raw[sizeof(struct rdiff_file_header)];
+   struct rdiff_chunk_header chunk;
+
+   memset(info, 0, sizeof(*info));
+
+   if (fread(raw, 1, sizeof(raw), file) != sizeof(raw)
+         || memcmp(raw, RDIFF_MAGIC, 4))
+   {
+      fprintf(stderr, "Not an rdiff recording.\n");
+      return false;
+   }
+
+   memcpy(info->header.magic, raw, 4);
+   info->header.version        = get_le32(raw + 4);
+   info->header.flags          = get_le32(raw + 8);
+   info->header.pix_fmt        = get_le32(raw + 12);
+   info->header.fps_num        = get_le32(raw + 16);
+   info->header.samplerate_num = get_le32(raw + 20);
+   info->header.channels       = get_le32(raw + 24);
+   info->header.aspect_num     = get_le32(raw + 28);
+
+   if (info->header.version != RDIFF_VERSION)
+   {
+      fprintf(stderr, "Unsupported rdiff version %u.\n",
+            info->header.version);
+      return false;
+   }
+
+   if (info->header.pix_fmt > RDIFF_PIX_XRGB8888
+         || info->header.channels != 2 || !info->header.fps_num)
+   {
+      fprintf(stderr, "Unsupported stream parameters.\n");
+      return false;
+   }
+
+   while (read_chunk(file, &chunk))
+   {
+      if (chunk.type == RDIFF_CHUNK_VIDEO)
+      {
+         unsigned width  = chunk.info0 & 0xffff;
+         unsigned height = chunk.info0 >> 16;
+
+         if (width > info->max_width)
+            info->max_width = width;
+         if (height > info->max_height)
+            info->max_height = height;
+         if (chunk.info1 & RDIFF_FRAME_KEY)
+            info->keyframes++;
+         info->video_frames++;
+      }
+      else if (chunk.type == RDIFF_CHUNK_AUDIO)
+      {
+         info->audio_frames += chunk.info0;
+         info->audio_chunks++;
+      }
+
+      info->payload += chunk.size;
+
+      if (fseek(file, chunk.size, SEEK_CUR) != 0)
+         break;
+   }
+
+   return true;
+}
+
+static bool apply_delta(uint8_t *frame, size_t size,
+      const uint8_t *data, size_t data_size, uint32_t flags)
+{
+   size_t pos          = 0;
+   const uint8_t *end  = data + data_size;
+
+   if (flags & RDIFF_FRAME_KEY)
+      memset(frame, 0, size);
+
+   if (flags & RDIFF_FRAME_RAW)
+   {
+      size_t i;
+
+      if (data_size != size)
+         return false;
+      for (i = 0; i < size; i++)
+         frame[i] ^= data[i];
+      return true;
+   }
+
+   while (data < end)
+   {
+      size_t i;
+      size_t vals[2];
+
+      for (i = 0; i < 2; i++)
+      {
+         unsigned shift = 0;
+
+         vals[i] = 0;
+         do
+         {
+            if (data >= end || shift > 35)
+               return false;
+            vals[i] |= (size_t)(*data & 0x7f) << shift;
+            shift   += 7;
+         } while (*data++ & 0x80);
+      }
+
+      pos += vals[0];
+      if (pos > size || vals[1] > size - pos
+            || vals[1] > (size_t)(end - data))
+         return false;
+
+      for (i = 0; i < vals[1]; i++)
+         frame[pos + i] ^= data[i];
+
+      pos  += vals[1];
+      data += vals[1];
+   }
+
+   return true;
+}
+
+/* Converts a packed frame to a bottom-up BGR24 DIB, padded
+ * with black to the size of the largest frame. */
+static void frame_to_dib(uint8_t *dib, unsigned dib_width,
+      unsigned dib_height, const uint8_t *frame, unsigned width,
+      unsigned height, const struct rdiff_file_header *header)
+{
+   unsigned x, y;
+   size_t stride = ((size_t)dib_width * 3 + 3) & ~3;
+   bool big      = (header->flags & RDIFF_FLAG_BIG_ENDIAN) != 0;
+
+   memset(dib, 0, stride * dib_height);
+
+   for (y = 0; y < height; y++)
+   {
+      uint8_t *dst = dib + (dib_height - 1 - y) * stride;
+
+      switch (header->pix_fmt)
+      {
+         case RDIFF_PIX_RGB565:
+            {
+               const uint8_t *src = frame + (size_t)y * width * 2;
+               for (x = 0; x < width; x++, src += 2, dst += 3)
+               {
+                  unsigned v = big ? (src[0] << 8) | src[1]
+                     : src[0] | (src[1] << 8);
+                  unsigned r = (v >> 11) & 0x1f;
+                  unsigned g = (v >>  5) & 0x3f;
+                  unsigned b = (v >>  0) & 0x1f;
+
+                  dst[0] = (b << 3) | (b >> 2);
+                  dst[1] = (g << 2) | (g >> 4);
+                  dst[2] = (r << 3) | (r >> 2);
+               }
+            }
+            break;
+         case RDIFF_PIX_BGR24:
+            memcpy(dst, frame + (size_t)y * width * 3, (size_t)width * 3);
+            break;
+         case RDIFF_PIX_XRGB8888:
+            {
+               const uint8_t *src = frame + (size_t)y * width * 4;
+               for (x = 0; x < width; x++, src += 4, dst += 3)
+               {
+                  dst[0] = big ? src[3] : src[0];
+                  dst[1] = big ? src[2] : src[1];
+                  dst[2] = big ? src[1] : src[2];
+               }
+            }
+            break;
+      }
+   }
+}
+
+static void write_strh(FILE *out, const char *type, uint32_t scale,
+      uint32_t rate, uint32_t length, uint32_t buffer_size,
+      uint32_t sample_size, unsigned width, unsigned height)
+{
+   put_fourcc(out, "strh");
+   put_le32(out, 56);
+   put_fourcc(out, type);
+   put_le32(out, 0);          /* fccHandler */
+   put_le32(out, 0);          /* dwFlags */
+   put_le16(out, 0);          /* wPriority */
+   put_le16(out, 0);          /* wLanguage */
+   put_le32(out, 0);          /* dwInitialFrames */
+   put_le32(out, scale);
+   put_le32(out, rate);
+   put_le32(out, 0);          /* dwStart */
+   put_le32(out, length);
+   put_le32(out, buffer_size);
+   put_le32(out, 0xffffffff); /* dwQuality */
+   put_le32(out, sample_size);
+   put_le16(out, 0);
+   put_le16(out, 0);
+   put_le16(out, width);
+   put_le16(out, height);
+}
+
+static int convert(FILE *in, FILE *out, const struct rdiff_info *info)
+{
+   struct rdiff_chunk_header chunk;
+   long riff_pos, movi_pos, movi_start;
+   unsigned i;
+   size_t index_count      = 0;
+   size_t index_cap        = 0;
+   struct avi_index_entry
+      *index               = NULL;
+   const struct rdiff_file_header
+      *h                   = &info->header;
+   unsigned bpp            = h->pix_fmt == RDIFF_PIX_RGB565 ? 2
+      : h->pix_fmt == RDIFF_PIX_BGR24 ? 3 : 4;
+   uint32_t samplerate     = (h->samplerate_num + 500) / 1000;
+   bool has_audio          = info->audio_frames && samplerate;
+   size_t frame_cap        = (size_t)info->max_width * info->max_height * bpp;
+   size_t dib_size         = (((size_t)info->max_width * 3 + 3) & ~3)
+      * info->max_height;
+   uint8_t *frame          = (uint8_t*)calloc(1, frame_cap + 1);
+   uint8_t *dib            = (uint8_t*)calloc(1, dib_size + 1);
+   uint8_t *payload        = NULL;
+   size_t payload_cap      = 0;
+   unsigned width          = 0;
+   unsigned height         = 0;
+   int ret                 = 1;
+   uint64_t estimate       = (uint64_t)info->video_frames * (dib_size + 24)
+      + info->audio_frames * 4 + info->audio_chunks * 24 + 4096;
+
+   if (!info->video_frames || !info->max_width || !info->max_height)
+   {
+      fprintf(stderr, "Recording contains no video.\n");
+      goto end;
+   }
+
+   if (estimate > AVI_MAX_SIZE)
+   {
+      fprintf(stderr, "Output would exceed the 4 GiB AVI limit.\n");
+      goto end;
+   }
+
+   if (!frame || !dib)
+      goto end;
+
+   put_fourcc(out, "RIFF");
+   riff_pos = ftell(out);
+   put_le32(out, 0);
+   put_fourcc(out, "AVI ");
+
+   put_fourcc(out, "LIST");
+   put_le32(out, 4 + 64 + 124 + (has_audio ? 102 : 0));
+   put_fourcc(out, "hdrl");
+
+   put_fourcc(out, "avih");
+   put_le32(out, 56);
+   put_le32(out, (uint32_t)(1000000000000ULL / h->fps_num));
+   put_le32(out, 0);          /* dwMaxBytesPerSec */
+   put_le32(out, 0);          /* dwPaddingGranularity */
+   put_le32(out, AVIF_HASINDEX);
+   put_le32(out, info->video_frames);
+   put_le32(out, 0);          /* dwInitialFrames */
+   put_le32(out, has_audio ? 2 : 1);
+   put_le32(out, (uint32_t)dib_size);
+   put_le32(out, info->max_width);
+   put_le32(out, info->max_height);
+   for (i = 0; i < 4; i++)
+      put_le32(out, 0);
+
+   put_fourcc(out, "LIST");
+   put_le32(out, 124 - 8);
+   put_fourcc(out, "strl");
+   write_strh(out, "vids", 1000000, h->fps_num, info->video_frames,
+         (uint32_t)dib_size, 0, info->max_width, info->max_height);
+   put_fourcc(out, "strf");
+   put_le32(out, 40);
+   put_le32(out, 40);
+   put_le32(out, info->max_width);
+   put_le32(out, info->max_height);
+   put_le16(out, 1);
+   put_le16(out, 24);
+   put_le32(out, 0);          /* BI_RGB */
+   put_le32(out, (uint32_t)dib_size);
+   for (i = 0; i < 4; i++)
+      put_le32(out, 0);
+
+   if (has_audio)
+   {
+      put_fourcc(out, "LIST");
+      put_le32(out, 102 - 8);
+      put_fourcc(out, "strl");
+      write_strh(out, "auds", 4, samplerate * 4,
+            (uint32_t)info->audio_frames, samplerate, 4, 0, 0);
+      put_fourcc(out, "strf");
+      put_le32(out, 18);
+      put_le16(out, 1);       /* WAVE_FORMAT_PCM */
+      put_le16(out, 2);
+      put_le32(out, samplerate);
+      put_le32(out, samplerate * 4);
+      put_le16(out, 4);
+      put_le16(out, 16);
+      put_le16(out, 0);
+   }
+
+   put_fourcc(out, "LIST");
+   movi_pos   = ftell(out);
+   put_le32(out, 0);
+   movi_start = ftell(out);
+   put_fourcc(out, "movi");
+
+   fseek(in, sizeof(struct rdiff_file_header), SEEK_SET);
+
+   while (read_chunk(in, &chunk))
+   {
+      struct avi_index_entry entry;
+
+      if (chunk.size > payload_cap)
+      {
+         uint8_t *tmp = (uint8_t*)realloc(payload, chunk.size);
+         if (!tmp)
+            goto end;
+         payload     = tmp;
+         payload_cap = chunk.size;
+      }
+
+      if (fread(payload, 1, chunk.size, in) != chunk.size)
+      {
+         fprintf(stderr, "Recording is truncated, stopping early.\n");
+         break;
+      }
+
+      if (chunk.type == RDIFF_CHUNK_VIDEO)
+      {
+         if (!(chunk.info1 & RDIFF_FRAME_DUPE))
+         {
+            width  = chunk.info0 & 0xffff;
+            height = chunk.info0 >> 16;
+
+            if (!apply_delta(frame, (size_t)width * height * bpp,
+                     payload, chunk.size, chunk.info1))
+               fprintf(stderr, "Corrupt frame #%u.\n",
+                     (unsigned)index_count);
+
+            frame_to_dib(dib, info->max_width, info->max_height,
+                  frame, width, height, h);
+         }
+
+         entry.id    = get_le32("00db");
+         entry.flags = AVIIF_KEYFRAME;
+         entry.size  = (uint32_t)dib_size;
+      }
+      else if (chunk.type == RDIFF_CHUNK_AUDIO && has_audio)
+      {
+         if (h->flags & RDIFF_FLAG_BIG_ENDIAN)
+         {
+            size_t j;
+            for (j = 0; j + 1 < chunk.size; j += 2)
+            {
+               uint8_t tmp    = payload[j];
+               payload[j]     = payload[j + 1];
+               payload[j + 1] = tmp;
+            }
+         }
+
+         entry.id    = get_le32("01wb");
+         entry.flags = AVIIF_KEYFRAME;
+         entry.size  = chunk.size;
+      }
+      else
+         continue;
+
+      entry.offset = (uint32_t)(ftell(out) - movi_start);
+
+      put_le32(out, entry.id);
+      put_le32(out, entry.size);
+      if (chunk.type == RDIFF_CHUNK_VIDEO)
+         fwrite(dib, 1, dib_size, out);
+      else
+         fwrite(payload, 1, chunk.size, out);
+      if (entry.size & 1)
+         fputc(0, out);
+
+      if (index_count == index_cap)
+      {
+         size_t cap                  = index_cap ? index_cap * 2 : 1024;
+         struct avi_index_entry *tmp = (struct avi_index_entry*)
+            realloc(index, cap * sizeof(*index));
+         if (!tmp)
+            goto end;
+         index     = tmp;
+         index_cap = cap;
+      }
+      index[index_count++] = entry;
+   }
+
+   patch_le32(out, movi_pos, (uint32_t)(ftell(out) - movi_start));
+
+   put_fourcc(out, "idx1");
+   put_le32(out, (uint32_t)(index_count * 16));
+   for (i = 0; i < index_count; i++)
+   {
+      put_le32(out, index[i].id);
+      put_le32(out, index[i].flags);
+      put_le32(out, index[i].offset);
+      put_le32(out, index[i].size);
+   }
+
+   patch_le32(out, riff_pos, (uint32_t)(ftell(out) - riff_pos - 4));
+
+   ret = ferror(out) ? 1 : 0;
+   if (ret)
+      fprintf(stderr, "Failed to write output.\n");
+
+end:
+   free(index);
+   free(payload);
+   free(dib);
+   free(frame);
+   return ret;
+}
+
+static void print_info(const struct rdiff_info *info)
+{
+   const struct rdiff_file_header *h = &info->header;
+   static const char *formats[]      = { "RGB565", "BGR24", "XRGB8888" };
+   double fps                        = h->fps_num / 1000000.0;
+
+   printf("Pixel format: %s\n", formats[h->pix_fmt]);
+   printf("Size:         %ux%u (largest frame)\n",
+         info->max_width, info->max_height);
+   printf("Aspect ratio: %.4f\n", h->aspect_num / 1000000.0);
+   printf("Frame rate:   %.4f\n", fps);
+   printf("Frames:       %u (%u keyframes), %.2f s\n",
+         info->video_frames, info->keyframes, info->video_frames / fps);
+   printf("Audio:        %.1f Hz, %llu frames\n",
+         h->samplerate_num / 1000.0,
+         (unsigned long long)info->audio_frames);
+   printf("Payload:      %llu bytes\n", (unsigned long long)info->payload);
+}
+
+static void usage(const char *argv0)
+{
+   fprintf(stderr,
+         "Usage: %s [-i] <recording.rdiff> [output.avi]\n"
+         "  -i  Print information about the recording and exit.\n",
+         argv0);
+}
+
+int main(int argc, char *argv[])
+{
+   struct rdiff_info info;
+   int arg;
+   FILE *in             = NULL;
+   FILE *out            = NULL;
+   const char *in_path  = NULL;
+   const char *out_path = NULL;
+   bool info_only       = false;
+   int ret              = 1;
+
+   for (arg = 1; arg < argc; arg++)
+   {
+      if (!strcmp(argv[arg], "-i"))
+         info_only = true;
+      else if (!in_path)
+         in_path   = argv[arg];
+      else if (!out_path)
+         out_path  = argv[arg];
+      else
+      {
+         usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (!in_path || (!info_only && !out_path))
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   in = fopen(in_path, "rb");
+   if (!in)
+   {
+      perror(in_path);
+      return 1;
+   }
+
+   if (!read_info(in, &info))
+      goto end;
+
+   if (info_only)
+   {
+      print_info(&info);
+      ret = 0;
+      goto end;
+   }
+
+   out = fopen(out_path, "wb");
+   if (!out)
+   {
+      perror(out_path);
+      goto end;
+   }
+
+   ret = convert(in, out, &info);
+
+end:
+   if (out)
+      fclose(out);
+   fclose(in);
+   return ret;
+}
@@ -0,0 +1,313 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2017 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Compiles every pass of a .slangp preset to SPIR-V and runs
+ * reflection on it, without creating any GPU context. Useful
+ * for validating presets and for exercising the shader cache. */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+#include <file/config_file.h>
+#include <file/file_path.h>
+#include <lists/string_list.h>
+#include <string/stdstring.h>
+
+#include "../../gfx/drivers_shader/glslang_util.h"
+#include "../../gfx/drivers_shader/slang_cache.h"
+#include "../../gfx/drivers_shader/slang_reflection.h"
+#include "../../verbosity.h"
+
+using namespace std;
+
+static bool verbose = false;
+
+void RARCH_LOG(const char *fmt, ...)
+{
+   va_list ap;
+
+   if (!verbose)
+      return;
+
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+void RARCH_WARN(const char *fmt, ...)
+{
+   va_list ap;
+
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+static void usage(const char *argv0)
+{
+   fprintf(stderr,
+         "Usage: %s [-v] [-s] [-c <cache dir>] <preset.slangp | shader.slang>\n"
+         "  -c  Directory holding the SPIR-V cache (\"slang\" subdirectory).\n"
+         "  -s  Compile passes one after another instead of concurrently.\n"
+         "  -v  Verbose logging.\n", argv0);
+}
+
+struct preset_pass
+{
+   string path;
+   string alias;
+   glslang_output output;
+};
+
+static bool load_preset(const char *path, vector<preset_pass> *passes,
+      vector<string> *luts)
+{
+   int i;
+   int shaders          = 0;
+   char textures[4096];
+   config_file_t *conf  = NULL;
+
+   if (string_is_equal(path_get_extension(path), "slang"))
+   {
+      preset_pass pass;
+      pass.path = path;
+      passes->push_back(pass);
+      return true;
+   }
+
+   conf = config_file_new(path);
+
+   if (!conf)
+   {
+      fprintf(stderr, "Cannot open preset \"%s\".\n", path);
+      return false;
+   }
+
+   if (!config_get_int(conf, "shaders", &shaders) || shaders < 1)
+   {
+      fprintf(stderr, "Preset \"%s\" has no passes.\n", path);
+      config_file_free(conf);
+      return false;
+   }
+
+   for (i = 0; i < shaders; i++)
+   {
+      char key[64];
+      char value[PATH_MAX_LENGTH];
+      char resolved[PATH_MAX_LENGTH];
+      preset_pass pass;
+
+      snprintf(key, sizeof(key), "shader%d", i);
+      if (!config_get_path(conf, key, value, sizeof(value)))
+      {
+         fprintf(stderr, "Preset is missing \"%s\".\n", key);
+         config_file_free(conf);
+         return false;
+      }
+
+      fill_pathname_resolve_relative(resolved, path, value, sizeof(resolved));
+      pass.path = resolved;
+
+      snprintf(key, sizeof(key), "alias%d", i);
+      if (config_get_array(conf, key, value, sizeof(value)))
+         pass.alias = value;
+
+      passes->push_back(pass);
+   }
+
+   if (config_get_array(conf, "textures", textures, sizeof(textures)))
+   {
+      unsigned j;
+      struct string_list *list = string_split(textures, ";");
+
+      for (j = 0; list && j < list->size; j++)
+         luts->push_back(list->elems[j].data);
+
+      string_list_free(list);
+   }
+
+   config_file_free(conf);
+   return true;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   unordered_map<string, slang_texture_semantic_map> texture_map;
+   unordered_map<string, slang_texture_semantic_map> texture_uniform_map;
+   vector<preset_pass> passes;
+   vector<string> luts;
+   unsigned hits           = 0;
+   unsigned misses         = 0;
+   const char *preset      = NULL;
+   const char *cache_dir   = NULL;
+   bool serial             = false;
+   retro_time_t total_time = 0;
+   retro_time_t start;
+   int arg;
+
+   for (arg = 1; arg < argc; arg++)
+   {
+      if (string_is_equal(argv[arg], "-v"))
+         verbose = true;
+      else if (string_is_equal(argv[arg], "-s"))
+         serial  = true;
+      else if (string_is_equal(argv[arg], "-c") && arg + 1 < argc)
+         cache_dir = argv[++arg];
+      else if (!preset && argv[arg][0] != '-')
+         preset = argv[arg];
+      else
+      {
+         usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (!preset)
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   slang_cache_set_directory(cache_dir);
+
+   if (!load_preset(preset, &passes, &luts))
+      return 1;
+
+   start = cpu_features_get_time_usec();
+
+   if (serial)
+   {
+      for (i = 0; i < passes.size(); i++)
+      {
+         if (!glslang_compile_shader(passes[i].path.c_str(),
+                  &passes[i].output))
+         {
+            fprintf(stderr, "Pass #%u: failed to compile \"%s\".\n",
+                  i, passes[i].path.c_str());
+            return 1;
+         }
+      }
+   }
+   else
+   {
+      vector<const char*> paths;
+      vector<glslang_output> outputs(passes.size());
+
+      for (i = 0; i < passes.size(); i++)
+         paths.push_back(passes[i].path.c_str());
+
+      if (!glslang_compile_shaders(paths.data(), outputs.data(),
+               (unsigned)passes.size()))
+         return 1;
+
+      for (i = 0; i < passes.size(); i++)
+         passes[i].output = outputs[i];
+   }
+
+   total_time = cpu_features_get_time_usec() - start;
+
+   for (i = 0; i < passes.size(); i++)
+   {
+      if (passes[i].alias.empty())
+         passes[i].alias = passes[i].output.meta.name;
+
+      printf("Pass #%u: %s (%u + %u SPIR-V words)\n", i,
+            path_basename(passes[i].path.c_str()),
+            (unsigned)passes[i].output.vertex.size(),
+            (unsigned)passes[i].output.fragment.size());
+   }
+
+   /* Same aliasing rules as the filter chains. */
+   for (i = 0; i < passes.size(); i++)
+   {
+      const string &name = passes[i].alias;
+
+      if (name.empty())
+         continue;
+
+      texture_map[name]                          =
+         slang_texture_semantic_map{ SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT, i };
+      texture_uniform_map[name + "Size"]         =
+         slang_texture_semantic_map{ SLANG_TEXTURE_SEMANTIC_PASS_OUTPUT, i };
+      texture_map[name + "Feedback"]             =
+         slang_texture_semantic_map{ SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK, i };
+      texture_uniform_map[name + "FeedbackSize"] =
+         slang_texture_semantic_map{ SLANG_TEXTURE_SEMANTIC_PASS_FEEDBACK, i };
+   }
+
+   for (i = 0; i < luts.size(); i++)
+   {
+      texture_map[luts[i]]                  =
+         slang_texture_semantic_map{ SLANG_TEXTURE_SEMANTIC_USER, i };
+      texture_uniform_map[luts[i] + "Size"] =
+         slang_texture_semantic_map{ SLANG_TEXTURE_SEMANTIC_USER, i };
+   }
+
+   for (i = 0; i < passes.size(); i++)
+   {
+      unsigned j;
+      slang_reflection reflection;
+      unordered_map<string, slang_semantic_map> semantic_map;
+      const glslang_meta &meta = passes[i].output.meta;
+
+      for (j = 0; j < meta.parameters.size(); j++)
+         semantic_map[meta.parameters[j].id] =
+            slang_semantic_map{ SLANG_SEMANTIC_FLOAT_PARAMETER, j };
+
+      reflection.pass_number                  = i;
+      reflection.texture_semantic_map         = &texture_map;
+      reflection.texture_semantic_uniform_map = &texture_uniform_map;
+      reflection.semantic_map                 = &semantic_map;
+
+      if (!slang_reflect_spirv(passes[i].output.vertex,
+               passes[i].output.fragment, &reflection))
+      {
+         fprintf(stderr, "Pass #%u: reflection failed.\n", i);
+         return 1;
+      }
+
+      printf("Pass #%u: UBO %u bytes, push constants %u bytes, %u parameters\n",
+            i, (unsigned)reflection.ubo_size,
+            (unsigned)reflection.push_constant_size,
+            (unsigned)meta.parameters.size());
+   }
+
+   slang_cache_get_stats(&hits, &misses);
+
+   printf("%u passes compiled in %.2f ms",
+         (unsigned)passes.size(), total_time / 1000.0);
+   if (slang_cache_is_enabled())
+      printf(" (cache: %u hits, %u misses)", hits, misses);
+   printf("\n");
+
+   return 0;
+}